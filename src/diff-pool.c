@@ -0,0 +1,209 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include "diff-pool.h"
+#include "skein-stats.h"
+#include "transcript-diff.h"
+
+/* How often finished diffs are handed back to the main thread, and how many at
+ most each time, so that a flood of results doesn't freeze the UI */
+#define BATCH_INTERVAL_MS 50
+#define BATCH_SIZE 200
+
+/* The worker threads only ever see the two strings and the result; the
+ callback data is only touched in the main thread */
+typedef struct {
+	char *expected;
+	char *actual;
+	gboolean equal;
+	GArray *expected_diffs;
+	GArray *actual_diffs;
+
+	DiffPoolResultFunc callback;
+	gpointer data;
+	GDestroyNotify destroy;
+} DiffJob;
+
+struct _DiffPool {
+	GThreadPool *workers;
+	GAsyncQueue *results;
+	volatile gint cancelled; /* Read by the worker threads */
+
+	/* Main thread only */
+	guint pending; /* Jobs pushed whose results haven't been delivered yet */
+	guint source_id;
+};
+
+static void
+diff_job_free(DiffJob *job)
+{
+	g_free(job->expected);
+	g_free(job->actual);
+	if(job->expected_diffs)
+		g_array_free(job->expected_diffs, TRUE);
+	if(job->actual_diffs)
+		g_array_free(job->actual_diffs, TRUE);
+	if(job->destroy)
+		job->destroy(job->data);
+	g_slice_free(DiffJob, job);
+}
+
+/* Runs in a worker thread; word_diff() keeps a diff context for each thread */
+static void
+run_job(DiffJob *job, DiffPool *pool)
+{
+	if(!g_atomic_int_get(&pool->cancelled)) {
+		gint64 start = skein_stats_start();
+		job->equal = word_diff(job->expected, job->actual, &job->expected_diffs, &job->actual_diffs);
+		skein_stats_stop(SKEIN_STATS_DIFF, start);
+		skein_stats_count(SKEIN_STATS_DIFFS_COMPUTED, 1);
+	}
+
+	/* The texts are no longer needed; free them here rather than in the main
+	 thread */
+	g_free(job->expected);
+	g_free(job->actual);
+	job->expected = job->actual = NULL;
+
+	g_async_queue_push(pool->results, job);
+}
+
+static void
+destroy_pool(DiffPool *pool)
+{
+	if(pool->source_id)
+		g_source_remove(pool->source_id);
+
+	/* Let the workers run through the remaining jobs without diffing them, and
+	 wait for them to finish */
+	g_atomic_int_set(&pool->cancelled, 1);
+	g_thread_pool_free(pool->workers, FALSE, TRUE);
+
+	DiffJob *job;
+	while((job = g_async_queue_try_pop(pool->results)) != NULL)
+		diff_job_free(job);
+	g_async_queue_unref(pool->results);
+
+	g_slice_free(DiffPool, pool);
+}
+
+/* Timeout callback: deliver one batch of finished diffs in the main thread */
+static gboolean
+deliver_results(DiffPool *pool)
+{
+	DiffJob *job;
+	int count;
+
+	for(count = 0; count < BATCH_SIZE; count++) {
+		if((job = g_async_queue_try_pop(pool->results)) == NULL)
+			break;
+		job->callback(job->equal, job->expected_diffs, job->actual_diffs, job->data);
+		job->expected_diffs = job->actual_diffs = NULL; /* callback owns them */
+		diff_job_free(job);
+		pool->pending--;
+	}
+
+	if(pool->pending > 0)
+		return TRUE; /* Call again */
+
+	pool->source_id = 0;
+	return FALSE;
+}
+
+static guint
+get_num_workers(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+	return MAX(g_get_num_processors(), 1);
+#else
+	return 2;
+#endif
+}
+
+/*
+ * diff_pool_new:
+ *
+ * Creates a pool of worker threads, one for each processor, that compare
+ * transcripts with word_diff() in the background.
+ *
+ * Returns: a new #DiffPool.
+ */
+DiffPool *
+diff_pool_new(void)
+{
+	DiffPool *pool = g_slice_new0(DiffPool);
+	pool->results = g_async_queue_new();
+	pool->workers = g_thread_pool_new((GFunc)run_job, pool, get_num_workers(), FALSE, NULL);
+	return pool;
+}
+
+/*
+ * diff_pool_push:
+ * @pool: the pool
+ * @expected: the expected text
+ * @actual: the text that the game produced
+ * @callback: function to call in the main thread with the result
+ * @data: user data for @callback
+ * @destroy: function to free @data with, or %NULL
+ *
+ * Queues two texts to be compared in a worker thread. The texts are copied.
+ * @callback is called from the main loop in a batch with other results; if the
+ * pool is freed before then, only @destroy is called.
+ */
+void
+diff_pool_push(DiffPool *pool, const char *expected, const char *actual, DiffPoolResultFunc callback, gpointer data, GDestroyNotify destroy)
+{
+	DiffJob *job = g_slice_new0(DiffJob);
+	job->expected = g_strdup(expected? expected : "");
+	job->actual = g_strdup(actual? actual : "");
+	job->callback = callback;
+	job->data = data;
+	job->destroy = destroy;
+
+	pool->pending++;
+	if(pool->source_id == 0)
+		pool->source_id = g_timeout_add(BATCH_INTERVAL_MS, (GSourceFunc)deliver_results, pool);
+
+	g_thread_pool_push(pool->workers, job, NULL);
+}
+
+/*
+ * diff_pool_get_pending:
+ * @pool: the pool
+ *
+ * Returns: the number of comparisons whose results have not been delivered
+ * yet.
+ */
+guint
+diff_pool_get_pending(DiffPool *pool)
+{
+	return pool->pending;
+}
+
+/*
+ * diff_pool_free:
+ * @pool: the pool
+ *
+ * Frees the pool immediately, throwing away any results that have not been
+ * delivered yet.
+ */
+void
+diff_pool_free(DiffPool *pool)
+{
+	destroy_pool(pool);
+}
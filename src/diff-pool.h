@@ -0,0 +1,33 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DIFF_POOL_H
+#define DIFF_POOL_H
+
+#include <glib.h>
+
+typedef struct _DiffPool DiffPool;
+
+/* Called in the main thread with the result of word_diff(); takes ownership
+ of the two arrays */
+typedef void (*DiffPoolResultFunc)(gboolean equal, GArray *expected_diffs, GArray *actual_diffs, gpointer data);
+
+DiffPool *diff_pool_new(void);
+void diff_pool_push(DiffPool *pool, const char *expected, const char *actual, DiffPoolResultFunc callback, gpointer data, GDestroyNotify destroy);
+guint diff_pool_get_pending(DiffPool *pool);
+void diff_pool_free(DiffPool *pool);
+
+#endif /* DIFF_POOL_H */
@@ -1,3 +1,5 @@
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <glib.h>
 #include "transcript-diff.h"
@@ -12,8 +14,8 @@ char *actual_different = "This text isn't the same at all.\nGeronimo!\n\n";
 static void
 print_diffs(const char *expected, const char *actual)
 {
-	GList *expected_diffs = NULL;
-	GList *actual_diffs = NULL;
+	GArray *expected_diffs = NULL;
+	GArray *actual_diffs = NULL;
 	char *buf;
 
 	if(word_diff(expected, actual, &expected_diffs, &actual_diffs)) {
@@ -27,11 +29,107 @@ print_diffs(const char *expected, const char *actual)
 	buf = make_pango_markup_string(actual, actual_diffs);
 	g_print(" Actual: '%s'\n", buf);
 	g_free(buf);
+	if(expected_diffs)
+		g_array_free(expected_diffs, TRUE);
+	if(actual_diffs)
+		g_array_free(actual_diffs, TRUE);
+}
+
+static const char *vocabulary[] = {
+	"You", "can't", "see", "any", "such", "thing.", "The", "room", "is",
+	"dark", "and", "a", "lamp", "sits", "on", "table.", "There", "door",
+	"to", "the", "north.", "Taken.", "Dropped.", "I", "only", "understood",
+	"you", "as", "far", "wanting", "go.", ">"
+};
+
+/* Make up a transcript of about @n_words words */
+static char *
+random_transcript(int n_words)
+{
+	GString *text = g_string_new("");
+	int count;
+	for(count = 0; count < n_words; count++) {
+		g_string_append(text, vocabulary[g_random_int_range(0, G_N_ELEMENTS(vocabulary))]);
+		g_string_append_c(text, g_random_int_range(0, 10) == 0? '\n' : ' ');
+	}
+	return g_string_free(text, FALSE);
+}
+
+/* Make a copy of @text that is the same, differs only in whitespace, or has a
+ few words changed, like the transcript of a knot replayed against its blessed
+ transcript */
+static char *
+mutate_transcript(const char *text)
+{
+	switch(g_random_int_range(0, 5)) {
+		case 0:
+			return g_strdup(text);
+		case 1:
+			return g_strconcat(text, "\n\n", NULL);
+		default:
+		{
+			char **words = g_strsplit(text, " ", -1);
+			guint len = g_strv_length(words), count;
+			for(count = 0; count < 3; count++) {
+				guint index = g_random_int_range(0, len);
+				g_free(words[index]);
+				words[index] = g_strdup(vocabulary[g_random_int_range(0, G_N_ELEMENTS(vocabulary))]);
+			}
+			char *retval = g_strjoinv(" ", words);
+			g_strfreev(words);
+			return retval;
+		}
+	}
+}
+
+/* Compare the transcripts of @n_knots made-up knots, as happens when replaying
+ a whole skein, and report the throughput */
+static void
+benchmark(int n_knots)
+{
+	char **expected = g_new(char *, n_knots);
+	char **actual = g_new(char *, n_knots);
+	GArray *expected_diffs, *actual_diffs;
+	GTimer *timer = g_timer_new();
+	double elapsed;
+	int count, different = 0;
+
+	for(count = 0; count < n_knots; count++) {
+		expected[count] = random_transcript(g_random_int_range(10, 200));
+		actual[count] = mutate_transcript(expected[count]);
+	}
+
+	g_timer_start(timer);
+	for(count = 0; count < n_knots; count++) {
+		if(!word_diff(expected[count], actual[count], &expected_diffs, &actual_diffs))
+			different++;
+		if(expected_diffs)
+			g_array_free(expected_diffs, TRUE);
+		if(actual_diffs)
+			g_array_free(actual_diffs, TRUE);
+	}
+	elapsed = g_timer_elapsed(timer, NULL);
+	g_print("Diffed %d knots (%d different) in %.3f s: %.0f knots/s\n",
+		n_knots, different, elapsed, n_knots / elapsed);
+
+	for(count = 0; count < n_knots; count++) {
+		g_free(expected[count]);
+		g_free(actual[count]);
+	}
+	g_free(expected);
+	g_free(actual);
+	g_timer_destroy(timer);
 }
 
 int
 main(int argc, char **argv)
 {
+	/* Run with --benchmark [number of knots] to measure the throughput */
+	if(argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+		benchmark(argc > 2? atoi(argv[2]) : 100000);
+		return 0;
+	}
+
 	g_print("Same:\n");
 	print_diffs(expected_same, actual_same);
 	g_print("Same except whitespace:\n");
@@ -22,13 +22,14 @@
 /*   values of the global variables (in 240x2 = 480 bytes) followed by any   */
 /*   (dynamic) arrays which may be defined.  Owing to a poor choice of name  */
 /*   some years ago, this is also called the "static data area", which is    */
-/*   why the memory setting for its maximum extent is "MAX_STATIC_DATA".     */
+/*   why the memory setting for its initial extent is "MAX_STATIC_DATA".     */
 /*                                                                           */
 /*   In Glulx, that 240 is changed to MAX_GLOBAL_VAR_NUMBER, and we take     */
 /*   correspondingly more space for the globals. This *really* ought to be   */
 /*   split into two segments.                                                */
 /* ------------------------------------------------------------------------- */
 int     *dynamic_array_area;           /* See above                          */
+memory_list dynamic_array_area_memlist;/* (It grows as arrays are defined)   */
 int32   *global_initial_value;
 
 int no_globals;                        /* Number of global variables used
@@ -43,6 +44,8 @@ int dynamic_array_area_size;           /* Size in bytes                      */
 int no_arrays;
 int32   *array_symbols;
 int     *array_sizes, *array_types;
+static memory_list array_symbols_memlist, array_sizes_memlist,
+    array_types_memlist;
 
 static int array_entry_size,           /* 1 for byte array, 2 for word array */
            array_base;                 /* Offset in dynamic array area of the
@@ -60,6 +63,10 @@ extern void finish_array(int32 i)
 {
     /*  Write the array size into the 0th byte/word of the array, if it's
         a "table" or "string" array                                          */
+
+  ensure_memory_list_available(&dynamic_array_area_memlist,
+      dynamic_array_area_size);
+
   if (!glulx_mode) {
 
     if (array_base!=dynamic_array_area_size)
@@ -105,8 +112,8 @@ extern void array_entry(int32 i, assembly_operand VAL)
   if (!glulx_mode) {
     /*  Array entry i (initial entry has i=0) is set to Z-machine value j    */
 
-    if (dynamic_array_area_size+(i+1)*array_entry_size > MAX_STATIC_DATA)
-        memoryerror("MAX_STATIC_DATA", MAX_STATIC_DATA);
+    ensure_memory_list_available(&dynamic_array_area_memlist,
+        dynamic_array_area_size+(i+1)*array_entry_size);
 
     if (array_entry_size==1)
     {   dynamic_array_area[dynamic_array_area_size+i] = (VAL.value)%256;
@@ -131,8 +138,8 @@ extern void array_entry(int32 i, assembly_operand VAL)
   else {
     /*  Array entry i (initial entry has i=0) is set to value j              */
 
-    if (dynamic_array_area_size+(i+1)*array_entry_size > MAX_STATIC_DATA)
-        memoryerror("MAX_STATIC_DATA", MAX_STATIC_DATA);
+    ensure_memory_list_available(&dynamic_array_area_memlist,
+        dynamic_array_area_size+(i+1)*array_entry_size);
 
     if (array_entry_size==1)
     {   dynamic_array_area[dynamic_array_area_size+i] = (VAL.value) & 0xFF;
@@ -241,8 +248,9 @@ extern void make_global(int array_flag, int name_only)
         else
             assign_symbol(i, 
                 dynamic_array_area_size - 4*MAX_GLOBAL_VARIABLES, ARRAY_T);
-        if (no_arrays == MAX_ARRAYS)
-            memoryerror("MAX_ARRAYS", MAX_ARRAYS);
+        ensure_memory_list_available(&array_symbols_memlist, no_arrays+1);
+        ensure_memory_list_available(&array_sizes_memlist, no_arrays+1);
+        ensure_memory_list_available(&array_types_memlist, no_arrays+1);
         array_symbols[no_arrays] = i;
     }
     else
@@ -635,24 +643,29 @@ extern void arrays_begin_pass(void)
     else
         no_globals=11;
     dynamic_array_area_size = WORDSIZE * MAX_GLOBAL_VARIABLES;
+    ensure_memory_list_available(&dynamic_array_area_memlist,
+        dynamic_array_area_size);
 }
 
 extern void arrays_allocate_arrays(void)
-{   dynamic_array_area = my_calloc(sizeof(int), MAX_STATIC_DATA, 
-        "static data");
-    array_sizes = my_calloc(sizeof(int), MAX_ARRAYS, "array sizes");
-    array_types = my_calloc(sizeof(int), MAX_ARRAYS, "array types");
-    array_symbols = my_calloc(sizeof(int32), MAX_ARRAYS, "array symbols");
+{   initialise_memory_list(&dynamic_array_area_memlist,
+        sizeof(int), MAX_STATIC_DATA, &dynamic_array_area, "static data");
+    initialise_memory_list(&array_sizes_memlist,
+        sizeof(int), MAX_ARRAYS, &array_sizes, "array sizes");
+    initialise_memory_list(&array_types_memlist,
+        sizeof(int), MAX_ARRAYS, &array_types, "array types");
+    initialise_memory_list(&array_symbols_memlist,
+        sizeof(int32), MAX_ARRAYS, &array_symbols, "array symbols");
     global_initial_value = my_calloc(sizeof(int32), MAX_GLOBAL_VARIABLES, 
         "global values");
 }
 
 extern void arrays_free_arrays(void)
-{   my_free(&dynamic_array_area, "static data");
+{   deallocate_memory_list(&dynamic_array_area_memlist);
     my_free(&global_initial_value, "global values");
-    my_free(&array_sizes, "array sizes");
-    my_free(&array_types, "array sizes");
-    my_free(&array_symbols, "array sizes");
+    deallocate_memory_list(&array_sizes_memlist);
+    deallocate_memory_list(&array_types_memlist);
+    deallocate_memory_list(&array_symbols_memlist);
 }
 
 /* ========================================================================= */
@@ -13,6 +13,15 @@ uchar *zcode_holding_area;         /* Area holding code yet to be transferred
 uchar *zcode_markers;              /* Bytes holding marker values for this
                                       code                                   */
 static int zcode_ha_size;          /* Number of bytes in holding area        */
+static memory_list zcode_holding_area_memlist, zcode_markers_memlist;
+
+/*  The holding area grows as a routine is assembled.  It must not move
+    while an instruction is being assembled, since pointers into it are
+    kept meanwhile, so room is made for each instruction before it starts:
+    no instruction (except for the text of "print" and "print_ret") takes
+    more than this many bytes                                                */
+
+#define MAX_INSTRUCTION_SIZE (64)
 
 memory_block zcode_area;           /* Block to hold assembled code (if
                                       temporary files are not being used)    */
@@ -80,6 +89,7 @@ static int routine_locals;         /* The number of local variables used by
 static int32 routine_start_pc;
 
 int32 *named_routine_symbols;
+static memory_list named_routine_symbols_memlist;
 
 static void transfer_routine_z(void);
 static void transfer_routine_g(void);
@@ -100,9 +110,25 @@ static debug_location *sequence_point_locations;
                                    /* Source code references for each        */
                                    /* (used for making debugging file)       */
 
+static memory_list label_offsets_memlist, label_next_memlist,
+    label_prev_memlist, label_symbols_memlist,
+    sequence_point_labels_memlist, sequence_point_locations_memlist;
+
+static void ensure_labels_available(int count)
+{   ensure_memory_list_available(&label_offsets_memlist, count);
+    ensure_memory_list_available(&label_next_memlist, count);
+    ensure_memory_list_available(&label_prev_memlist, count);
+    ensure_memory_list_available(&label_symbols_memlist, count);
+}
+
+static void ensure_sequence_points_available(int count)
+{   ensure_memory_list_available(&sequence_point_labels_memlist, count);
+    ensure_memory_list_available(&sequence_point_locations_memlist, count);
+}
+
 static void set_label_offset(int label, int32 offset)
 {
-    if (label >= MAX_LABELS) memoryerror("MAX_LABELS", MAX_LABELS);
+    ensure_labels_available(label+1);
 
     label_offsets[label] = offset;
     if (last_label == -1)
@@ -263,9 +289,13 @@ extern void print_operand(assembly_operand o)
 /*   Writing bytes to the code area                                          */
 /* ------------------------------------------------------------------------- */
 
+static void ensure_holding_area_available(int32 size)
+{   ensure_memory_list_available(&zcode_holding_area_memlist, size);
+    ensure_memory_list_available(&zcode_markers_memlist, size);
+}
+
 static void byteout(int32 i, int mv)
-{   if (zcode_ha_size >= MAX_ZCODE_SIZE)
-        memoryerror("MAX_ZCODE_SIZE",MAX_ZCODE_SIZE);
+{   ensure_holding_area_available(zcode_ha_size+1);
     zcode_markers[zcode_ha_size] = (uchar) mv;
     zcode_holding_area[zcode_ha_size++] = (uchar) i;
     zmachine_pc++;
@@ -782,7 +812,7 @@ static void write_operand(assembly_operand op)
 extern void assemblez_instruction(assembly_instruction *AI)
 {
     uchar *start_pc, *operands_pc;
-    int32 offset, j, topbits, types_byte1, types_byte2;
+    int32 offset, j, topbits, types_byte1, types_byte2, text_length;
     int operand_rules, min, max, no_operands_given, at_seq_point = FALSE;
     assembly_operand o1, o2;
     opcodez opco;
@@ -797,7 +827,8 @@ extern void assemblez_instruction(assembly_instruction *AI)
     if (sequence_point_follows)
     {   sequence_point_follows = FALSE; at_seq_point = TRUE;
         if (debugfile_switch)
-        {   sequence_point_labels[next_sequence_point] = next_label;
+        {   ensure_sequence_points_available(next_sequence_point+1);
+            sequence_point_labels[next_sequence_point] = next_label;
             sequence_point_locations[next_sequence_point] =
                 statement_debug_location;
             set_label_offset(next_label++, zmachine_pc);
@@ -825,6 +856,14 @@ extern void assemblez_instruction(assembly_instruction *AI)
     if ((opco.no == TWO) && ((no_operands_given==3)||(no_operands_given==4)))
         opco.no = VAR;
 
+    /* 0. Make room for the whole instruction, translating any text now to
+          find out how long it is */
+
+    text_length = 0;
+    if (operand_rules==TEXT) text_length = translate_text(-1, AI->text);
+    ensure_holding_area_available
+        (zcode_ha_size + text_length + MAX_INSTRUCTION_SIZE);
+
     /* 1. Write the opcode byte(s) */
 
     start_pc = zcode_holding_area + zcode_ha_size;
@@ -854,10 +893,8 @@ extern void assemblez_instruction(assembly_instruction *AI)
 
     if (operand_rules==TEXT)
     {   int32 i;
-        uchar *tmp = translate_text(zcode_holding_area + zcode_ha_size, zcode_holding_area+MAX_ZCODE_SIZE, AI->text);
-        if (!tmp)
-            memoryerror("MAX_ZCODE_SIZE", MAX_ZCODE_SIZE);
-        j = subtract_pointers(tmp, (zcode_holding_area + zcode_ha_size));
+        j = text_length;
+        memcpy(zcode_holding_area + zcode_ha_size, translated_text, j);
         for (i=0; i<j; i++) zcode_markers[zcode_ha_size++] = 0;
         zmachine_pc += j;
         goto Instruction_Done;
@@ -1100,7 +1137,8 @@ extern void assembleg_instruction(assembly_instruction *AI)
     if (sequence_point_follows)
     {   sequence_point_follows = FALSE; at_seq_point = TRUE;
         if (debugfile_switch)
-        {   sequence_point_labels[next_sequence_point] = next_label;
+        {   ensure_sequence_points_available(next_sequence_point+1);
+            sequence_point_labels[next_sequence_point] = next_label;
             sequence_point_locations[next_sequence_point] =
                 statement_debug_location;
             set_label_offset(next_label++, zmachine_pc);
@@ -1130,6 +1168,10 @@ extern void assembleg_instruction(assembly_instruction *AI)
 
     no_operands_given = AI->operand_count;
 
+    /* 0. Make room for the whole instruction */
+
+    ensure_holding_area_available(zcode_ha_size + MAX_INSTRUCTION_SIZE);
+
     /* 1. Write the opcode byte(s) */
 
     start_pc = zcode_holding_area + zcode_ha_size; 
@@ -1480,6 +1522,8 @@ extern int32 assemble_routine_header(int no_locals,
             }
             else
             {   i = no_named_routines++;
+                ensure_memory_list_available(&named_routine_symbols_memlist,
+                    no_named_routines);
                   named_routine_symbols[i] = the_symbol;
                 CON.value = i/8; CON.type = LONG_CONSTANT_OT; CON.marker = 0;
                 RFA.value = routine_flags_array_SC;
@@ -1554,6 +1598,8 @@ extern int32 assemble_routine_header(int no_locals,
           }
           else {
             i = no_named_routines++;
+            ensure_memory_list_available(&named_routine_symbols_memlist,
+                no_named_routines);
             named_routine_symbols[i] = the_symbol;
           }
         }
@@ -1770,30 +1816,31 @@ void assemble_routine_end(int embedded_flag, debug_locations locations)
 
 static int32 adjusted_pc;
 
-static void transfer_to_temp_file(uchar *c)
-{   fputc(*c,Temp2_fp);
-    adjusted_pc++;
-}
+/*  As each byte is finished with, it is moved down to the front of the
+    holding area (it can only move down, since bytes are deleted but never
+    inserted), and the finished routine is then sent on in one go.           */
 
-static void transfer_to_zcode_area(uchar *c)
-{   write_byte_to_memory_block(&zcode_area, adjusted_pc++, *c);
+static void transfer_to_zcode_area(int32 size)
+{   if (temporary_files_switch)
+        fwrite(zcode_holding_area, 1, size, Temp2_fp);
+    else
+        write_bytes_to_memory_block(&zcode_area, adjusted_pc,
+            zcode_holding_area, size);
+    adjusted_pc += size;
 }
 
 static void transfer_routine_z(void)
 {   int32 i, j, pc, new_pc, label, long_form, offset_of_next, addr,
           branch_on_true, rstart_pc;
-    void (* transfer_byte)(uchar *);
 
     adjusted_pc = zmachine_pc - zcode_ha_size; rstart_pc = adjusted_pc;
+    ensure_labels_available(next_label);
 
     if (asm_trace_level >= 3)
     {   printf("Backpatching routine at %05lx: initial size %d, %d labels\n",
              (long int) adjusted_pc, zcode_ha_size, next_label);
     }
 
-    transfer_byte =
-        (temporary_files_switch)?transfer_to_temp_file:transfer_to_zcode_area;
-
     /*  (1) Scan through for branches and make short/long decisions in each
             case.  Mark omitted bytes (2nd bytes in branches converted to
             short form) with DELETED_MV.                                     */
@@ -1872,7 +1919,7 @@ static void transfer_routine_z(void)
                 }
                 zcode_holding_area[i] = branch_on_true + 0x40 + (addr&0x3f);
             }
-            transfer_byte(zcode_holding_area + i); new_pc++;
+            zcode_holding_area[(new_pc++)-rstart_pc] = zcode_holding_area[i];
             break;
 
           case LABEL_MV:
@@ -1883,7 +1930,7 @@ static void transfer_routine_z(void)
             if (addr<0) addr += (int32) 0x10000L;
             zcode_holding_area[i] = addr/256;
             zcode_holding_area[i+1] = addr%256;
-            transfer_byte(zcode_holding_area + i); new_pc++;
+            zcode_holding_area[(new_pc++)-rstart_pc] = zcode_holding_area[i];
             break;
 
           case DELETED_MV:
@@ -1905,16 +1952,17 @@ static void transfer_routine_z(void)
                         break;
                     }
 
-                    write_byte_to_memory_block(&zcode_backpatch_table,
-                        zcode_backpatch_size++,
-                        zcode_markers[i] + 32*(new_pc/65536));
-                    write_byte_to_memory_block(&zcode_backpatch_table,
-                        zcode_backpatch_size++, (new_pc/256)%256);
-                    write_byte_to_memory_block(&zcode_backpatch_table,
-                        zcode_backpatch_size++, new_pc%256);
+                    {   uchar entry[3];
+                        entry[0] = zcode_markers[i] + 32*(new_pc/65536);
+                        entry[1] = (new_pc/256)%256;
+                        entry[2] = new_pc%256;
+                        write_bytes_to_memory_block(&zcode_backpatch_table,
+                            zcode_backpatch_size, entry, 3);
+                        zcode_backpatch_size += 3;
+                    }
                     break;
             }
-            transfer_byte(zcode_holding_area + i); new_pc++;
+            zcode_holding_area[(new_pc++)-rstart_pc] = zcode_holding_area[i];
             break;
         }
     }
@@ -1927,14 +1975,13 @@ static void transfer_routine_z(void)
     /*  Insert null bytes if necessary to ensure the next routine address is */
     /*  expressible as a packed address                                      */
 
-    {   uchar zero[1];
-        zero[0] = 0;
-        if (oddeven_packing_switch)
-            while ((adjusted_pc%(scale_factor*2))!=0) transfer_byte(zero);
-        else
-            while ((adjusted_pc%scale_factor)!=0) transfer_byte(zero);
+    {   int packing = (oddeven_packing_switch)?(scale_factor*2):scale_factor;
+        ensure_holding_area_available(new_pc-rstart_pc+packing);
+        while ((new_pc%packing)!=0)
+            zcode_holding_area[(new_pc++)-rstart_pc] = 0;
     }
 
+    transfer_to_zcode_area(new_pc-rstart_pc);
     zmachine_pc = adjusted_pc;
     zcode_ha_size = 0;
 }
@@ -1942,18 +1989,15 @@ static void transfer_routine_z(void)
 static void transfer_routine_g(void)
 {   int32 i, j, pc, new_pc, label, form_len, offset_of_next, addr,
           rstart_pc;
-    void (* transfer_byte)(uchar *);
 
     adjusted_pc = zmachine_pc - zcode_ha_size; rstart_pc = adjusted_pc;
+    ensure_labels_available(next_label);
 
     if (asm_trace_level >= 3)
     {   printf("Backpatching routine at %05lx: initial size %d, %d labels\n",
              (long int) adjusted_pc, zcode_ha_size, next_label);
     }
 
-    transfer_byte =
-        (temporary_files_switch)?transfer_to_temp_file:transfer_to_zcode_area;
-
     /*  (1) Scan through for branches and make short/long decisions in each
             case.  Mark omitted bytes (bytes 2-4 in branches converted to
             short form) with DELETED_MV.                                     */
@@ -2080,7 +2124,7 @@ static void transfer_routine_g(void)
             zcode_holding_area[i+2] = (addr >> 8) & 0xFF;
             zcode_holding_area[i+3] = (addr) & 0xFF;
         }
-        transfer_byte(zcode_holding_area + i); new_pc++;
+        zcode_holding_area[(new_pc++)-rstart_pc] = zcode_holding_area[i];
       }
       else if (zcode_markers[i] == LABEL_MV) {
           error("*** No LABEL opcodes in Glulx ***");
@@ -2109,23 +2153,20 @@ static void transfer_routine_g(void)
              Then a byte indicating the data size to be patched (1, 2, 4).
              Then the four-byte address (new_pc).
           */
-          write_byte_to_memory_block(&zcode_backpatch_table,
-            zcode_backpatch_size++,
-            zcode_markers[i]);
-          write_byte_to_memory_block(&zcode_backpatch_table,
-            zcode_backpatch_size++,
-            4);
-          write_byte_to_memory_block(&zcode_backpatch_table,
-            zcode_backpatch_size++, ((new_pc >> 24) & 0xFF));
-          write_byte_to_memory_block(&zcode_backpatch_table,
-            zcode_backpatch_size++, ((new_pc >> 16) & 0xFF));
-          write_byte_to_memory_block(&zcode_backpatch_table,
-            zcode_backpatch_size++, ((new_pc >> 8) & 0xFF));
-          write_byte_to_memory_block(&zcode_backpatch_table,
-            zcode_backpatch_size++, (new_pc & 0xFF));
+          {   uchar entry[6];
+              entry[0] = zcode_markers[i];
+              entry[1] = 4;
+              entry[2] = ((new_pc >> 24) & 0xFF);
+              entry[3] = ((new_pc >> 16) & 0xFF);
+              entry[4] = ((new_pc >> 8) & 0xFF);
+              entry[5] = (new_pc & 0xFF);
+              write_bytes_to_memory_block(&zcode_backpatch_table,
+                zcode_backpatch_size, entry, 6);
+              zcode_backpatch_size += 6;
+          }
           break;
         }
-        transfer_byte(zcode_holding_area + i); new_pc++;
+        zcode_holding_area[(new_pc++)-rstart_pc] = zcode_holding_area[i];
       }
     }
 
@@ -2134,6 +2175,7 @@ static void transfer_routine_g(void)
              new_pc - rstart_pc);
     }
 
+    transfer_to_zcode_area(new_pc-rstart_pc);
     zmachine_pc = adjusted_pc;
     zcode_ha_size = 0;
 }
@@ -3132,22 +3174,30 @@ extern void asm_allocate_arrays(void)
     variable_usage = my_calloc(sizeof(int),  
         MAX_LOCAL_VARIABLES+MAX_GLOBAL_VARIABLES, "variable usage");
 
-    label_offsets = my_calloc(sizeof(int32), MAX_LABELS, "label offsets");
-    label_symbols = my_calloc(sizeof(int32), MAX_LABELS, "label symbols");
-    label_next = my_calloc(sizeof(int), MAX_LABELS, "label dll 1");
-    label_prev = my_calloc(sizeof(int), MAX_LABELS, "label dll 1");
-    sequence_point_labels
-        = my_calloc(sizeof(int), MAX_LABELS, "sequence point labels");
-    sequence_point_locations
-        = my_calloc(sizeof(debug_location),
-                    MAX_LABELS,
-                    "sequence point locations");
-
-    zcode_holding_area = my_malloc(MAX_ZCODE_SIZE,"compiled routine code area");
-    zcode_markers = my_malloc(MAX_ZCODE_SIZE, "compiled routine code area");
-
-    named_routine_symbols
-        = my_calloc(sizeof(int32), MAX_SYMBOLS, "named routine symbols");
+    initialise_memory_list(&label_offsets_memlist,
+        sizeof(int32), MAX_LABELS, &label_offsets, "label offsets");
+    initialise_memory_list(&label_symbols_memlist,
+        sizeof(int32), MAX_LABELS, &label_symbols, "label symbols");
+    initialise_memory_list(&label_next_memlist,
+        sizeof(int), MAX_LABELS, &label_next, "label dll 1");
+    initialise_memory_list(&label_prev_memlist,
+        sizeof(int), MAX_LABELS, &label_prev, "label dll 2");
+    initialise_memory_list(&sequence_point_labels_memlist,
+        sizeof(int), debugfile_switch?MAX_LABELS:0,
+        &sequence_point_labels, "sequence point labels");
+    initialise_memory_list(&sequence_point_locations_memlist,
+        sizeof(debug_location), debugfile_switch?MAX_LABELS:0,
+        &sequence_point_locations, "sequence point locations");
+
+    initialise_memory_list(&zcode_holding_area_memlist,
+        sizeof(uchar), MAX_ZCODE_SIZE, &zcode_holding_area,
+        "compiled routine code area");
+    initialise_memory_list(&zcode_markers_memlist,
+        sizeof(uchar), MAX_ZCODE_SIZE, &zcode_markers,
+        "compiled routine code markers");
+
+    initialise_memory_list(&named_routine_symbols_memlist,
+        sizeof(int32), 0, &named_routine_symbols, "named routine symbols");
 }
 
 extern void asm_free_arrays(void)
@@ -3155,17 +3205,17 @@ extern void asm_free_arrays(void)
     my_free(&variable_tokens, "variable tokens");
     my_free(&variable_usage, "variable usage");
 
-    my_free(&label_offsets, "label offsets");
-    my_free(&label_symbols, "label symbols");
-    my_free(&label_next, "label dll 1");
-    my_free(&label_prev, "label dll 2");
-    my_free(&sequence_point_labels, "sequence point labels");
-    my_free(&sequence_point_locations, "sequence point locations");
+    deallocate_memory_list(&label_offsets_memlist);
+    deallocate_memory_list(&label_symbols_memlist);
+    deallocate_memory_list(&label_next_memlist);
+    deallocate_memory_list(&label_prev_memlist);
+    deallocate_memory_list(&sequence_point_labels_memlist);
+    deallocate_memory_list(&sequence_point_locations_memlist);
 
-    my_free(&zcode_holding_area, "compiled routine code area");
-    my_free(&zcode_markers, "compiled routine code markers");
+    deallocate_memory_list(&zcode_holding_area_memlist);
+    deallocate_memory_list(&zcode_markers_memlist);
 
-    my_free(&named_routine_symbols, "named routine symbols");
+    deallocate_memory_list(&named_routine_symbols_memlist);
     deallocate_memory_block(&zcode_area);
 }
 
@@ -332,7 +332,8 @@ extern int32 backpatch_value(int32 value)
 }
 
 static void backpatch_zmachine_z(int mv, int zmachine_area, int32 offset)
-{   if (module_switch)
+{   uchar entry[4];
+    if (module_switch)
     {   if (zmachine_area == PROP_DEFAULTS_ZA) return;
     }
     else
@@ -343,18 +344,18 @@ static void backpatch_zmachine_z(int mv, int zmachine_area, int32 offset)
 
     /* printf("MV %d ZA %d Off %04x\n", mv, zmachine_area, offset); */
 
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, mv);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, zmachine_area);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, offset/256);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, offset%256);
+    entry[0] = mv;
+    entry[1] = zmachine_area;
+    entry[2] = offset/256;
+    entry[3] = offset%256;
+    write_bytes_to_memory_block(&zmachine_backpatch_table,
+        zmachine_backpatch_size, entry, 4);
+    zmachine_backpatch_size += 4;
 }
 
 static void backpatch_zmachine_g(int mv, int zmachine_area, int32 offset)
-{   if (module_switch)
+{   uchar entry[6];
+    if (module_switch)
     {   if (zmachine_area == PROP_DEFAULTS_ZA) return;
     }
     else
@@ -370,18 +371,15 @@ static void backpatch_zmachine_g(int mv, int zmachine_area, int32 offset)
 
 /*    printf("+MV %d ZA %d Off %06x\n", mv, zmachine_area, offset);  */
 
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, mv);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, zmachine_area);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, (offset >> 24) & 0xFF);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, (offset >> 16) & 0xFF);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, (offset >> 8) & 0xFF);
-    write_byte_to_memory_block(&zmachine_backpatch_table,
-        zmachine_backpatch_size++, (offset) & 0xFF);
+    entry[0] = mv;
+    entry[1] = zmachine_area;
+    entry[2] = (offset >> 24) & 0xFF;
+    entry[3] = (offset >> 16) & 0xFF;
+    entry[4] = (offset >> 8) & 0xFF;
+    entry[5] = (offset) & 0xFF;
+    write_bytes_to_memory_block(&zmachine_backpatch_table,
+        zmachine_backpatch_size, entry, 6);
+    zmachine_backpatch_size += 6;
 }
 
 extern void backpatch_zmachine(int mv, int zmachine_area, int32 offset)
@@ -394,16 +392,15 @@ extern void backpatch_zmachine(int mv, int zmachine_area, int32 offset)
 
 extern void backpatch_zmachine_image_z(void)
 {   int bm = 0, zmachine_area; int32 offset, value, addr;
+    uchar entry[4];
     ASSERT_ZCODE();
     backpatch_error_flag = FALSE;
     while (bm < zmachine_backpatch_size)
-    {   backpatch_marker
-            = read_byte_from_memory_block(&zmachine_backpatch_table, bm);
-        zmachine_area
-            = read_byte_from_memory_block(&zmachine_backpatch_table, bm+1);
-        offset
-          = 256*read_byte_from_memory_block(&zmachine_backpatch_table,bm+2)
-            + read_byte_from_memory_block(&zmachine_backpatch_table, bm+3);
+    {   read_bytes_from_memory_block(&zmachine_backpatch_table, bm,
+            entry, 4);
+        backpatch_marker = entry[0];
+        zmachine_area = entry[1];
+        offset = 256*entry[2] + entry[3];
         bm += 4;
 
         switch(zmachine_area)
@@ -435,20 +432,18 @@ extern void backpatch_zmachine_image_z(void)
 
 extern void backpatch_zmachine_image_g(void)
 {   int bm = 0, zmachine_area; int32 offset, value, addr;
+    uchar entry[6];
     ASSERT_GLULX();
     backpatch_error_flag = FALSE;
     while (bm < zmachine_backpatch_size)
-    {   backpatch_marker
-            = read_byte_from_memory_block(&zmachine_backpatch_table, bm);
-        zmachine_area
-            = read_byte_from_memory_block(&zmachine_backpatch_table, bm+1);
-        offset = read_byte_from_memory_block(&zmachine_backpatch_table, bm+2);
-        offset = (offset << 8) |
-          read_byte_from_memory_block(&zmachine_backpatch_table, bm+3);
-        offset = (offset << 8) |
-          read_byte_from_memory_block(&zmachine_backpatch_table, bm+4);
-        offset = (offset << 8) |
-          read_byte_from_memory_block(&zmachine_backpatch_table, bm+5);
+    {   read_bytes_from_memory_block(&zmachine_backpatch_table, bm,
+            entry, 6);
+        backpatch_marker = entry[0];
+        zmachine_area = entry[1];
+        offset = entry[2];
+        offset = (offset << 8) | entry[3];
+        offset = (offset << 8) | entry[4];
+        offset = (offset << 8) | entry[5];
             bm += 6;
 
         /* printf("-MV %d ZA %d Off %06x\n", backpatch_marker, zmachine_area, offset);  */
@@ -70,8 +70,6 @@ extern int parse_given_directive(int internal_flag)
            {   error("All 64 abbreviations already declared");
                panic_mode_error_recovery(); return FALSE;
            }
-           if (no_abbreviations==MAX_ABBREVS)
-               memoryerror("MAX_ABBREVS", MAX_ABBREVS);
 
            if (abbrevs_lookup_table_made)
            {   error("All abbreviations must be declared together");
@@ -911,6 +911,8 @@ static int evaluate_term(token_data t, assembly_operand *o)
 
 expression_tree_node *ET;
 static int ET_used;
+static memory_list ET_memlist;             /* (MAX_EXPRESSION_NODES is only
+                                              the initial size of these)     */
 
 extern void clear_expression_space(void)
 {   ET_used = 0;
@@ -919,6 +921,14 @@ extern void clear_expression_space(void)
 static assembly_operand *emitter_stack;
 static int *emitter_markers;
 static int *emitter_bracket_counts;
+static memory_list emitter_stack_memlist, emitter_markers_memlist,
+    emitter_bracket_counts_memlist;
+
+static void ensure_emitter_available(int count)
+{   ensure_memory_list_available(&emitter_stack_memlist, count);
+    ensure_memory_list_available(&emitter_markers_memlist, count);
+    ensure_memory_list_available(&emitter_bracket_counts_memlist, count);
+}
 
 #define FUNCTION_VALUE_MARKER 1
 #define ARGUMENT_VALUE_MARKER 2
@@ -963,8 +973,7 @@ static void mark_top_of_emitter_stack(int marker, token_data t)
             return;
         }
         error_named("Missing operand for", t.text);
-        if (emitter_sp == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+        ensure_emitter_available(emitter_sp+1);
         emitter_markers[emitter_sp] = 0;
         emitter_bracket_counts[emitter_sp] = 0;
         emitter_stack[emitter_sp] = zero_operand;
@@ -1022,6 +1031,7 @@ static void emit_token(token_data t)
     {   if (stack_size < emitter_sp && emitter_bracket_counts[emitter_sp-stack_size-1])
         {   if (stack_size == 0)
             {   error("No expression between brackets '(' and ')'");
+                ensure_emitter_available(emitter_sp+1);
                 emitter_stack[emitter_sp] = zero_operand;
                 emitter_markers[emitter_sp] = 0;
                 emitter_bracket_counts[emitter_sp] = 0;
@@ -1037,11 +1047,10 @@ static void emit_token(token_data t)
     }
 
     if (t.type != OP_TT)
-    {   emitter_markers[emitter_sp] = 0;
+    {   ensure_emitter_available(emitter_sp+1);
+        emitter_markers[emitter_sp] = 0;
         emitter_bracket_counts[emitter_sp] = 0;
 
-        if (emitter_sp == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
         if (!evaluate_term(t, &(emitter_stack[emitter_sp++])))
             compiler_error_named("Emit token error:", t.text);
         return;
@@ -1113,8 +1122,7 @@ static void emit_token(token_data t)
         if (arity > stack_size)
         {   error_named("Missing operand for", t.text);
             while (arity > stack_size)
-            {   if (emitter_sp == MAX_EXPRESSION_NODES)
-                    memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+            {   ensure_emitter_available(emitter_sp+1);
                 emitter_markers[emitter_sp] = 0;
                 emitter_bracket_counts[emitter_sp] = 0;
                 emitter_stack[emitter_sp] = zero_operand;
@@ -1246,8 +1254,7 @@ static void emit_token(token_data t)
     }
 
     op_node_number = ET_used++;
-    if (op_node_number == MAX_EXPRESSION_NODES)
-        memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+    ensure_memory_list_available(&ET_memlist, ET_used);
 
     ET[op_node_number].operator_number = t.value;
     ET[op_node_number].up = -1;
@@ -1267,8 +1274,7 @@ static void emit_token(token_data t)
             operand_node_number = emitter_stack[i].value;
         else
         {   operand_node_number = ET_used++;
-            if (operand_node_number == MAX_EXPRESSION_NODES)
-                memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+            ensure_memory_list_available(&ET_memlist, ET_used);
             ET[operand_node_number].down = -1;
             ET[operand_node_number].value = emitter_stack[i];
         }
@@ -1603,8 +1609,7 @@ static void insert_exp_to_cond(int n, int context)
     if (ET[n].down == -1)
     {   if (context==CONDITION_CONTEXT)
         {   new = ET_used++;
-            if (new == MAX_EXPRESSION_NODES)
-                memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+            ensure_memory_list_available(&ET_memlist, ET_used);
             ET[new] = ET[n];
             ET[n].down = new; ET[n].operator_number = NONZERO_OP;
             ET[new].up = n; ET[new].right = -1;
@@ -1626,8 +1631,7 @@ static void insert_exp_to_cond(int n, int context)
             if (context != CONDITION_CONTEXT) break;
 
             new = ET_used++;
-            if (new == MAX_EXPRESSION_NODES)
-                memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+            ensure_memory_list_available(&ET_memlist, ET_used);
             ET[new] = ET[n];
             ET[n].down = new; ET[n].operator_number = NONZERO_OP;
             ET[new].up = n; ET[new].right = -1;
@@ -1685,8 +1689,7 @@ static void func_args_on_stack(int n, int context)
               || ET[fnaddr].value.value == GLK_SYSF))) {
         if (etoken_num_children(pn) > (unsigned int)(opnum == FCALL_OP ? 4:3)) {
           new = ET_used++;
-          if (new == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+          ensure_memory_list_available(&ET_memlist, ET_used);
           ET[new] = ET[n];
           ET[n].down = new; 
           ET[n].operator_number = PUSH_OP;
@@ -1708,8 +1711,7 @@ static assembly_operand check_conditions(assembly_operand AO, int context)
     if (AO.type != EXPRESSION_OT)
     {   if (context != CONDITION_CONTEXT) return AO;
         n = ET_used++;
-        if (n == MAX_EXPRESSION_NODES)
-            memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+        ensure_memory_list_available(&ET_memlist, ET_used);
         ET[n].down = -1;
         ET[n].up = -1;
         ET[n].right = -1;
@@ -1732,6 +1734,7 @@ static assembly_operand check_conditions(assembly_operand AO, int context)
 
 static int sr_sp;
 static token_data *sr_stack;
+static memory_list sr_stack_memlist;
 
 extern assembly_operand parse_expression(int context)
 {
@@ -1816,6 +1819,7 @@ extern assembly_operand parse_expression(int context)
     previous_token.value = 0;
 
     sr_sp = 1;
+    ensure_memory_list_available(&sr_stack_memlist, 1);
     sr_stack[0] = previous_token;
 
     AO = zero_operand;
@@ -1890,8 +1894,7 @@ extern assembly_operand parse_expression(int context)
 
             case LOWER_P:
             case EQUAL_P:
-                if (sr_sp == MAX_EXPRESSION_NODES)
-                    memoryerror("MAX_EXPRESSION_NODES", MAX_EXPRESSION_NODES);
+                ensure_memory_list_available(&sr_stack_memlist, sr_sp+1);
                 sr_stack[sr_sp++] = b;
                 switch(b.type)
                 {
@@ -2012,24 +2015,29 @@ extern void expressp_begin_pass(void)
 }
 
 extern void expressp_allocate_arrays(void)
-{   ET = my_calloc(sizeof(expression_tree_node), MAX_EXPRESSION_NODES,
+{   initialise_memory_list(&ET_memlist,
+        sizeof(expression_tree_node), MAX_EXPRESSION_NODES, &ET,
         "expression parse trees");
-    emitter_markers = my_calloc(sizeof(int), MAX_EXPRESSION_NODES,
+    initialise_memory_list(&emitter_markers_memlist,
+        sizeof(int), MAX_EXPRESSION_NODES, &emitter_markers,
         "emitter markers");
-    emitter_bracket_counts = my_calloc(sizeof(int), MAX_EXPRESSION_NODES,
+    initialise_memory_list(&emitter_bracket_counts_memlist,
+        sizeof(int), MAX_EXPRESSION_NODES, &emitter_bracket_counts,
         "emitter bracket layer counts");
-    emitter_stack = my_calloc(sizeof(assembly_operand), MAX_EXPRESSION_NODES,
+    initialise_memory_list(&emitter_stack_memlist,
+        sizeof(assembly_operand), MAX_EXPRESSION_NODES, &emitter_stack,
         "emitter stack");
-    sr_stack = my_calloc(sizeof(token_data), MAX_EXPRESSION_NODES,
+    initialise_memory_list(&sr_stack_memlist,
+        sizeof(token_data), MAX_EXPRESSION_NODES, &sr_stack,
         "shift-reduce parser stack");
 }
 
 extern void expressp_free_arrays(void)
-{   my_free(&ET, "expression parse trees");
-    my_free(&emitter_markers, "emitter markers");
-    my_free(&emitter_bracket_counts, "emitter bracket layer counts");
-    my_free(&emitter_stack, "emitter stack");
-    my_free(&sr_stack, "shift-reduce parser stack");
+{   deallocate_memory_list(&ET_memlist);
+    deallocate_memory_list(&emitter_markers_memlist);
+    deallocate_memory_list(&emitter_bracket_counts_memlist);
+    deallocate_memory_list(&emitter_stack_memlist);
+    deallocate_memory_list(&sr_stack_memlist);
 }
 
 /* ========================================================================= */
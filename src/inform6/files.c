@@ -31,9 +31,8 @@ static int checksum_count;              /* similarly                         */
 /* ------------------------------------------------------------------------- */
 
 FileId *InputFiles=NULL;                /*  Ids for all the source files     */
-static char *filename_storage,          /*  Translated filenames             */
-            *filename_storage_p;
-static int filename_storage_left;
+static memory_list InputFiles_memlist;  /*  (MAX_SOURCE_FILES is only its
+                                            initial size)                    */
 
 /* ------------------------------------------------------------------------- */
 /*   When emitting debug information, we won't have addresses of routines,   */
@@ -100,8 +99,7 @@ extern void load_sourcefile(char *filename_given, int same_directory_flag)
     int x = 0;
     FILE *handle;
 
-    if (input_file == MAX_SOURCE_FILES)
-        memoryerror("MAX_SOURCE_FILES", MAX_SOURCE_FILES);
+    ensure_memory_list_available(&InputFiles_memlist, input_file+1);
 
     do
     {   x = translate_in_filename(x, name, filename_given, same_directory_flag,
@@ -109,14 +107,9 @@ extern void load_sourcefile(char *filename_given, int same_directory_flag)
         handle = fopen(name,"r");
     } while ((handle == NULL) && (x != 0));
 
-    if (filename_storage_left <= (int)strlen(name))
-        memoryerror("MAX_SOURCE_FILES", MAX_SOURCE_FILES);
-
-    filename_storage_left -= strlen(name)+1;
-    strcpy(filename_storage_p, name);
-    InputFiles[input_file].filename = filename_storage_p;
-
-    filename_storage_p += strlen(name)+1;
+    InputFiles[input_file].filename
+        = my_malloc(strlen(name)+1, "translated filename");
+    strcpy(InputFiles[input_file].filename, name);
 
     if (debugfile_switch)
     {   debug_file_printf("<source index=\"%d\">", input_file);
@@ -210,7 +203,7 @@ extern int file_load_chars(int file_number, char *buffer, int length)
 
 FILE *sf_handle;
 
-static void sf_put(int c)
+static void sf_checksum(int c)
 {
     if (!glulx_mode) {
 
@@ -250,10 +243,44 @@ static void sf_put(int c)
       checksum_count = (checksum_count+1) & 3;
       
     }
+}
 
+static void sf_put(int c)
+{   sf_checksum(c);
     fputc(c, sf_handle);
 }
 
+/*  Outputs count bytes of a memory block at once, starting from index.      */
+
+static void sf_put_memory_block(memory_block *MB, int32 index, int32 count)
+{   uchar buffer[4096];
+    int32 i, n;
+
+    while (count > 0)
+    {   n = (count < 4096) ? count : 4096;
+        read_bytes_from_memory_block(MB, index, buffer, n);
+        for (i=0; i<n; i++) sf_checksum(buffer[i]);
+        fwrite(buffer, 1, n, sf_handle);
+        index += n; count -= n;
+    }
+}
+
+/*  Outputs the count bytes of code starting at offset j, from temporary
+    file 2 or the Z-code area; if the function they belong to has been
+    stripped out, they are passed over instead.                              */
+
+static void sf_put_code(FILE *fin, int32 j, int32 count, int use_function)
+{   int32 i;
+    if (temporary_files_switch)
+    {   for (i=0; i<count; i++)
+        {   int c = fgetc(fin);
+            if (use_function) sf_put(c);
+        }
+    }
+    else
+        if (use_function) sf_put_memory_block(&zcode_area, j, count);
+}
+
 /* Recursive procedure to generate the Glulx compression table. */
 
 static void output_compression(int entnum, int32 *size, int *count)
@@ -410,12 +437,11 @@ static void output_file_z(void)
     if (!module_switch)
     for (i=0; i<zcode_backpatch_size; i=i+3)
     {   int long_flag = TRUE;
-        offset
-            = 256*read_byte_from_memory_block(&zcode_backpatch_table, i+1)
-              + read_byte_from_memory_block(&zcode_backpatch_table, i+2);
+        uchar entry[3];
+        read_bytes_from_memory_block(&zcode_backpatch_table, i, entry, 3);
+        offset = 256*entry[1] + entry[2];
         backpatch_error_flag = FALSE;
-        backpatch_marker
-            = read_byte_from_memory_block(&zcode_backpatch_table, i);
+        backpatch_marker = entry[0];
         if (backpatch_marker >= 0x80) long_flag = FALSE;
         backpatch_marker &= 0x7f;
         offset = offset + (backpatch_marker/32)*0x10000;
@@ -428,22 +454,12 @@ static void output_file_z(void)
         /* All code up until the next backpatch marker gets flushed out
            as-is. (Unless we're in a stripped-out function.) */
         while (j<offset) {
-            if (!use_function) {
-                while (j<offset && j<next_cons_check) {
-                    /* get dummy value */
-                    ((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
-            }
-            else {
-                while (j<offset && j<next_cons_check) {
-                    size++;
-                    sf_put((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
-            }
+            int32 run_end = offset;
+            if ((uint32) run_end > next_cons_check)
+                run_end = next_cons_check;
+            sf_put_code(fin, j, run_end-j, use_function);
+            if (use_function) size += run_end-j;
+            j = run_end;
             if (j == next_cons_check)
                 next_cons_check = df_next_function_iterate(&use_function);
         }
@@ -484,22 +500,12 @@ static void output_file_z(void)
        marker. */
     offset = zmachine_pc;
     while (j<offset) {
-        if (!use_function) {
-            while (j<offset && j<next_cons_check) {
-                /* get dummy value */
-                ((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
-        }
-        else {
-            while (j<offset && j<next_cons_check) {
-                size++;
-                sf_put((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
-        }
+        int32 run_end = offset;
+        if ((uint32) run_end > next_cons_check)
+            run_end = next_cons_check;
+        sf_put_code(fin, j, run_end-j, use_function);
+        if (use_function) size += run_end-j;
+        j = run_end;
         if (j == next_cons_check)
             next_cons_check = df_next_function_iterate(&use_function);
     }
@@ -532,10 +538,9 @@ static void output_file_z(void)
         remove(Temp1_Name); remove(Temp2_Name);
     }
     else
-      for (i=0; i<static_strings_extent; i++) {
-        sf_put(read_byte_from_memory_block(&static_strings_area,i));
-        size++;
-      }
+    {   sf_put_memory_block(&static_strings_area, 0, static_strings_extent);
+        size += static_strings_extent;
+    }
 
     /*  (5)  Output the linking data table (in the case of a module).        */
 
@@ -554,14 +559,13 @@ static void output_file_z(void)
     }
     else
         if (module_switch)
-            for (i=0; i<link_data_size; i++)
-                sf_put(read_byte_from_memory_block(&link_data_area,i));
+            sf_put_memory_block(&link_data_area, 0, link_data_size);
 
     if (module_switch)
-    {   for (i=0; i<zcode_backpatch_size; i++)
-            sf_put(read_byte_from_memory_block(&zcode_backpatch_table, i));
-        for (i=0; i<zmachine_backpatch_size; i++)
-            sf_put(read_byte_from_memory_block(&zmachine_backpatch_table, i));
+    {   sf_put_memory_block(&zcode_backpatch_table, 0,
+            zcode_backpatch_size);
+        sf_put_memory_block(&zmachine_backpatch_table, 0,
+            zmachine_backpatch_size);
     }
 
     /*  (6)  Output null bytes to reach a multiple of 0.5K.                  */
@@ -798,36 +802,25 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
       for (i=0; i<zcode_backpatch_size; i=i+6) {
         int data_len;
         int32 v;
-        offset = 
-          (read_byte_from_memory_block(&zcode_backpatch_table, i+2) << 24)
-          | (read_byte_from_memory_block(&zcode_backpatch_table, i+3) << 16)
-          | (read_byte_from_memory_block(&zcode_backpatch_table, i+4) << 8)
-          | (read_byte_from_memory_block(&zcode_backpatch_table, i+5));
+        uchar entry[6];
+        read_bytes_from_memory_block(&zcode_backpatch_table, i, entry, 6);
+        offset = entry[2];
+        offset = (offset << 8) | entry[3];
+        offset = (offset << 8) | entry[4];
+        offset = (offset << 8) | entry[5];
         backpatch_error_flag = FALSE;
-        backpatch_marker =
-          read_byte_from_memory_block(&zcode_backpatch_table, i);
-        data_len =
-          read_byte_from_memory_block(&zcode_backpatch_table, i+1);
+        backpatch_marker = entry[0];
+        data_len = entry[1];
 
         /* All code up until the next backpatch marker gets flushed out
            as-is. (Unless we're in a stripped-out function.) */
         while (j<offset) {
-            if (!use_function) {
-                while (j<offset && j<next_cons_check) {
-                    /* get dummy value */
-                    ((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
-            }
-            else {
-                while (j<offset && j<next_cons_check) {
-                    size++;
-                    sf_put((temporary_files_switch)?fgetc(fin):
-                        read_byte_from_memory_block(&zcode_area, j));
-                    j++;
-                }
-            }
+            int32 run_end = offset;
+            if ((uint32) run_end > next_cons_check)
+                run_end = next_cons_check;
+            sf_put_code(fin, j, run_end-j, use_function);
+            if (use_function) size += run_end-j;
+            j = run_end;
             if (j == next_cons_check)
                 next_cons_check = df_next_function_iterate(&use_function);
         }
@@ -908,22 +901,12 @@ game features require version 0x%08lx", (long)requested_glulx_version, (long)Ver
        marker. */
     offset = zmachine_pc;
     while (j<offset) {
-        if (!use_function) {
-            while (j<offset && j<next_cons_check) {
-                /* get dummy value */
-                ((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
-        }
-        else {
-            while (j<offset && j<next_cons_check) {
-                size++;
-                sf_put((temporary_files_switch)?fgetc(fin):
-                    read_byte_from_memory_block(&zcode_area, j));
-                j++;
-            }
-        }
+        int32 run_end = offset;
+        if ((uint32) run_end > next_cons_check)
+            run_end = next_cons_check;
+        sf_put_code(fin, j, run_end-j, use_function);
+        if (use_function) size += run_end-j;
+        j = run_end;
         if (j == next_cons_check)
             next_cons_check = df_next_function_iterate(&use_function);
     }
@@ -1710,11 +1693,8 @@ static void initialise_accumulator
 }
 
 extern void files_allocate_arrays(void)
-{   filename_storage = my_malloc(MAX_SOURCE_FILES*64, "filename storage");
-    filename_storage_p = filename_storage;
-    filename_storage_left = MAX_SOURCE_FILES*64;
-    InputFiles = my_malloc(MAX_SOURCE_FILES*sizeof(FileId), 
-        "input file storage");
+{   initialise_memory_list(&InputFiles_memlist,
+        sizeof(FileId), MAX_SOURCE_FILES, &InputFiles, "input file storage");
     if (debugfile_switch)
     {   if (glulx_mode)
         {   initialise_accumulator
@@ -1742,8 +1722,10 @@ static void tear_down_accumulator(debug_backpatch_accumulator *accumulator)
 }
 
 extern void files_free_arrays(void)
-{   my_free(&filename_storage, "filename storage");
-    my_free(&InputFiles, "input file storage");
+{   int i;
+    for (i=0; i<input_file; i++)
+        my_free(&InputFiles[i].filename, "translated filename");
+    deallocate_memory_list(&InputFiles_memlist);
     if (debugfile_switch)
     {   if (!glulx_mode)
         {   tear_down_accumulator(&object_backpatch_accumulator);
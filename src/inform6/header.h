@@ -127,6 +127,8 @@
 /*                         by default, you should define this                */
 /*   HAS_REALPATH        - the POSIX realpath() function is available to     */
 /*                         find the absolute path to a file                  */
+/*   HAS_PTHREADS        - POSIX threads are available, so the abbreviations */
+/*                         optimiser can use every processor                 */
 /*                                                                           */
 /*   3. An estimate of the typical amount of memory likely to be free        */
 /*   should be given in DEFAULT_MEMORY_SIZE.                                 */
@@ -278,6 +280,7 @@ static int32 unique_task_id(void)
 #define MACHINE_STRING   "Linux"
 /* 2 */
 #define HAS_REALPATH
+#define HAS_PTHREADS
 /* 3 */
 #define DEFAULT_MEMORY_SIZE HUGE_SIZE
 /* 4 */
@@ -347,6 +350,7 @@ static int32 unique_task_id(void)
 #define MACHINE_STRING   "Mac OS X"
 /* 2 */
 #define HAS_REALPATH
+#define HAS_PTHREADS
 /* 3 */
 #define DEFAULT_MEMORY_SIZE LARGE_SIZE
 /* 4 */
@@ -859,17 +863,25 @@ typedef struct ErrorPosition_s
     int  main_flag;
 } ErrorPosition;
 
-/*  A memory block can hold at most ALLOC_CHUNK_SIZE * 72:  */
+/*  A memory block is a contiguous buffer which grows as it is written to,
+    starting at ALLOC_CHUNK_SIZE bytes (see memory.c):  */
 
 extern int ALLOC_CHUNK_SIZE;
 
 typedef struct memory_block_s
-{   int chunks;
-    int extent_of_last;
-    uchar *chunk[72];
-    int write_pos;
+{   uchar *data;
+    int32 size;                        /* Bytes allocated so far             */
 } memory_block;
 
+/*  A memory list is an array which grows as needed (see memory.c):  */
+
+typedef struct memory_list_s
+{   char *whatfor;
+    void **data;                       /* The variable holding the array     */
+    int32 itemsize;
+    int32 count;                       /* Entries allocated so far           */
+} memory_list;
+
 /* This serves for both Z-code and Glulx instructions. Glulx doesn't use
    the text, store_variable_number, branch_label_number, or branch_flag
    fields. */
@@ -2062,6 +2074,7 @@ extern void verbs_free_arrays(void);
 extern int no_globals, no_arrays;
 extern int dynamic_array_area_size;
 extern int *dynamic_array_area;
+extern memory_list dynamic_array_area_memlist;
 extern int32 *global_initial_value;
 extern int32 *array_symbols;
 extern int  *array_sizes, *array_types;
@@ -2412,7 +2425,7 @@ extern int32 requested_glulx_version;
 
 extern int error_format,    store_the_text,       asm_trace_setting,
     double_space_setting,   trace_fns_setting,    character_set_setting,
-    character_set_unicode;
+    character_set_unicode,  optimise_setting;
 
 extern char Debugging_Name[];
 extern char Transcript_Name[];
@@ -2551,6 +2564,15 @@ extern void deallocate_memory_block(memory_block *MB);
 extern int  read_byte_from_memory_block(memory_block *MB, int32 index);
 extern void write_byte_to_memory_block(memory_block *MB,
     int32 index, int value);
+extern void read_bytes_from_memory_block(memory_block *MB, int32 index,
+    uchar *to, int32 count);
+extern void write_bytes_to_memory_block(memory_block *MB, int32 index,
+    uchar *from, int32 count);
+
+extern void initialise_memory_list(memory_list *ML, int32 itemsize,
+    int32 initalloc, void *dataref, char *whatfor);
+extern void deallocate_memory_list(memory_list *ML);
+extern void ensure_memory_list_available(memory_list *ML, int32 count);
 
 /* ------------------------------------------------------------------------- */
 /*   Extern definitions for "objects"                                        */
@@ -2572,6 +2594,7 @@ extern int *prop_is_long;
 extern int *prop_is_additive;
 extern char *properties_table;
 extern int properties_table_size;
+extern memory_list properties_table_memlist, individuals_table_memlist;
 
 extern void make_attribute(void);
 extern void make_property(void);
@@ -2582,6 +2605,8 @@ extern void make_class(char *metaclass_name);
 extern int  object_provides(int obj, int id);
 extern void list_object_tree(void);
 extern void write_the_identifier_names(void);
+extern void ensure_objects_available(int count);
+extern void ensure_classes_available(int count);
 
 /* ------------------------------------------------------------------------- */
 /*   Extern definitions for "symbols"                                        */
@@ -2609,11 +2634,13 @@ extern int track_unused_routines;
 extern int df_dont_note_global_symbols;
 extern uint32 df_total_size_before_stripping;
 extern uint32 df_total_size_after_stripping;
+extern int32 symbol_lookups, symbol_probes;
 
 extern char *typename(int type);
+extern int32 hash_value_from_string(char *p);
 extern int hash_code_from_string(char *p);
 extern int strcmpcis(char *p, char *q);
-extern int symbol_index(char *lexeme_text, int hashcode);
+extern int symbol_index(char *lexeme_text, int32 hash_value);
 extern void end_symbol_scope(int k);
 extern void describe_symbol(int k);
 extern void list_symbols(int level);
@@ -2688,8 +2715,10 @@ extern void write_serial_number(char *buffer);
 /*   Extern definitions for "text"                                           */
 /* ------------------------------------------------------------------------- */
 
-extern uchar *low_strings, *low_strings_top;
+extern uchar *low_strings;
+extern int32 low_strings_top;
 extern char  *all_text,    *all_text_top;
+extern uchar *translated_text;
 
 extern int   no_abbreviations;
 extern int   abbrevs_lookup_table_made, is_abbreviation;
@@ -2719,7 +2748,7 @@ extern int no_unicode_chars;
 typedef struct unicode_usage_s unicode_usage_t;
 struct unicode_usage_s {
   int32 ch;
-  unicode_usage_t *next;  
+  int next;  /* index into unicode_usage_entries, or -1 */
 };
 
 extern unicode_usage_t *unicode_usage_entries;
@@ -2759,7 +2788,7 @@ extern void  compress_game_text(void);
 
 extern void  ao_free_arrays(void);
 extern int32 compile_string(char *b, int in_low_memory, int is_abbrev);
-extern uchar *translate_text(uchar *p, uchar *p_limit, char *s_text);
+extern int32 translate_text(int32 p_limit, char *s_text);
 extern void  optimise_abbreviations(void);
 extern void  make_abbreviation(char *text);
 extern void  show_dictionary(void);
@@ -2804,5 +2833,6 @@ extern assembly_operand action_of_name(char *name);
 extern void make_verb(void);
 extern void extend_verb(void);
 extern void list_verb_table(void);
+extern void ensure_actions_available(int count);
 
 /* ========================================================================= */
@@ -129,10 +129,6 @@ static void select_target(int targ)
       MAX_GLOBAL_VARIABLES = 240;
       fatalerror("You cannot change MAX_GLOBAL_VARIABLES in Z-code");
     }
-    if (MAX_VERBS > 255) {
-      MAX_VERBS = 255;
-      fatalerror("MAX_VERBS can only go above 255 when Glulx is used");
-    }
   }
   else {
     /* Glulx */
@@ -255,6 +251,7 @@ int character_set_setting,          /* set by -C0 through -C9 */
                                        asm_trace_level to use when tracing */
     double_space_setting,           /* set by -d: 0, 1 or 2 */
     trace_fns_setting,              /* set by -g: 0, 1 or 2 */
+    optimise_setting,               /* set by -u: 1, 2 or 3 */
     linker_trace_setting,           /* set by -y: ditto for linker_... */
     store_the_text;                 /* when set, record game text to a chunk
                                        of memory (used by both -r & -k) */
@@ -275,6 +272,7 @@ static void reset_switch_settings(void)
     economy_switch = FALSE;
     frequencies_switch = FALSE;
     trace_fns_setting = 0;
+    optimise_setting = 1;
     ignore_switches_switch = FALSE;
     listobjects_switch = FALSE;
     debugfile_switch = FALSE;
@@ -1213,7 +1211,9 @@ One or more words can be supplied as \"commands\". These may be:\n\n\
       Transcript_Name);
 
    printf("\
-  u   work out most useful abbreviations (very very slowly)\n\
+  u   work out most useful abbreviations (using all processors)\n\
+  u2  work them out with the original multi-pass method (very very slowly)\n\
+  u3  use both methods and compare their speed and savings\n\
   v3  compile to version-3 (\"Standard\") story file\n\
   v4  compile to version-4 (\"Plus\") story file\n\
   v5  compile to version-5 (\"Advanced\") story file: the default\n\
@@ -1327,7 +1327,14 @@ extern void switches(char *p, int cmode)
                       transcript_switch = state; break;
         case 's': statistics_switch = state; break;
         case 't': asm_trace_setting=2; break;
-        case 'u': optimise_switch = state; break;
+        case 'u': optimise_switch = state;
+                  switch(p[i+1])
+                  {   case '1': optimise_setting=1; s=2; break;
+                      case '2': optimise_setting=2; s=2; break;
+                      case '3': optimise_setting=3; s=2; break;
+                      default: optimise_setting=1; break;
+                  }
+                  break;
         case 'v': if (glulx_mode) { s = select_glulx_version(p+i+1)+1; break; }
                   if ((cmode==0) && (version_set_switch)) { s=2; break; }
                   version_set_switch = TRUE; s=2;
@@ -1425,19 +1432,7 @@ extern void switches(char *p, int cmode)
     }
 
     if (optimise_switch && (!store_the_text))
-    {   store_the_text=TRUE;
-#ifdef PC_QUICKC
-        if (memout_switch)
-            printf("Allocation %ld bytes for transcription text\n",
-                (long) MAX_TRANSCRIPT_SIZE);
-        all_text = halloc(MAX_TRANSCRIPT_SIZE,1);
-        malloced_bytes += MAX_TRANSCRIPT_SIZE;
-        if (all_text==NULL)
-         fatalerror("Can't hallocate memory for transcription text.  Darn.");
-#else
-        all_text=my_malloc(MAX_TRANSCRIPT_SIZE,"transcription text");
-#endif
-    }
+        store_the_text=TRUE;                 /* (see text_allocate_arrays) */
 }
 
 static int icl_command(char *p)
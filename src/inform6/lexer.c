@@ -659,12 +659,13 @@ extern void construct_local_variable_tables(void)
 }
 
 static void interpret_identifier(int pos, int dirs_only_flag)
-{   int index, hashcode; char *p = circle[pos].text;
+{   int index, hashcode; int32 hash_value; char *p = circle[pos].text;
 
     /*  An identifier is either a keyword or a "symbol", a name which the
         lexical analyser leaves to higher levels of Inform to understand.    */
 
-    hashcode = hash_code_from_string(p);
+    hash_value = hash_value_from_string(p);
+    hashcode = (int) (hash_value % HASH_TAB_SIZE);
 
     if (dirs_only_flag) goto KeywordSearch;
 
@@ -728,7 +729,7 @@ static void interpret_identifier(int pos, int dirs_only_flag)
 
     /*  Search for the name; create it if necessary.                         */
 
-    circle[pos].value = symbol_index(p, hashcode);
+    circle[pos].value = symbol_index(p, hash_value);
     circle[pos].type = SYMBOL_TT;
 }
 
@@ -1163,6 +1164,8 @@ typedef struct Sourcefile_s
 } Sourcefile;
 
 static Sourcefile *FileStack;
+static memory_list FileStack_memlist;            /*  (Grows as files are
+                                                     nested more deeply)     */
 static int File_sp;                              /*  Stack pointer           */
 
 static Sourcefile *CF;                           /*  Top entry on stack      */
@@ -1172,8 +1175,10 @@ static int last_no_files;
 static void begin_buffering_file(int i, int file_no)
 {   int j, cnt; uchar *p;
 
-    if (i >= MAX_INCLUSION_DEPTH) 
-       memoryerror("MAX_INCLUSION_DEPTH",MAX_INCLUSION_DEPTH);
+    ensure_memory_list_available(&FileStack_memlist, i+1);
+    if (FileStack[i].buffer == NULL)
+        FileStack[i].buffer
+            = my_malloc(SOURCE_BUFFER_SIZE+4, "source file buffer");
 
     p = (uchar *) FileStack[i].buffer;
 
@@ -1736,7 +1741,8 @@ extern void lexer_endpass(void)
 extern void lexer_allocate_arrays(void)
 {   int i;
 
-    FileStack = my_malloc(MAX_INCLUSION_DEPTH*sizeof(Sourcefile),
+    initialise_memory_list(&FileStack_memlist,
+        sizeof(Sourcefile), MAX_INCLUSION_DEPTH, &FileStack,
         "filestack buffer");
 
     for (i=0; i<MAX_INCLUSION_DEPTH; i++)
@@ -1781,11 +1787,11 @@ extern void lexer_allocate_arrays(void)
 extern void lexer_free_arrays(void)
 {   int i; char *p;
 
-    for (i=0; i<MAX_INCLUSION_DEPTH; i++)
+    for (i=0; i<FileStack_memlist.count; i++)
     {   p = FileStack[i].buffer;
         my_free(&p, "source file buffer");
     }
-    my_free(&FileStack, "filestack buffer");
+    deallocate_memory_list(&FileStack_memlist);
     my_free(&lexeme_memory, "lexeme memory");
 
     my_free(&keywords_hash_table, "keyword hash table");
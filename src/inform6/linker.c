@@ -9,10 +9,10 @@
 #include "header.h"
 
 memory_block link_data_area;
-uchar *link_data_holding_area, *link_data_top;
-                                          /*  Start, current top, size of    */
-int32 link_data_size;                     /*  link data table being written  */
-                                          /*  (holding import/export names)  */
+uchar *link_data_holding_area;           /*  Start, current top, size of    */
+static int32 link_data_ha_size;           /*  link data table being written  */
+int32 link_data_size;                     /*  (holding import/export names)  */
+static memory_list link_data_holding_area_memlist;
 extern int32 *action_symbol;
 
 /* ------------------------------------------------------------------------- */
@@ -249,6 +249,7 @@ static void accept_export(void)
     else
     {   if (IE.module_value == EXPORTAC_MV)
         {   IE.symbol_value = no_actions;
+            ensure_actions_available(no_actions+1);
             action_symbol[no_actions++] = index;
             if (linker_trace_level >= 4)
                 printf("Creating action ##%s\n", (char *) symbs[index]);
@@ -809,8 +810,8 @@ of the Inform 6 compiler knows about: it may not link in correctly", filename);
     /* (10) Glue in the dynamic array data */
 
     i = m_static_offset - m_vars_offset - MAX_GLOBAL_VARIABLES*2;
-    if (dynamic_array_area_size + i >= MAX_STATIC_DATA)
-        memoryerror("MAX_STATIC_DATA", MAX_STATIC_DATA);
+    ensure_memory_list_available(&dynamic_array_area_memlist,
+        dynamic_array_area_size + i);
 
     if (linker_trace_level >= 2)
         printf("Inserting dynamic array area, %04x to %04x, at %04x\n",
@@ -828,13 +829,16 @@ of the Inform 6 compiler knows about: it may not link in correctly", filename);
       printf("Inserting code area, %04x to %04x, at code offset %04x (+%04x)\n",
         m_code_offset, m_strs_offset, code_offset, zmachine_pc);
 
-    for (k=m_code_offset;k<m_strs_offset;k++)
-    {   if (temporary_files_switch)
+    if (temporary_files_switch)
+    {   for (k=m_code_offset;k<m_strs_offset;k++)
         {   fputc(p[k],Temp2_fp);
             zmachine_pc++;
         }
-        else
-            write_byte_to_memory_block(&zcode_area, zmachine_pc++, p[k]);
+    }
+    else
+    {   write_bytes_to_memory_block(&zcode_area, zmachine_pc,
+            p+m_code_offset, m_strs_offset-m_code_offset);
+        zmachine_pc += m_strs_offset-m_code_offset;
     }
 
     /* (12) Glue in the static strings area */
@@ -844,14 +848,16 @@ of the Inform 6 compiler knows about: it may not link in correctly", filename);
 at strings offset %04x (+%04x)\n",
         m_strs_offset, link_offset, strings_offset,
         static_strings_extent);
-    for (k=m_strs_offset;k<link_offset;k++)
-    {   if (temporary_files_switch)
+    if (temporary_files_switch)
+    {   for (k=m_strs_offset;k<link_offset;k++)
         {   fputc(p[k], Temp1_fp);
             static_strings_extent++;
         }
-        else
-            write_byte_to_memory_block(&static_strings_area,
-                    static_strings_extent++, p[k]);
+    }
+    else
+    {   write_bytes_to_memory_block(&static_strings_area,
+            static_strings_extent, p+m_strs_offset, link_offset-m_strs_offset);
+        static_strings_extent += link_offset-m_strs_offset;
     }
 
     /* (13) Append the class object-numbers table: note that modules
@@ -862,6 +868,7 @@ at strings offset %04x (+%04x)\n",
     {   j = p[i]*256 + p[i+1]; i+=2;
         if (j == 0) break;
 
+        ensure_classes_available(no_classes+1);
         class_object_numbers[no_classes] = j + no_objects;
         j = p[i]*256 + p[i+1]; i+=2;
         class_begins_at[no_classes++] = j + properties_table_size;
@@ -873,6 +880,7 @@ at strings offset %04x (+%04x)\n",
     if ((linker_trace_level>=2) && (m_no_objects>0))
         printf("Joining on object tree of size %d\n", m_no_objects);
 
+    ensure_objects_available(no_objects+m_no_objects);
     for (i=0, k=no_objects, last=m_props_offset;i<m_no_objects;i++)
     {   objectsz[no_objects].atts[0]=p[m_objs_offset+14*i];
         objectsz[no_objects].atts[1]=p[m_objs_offset+14*i+1];
@@ -922,9 +930,8 @@ at strings offset %04x (+%04x)\n",
     /* (15) Glue on the properties */
 
     if (last>m_props_offset)
-    {   i = m_static_offset - m_vars_offset - MAX_GLOBAL_VARIABLES*2;
-        if (dynamic_array_area_size + i >= MAX_STATIC_DATA)
-            memoryerror("MAX_STATIC_DATA", MAX_STATIC_DATA);
+    {   ensure_memory_list_available(&properties_table_memlist,
+            properties_table_size + last - m_props_offset);
 
         if (linker_trace_level >= 2)
             printf("Inserting object properties area, %04x to %04x, at +%04x\n",
@@ -941,9 +948,8 @@ at strings offset %04x (+%04x)\n",
     /* (17) Append the individual property values table */
 
     i = m_individuals_length;
-    if (individuals_length + i >= MAX_INDIV_PROP_TABLE_SIZE)
-        memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-            MAX_INDIV_PROP_TABLE_SIZE);
+    ensure_memory_list_available(&individuals_table_memlist,
+        individuals_length + i);
 
     if (linker_trace_level >= 2)
       printf("Inserting individual prop tables area, %04x to %04x, at +%04x\n",
@@ -974,23 +980,21 @@ at strings offset %04x (+%04x)\n",
 /* ------------------------------------------------------------------------- */
 
 static void write_link_byte(int x)
-{   *link_data_top=(unsigned char) x; link_data_top++; link_data_size++;
-    if (subtract_pointers(link_data_top,link_data_holding_area)
-        >= MAX_LINK_DATA_SIZE)
-    {   memoryerror("MAX_LINK_DATA_SIZE",MAX_LINK_DATA_SIZE);
-    }
+{   ensure_memory_list_available(&link_data_holding_area_memlist,
+        link_data_ha_size+1);
+    link_data_holding_area[link_data_ha_size++] = (unsigned char) x;
+    link_data_size++;
 }
 
 extern void flush_link_data(void)
 {   int32 i, j;
-    j = subtract_pointers(link_data_top, link_data_holding_area);
+    j = link_data_ha_size;
     if (temporary_files_switch)
         for (i=0;i<j;i++) fputc(link_data_holding_area[i], Temp3_fp);
     else
-        for (i=0;i<j;i++)
-            write_byte_to_memory_block(&link_data_area, link_data_size-j+i,
-            link_data_holding_area[i]);
-    link_data_top=link_data_holding_area;
+        write_bytes_to_memory_block(&link_data_area, link_data_size-j,
+            link_data_holding_area, j);
+    link_data_ha_size = 0;
 }
 
 static void write_link_word(int32 x)
@@ -1114,7 +1118,7 @@ extern void init_linker_vars(void)
 }
 
 extern void linker_begin_pass(void)
-{   link_data_top = link_data_holding_area;
+{   link_data_ha_size = 0;
 }
 
 extern void linker_endpass(void)
@@ -1124,16 +1128,13 @@ extern void linker_endpass(void)
 }
 
 extern void linker_allocate_arrays(void)
-{   if (!module_switch)
-        link_data_holding_area
-            = my_malloc(64, "link data holding area");
-    else
-        link_data_holding_area
-            = my_malloc(MAX_LINK_DATA_SIZE, "link data holding area");
+{   initialise_memory_list(&link_data_holding_area_memlist,
+        sizeof(uchar), module_switch?MAX_LINK_DATA_SIZE:64,
+        &link_data_holding_area, "link data holding area");
 }
 
 extern void linker_free_arrays(void)
-{   my_free(&link_data_holding_area, "link data holding area");
+{   deallocate_memory_list(&link_data_holding_area_memlist);
     deallocate_memory_block(&link_data_area);
 }
 
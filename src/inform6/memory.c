@@ -155,66 +155,133 @@ extern void my_free(void *pointer, char *whatitwas)
 
 /* ------------------------------------------------------------------------- */
 /*   Extensible blocks of memory, providing a kind of RAM disc as an         */
-/*   alternative to the temporary files option                               */
+/*   alternative to the temporary files option.  Each block is a single      */
+/*   contiguous buffer, which is reallocated at twice the size (or more, if  */
+/*   need be) whenever a write goes beyond its end.  Bytes which have been   */
+/*   allocated but not yet written read as 255.                              */
 /* ------------------------------------------------------------------------- */
 
-static char chunk_name_buffer[60];
-static char *chunk_name(memory_block *MB, int no)
+static char *block_name(memory_block *MB)
 {   char *p = "(unknown)";
     if (MB == &static_strings_area) p = "static strings area";
     if (MB == &zcode_area)          p = "Z-code area";
     if (MB == &link_data_area)      p = "link data area";
     if (MB == &zcode_backpatch_table) p = "Z-code backpatch table";
     if (MB == &zmachine_backpatch_table) p = "Z-machine backpatch table";
-    sprintf(chunk_name_buffer, "%s chunk %d", p, no);
-    return(chunk_name_buffer);
+    return(p);
 }
 
 extern void initialise_memory_block(memory_block *MB)
-{   int i;
-    MB->chunks = 0;
-    for (i=0; i<72; i++) MB->chunk[i] = NULL;
-    MB->extent_of_last = 0;
-    MB->write_pos = 0;
+{   MB->data = NULL;
+    MB->size = 0;
 }
 
 extern void deallocate_memory_block(memory_block *MB)
-{   int i;
-    for (i=0; i<72; i++)
-        if (MB->chunk[i] != NULL)
-            my_free(&(MB->chunk[i]), chunk_name(MB, i));
-    MB->chunks = 0;
-    MB->extent_of_last = 0;
+{   my_free(&(MB->data), block_name(MB));
+    MB->size = 0;
+}
+
+static void ensure_memory_block_available(memory_block *MB, int32 size)
+{   int32 oldsize = MB->size;
+
+    if (size <= oldsize) return;
+
+    MB->size = 2*oldsize;
+    if (MB->size < size) MB->size = size;
+    if (MB->size < ALLOC_CHUNK_SIZE) MB->size = ALLOC_CHUNK_SIZE;
+
+    if (MB->data == NULL)
+        MB->data = my_malloc(MB->size, block_name(MB));
+    else
+        my_realloc(&(MB->data), oldsize, MB->size, block_name(MB));
+    memset(MB->data + oldsize, 255, MB->size - oldsize);
 }
 
 extern int read_byte_from_memory_block(memory_block *MB, int32 index)
-{   uchar *p;
-    p = MB->chunk[index/ALLOC_CHUNK_SIZE];
-    if (p == NULL)
+{   if ((index < 0) || (index >= MB->size))
     {   compiler_error_named("memory: read from unwritten byte in",
-            chunk_name(MB, index/ALLOC_CHUNK_SIZE));
+            block_name(MB));
         return 0;
     }
-    return p[index % ALLOC_CHUNK_SIZE];
+    return MB->data[index];
 }
 
 extern void write_byte_to_memory_block(memory_block *MB, int32 index, int value)
-{   uchar *p; int ch = index/ALLOC_CHUNK_SIZE;
-    if (ch < 0)
-    {   compiler_error_named("memory: negative index to", chunk_name(MB, 0));
+{   if (index < 0)
+    {   compiler_error_named("memory: negative index to", block_name(MB));
         return;
     }
-    if (ch >= 72) memoryerror("ALLOC_CHUNK_SIZE", ALLOC_CHUNK_SIZE);
+    if (index >= MB->size) ensure_memory_block_available(MB, index+1);
+    MB->data[index] = value;
+}
+
+/*  The bulk forms copy count bytes at a time.  Writing at the current end
+    of the block appends to it; writing inside it patches what is there.     */
 
-    if (MB->chunk[ch] == NULL)
-    {   int i;
-        MB->chunk[ch] = my_malloc(ALLOC_CHUNK_SIZE, chunk_name(MB, ch));
-        p = MB->chunk[ch];
-        for (i=0; i<ALLOC_CHUNK_SIZE; i++) p[i] = 255;
+extern void read_bytes_from_memory_block(memory_block *MB, int32 index,
+    uchar *to, int32 count)
+{   if ((index < 0) || (count < 0) || (index+count > MB->size))
+    {   compiler_error_named("memory: read from unwritten byte in",
+            block_name(MB));
+        return;
+    }
+    if (count > 0) memcpy(to, MB->data + index, count);
+}
+
+extern void write_bytes_to_memory_block(memory_block *MB, int32 index,
+    uchar *from, int32 count)
+{   if ((index < 0) || (count < 0))
+    {   compiler_error_named("memory: negative index to", block_name(MB));
+        return;
     }
+    if (count == 0) return;
+    ensure_memory_block_available(MB, index+count);
+    memcpy(MB->data + index, from, count);
+}
+
+/* ------------------------------------------------------------------------- */
+/*   Growable arrays.  A memory list looks after one array, through a        */
+/*   pointer to the variable which holds it (so that the rest of Inform can  */
+/*   go on indexing the array directly), and reallocates it at twice the     */
+/*   size whenever more entries are needed than it has.  New entries are     */
+/*   zeroed, as if the array had been made by my_calloc().                   */
+/*                                                                           */
+/*   Since the array can move, no pointer into it may be kept across a call  */
+/*   which might add entries to it.                                          */
+/* ------------------------------------------------------------------------- */
+
+extern void initialise_memory_list(memory_list *ML, int32 itemsize,
+    int32 initalloc, void *dataref, char *whatfor)
+{   ML->whatfor = whatfor;
+    ML->itemsize = itemsize;
+    ML->count = 0;
+    ML->data = (void **) dataref;
+    *(ML->data) = NULL;
+    if (initalloc > 0) ensure_memory_list_available(ML, initalloc);
+}
 
-    p = MB->chunk[ch];
-    p[index % ALLOC_CHUNK_SIZE] = value;
+extern void deallocate_memory_list(memory_list *ML)
+{   if (ML->data != NULL) my_free(ML->data, ML->whatfor);
+    ML->count = 0;
+}
+
+extern void ensure_memory_list_available(memory_list *ML, int32 count)
+{   int32 oldcount = ML->count;
+
+    if (count <= oldcount) return;
+
+    ML->count = 2*oldcount;
+    if (ML->count < count) ML->count = count;
+    if (ML->count < 16) ML->count = 16;
+
+    if (*(ML->data) == NULL)
+        *(ML->data) = my_calloc(ML->itemsize, ML->count, ML->whatfor);
+    else
+    {   my_recalloc(ML->data, ML->itemsize, oldcount, ML->count,
+            ML->whatfor);
+        memset((char *) *(ML->data) + oldcount*ML->itemsize, 0,
+            (ML->count-oldcount)*ML->itemsize);
+    }
 }
 
 /* ------------------------------------------------------------------------- */
@@ -570,8 +637,9 @@ static void explain_parameter(char *command)
     }
     if (strcmp(command,"MAX_SYMBOLS")==0)
     {   printf(
-"  MAX_SYMBOLS is the maximum number of symbols - names of variables, \n\
-  objects, routines, the many internal Inform-generated names and so on.\n");
+"  MAX_SYMBOLS is the number of symbols - names of variables, objects, \n\
+  routines, the many internal Inform-generated names and so on - to make \n\
+  room for at first.  More room is made as needed.\n");
         return;
     }
     if (strcmp(command,"SYMBOLS_CHUNK_SIZE")==0)
@@ -582,33 +650,35 @@ static void explain_parameter(char *command)
     }
     if (strcmp(command,"HASH_TAB_SIZE")==0)
     {   printf(
-"  HASH_TAB_SIZE is the size of the hash tables used for the heaviest \n\
-  symbols banks.\n");
+"  HASH_TAB_SIZE is the size of the hash tables used for keywords and \n\
+  local variables.  (The symbols table grows as needed.)\n");
         return;
     }
     if (strcmp(command,"MAX_OBJECTS")==0)
     {   printf(
-"  MAX_OBJECTS is the maximum number of objects.  (If compiling a version-3 \n\
-  game, 255 is an absolute maximum in any event.)\n");
+"  MAX_OBJECTS is the number of objects to make room for at first.  More \n\
+  room is made as needed.  (If compiling a version-3 game, 255 is an \n\
+  absolute maximum in any event.)\n");
         return;
     }
     if (strcmp(command,"MAX_ACTIONS")==0)
     {   printf(
-"  MAX_ACTIONS is the maximum number of actions - that is, routines such as \n\
-  TakeSub which are referenced in the grammar table.\n");
+"  MAX_ACTIONS is the number of actions - that is, routines such as TakeSub \n\
+  which are referenced in the grammar table - to make room for at first.\n\
+  More room is made as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_ADJECTIVES")==0)
     {   printf(
-"  MAX_ADJECTIVES is the maximum number of different \"adjectives\" in the \n\
-  grammar table.  Adjectives are misleadingly named: they are words such as \n\
-  \"in\", \"under\" and the like.\n");
+"  MAX_ADJECTIVES is the number of different \"adjectives\" in the grammar \n\
+  table to make room for at first.  Adjectives are misleadingly named: they \n\
+  are words such as \"in\", \"under\" and the like.\n");
         return;
     }
     if (strcmp(command,"MAX_DICT_ENTRIES")==0)
     {   printf(
-"  MAX_DICT_ENTRIES is the maximum number of words which can be entered \n\
-  into the game's dictionary.  It costs 29 bytes to increase this by one.\n");
+"  MAX_DICT_ENTRIES is the number of dictionary words to make room for at \n\
+  first.  More room is made as needed.\n");
         return;
     }
     if (strcmp(command,"DICT_WORD_SIZE")==0)
@@ -658,52 +728,52 @@ static void explain_parameter(char *command)
     }
     if (strcmp(command,"MAX_STATIC_DATA")==0)
     {   printf(
-"  MAX_STATIC_DATA is the size of an array of integers holding initial \n\
-  values for arrays and strings stored as ASCII inside the Z-machine.  It \n\
-  should be at least 1024 but seldom needs much more.\n");
+"  MAX_STATIC_DATA is the initial size of an array of integers holding \n\
+  initial values for arrays and strings stored as ASCII inside the \n\
+  Z-machine.  It grows as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_PROP_TABLE_SIZE")==0)
     {   printf(
-"  MAX_PROP_TABLE_SIZE is the number of bytes allocated to hold the \n\
-  properties table.\n");
+"  MAX_PROP_TABLE_SIZE is the number of bytes allocated at first to hold \n\
+  the properties table, which grows as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_ABBREVS")==0)
     {   printf(
-"  MAX_ABBREVS is the maximum number of declared abbreviations.  It is not \n\
-  allowed to exceed 64.\n");
+"  MAX_ABBREVS is the number of declared abbreviations to make room for at \n\
+  first.  (Z-code allows at most 64 in any event.)\n");
         return;
     }
     if (strcmp(command,"MAX_ARRAYS")==0)
     {   printf(
-"  MAX_ARRAYS is the maximum number of declared arrays.\n");
+"  MAX_ARRAYS is the number of declared arrays to make room for at first.\n");
         return;
     }
     if (strcmp(command,"MAX_EXPRESSION_NODES")==0)
     {   printf(
-"  MAX_EXPRESSION_NODES is the maximum number of nodes in the expression \n\
-  evaluator's storage for parse trees.  In effect, it measures how \n\
-  complicated algebraic expressions are allowed to be.  Increasing it by \n\
-  one costs about 80 bytes.\n");
+"  MAX_EXPRESSION_NODES is the number of nodes in the expression \n\
+  evaluator's storage for parse trees to make room for at first.  More \n\
+  room is made for complicated expressions as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_VERBS")==0)
     {   printf(
-"  MAX_VERBS is the maximum number of verbs (such as \"take\") which can be \n\
-  defined, each with its own grammar.  To increase it by one costs about\n\
-  128 bytes.  A full game will contain at least 100.\n");
+"  MAX_VERBS is the number of verbs (such as \"take\"), each with its own \n\
+  grammar, to make room for at first.  A full game will contain at least \n\
+  100.  (Z-code allows at most 255 in any event.)\n");
         return;
     }
     if (strcmp(command,"MAX_VERBSPACE")==0)
     {   printf(
-"  MAX_VERBSPACE is the size of workspace used to store verb words, so may\n\
-  need increasing in games with many synonyms: unlikely to exceed 4K.\n");
+"  MAX_VERBSPACE is the initial size of workspace used to store verb words,\n\
+  which grows as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_LABELS")==0)
     {   printf(
-"  MAX_LABELS is the maximum number of label points in any one routine.\n\
+"  MAX_LABELS is the number of label points in any one routine to make \n\
+  room for at first.\n\
   (If the -k debugging information switch is set, MAX_LABELS is raised to\n\
   a minimum level of 2000, as about twice the normal number of label points\n\
   are needed to generate tables of how source code corresponds to positions\n\
@@ -712,84 +782,81 @@ static void explain_parameter(char *command)
     }
     if (strcmp(command,"MAX_LINESPACE")==0)
     {   printf(
-"  MAX_LINESPACE is the size of workspace used to store grammar lines, so \n\
-  may need increasing in games with complex or extensive grammars.\n");
+"  MAX_LINESPACE is the initial size of workspace used to store grammar \n\
+  lines, which grows as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_STATIC_STRINGS")==0)
     {
         printf(
-"  MAX_STATIC_STRINGS is the size in bytes of a buffer to hold compiled\n\
-  strings before they're written into longer-term storage.  2000 bytes is \n\
-  plenty, allowing string constants of up to about 3000 characters long.\n\
-  Inform automatically ensures that this is at least twice the size of\n\
-  MAX_QTEXT_SIZE, to be on the safe side.");
+"  MAX_STATIC_STRINGS is the initial size in bytes of a buffer to hold \n\
+  compiled strings before they're written into longer-term storage.  It \n\
+  grows as needed.");
         return;
     }
     if (strcmp(command,"MAX_ZCODE_SIZE")==0)
     {
         printf(
-"  MAX_ZCODE_SIZE is the size in bytes of a buffer to hold compiled \n\
-  code for a single routine.  (It applies to both Z-code and Glulx, \n\
-  despite the name.)  As a guide, the longest library routine is \n\
-  about 6500 bytes long in Z-code; about twice that in Glulx.");
+"  MAX_ZCODE_SIZE is the initial size in bytes of a buffer to hold \n\
+  compiled code for a single routine, which grows as needed.  (It applies \n\
+  to both Z-code and Glulx, despite the name.)");
         return;
     }
     if (strcmp(command,"MAX_LINK_DATA_SIZE")==0)
     {
         printf(
-"  MAX_LINK_DATA_SIZE is the size in bytes of a buffer to hold module \n\
-  link data before it's written into longer-term storage.  2000 bytes \n\
-  is plenty.");
+"  MAX_LINK_DATA_SIZE is the initial size in bytes of a buffer to hold \n\
+  module link data before it's written into longer-term storage.");
         return;
     }
     if (strcmp(command,"MAX_LOW_STRINGS")==0)
     {   printf(
-"  MAX_LOW_STRINGS is the size in bytes of a buffer to hold all the \n\
-  compiled \"low strings\" which are to be written above the synonyms table \n\
-  in the Z-machine.  1024 is plenty.\n");
+"  MAX_LOW_STRINGS is the initial size in bytes of a buffer to hold all \n\
+  the compiled \"low strings\" which are to be written above the synonyms \n\
+  table in the Z-machine.  It grows as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_TRANSCRIPT_SIZE")==0)
     {   printf(
 "  MAX_TRANSCRIPT_SIZE is only allocated for the abbreviations optimisation \n\
-  switch, and has the size in bytes of a buffer to hold the entire text of\n\
-  the game being compiled: it has to be enormous, say 100000 to 200000.\n");
+  switch, and is the initial size in bytes of a buffer to hold the entire \n\
+  text of the game being compiled, which grows as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_CLASSES")==0)
     {   printf(
-"  MAX_CLASSES maximum number of object classes which can be defined.  This\n\
-  is cheap to increase.\n");
+"  MAX_CLASSES is the number of object classes to make room for at first.\n\
+  More room is made as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_INCLUSION_DEPTH")==0)
     {   printf(
-"  MAX_INCLUSION_DEPTH is the number of nested includes permitted.\n");
+"  MAX_INCLUSION_DEPTH is the number of nested includes to make room for \n\
+  at first.\n");
         return;
     }
     if (strcmp(command,"MAX_SOURCE_FILES")==0)
     {   printf(
-"  MAX_SOURCE_FILES is the number of source files that can be read in the \n\
-  compilation.\n");
+"  MAX_SOURCE_FILES is the number of source files to make room for at \n\
+  first.\n");
         return;
     }
     if (strcmp(command,"MAX_INDIV_PROP_TABLE_SIZE")==0)
     {   printf(
-"  MAX_INDIV_PROP_TABLE_SIZE is the number of bytes allocated to hold the \n\
-  table of ..variable values.\n");
+"  MAX_INDIV_PROP_TABLE_SIZE is the number of bytes allocated at first to \n\
+  hold the table of ..variable values, which grows as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_OBJ_PROP_COUNT")==0)
     {   printf(
-"  MAX_OBJ_PROP_COUNT is the maximum number of properties a single object \n\
-  can have. (Glulx only)\n");
+"  MAX_OBJ_PROP_COUNT is the number of properties of a single object to \n\
+  make room for at first. (Glulx only)\n");
         return;
     }
     if (strcmp(command,"MAX_OBJ_PROP_TABLE_SIZE")==0)
     {   printf(
-"  MAX_OBJ_PROP_TABLE_SIZE is the number of words allocated to hold a \n\
-  single object's properties. (Glulx only)\n");
+"  MAX_OBJ_PROP_TABLE_SIZE is the number of words allocated at first to \n\
+  hold a single object's properties. (Glulx only)\n");
         return;
     }
     if (strcmp(command,"MAX_LOCAL_VARIABLES")==0)
@@ -807,23 +874,24 @@ static void explain_parameter(char *command)
     if (strcmp(command,"MAX_NUM_STATIC_STRINGS")==0)
     {
         printf(
-"  MAX_NUM_STATIC_STRINGS is the maximum number of compiled strings \n\
-  allowed in the program. (Glulx only)\n");
+"  MAX_NUM_STATIC_STRINGS is the number of compiled strings to make room \n\
+  for at first. (Glulx only)\n");
         return;
     }
     if (strcmp(command,"MAX_UNICODE_CHARS")==0)
     {
         printf(
-"  MAX_UNICODE_CHARS is the maximum number of different Unicode characters \n\
-  (beyond the Latin-1 range, $00..$FF) which the game text can use. \n\
-  (Glulx only)\n");
+"  MAX_UNICODE_CHARS is the number of different Unicode characters (beyond \n\
+  the Latin-1 range, $00..$FF) used by the game text to make room for at \n\
+  first. (Glulx only)\n");
         return;
     }
     if (strcmp(command,"ALLOC_CHUNK_SIZE")==0)
     {
         printf(
-"  ALLOC_CHUNK_SIZE is a base unit of Inform's internal memory allocation \n\
-  for various structures.\n");
+"  ALLOC_CHUNK_SIZE is the number of bytes first allocated for each of \n\
+  Inform's internal memory blocks (the code area, the static strings area, \n\
+  and so on).  More room is made as needed.\n");
         return;
     }
     if (strcmp(command,"MAX_STACK_SIZE")==0)
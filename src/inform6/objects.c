@@ -351,6 +351,33 @@ static int   *classes_to_inherit_from;
 int          *class_object_numbers;
 int32        *class_begins_at;
 
+/*  All of these, and the properties and individuals tables, grow as objects
+    and classes are made: MAX_OBJECTS and the like are only initial sizes    */
+
+memory_list properties_table_memlist, individuals_table_memlist;
+static memory_list objectsz_memlist, objectsg_memlist, objectatts_memlist,
+    classes_to_inherit_from_memlist, class_object_numbers_memlist,
+    class_begins_at_memlist, props_memlist, propdata_memlist;
+
+extern void ensure_objects_available(int count)
+{   if (!glulx_mode)
+        ensure_memory_list_available(&objectsz_memlist, count);
+    else
+    {   ensure_memory_list_available(&objectsg_memlist, count);
+        ensure_memory_list_available(&objectatts_memlist, count);
+    }
+}
+
+extern void ensure_classes_available(int count)
+{   ensure_memory_list_available(&class_begins_at_memlist, count);
+    ensure_memory_list_available(&class_object_numbers_memlist, count);
+}
+
+static void ensure_object_props_available(int numprops, int32 propdatasize)
+{   ensure_memory_list_available(&props_memlist, numprops);
+    ensure_memory_list_available(&propdata_memlist, propdatasize);
+}
+
 
 /* ------------------------------------------------------------------------- */
 /*   Tracing for compiler maintenance                                        */
@@ -498,9 +525,9 @@ so many values that the list has overflowed the maximum 32 entries");
                             {   if (module_switch)
                                     backpatch_zmachine(IDENT_MV,
                                         INDIVIDUAL_PROP_ZA, i_m);
-                                if (i_m+3+p[2] > MAX_INDIV_PROP_TABLE_SIZE)
-                                    memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                                        MAX_INDIV_PROP_TABLE_SIZE);
+                                ensure_memory_list_available
+                                    (&individuals_table_memlist, i_m+3+p[2]);
+                                p = individuals_table + z;
                                 individuals_table[i_m++] = p[0];
                                 individuals_table[i_m++] = p[1];
                                 individuals_table[i_m++] = p[2];
@@ -565,9 +592,9 @@ so many values that the list has overflowed the maximum 32 entries");
                     while ((p[0]!=0)||(p[1]!=0))
                     {   if (module_switch)
                         backpatch_zmachine(IDENT_MV, INDIVIDUAL_PROP_ZA, i_m);
-                        if (i_m+3+p[2] > MAX_INDIV_PROP_TABLE_SIZE)
-                            memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                                MAX_INDIV_PROP_TABLE_SIZE);
+                        ensure_memory_list_available
+                            (&individuals_table_memlist, i_m+3+p[2]);
+                        p = individuals_table + z;
                         individuals_table[i_m++] = p[0];
                         individuals_table[i_m++] = p[1];
                         individuals_table[i_m++] = p[2];
@@ -588,10 +615,7 @@ so many values that the list has overflowed the maximum 32 entries");
 
     if (individual_prop_table_size > 0)
     {
-        if (i_m+2 > MAX_INDIV_PROP_TABLE_SIZE)
-            memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                MAX_INDIV_PROP_TABLE_SIZE);
-
+        ensure_memory_list_available(&individuals_table_memlist, i_m+2);
         individuals_table[i_m++] = 0;
         individuals_table[i_m++] = 0;
         individuals_length += 2;
@@ -667,16 +691,14 @@ static void property_inheritance_g(void)
               }
             }
           }
+          ensure_object_props_available(full_object_g.numprops+1,
+            full_object_g.propdatasize + prop_length);
           k = full_object_g.numprops++;
           full_object_g.props[k].num = prop_number;
           full_object_g.props[k].flags = 0;
           full_object_g.props[k].datastart = full_object_g.propdatasize;
           full_object_g.props[k].continuation = prevcont+1;
           full_object_g.props[k].datalen = prop_length;
-          if (full_object_g.propdatasize + prop_length 
-            > MAX_OBJ_PROP_TABLE_SIZE) {
-            memoryerror("MAX_OBJ_PROP_TABLE_SIZE",MAX_OBJ_PROP_TABLE_SIZE);
-          }
 
           for (i=0; i<prop_length; i++) {
             int ppos = full_object_g.propdatasize++;
@@ -695,16 +717,14 @@ static void property_inheritance_g(void)
             /*  The case where the class defined a property which wasn't
                 defined at all in full_object_g: we copy out the data into
                 a new property added to full_object_g. */
+            ensure_object_props_available(full_object_g.numprops+1,
+              full_object_g.propdatasize + prop_length);
             k = full_object_g.numprops++;
             full_object_g.props[k].num = prop_number;
             full_object_g.props[k].flags = prop_flags;
             full_object_g.props[k].datastart = full_object_g.propdatasize;
             full_object_g.props[k].continuation = 0;
             full_object_g.props[k].datalen = prop_length;
-            if (full_object_g.propdatasize + prop_length 
-              > MAX_OBJ_PROP_TABLE_SIZE) {
-              memoryerror("MAX_OBJ_PROP_TABLE_SIZE",MAX_OBJ_PROP_TABLE_SIZE);
-            }
 
             for (i=0; i<prop_length; i++) {
               int ppos = full_object_g.propdatasize++;
@@ -713,10 +733,6 @@ static void property_inheritance_g(void)
               full_object_g.propdata[ppos].type = CONSTANT_OT;
             }
           }
-
-          if (full_object_g.numprops == MAX_OBJ_PROP_COUNT) {
-            memoryerror("MAX_OBJ_PROP_COUNT",MAX_OBJ_PROP_COUNT);
-          }
     }
   }
   
@@ -728,14 +744,13 @@ static void property_inheritance_g(void)
 
 static int write_properties_between(uchar *p, int mark, int from, int to)
 {   int j, k, prop_number, prop_length;
-    /* Note that p is properties_table. */
+    /* Note that p is properties_table, which the caller has already made
+       large enough. */
     for (prop_number=to; prop_number>=from; prop_number--)
     {   for (j=0; j<full_object.l; j++)
         {   if ((full_object.pp[j].num == prop_number)
                 && (full_object.pp[j].l != 100))
             {   prop_length = 2*full_object.pp[j].l;
-                if (mark+2+prop_length >= MAX_PROP_TABLE_SIZE)
-                    memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
                 if (version_number == 3)
                     p[mark++] = prop_number + (prop_length - 1)*32;
                 else
@@ -774,18 +789,29 @@ static int write_property_block_z(char *shortname)
 
         Return the number of bytes written to the block.                     */
 
-    int32 mark = properties_table_size, i;
-    uchar *p = (uchar *) properties_table;
+    int32 mark = properties_table_size, i, size;
+    uchar *p;
 
     /* printf("Object at %04x\n", mark); */
 
+    /*  Make room for the largest block these properties could need: the
+        short name, the class attributes, two terminating zeros and each
+        property with its two size bytes                                     */
+
+    size = 1 + 510 + 6 + 2;
+    for (i=0; i<full_object.l; i++)
+        if (full_object.pp[i].l != 100)
+            size += 2 + 2*full_object.pp[i].l;
+    ensure_memory_list_available(&properties_table_memlist, mark + size);
+    p = (uchar *) properties_table;
+
     if (shortname != NULL)
-    {   uchar *tmp;
-        if (mark+1+510 >= MAX_PROP_TABLE_SIZE)
-            memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
-        tmp = translate_text(p+mark+1,p+mark+1+510,shortname);
-        if (!tmp) error ("Short name of object exceeded 765 Z-characters");
-        i = subtract_pointers(tmp,(p+mark+1));
+    {   i = translate_text(510,shortname);
+        if (i < 0)
+        {   error ("Short name of object exceeded 765 Z-characters");
+            i = 0;
+        }
+        memcpy(p+mark+1, translated_text, i);
         p[mark] = i/2;
         mark += i+1;
     }
@@ -833,7 +859,17 @@ static int32 write_property_block_g(void)
   int ix, jx, kx, totalprops;
   int32 mark = properties_table_size;
   int32 datamark;
-  uchar *p = (uchar *) properties_table;
+  uchar *p;
+
+  /*  Make room for the largest block these properties could need: the
+      class attributes, the count, and a 10-byte entry and the data for
+      each property                                                          */
+
+  datamark = mark + NUM_ATTR_BYTES + 4;
+  for (ix=0; ix<full_object_g.numprops; ix++)
+    datamark += 10 + 4*full_object_g.props[ix].datalen;
+  ensure_memory_list_available(&properties_table_memlist, datamark);
+  p = (uchar *) properties_table;
 
   if (current_defn_is_class) {
     for (i=0;i<NUM_ATTR_BYTES;i++)
@@ -859,8 +895,6 @@ static int32 write_property_block_g(void)
   }
 
   /* Write out the number of properties in this table. */
-  if (mark+4 >= MAX_PROP_TABLE_SIZE)
-      memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
   WriteInt32(p+mark, totalprops);
   mark += 4;
 
@@ -877,8 +911,6 @@ static int32 write_property_block_g(void)
         jx<full_object_g.numprops && full_object_g.props[jx].num == propnum;
         jx++) {
       int32 datastart = full_object_g.props[jx].datastart;
-      if (datamark+4*full_object_g.props[jx].datalen >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
       for (kx=0; kx<full_object_g.props[jx].datalen; kx++) {
         int32 val = full_object_g.propdata[datastart+kx].value;
         WriteInt32(p+datamark, val);
@@ -889,8 +921,6 @@ static int32 write_property_block_g(void)
         datamark += 4;
       }
     }
-    if (mark+10 >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
     WriteInt16(p+mark, propnum);
     mark += 2;
     WriteInt16(p+mark, totallen);
@@ -920,6 +950,7 @@ static void manufacture_object_z(void)
 
     property_inheritance_z();
 
+    ensure_objects_available(no_objects+1);
     objectsz[no_objects].parent = parent_of_this_obj;
     objectsz[no_objects].next = 0;
     objectsz[no_objects].child = 0;
@@ -941,8 +972,6 @@ static void manufacture_object_z(void)
     j = write_property_block_z(shortname_buffer);
 
     objectsz[no_objects].propsize = j;
-    if (properties_table_size >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
 
     if (current_defn_is_class)
         for (i=0;i<6;i++) objectsz[no_objects].atts[i] = 0;
@@ -961,6 +990,7 @@ static void manufacture_object_g(void)
 
     property_inheritance_g();
 
+    ensure_objects_available(no_objects+1);
     objectsg[no_objects].parent = parent_of_this_obj;
     objectsg[no_objects].next = 0;
     objectsg[no_objects].child = 0;
@@ -987,8 +1017,6 @@ static void manufacture_object_g(void)
     objectsg[no_objects].propaddr = full_object_g.finalpropaddr;
 
     objectsg[no_objects].propsize = j;
-    if (properties_table_size >= MAX_PROP_TABLE_SIZE)
-        memoryerror("MAX_PROP_TABLE_SIZE",MAX_PROP_TABLE_SIZE);
 
     if (current_defn_is_class)
         for (i=0;i<NUM_ATTR_BYTES;i++) 
@@ -1093,6 +1121,7 @@ and may not be used as a property name too",
                 i_m = individuals_length;
                 full_object.l++;
             }
+            ensure_memory_list_available(&individuals_table_memlist, i_m+3);
             individuals_table[i_m] = this_identifier_number/256;
             if (this_segment == PRIVATE_SEGMENT)
                 individuals_table[i_m] |= 0x80;
@@ -1226,6 +1255,8 @@ the names '%s' and '%s' actually refer to the same property",
             {   if (AO.marker != 0)
                     backpatch_zmachine(AO.marker, INDIVIDUAL_PROP_ZA,
                         i_m+3+length);
+                ensure_memory_list_available(&individuals_table_memlist,
+                    i_m+3+length+2);
                 individuals_table[i_m+3+length++] = AO.value/256;
                 individuals_table[i_m+3+length++] = AO.value%256;
             }
@@ -1246,7 +1277,9 @@ the names '%s' and '%s' actually refer to the same property",
 
         if (length == 0)
         {   if (individual_property)
-            {   individuals_table[i_m+3+length++] = 0;
+            {   ensure_memory_list_available(&individuals_table_memlist,
+                    i_m+3+length+2);
+                individuals_table[i_m+3+length++] = 0;
                 individuals_table[i_m+3+length++] = 0;
             }
             else
@@ -1269,9 +1302,6 @@ the names '%s' and '%s' actually refer to the same property",
 
         if (individual_property)
         {
-            if (individuals_length+length+3 > MAX_INDIV_PROP_TABLE_SIZE)
-                memoryerror("MAX_INDIV_PROP_TABLE_SIZE",
-                    MAX_INDIV_PROP_TABLE_SIZE);
             individuals_table[i_m + 2] = length;
             individuals_length += length+3;
             i_m = individuals_length;
@@ -1352,6 +1382,8 @@ and may not be used as a property name too",
             defined_this_segment[def_t_s++] = token_value;
             property_number = svals[token_value];
 
+            ensure_object_props_available(full_object_g.numprops+1,
+                full_object_g.propdatasize);
             next_prop=full_object_g.numprops++;
             full_object_g.props[next_prop].num = property_number;
             full_object_g.props[next_prop].flags = 
@@ -1374,6 +1406,8 @@ not 'private':", token_text);
             defined_this_segment[def_t_s++] = token_value;
             property_number = svals[token_value];
 
+            ensure_object_props_available(full_object_g.numprops+1,
+                full_object_g.propdatasize);
             next_prop=full_object_g.numprops++;
             full_object_g.props[next_prop].num = property_number;
             full_object_g.props[next_prop].flags = 0;
@@ -1398,10 +1432,6 @@ the names '%s' and '%s' actually refer to the same property",
                 error(error_b);
             }
 
-        if (full_object_g.numprops == MAX_OBJ_PROP_COUNT) {
-          memoryerror("MAX_OBJ_PROP_COUNT",MAX_OBJ_PROP_COUNT);
-        }
-
         property_name_symbol = token_value;
         sflags[token_value] |= USED_SFLAG;
 
@@ -1489,9 +1519,8 @@ the names '%s' and '%s' actually refer to the same property",
                 break;
             }
 
-            if (full_object_g.propdatasize >= MAX_OBJ_PROP_TABLE_SIZE) {
-              memoryerror("MAX_OBJ_PROP_TABLE_SIZE",MAX_OBJ_PROP_TABLE_SIZE);
-            }
+            ensure_object_props_available(full_object_g.numprops,
+                full_object_g.propdatasize+1);
 
             full_object_g.propdata[full_object_g.propdatasize++] = AO;
             length += 1;
@@ -1512,6 +1541,8 @@ the names '%s' and '%s' actually refer to the same property",
             AO.value = 0;
             AO.type = CONSTANT_OT;
             AO.marker = 0;
+            ensure_object_props_available(full_object_g.numprops,
+                full_object_g.propdatasize+1);
             full_object_g.propdata[full_object_g.propdatasize++] = AO;
             length += 1;
         }
@@ -1614,6 +1645,8 @@ static void add_class_to_inheritance_list(int class_number)
     /*  Remember the inheritance list so that property inheritance can
         be sorted out later on, when the definition has been finished:       */
 
+    ensure_memory_list_available(&classes_to_inherit_from_memlist,
+        no_classes_to_inherit_from+1);
     classes_to_inherit_from[no_classes_to_inherit_from++] = class_number;
 
     /*  Inheriting attributes from the class at once:                        */
@@ -1746,9 +1779,6 @@ extern void make_class(char * metaclass_name)
     current_defn_is_class = TRUE; no_classes_to_inherit_from = 0;
     individual_prop_table_size = 0;
 
-    if (no_classes==MAX_CLASSES)
-        memoryerror("MAX_CLASSES", MAX_CLASSES);
-
     if (no_classes==VENEER_CONSTRAINT_ON_CLASSES)
         fatalerror("Inform's maximum possible number of classes (whatever \
 amount of memory is allocated) has been reached. If this causes serious \
@@ -1795,6 +1825,7 @@ inconvenience, please contact the maintainers.");
     if (metaclass_flag) parent_of_this_obj = 0;
     else parent_of_this_obj = (module_switch)?MAXINTWORD:1;
 
+    ensure_classes_available(no_classes+1);
     class_object_numbers[no_classes] = class_number;
 
     initialise_full_object();
@@ -1813,6 +1844,7 @@ inconvenience, please contact the maintainers.");
       full_object.pp[0].ao[0].marker = OBJECT_MV;
     }
     else {
+      ensure_object_props_available(1, 1);
       full_object_g.numprops = 1;
       full_object_g.props[0].num = 2;
       full_object_g.props[0].flags = 0;
@@ -1923,8 +1955,6 @@ extern void make_object(int nearby_flag,
 
     directives.enabled = FALSE;
 
-    if (no_objects==MAX_OBJECTS) memoryerror("MAX_OBJECTS", MAX_OBJECTS);
-
     sprintf(internal_name, "nameless_obj__%d", no_objects+1);
     objectname_text = internal_name;
 
@@ -2185,10 +2215,6 @@ extern void objects_begin_pass(void)
 
 extern void objects_allocate_arrays(void)
 {
-    objectsz = NULL;
-    objectsg = NULL;
-    objectatts = NULL;
-
     prop_default_value    = my_calloc(sizeof(int32), INDIV_PROP_START,
                                 "property default values");
     prop_is_long          = my_calloc(sizeof(int), INDIV_PROP_START,
@@ -2196,36 +2222,39 @@ extern void objects_allocate_arrays(void)
     prop_is_additive      = my_calloc(sizeof(int), INDIV_PROP_START,
                                 "property-is-additive flags");
 
-    classes_to_inherit_from = my_calloc(sizeof(int), MAX_CLASSES,
-                                "inherited classes list");
-    class_begins_at       = my_calloc(sizeof(int32), MAX_CLASSES,
-                                "pointers to classes");
-    class_object_numbers  = my_calloc(sizeof(int),     MAX_CLASSES,
-                                "class object numbers");
-
-    properties_table      = my_malloc(MAX_PROP_TABLE_SIZE,"properties table");
-    individuals_table     = my_malloc(MAX_INDIV_PROP_TABLE_SIZE,
-                                "individual properties table");
+    initialise_memory_list(&classes_to_inherit_from_memlist,
+        sizeof(int), MAX_CLASSES, &classes_to_inherit_from,
+        "inherited classes list");
+    initialise_memory_list(&class_begins_at_memlist,
+        sizeof(int32), MAX_CLASSES, &class_begins_at, "pointers to classes");
+    initialise_memory_list(&class_object_numbers_memlist,
+        sizeof(int), MAX_CLASSES, &class_object_numbers,
+        "class object numbers");
+
+    initialise_memory_list(&properties_table_memlist,
+        sizeof(char), MAX_PROP_TABLE_SIZE, &properties_table,
+        "properties table");
+    initialise_memory_list(&individuals_table_memlist,
+        sizeof(uchar), MAX_INDIV_PROP_TABLE_SIZE, &individuals_table,
+        "individual properties table");
 
     defined_this_segment_size = 128;
     defined_this_segment  = my_calloc(sizeof(int), defined_this_segment_size,
                                 "defined this segment table");
 
-    if (!glulx_mode) {
-      objectsz            = my_calloc(sizeof(objecttz), MAX_OBJECTS, 
-                                "z-objects");
-    }
-    else {
-      objectsg            = my_calloc(sizeof(objecttg), MAX_OBJECTS, 
-                                "g-objects");
-      objectatts          = my_calloc(NUM_ATTR_BYTES, MAX_OBJECTS, 
-                                "g-attributes");
-      full_object_g.props = my_calloc(sizeof(propg), MAX_OBJ_PROP_COUNT,
-                              "object property list");
-      full_object_g.propdata = my_calloc(sizeof(assembly_operand),
-                                 MAX_OBJ_PROP_TABLE_SIZE,
-                                 "object property data table");
-    }
+    initialise_memory_list(&objectsz_memlist,
+        sizeof(objecttz), glulx_mode?0:MAX_OBJECTS, &objectsz, "z-objects");
+    initialise_memory_list(&objectsg_memlist,
+        sizeof(objecttg), glulx_mode?MAX_OBJECTS:0, &objectsg, "g-objects");
+    initialise_memory_list(&objectatts_memlist,
+        NUM_ATTR_BYTES, glulx_mode?MAX_OBJECTS:0, &objectatts,
+        "g-attributes");
+    initialise_memory_list(&props_memlist,
+        sizeof(propg), glulx_mode?MAX_OBJ_PROP_COUNT:0, &full_object_g.props,
+        "object property list");
+    initialise_memory_list(&propdata_memlist,
+        sizeof(assembly_operand), glulx_mode?MAX_OBJ_PROP_TABLE_SIZE:0,
+        &full_object_g.propdata, "object property data table");
 }
 
 extern void objects_free_arrays(void)
@@ -2234,23 +2263,20 @@ extern void objects_free_arrays(void)
     my_free(&prop_is_long,     "property-is-long flags");
     my_free(&prop_is_additive, "property-is-additive flags");
 
-    my_free(&objectsz,         "z-objects");
-    my_free(&objectsg,         "g-objects");
-    my_free(&objectatts,       "g-attributes");
-    my_free(&class_object_numbers,"class object numbers");
-    my_free(&classes_to_inherit_from, "inherited classes list");
-    my_free(&class_begins_at,  "pointers to classes");
+    deallocate_memory_list(&objectsz_memlist);
+    deallocate_memory_list(&objectsg_memlist);
+    deallocate_memory_list(&objectatts_memlist);
+    deallocate_memory_list(&class_object_numbers_memlist);
+    deallocate_memory_list(&classes_to_inherit_from_memlist);
+    deallocate_memory_list(&class_begins_at_memlist);
 
-    my_free(&properties_table, "properties table");
-    my_free(&individuals_table,"individual properties table");
+    deallocate_memory_list(&properties_table_memlist);
+    deallocate_memory_list(&individuals_table_memlist);
 
     my_free(&defined_this_segment,"defined this segment table");
 
-    if (!glulx_mode) {
-        my_free(&full_object_g.props, "object property list");
-        my_free(&full_object_g.propdata, "object property data table");
-    }
-    
+    deallocate_memory_list(&props_memlist);
+    deallocate_memory_list(&propdata_memlist);
 }
 
 /* ========================================================================= */
@@ -61,20 +61,46 @@ int no_named_constants;                         /* Copied into story file    */
   maybe_file_position  *symbol_debug_backpatch_positions;
   maybe_file_position  *replacement_debug_backpatch_positions;
 
+/*  The arrays above grow together as symbols are created, starting from
+    room for MAX_SYMBOLS of them                                             */
+
+static memory_list symbs_memlist, svals_memlist, smarks_memlist,
+    slines_memlist, sflags_memlist, stypes_memlist,
+    symbol_debug_backpatch_positions_memlist,
+    replacement_debug_backpatch_positions_memlist;
+
+static void ensure_symbols_available(int32 count)
+{   ensure_memory_list_available(&symbs_memlist, count);
+    ensure_memory_list_available(&svals_memlist, count);
+    if (glulx_mode)
+        ensure_memory_list_available(&smarks_memlist, count);
+    ensure_memory_list_available(&slines_memlist, count);
+    ensure_memory_list_available(&sflags_memlist, count);
+    ensure_memory_list_available(&stypes_memlist, count);
+    if (debugfile_switch)
+    {   ensure_memory_list_available
+            (&symbol_debug_backpatch_positions_memlist, count);
+        ensure_memory_list_available
+            (&replacement_debug_backpatch_positions_memlist, count);
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 /*   Memory to hold the text of symbol names: note that this memory is       */
-/*   allocated as needed in chunks of size SYMBOLS_CHUNK_SIZE.               */
+/*   allocated as needed in chunks of size SYMBOLS_CHUNK_SIZE (or larger,    */
+/*   for a name which would not fit in one), and is never freed until the    */
+/*   end, so that the names form an "arena".                                 */
 /* ------------------------------------------------------------------------- */
 
-#define MAX_SYMBOL_CHUNKS (100)
-
 static uchar *symbols_free_space,       /* Next byte free to hold new names  */
            *symbols_ceiling;            /* Pointer to the end of the current
                                            allocation of memory for names    */
 
 static char** symbol_name_space_chunks; /* For chunks of memory used to hold
                                            the name strings of symbols       */
-static int no_symbol_name_space_chunks;
+static int no_symbol_name_space_chunks,
+           symbol_name_space_chunks_size;  /* Entries allocated for the
+                                           above, which doubles as needed    */
 
 typedef struct value_pair_struct {
     int original_symbol;
@@ -85,43 +111,62 @@ static int symbol_replacements_count;
 static int symbol_replacements_size; /* calloced size */
 
 /* ------------------------------------------------------------------------- */
-/*   The symbols table is "hash-coded" into a disjoint union of linked       */
-/*   lists, so that for any symbol i, next_entry[i] is either -1 (meaning    */
-/*   that it's the last in its list) or the next in the list.                */
-/*                                                                           */
-/*   Each list contains, in alphabetical order, all the symbols which share  */
-/*   the same "hash code" (a numerical function of the text of the symbol    */
-/*   name, designed with the aim that roughly equal numbers of symbols are   */
-/*   given each possible hash code).  The hash codes are 0 to HASH_TAB_SIZE  */
-/*   (which is a memory setting) minus 1: start_of_list[h] gives the first   */
-/*   symbol with hash code h, or -1 if no symbol exists with hash code h.    */
+/*   The symbols table is found through an "open addressing" hash table: an  */
+/*   array of slots, each either empty or holding a symbol number together   */
+/*   with the "hash value" of its name (a numerical function of the text,    */
+/*   designed with the aim that different names have different values).     */
+/*   A name is looked for starting at the slot chosen by its hash value and  */
+/*   moving on one slot at a time until it, or an empty slot, is found.  The */
+/*   names themselves are only compared when the hash values agree.          */
 /*                                                                           */
-/*   Note that the running time of the symbol search algorithm is about      */
+/*   The number of slots is a power of two, and is doubled whenever more     */
+/*   than half of them have been used, so that a search takes about the     */
+/*   same time however many symbols there are.  The hash values are kept in  */
+/*   the slots so that they need not be worked out again when this happens.  */
 /*                                                                           */
-/*       O ( n^2 / HASH_TAB_SIZE )                                           */
-/*                                                                           */
-/*   (where n is the number of symbols in the program) so that it is a good  */
-/*   idea to choose HASH_TAB_SIZE as large as conveniently possible.         */
+/*   A slot whose symbol has gone out of scope (see end_symbol_scope()) is   */
+/*   marked as such, rather than made empty, so that searches go past it.    */
 /* ------------------------------------------------------------------------- */
 
-static int   *next_entry;
-static int32 *start_of_list;
+#define EMPTY_SYMBOL_SLOT     (-1)
+#define ENDED_SYMBOL_SLOT     (-2)
+#define INITIAL_SYMBOL_SLOTS  (1024)
+
+typedef struct symbol_slot_s
+{   int32 symbol;
+    int32 hash_value;
+} symbol_slot;
+
+static symbol_slot *symbol_slots;
+static int32 no_symbol_slots,           /* Always a power of two             */
+             symbol_slots_used;         /* Slots which are not empty         */
+
+int32 symbol_lookups,                   /* Calls to symbol_index(), and...   */
+      symbol_probes;                    /* ...slots looked at by them, for
+                                           the statistics                    */
 
 /* ------------------------------------------------------------------------- */
 /*   Initialisation.                                                         */
 /* ------------------------------------------------------------------------- */
 
 static void init_symbol_banks(void)
-{   int i;
-    for (i=0; i<HASH_TAB_SIZE; i++) start_of_list[i] = -1;
+{   int32 i;
+    no_symbol_slots = INITIAL_SYMBOL_SLOTS;
+    symbol_slots = my_calloc(sizeof(symbol_slot), no_symbol_slots,
+                     "symbol hash table");
+    for (i=0; i<no_symbol_slots; i++) symbol_slots[i].symbol = EMPTY_SYMBOL_SLOT;
+    symbol_slots_used = 0;
+    symbol_lookups = 0;
+    symbol_probes = 0;
 }
 
 /* ------------------------------------------------------------------------- */
 /*   The hash coding we use is quite standard; the variable hashcode is      */
 /*   expected to overflow a good deal.  (The aim is to produce a number      */
 /*   so that similar names do not produce the same number.)  Note that       */
-/*   30011 is prime.  It doesn't matter if the unsigned int to int cast      */
-/*   behaves differently on different ports.                                 */
+/*   30011 is prime.  The hash value keeps 31 bits of this, so that it is    */
+/*   never negative; the hash code, used for the smaller tables of keywords  */
+/*   and local variables, is the hash value modulo HASH_TAB_SIZE.            */
 /* ------------------------------------------------------------------------- */
 
 int case_conversion_grid[128];
@@ -136,10 +181,53 @@ static void make_case_conversion_grid(void)
     for (i=0; i<26; i++) case_conversion_grid['A'+i]='a'+i;
 }
 
+extern int32 hash_value_from_string(char *p)
+{   uint32 hashcode=0; int c;
+    for (; *p; p++)
+    {   c = (uchar)*p;
+        if (c < 128) c = case_conversion_grid[c];
+        hashcode=hashcode*30011 + c;
+    }
+    return (int32) (hashcode & 0x7FFFFFFF);
+}
+
 extern int hash_code_from_string(char *p)
-{   uint32 hashcode=0;
-    for (; *p; p++) hashcode=hashcode*30011 + case_conversion_grid[(uchar)*p];
-    return (int) (hashcode % HASH_TAB_SIZE);
+{   return (int) (hash_value_from_string(p) % HASH_TAB_SIZE);
+}
+
+/*  The bits of the hash value are mixed before choosing a slot, because
+    with a power-of-two table only the lowest bits would otherwise count,
+    and these depend only on the lowest bits of each character              */
+
+static int32 first_symbol_slot(int32 hash_value)
+{   uint32 h = (uint32) hash_value;
+    h ^= h >> 16; h *= 0x85EBCA6BUL;
+    h ^= h >> 13; h *= 0xC2B2AE35UL;
+    h ^= h >> 16;
+    return (int32) (h & (no_symbol_slots-1));
+}
+
+static void grow_symbol_slots(void)
+{   symbol_slot *old_slots = symbol_slots;
+    int32 i, j, old_size = no_symbol_slots;
+
+    no_symbol_slots *= 2;
+    symbol_slots = my_calloc(sizeof(symbol_slot), no_symbol_slots,
+                     "symbol hash table");
+    for (i=0; i<no_symbol_slots; i++) symbol_slots[i].symbol = EMPTY_SYMBOL_SLOT;
+
+    /*  Symbols which have gone out of scope are dropped at this point       */
+
+    symbol_slots_used = 0;
+    for (i=0; i<old_size; i++)
+    {   if (old_slots[i].symbol < 0) continue;
+        j = first_symbol_slot(old_slots[i].hash_value);
+        while (symbol_slots[j].symbol != EMPTY_SYMBOL_SLOT)
+            j = (j+1) & (no_symbol_slots-1);
+        symbol_slots[j] = old_slots[i];
+        symbol_slots_used++;
+    }
+    my_free(&old_slots, "symbol hash table");
 }
 
 extern int strcmpcis(char *p, char *q)
@@ -161,70 +249,72 @@ extern int strcmpcis(char *p, char *q)
 /*   Symbol finding, creating, and removing.                                 */
 /* ------------------------------------------------------------------------- */
 
-extern int symbol_index(char *p, int hashcode)
+extern int symbol_index(char *p, int32 hash_value)
 {
     /*  Return the index in the symbs/svals/sflags/stypes/... arrays of symbol
         "p", creating a new symbol with that name if it isn't already there.
+        The caller may pass the hash value of "p" if it knows it, or -1.
 
         New symbols are created with flag UNKNOWN_SFLAG, value 0x100
         (a 2-byte quantity in Z-machine terms) and type CONSTANT_T.
 
         The string "p" is undamaged.                                         */
 
-    int32 new_entry, this, last; char *r;
-
-    if (hashcode == -1) hashcode = hash_code_from_string(p);
+    int32 slot, ended_slot = -1, this, length;
 
-    this = start_of_list[hashcode]; last = -1;
+    if (hash_value == -1) hash_value = hash_value_from_string(p);
 
-    do
-    {   if (this == -1) break;
-
-        r = (char *)symbs[this];
-        new_entry = strcmpcis(r, p);
-        if (new_entry == 0) 
+    symbol_lookups++;
+    for (slot = first_symbol_slot(hash_value);
+         (this = symbol_slots[slot].symbol) != EMPTY_SYMBOL_SLOT;
+         slot = (slot+1) & (no_symbol_slots-1))
+    {   symbol_probes++;
+        if (this == ENDED_SYMBOL_SLOT)
+        {   if (ended_slot == -1) ended_slot = slot;
+            continue;
+        }
+        if ((symbol_slots[slot].hash_value == hash_value)
+            && (strcmpcis((char *)symbs[this], p) == 0))
         {
             if (track_unused_routines)
                 df_note_function_symbol(this);
             return this;
         }
-        if (new_entry > 0) break;
-
-        last = this;
-        this = next_entry[this];
-    } while (this != -1);
-
-    if (no_symbols >= MAX_SYMBOLS)
-        memoryerror("MAX_SYMBOLS", MAX_SYMBOLS);
-
-    if (last == -1)
-    {   next_entry[no_symbols]=start_of_list[hashcode];
-        start_of_list[hashcode]=no_symbols;
-    }
-    else
-    {   next_entry[no_symbols]=this;
-        next_entry[last]=no_symbols;
     }
-
-    if (symbols_free_space+strlen(p)+1 >= symbols_ceiling)
-    {   symbols_free_space
-            = my_malloc(SYMBOLS_CHUNK_SIZE, "symbol names chunk");
-        symbols_ceiling = symbols_free_space + SYMBOLS_CHUNK_SIZE;
-        /* If we've passed MAX_SYMBOL_CHUNKS chunks, we print an error
-           message telling the user to increase SYMBOLS_CHUNK_SIZE.
-           That is the correct cure, even though the error comes out
-           worded inaccurately. */
-        if (no_symbol_name_space_chunks >= MAX_SYMBOL_CHUNKS)
-            memoryerror("SYMBOLS_CHUNK_SIZE", SYMBOLS_CHUNK_SIZE);
+    symbol_probes++;                       /* (The empty slot ending it)     */
+
+    ensure_symbols_available(no_symbols+1);
+
+    /*  Re-use the first slot of a symbol gone out of scope, if one was
+        passed on the way                                                    */
+
+    if (ended_slot != -1) slot = ended_slot;
+    else symbol_slots_used++;
+    symbol_slots[slot].symbol = no_symbols;
+    symbol_slots[slot].hash_value = hash_value;
+    if (2*symbol_slots_used > no_symbol_slots) grow_symbol_slots();
+
+    length = strlen(p)+1;
+    if (symbols_free_space+length >= symbols_ceiling)
+    {   int32 chunk_size = SYMBOLS_CHUNK_SIZE;
+        if (chunk_size <= length) chunk_size = length+1;
+        if (no_symbol_name_space_chunks == symbol_name_space_chunks_size)
+        {   my_recalloc(&symbol_name_space_chunks, sizeof(char *),
+                symbol_name_space_chunks_size,
+                2*symbol_name_space_chunks_size,
+                "symbol names chunk addresses");
+            symbol_name_space_chunks_size *= 2;
+        }
+        symbols_free_space
+            = my_malloc(chunk_size, "symbol names chunk");
+        symbols_ceiling = symbols_free_space + chunk_size;
         symbol_name_space_chunks[no_symbol_name_space_chunks++]
             = (char *) symbols_free_space;
-        if (symbols_free_space+strlen(p)+1 >= symbols_ceiling)
-            memoryerror("SYMBOLS_CHUNK_SIZE", SYMBOLS_CHUNK_SIZE);
     }
 
     strcpy((char *) symbols_free_space, p);
     symbs[no_symbols] = (int32 *) symbols_free_space;
-    symbols_free_space += strlen((char *)symbols_free_space) + 1;
+    symbols_free_space += length;
 
     svals[no_symbols]   =  0x100; /* ###-wrong? Would this fix the
                                      unbound-symbol-causes-asm-error? */
@@ -251,20 +341,14 @@ extern void end_symbol_scope(int k)
        If the symbol is not found, this silently does nothing.
     */
 
-    int j;
-    j = hash_code_from_string((char *) symbs[k]);
-    if (start_of_list[j] == k)
-    {   start_of_list[j] = next_entry[k];
-        return;
-    }
-    j = start_of_list[j];
-    while (j != -1)
-    {
-        if (next_entry[j] == k)
-        {   next_entry[j] = next_entry[k];
+    int32 slot;
+    for (slot = first_symbol_slot(hash_value_from_string((char *) symbs[k]));
+         symbol_slots[slot].symbol != EMPTY_SYMBOL_SLOT;
+         slot = (slot+1) & (no_symbol_slots-1))
+    {   if (symbol_slots[slot].symbol == k)
+        {   symbol_slots[slot].symbol = ENDED_SYMBOL_SLOT;
             return;
         }
-        j = next_entry[j];
     }
 }
 
@@ -1227,11 +1311,12 @@ extern void init_symbols_vars(void)
     smarks = NULL;
     stypes = NULL;
     sflags = NULL;
-    next_entry = NULL;
-    start_of_list = NULL;
+    symbol_slots = NULL;
+    no_symbol_slots = 0;
 
     symbol_name_space_chunks = NULL;
     no_symbol_name_space_chunks = 0;
+    symbol_name_space_chunks_size = 0;
     symbols_free_space=NULL;
     symbols_ceiling=symbols_free_space;
 
@@ -1262,28 +1347,30 @@ extern void symbols_begin_pass(void)
 
 extern void symbols_allocate_arrays(void)
 {
-    symbs      = my_calloc(sizeof(char *),  MAX_SYMBOLS, "symbols");
-    svals      = my_calloc(sizeof(int32),   MAX_SYMBOLS, "symbol values");
-    if (glulx_mode)
-        smarks = my_calloc(sizeof(int),     MAX_SYMBOLS, "symbol markers");
-    slines     = my_calloc(sizeof(int32),   MAX_SYMBOLS, "symbol lines");
-    stypes     = my_calloc(sizeof(char),    MAX_SYMBOLS, "symbol types");
-    sflags     = my_calloc(sizeof(int),     MAX_SYMBOLS, "symbol flags");
-    if (debugfile_switch)
-    {   symbol_debug_backpatch_positions =
-            my_calloc(sizeof(maybe_file_position), MAX_SYMBOLS,
-                      "symbol debug information backpatch positions");
-        replacement_debug_backpatch_positions =
-            my_calloc(sizeof(maybe_file_position), MAX_SYMBOLS,
-                      "replacement debug information backpatch positions");
-    }
-    next_entry = my_calloc(sizeof(int),     MAX_SYMBOLS,
-                     "symbol linked-list forward links");
-    start_of_list = my_calloc(sizeof(int32), HASH_TAB_SIZE,
-                     "hash code list beginnings");
-
+    initialise_memory_list(&symbs_memlist,
+        sizeof(int32 *), MAX_SYMBOLS, &symbs, "symbols");
+    initialise_memory_list(&svals_memlist,
+        sizeof(int32), MAX_SYMBOLS, &svals, "symbol values");
+    initialise_memory_list(&smarks_memlist,
+        sizeof(int), glulx_mode?MAX_SYMBOLS:0, &smarks, "symbol markers");
+    initialise_memory_list(&slines_memlist,
+        sizeof(int32), MAX_SYMBOLS, &slines, "symbol lines");
+    initialise_memory_list(&stypes_memlist,
+        sizeof(*stypes), MAX_SYMBOLS, &stypes, "symbol types");
+    initialise_memory_list(&sflags_memlist,
+        sizeof(int), MAX_SYMBOLS, &sflags, "symbol flags");
+    initialise_memory_list(&symbol_debug_backpatch_positions_memlist,
+        sizeof(maybe_file_position), debugfile_switch?MAX_SYMBOLS:0,
+        &symbol_debug_backpatch_positions,
+        "symbol debug information backpatch positions");
+    initialise_memory_list(&replacement_debug_backpatch_positions_memlist,
+        sizeof(maybe_file_position), debugfile_switch?MAX_SYMBOLS:0,
+        &replacement_debug_backpatch_positions,
+        "replacement debug information backpatch positions");
+    symbol_name_space_chunks_size = 64;
     symbol_name_space_chunks
-        = my_calloc(sizeof(char *), MAX_SYMBOL_CHUNKS, "symbol names chunk addresses");
+        = my_calloc(sizeof(char *), symbol_name_space_chunks_size,
+            "symbol names chunk addresses");
 
     if (track_unused_routines) {
         df_tables_closed = FALSE;
@@ -1323,22 +1410,15 @@ extern void symbols_free_arrays(void)
 
     my_free(&symbol_name_space_chunks, "symbol names chunk addresses");
 
-    my_free(&symbs, "symbols");
-    my_free(&svals, "symbol values");
-    my_free(&smarks, "symbol markers");
-    my_free(&slines, "symbol lines");
-    my_free(&stypes, "symbol types");
-    my_free(&sflags, "symbol flags");
-    if (debugfile_switch)
-    {   my_free
-            (&symbol_debug_backpatch_positions,
-             "symbol debug information backpatch positions");
-        my_free
-            (&replacement_debug_backpatch_positions,
-             "replacement debug information backpatch positions");
-    }
-    my_free(&next_entry, "symbol linked-list forward links");
-    my_free(&start_of_list, "hash code list beginnings");
+    deallocate_memory_list(&symbs_memlist);
+    deallocate_memory_list(&svals_memlist);
+    deallocate_memory_list(&smarks_memlist);
+    deallocate_memory_list(&slines_memlist);
+    deallocate_memory_list(&stypes_memlist);
+    deallocate_memory_list(&sflags_memlist);
+    deallocate_memory_list(&symbol_debug_backpatch_positions_memlist);
+    deallocate_memory_list(&replacement_debug_backpatch_positions_memlist);
+    my_free(&symbol_slots, "symbol hash table");
 
     if (symbol_replacements)
         my_free(&symbol_replacements, "symbol replacement table");
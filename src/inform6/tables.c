@@ -140,7 +140,7 @@ static int32 rough_size_of_paged_memory_z(void)
     ASSERT_ZCODE();
 
     total = 64                                                     /* header */
-            + 2 + subtract_pointers(low_strings_top, low_strings)
+            + 2 + low_strings_top
                                                          /* low strings pool */
             + 6*32;                                   /* abbreviations table */
 
@@ -274,7 +274,7 @@ static void construct_storyfile_z(void)
     p[mark]=0x80; p[mark+1]=0; mark+=2;        /* Start the low strings pool
                                          with a useful default string, "   " */
 
-    for (i=0; i+low_strings<low_strings_top; mark++, i++) /* Low strings pool */
+    for (i=0; i<low_strings_top; mark++, i++)            /* Low strings pool */
         p[0x42+i]=low_strings[i];
 
     abbrevs_at = mark;
@@ -940,10 +940,14 @@ or less.");
             }
 
             printf("Allocated:\n\
-%6d symbols (maximum %4d)    %8ld bytes of memory\n\
+%6d symbols (unlimited)      %8ld bytes of memory\n\
+%6ld symbol lookups            %8.2f slots searched per lookup\n\
 Out:   Version %d \"%s\" %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
-                 no_symbols, MAX_SYMBOLS,
+                 no_symbols,
                  (long int) malloced_bytes,
+                 (long int) symbol_lookups,
+                 (symbol_lookups == 0) ? 0.0
+                     : (double) symbol_probes / symbol_lookups,
                  version_number,
                  version_name(version_number),
                  output_called,
@@ -952,22 +956,22 @@ Out:   Version %d \"%s\" %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
 
             printf("\
 %6d classes (maximum %3d)        %6d objects (maximum %3d)\n\
-%6d global vars (maximum 233)    %6d variable/array space (maximum %d)\n",
-                 no_classes, MAX_CLASSES,
-                 no_objects, ((version_number==3)?255:(MAX_OBJECTS-1)),
+%6d global vars (maximum 233)    %6d variable/array space (unlimited)\n",
+                 no_classes, VENEER_CONSTRAINT_ON_CLASSES,
+                 no_objects, ((version_number==3)?255:65535),
                  no_globals,
-                 dynamic_array_area_size, MAX_STATIC_DATA);
+                 dynamic_array_area_size);
 
             printf(
-"%6d verbs (maximum %3d)          %6d dictionary entries (maximum %d)\n\
+"%6d verbs (maximum 255)          %6d dictionary entries (unlimited)\n\
 %6d grammar lines (version %d)    %6d grammar tokens (unlimited)\n\
 %6d actions (maximum %3d)        %6d attributes (maximum %2d)\n\
 %6d common props (maximum %2d)    %6d individual props (unlimited)\n",
-                 no_Inform_verbs, MAX_VERBS,
-                 dict_entries, MAX_DICT_ENTRIES,
+                 no_Inform_verbs,
+                 dict_entries,
                  no_grammar_lines, grammar_version_number,
                  no_grammar_tokens,
-                 no_actions, MAX_ACTIONS,
+                 no_actions, ((grammar_version_number==1)?256:4096),
                  no_attributes, ((version_number==3)?32:48),
                  no_properties-2, ((version_number==3)?30:62),
                  no_individual_properties - 64);
@@ -984,7 +988,7 @@ Out:   Version %d \"%s\" %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
 
             printf(
 "%6ld characters used in text      %6ld bytes compressed (rate %d.%3ld)\n\
-%6d abbreviations (maximum %d)   %6d routines (unlimited)\n\
+%6d abbreviations (maximum 64)   %6d routines (unlimited)\n\
 %6ld instructions of Z-code       %6d sequence points\n\
 %6ld bytes readable memory used (maximum 65536)\n\
 %6ld bytes used in Z-machine      %6ld bytes free in Z-machine\n",
@@ -992,7 +996,7 @@ Out:   Version %d \"%s\" %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
                  (long int) total_bytes_trans,
                  (total_chars_trans>total_bytes_trans)?0:1,
                  (long int) rate,
-                 no_abbreviations, MAX_ABBREVS,
+                 no_abbreviations,
                  no_routines,
                  (long int) no_instructions, no_sequence_points,
                  (long int) Write_Code_At,
@@ -1619,10 +1623,14 @@ table format requested (producing number 2 format instead)");
             {char serialnum[8];
             write_serial_number(serialnum);
             printf("Allocated:\n\
-%6d symbols (maximum %4d)    %8ld bytes of memory\n\
+%6d symbols (unlimited)      %8ld bytes of memory\n\
+%6ld symbol lookups            %8.2f slots searched per lookup\n\
 Out:   %s %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
-                 no_symbols, MAX_SYMBOLS,
+                 no_symbols,
                  (long int) malloced_bytes,
+                 (long int) symbol_lookups,
+                 (symbol_lookups == 0) ? 0.0
+                     : (double) symbol_probes / symbol_lookups,
                  version_name(version_number),
                  output_called,
                  release_number,
@@ -1632,23 +1640,23 @@ Out:   %s %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
             } 
 
             printf("\
-%6d classes (maximum %3d)        %6d objects (maximum %3d)\n\
-%6d global vars (maximum %3d)    %6d variable/array space (maximum %d)\n",
-                 no_classes, MAX_CLASSES,
-                 no_objects, MAX_OBJECTS,
+%6d classes (maximum %3d)        %6d objects (unlimited)\n\
+%6d global vars (maximum %3d)    %6d variable/array space (unlimited)\n",
+                 no_classes, VENEER_CONSTRAINT_ON_CLASSES,
+                 no_objects,
                  no_globals, MAX_GLOBAL_VARIABLES,
-                 dynamic_array_area_size, MAX_STATIC_DATA);
+                 dynamic_array_area_size);
 
             printf(
-"%6d verbs (maximum %3d)          %6d dictionary entries (maximum %d)\n\
+"%6d verbs (unlimited)            %6d dictionary entries (unlimited)\n\
 %6d grammar lines (version %d)    %6d grammar tokens (unlimited)\n\
 %6d actions (maximum %3d)        %6d attributes (maximum %2d)\n\
 %6d common props (maximum %3d)   %6d individual props (unlimited)\n",
-                 no_Inform_verbs, MAX_VERBS,
-                 dict_entries, MAX_DICT_ENTRIES,
+                 no_Inform_verbs,
+                 dict_entries,
                  no_grammar_lines, grammar_version_number,
                  no_grammar_tokens,
-                 no_actions, MAX_ACTIONS,
+                 no_actions, ((grammar_version_number==1)?256:4096),
                  no_attributes, NUM_ATTR_BYTES*8,
                  no_properties, INDIV_PROP_START,
                  no_individual_properties - INDIV_PROP_START);
@@ -1665,7 +1673,7 @@ Out:   %s %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
 
             printf(
 "%6ld characters used in text      %6ld bytes compressed (rate %d.%3ld)\n\
-%6d abbreviations (maximum %d)   %6d routines (unlimited)\n\
+%6d abbreviations (unlimited)    %6d routines (unlimited)\n\
 %6ld instructions of code         %6d sequence points\n\
 %6ld bytes writable memory used   %6ld bytes read-only memory used\n\
 %6ld bytes used in machine    %10ld bytes free in machine\n",
@@ -1673,7 +1681,7 @@ Out:   %s %s %d.%c%c%c%c%c%c (%ld%sK long):\n",
                  (long int) strings_length,
                  (total_chars_trans>strings_length)?0:1,
                  (long int) rate,
-                 no_abbreviations, MAX_ABBREVS,
+                 no_abbreviations,
                  no_routines,
                  (long int) no_instructions, no_sequence_points,
                  (long int) (Out_Size - Write_RAM_At),
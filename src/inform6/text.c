@@ -8,23 +8,33 @@
 
 #include "header.h"
 
-uchar *low_strings, *low_strings_top;  /* Start and next free byte in the low
-                                          strings pool */
+#ifdef HAS_PTHREADS
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+uchar *low_strings;                    /* The low strings pool           */
+int32 low_strings_top;                 /* Next free byte in it               */
+static memory_list low_strings_memlist;
 
 int32 static_strings_extent;           /* Number of bytes of static strings
                                           made so far */
 memory_block static_strings_area;      /* Used if (!temporary_files_switch) to
                                           hold the static strings area so far */
 
-static uchar *strings_holding_area;    /* Area holding translated strings
-                                          until they are moved into either
-                                          a temporary file, or the
-                                          static_strings_area below */
+uchar *translated_text;                /* Area holding the output of
+                                          translate_text() until the caller
+                                          moves it into a temporary file,
+                                          the static_strings_area below, or
+                                          wherever else it belongs          */
+static memory_list translated_text_memlist;
 
 char *all_text, *all_text_top;         /* Start and next byte free in (large)
                                           text buffer holding the entire text
                                           of the game, when it is being
                                           recorded                           */
+static memory_list all_text_memlist;
 int put_strings_in_low_memory,         /* When TRUE, put static strings in
                                           the low strings pool at 0x100 rather
                                           than in the static strings area    */
@@ -36,13 +46,15 @@ int put_strings_in_low_memory,         /* When TRUE, put static strings in
                                           abbreviation string is translated:
                                           this flag is TRUE after that       */
     abbrevs_lookup[256];               /* Once this has been constructed,
-                                          abbrevs_lookup[n] = the smallest
-                                          number of any abbreviation beginning
-                                          with ASCII character n, or -1
-                                          if none of the abbreviations do    */
+                                          abbrevs_lookup[n] = the node of the
+                                          abbreviations trie for the prefix
+                                          of ASCII character n, or -1
+                                          if none of the abbreviations begin
+                                          with it                            */
 int no_abbreviations;                  /* No of abbreviations defined so far */
 uchar *abbreviations_at;                 /* Memory to hold the text of any
                                           abbreviation strings declared      */
+static memory_list abbreviations_at_memlist;
 /* ------------------------------------------------------------------------- */
 /*   Glulx string compression storage                                        */
 /* ------------------------------------------------------------------------- */
@@ -55,11 +67,11 @@ int no_dynamic_strings;                /* No. of @.. string escapes used
 int no_unicode_chars;                  /* Number of distinct Unicode chars
                                           used. (Beyond 0xFF.)               */
 
-static int MAX_CHARACTER_SET;          /* Number of possible entities */
 huffentity_t *huff_entities;           /* The list of entities (characters,
                                           abbreviations, @.. escapes, and 
                                           the terminator)                    */
 static huffentity_t **hufflist;        /* Copy of the list, for sorting      */
+static memory_list huff_entities_memlist, hufflist_memlist;
 
 int no_huff_entities;                  /* The number of entities in the list */
 int huff_unicode_start;                /* Position in the list where Unicode
@@ -77,6 +89,7 @@ int32 compression_table_size;          /* Length of the Huffman table, in
                                           bytes                              */
 int32 compression_string_size;         /* Length of the compressed string
                                           data, in bytes                     */
+static memory_list compressed_offsets_memlist;
 int32 *compressed_offsets;             /* The beginning of every string in
                                           the game, relative to the beginning
                                           of the Huffman table. (So entry 0
@@ -84,7 +97,8 @@ int32 *compressed_offsets;             /* The beginning of every string in
 
 #define UNICODE_HASH_BUCKETS (64)
 unicode_usage_t *unicode_usage_entries;
-static unicode_usage_t *unicode_usage_hash[UNICODE_HASH_BUCKETS];
+static memory_list unicode_usage_entries_memlist;
+static int unicode_usage_hash[UNICODE_HASH_BUCKETS];
 
 static int unicode_entity_index(int32 unicode);
 
@@ -95,6 +109,8 @@ static int unicode_entity_index(int32 unicode);
 int *abbrev_values;
 int *abbrev_quality;
 int *abbrev_freqs;
+static memory_list abbrev_values_memlist, abbrev_quality_memlist,
+    abbrev_freqs_memlist;
 
 /* ------------------------------------------------------------------------- */
 
@@ -114,15 +130,17 @@ static int zchars_out_buffer[3],       /* During text translation, a buffer of
                                           these are written as a 2-byte word */
            zob_index;                  /* Index (0 to 2) into it             */
 
-static unsigned char *text_out_pc;     /* The "program counter" during text
-                                          translation: the next address to
-                                          write Z-coded text output to       */
+static int32 text_out_pos;             /* The "program counter" during text
+                                          translation: the next position in
+                                          translated_text to write Z-coded
+                                          text output to                     */
 
-static unsigned char *text_out_limit;  /* The upper limit of text_out_pc
-                                          during text translation            */
+static int32 text_out_limit;           /* The upper limit of text_out_pos
+                                          during text translation, or -1 if
+                                          there is none                      */
 
 static int text_out_overflow;          /* During text translation, becomes
-                                          true if text_out_pc tries to pass
+                                          true if text_out_pos tries to pass
                                           text_out_limit                     */
 
 /* ------------------------------------------------------------------------- */
@@ -131,34 +149,104 @@ static int text_out_overflow;          /* During text translation, becomes
 
 /* ------------------------------------------------------------------------- */
 /*   Prepare the abbreviations lookup table (used to speed up abbreviation   */
-/*   detection in text translation).  We first bubble-sort the abbrevs into  */
-/*   alphabetical order (this is necessary for the detection algorithm to    */
-/*   to work).  Since the table is only prepared once, and for a table       */
-/*   of size at most 96, there's no point using an efficient sort algorithm. */
+/*   detection in text translation).  We first sort the abbrevs into reverse */
+/*   alphabetical order, so that where one abbreviation begins another, the  */
+/*   longer comes first (this fixes their numbering in the story file).      */
+/*                                                                           */
+/*   They are then compiled into a trie: a tree of nodes, one for each      */
+/*   distinct prefix of an abbreviation, so that the text can be matched     */
+/*   against all of them at once by following one character at a time.      */
+/*   abbrevs_lookup[c] is the node for the one-character prefix c, and the   */
+/*   children of each node are a linked list.                                */
 /* ------------------------------------------------------------------------- */
 
+typedef struct abbrev_trie_node_s
+{   int c;                             /* Last character of the prefix       */
+    int abbrev;                        /* Number of the abbreviation which is
+                                          exactly this prefix, or -1         */
+    int child, sibling;                /* Node numbers, or -1 if none        */
+} abbrev_trie_node;
+
+static abbrev_trie_node *abbrev_trie;
+static int abbrev_trie_size;
+
+static int new_abbrev_trie_node(int c)
+{   abbrev_trie_node *node = abbrev_trie + abbrev_trie_size;
+    node->c = c;
+    node->abbrev = -1;
+    node->child = -1;
+    node->sibling = -1;
+    return(abbrev_trie_size++);
+}
+
+static int compare_abbreviations(const void *a, const void *b)
+{   int j = *((const int *) a), k = *((const int *) b);
+    int order = strcmp((char *)abbreviations_at+j*MAX_ABBREV_LENGTH,
+                       (char *)abbreviations_at+k*MAX_ABBREV_LENGTH);
+    if (order != 0) return(-order);
+    return(j - k);
+}
+
+static void sort_abbreviations(void)
+{   int j, *order, *values, *quality; char *texts;
+
+    order   = my_calloc(sizeof(int), no_abbreviations, "abbreviation order");
+    values  = my_calloc(sizeof(int), no_abbreviations, "abbrev values copy");
+    quality = my_calloc(sizeof(int), no_abbreviations, "abbrev quality copy");
+    texts   = my_malloc(no_abbreviations*MAX_ABBREV_LENGTH,
+                        "abbreviations copy");
+
+    for (j=0; j<no_abbreviations; j++) order[j] = j;
+    qsort(order, no_abbreviations, sizeof(int), compare_abbreviations);
+
+    memcpy(texts, abbreviations_at, no_abbreviations*MAX_ABBREV_LENGTH);
+    for (j=0; j<no_abbreviations; j++)
+    {   values[j] = abbrev_values[j];
+        quality[j] = abbrev_quality[j];
+    }
+    for (j=0; j<no_abbreviations; j++)
+    {   strcpy((char *)abbreviations_at+j*MAX_ABBREV_LENGTH,
+               texts+order[j]*MAX_ABBREV_LENGTH);
+        abbrev_values[j] = values[order[j]];
+        abbrev_quality[j] = quality[order[j]];
+    }
+
+    my_free(&texts, "abbreviations copy");
+    my_free(&quality, "abbrev quality copy");
+    my_free(&values, "abbrev values copy");
+    my_free(&order, "abbreviation order");
+}
+
 static void make_abbrevs_lookup(void)
-{   int bubble_sort, j, k, l; char p[MAX_ABBREV_LENGTH]; char *p1, *p2;
-    do
-    {   bubble_sort = FALSE;
-        for (j=0; j<no_abbreviations; j++)
-            for (k=j+1; k<no_abbreviations; k++)
-            {   p1=(char *)abbreviations_at+j*MAX_ABBREV_LENGTH;
-                p2=(char *)abbreviations_at+k*MAX_ABBREV_LENGTH;
-                if (strcmp(p1,p2)<0)
-                {   strcpy(p,p1); strcpy(p1,p2); strcpy(p2,p);
-                    l=abbrev_values[j]; abbrev_values[j]=abbrev_values[k];
-                    abbrev_values[k]=l;
-                    l=abbrev_quality[j]; abbrev_quality[j]=abbrev_quality[k];
-                    abbrev_quality[k]=l;
-                    bubble_sort = TRUE;
-                }
-            }
-    } while (bubble_sort);
+{   int j, k, size, node, child; uchar *p;
 
-    for (j=no_abbreviations-1; j>=0; j--)
-    {   p1=(char *)abbreviations_at+j*MAX_ABBREV_LENGTH;
-        abbrevs_lookup[(uchar)p1[0]]=j;
+    sort_abbreviations();
+
+    for (j=0, size=0; j<no_abbreviations; j++)
+        size += strlen((char *)abbreviations_at+j*MAX_ABBREV_LENGTH);
+    my_free(&abbrev_trie, "abbreviations trie");
+    abbrev_trie = my_calloc(sizeof(abbrev_trie_node), size,
+                            "abbreviations trie");
+    abbrev_trie_size = 0;
+
+    for (j=0; j<256; j++) abbrevs_lookup[j] = -1;
+    for (j=0; j<no_abbreviations; j++)
+    {   p=(uchar *)abbreviations_at+j*MAX_ABBREV_LENGTH;
+        node = abbrevs_lookup[p[0]];
+        if (node == -1) node = abbrevs_lookup[p[0]] = new_abbrev_trie_node(p[0]);
+        for (k=1; p[k]!=0; k++)
+        {   for (child=abbrev_trie[node].child; child!=-1;
+                 child=abbrev_trie[child].sibling)
+                if (abbrev_trie[child].c == p[k]) break;
+            if (child == -1)
+            {   child = new_abbrev_trie_node(p[k]);
+                abbrev_trie[child].sibling = abbrev_trie[node].child;
+                abbrev_trie[node].child = child;
+            }
+            node = child;
+        }
+        /*  If the same text is declared twice, the first one is used        */
+        if (abbrev_trie[node].abbrev == -1) abbrev_trie[node].abbrev = j;
         abbrev_freqs[j]=0;
     }
     abbrevs_lookup_table_made = TRUE;
@@ -168,9 +256,9 @@ static void make_abbrevs_lookup(void)
 /*   Search the abbreviations lookup table (a routine which must be fast).   */
 /*   The source text to compare is text[i], text[i+1], ... and this routine  */
 /*   is only called if text[i] is indeed the first character of at least one */
-/*   abbreviation, "from" begin the least index into the abbreviations table */
-/*   of an abbreviation for which text[i] is the first character.  Recall    */
-/*   that the abbrevs table is in alphabetical order.                        */
+/*   abbreviation, "from" being the trie node abbrevs_lookup[text[i]].  The  */
+/*   trie is followed for as long as the text matches, and the longest       */
+/*   abbreviation found on the way is used.                                  */
 /*                                                                           */
 /*   The return value is -1 if there is no match.  If there is a match, the  */
 /*   text to be abbreviated out is over-written by a string of null chars    */
@@ -180,26 +268,33 @@ static void make_abbrevs_lookup(void)
 /* ------------------------------------------------------------------------- */
 
 static int try_abbreviations_from(unsigned char *text, int i, int from)
-{   int j, k; uchar *p, c;
-    c=text[i];
-    for (j=from, p=(uchar *)abbreviations_at+from*MAX_ABBREV_LENGTH;
-         (j<no_abbreviations)&&(c==p[0]); j++, p+=MAX_ABBREV_LENGTH)
-    {   if (text[i+1]==p[1])
-        {   for (k=2; p[k]!=0; k++)
-                if (text[i+k]!=p[k]) goto NotMatched;
-            if (!glulx_mode) {
-                for (k=0; p[k]!=0; k++) text[i+k]=1;
-            }
-            abbrev_freqs[j]++;
-            return(j);
-            NotMatched: ;
+{   int j = -1, k, length = 0, node = from;
+    for (k=1; ; k++)
+    {   if (abbrev_trie[node].abbrev != -1)
+        {   j = abbrev_trie[node].abbrev; length = k;
         }
+        if (text[i+k] == 0) break;
+        for (node=abbrev_trie[node].child; node!=-1;
+             node=abbrev_trie[node].sibling)
+            if (abbrev_trie[node].c == text[i+k]) break;
+        if (node == -1) break;
+    }
+    if (j == -1) return(-1);
+    if (!glulx_mode) {
+        for (k=0; k<length; k++) text[i+k]=1;
     }
-    return(-1);
+    abbrev_freqs[j]++;
+    return(j);
 }
 
 extern void make_abbreviation(char *text)
 {
+    ensure_memory_list_available(&abbreviations_at_memlist,
+        (no_abbreviations+1)*MAX_ABBREV_LENGTH);
+    ensure_memory_list_available(&abbrev_values_memlist, no_abbreviations+1);
+    ensure_memory_list_available(&abbrev_quality_memlist, no_abbreviations+1);
+    ensure_memory_list_available(&abbrev_freqs_memlist, no_abbreviations+1);
+
     strcpy((char *)abbreviations_at
             + no_abbreviations*MAX_ABBREV_LENGTH, text);
 
@@ -218,7 +313,7 @@ extern void make_abbreviation(char *text)
 /* ------------------------------------------------------------------------- */
 
 extern int32 compile_string(char *b, int in_low_memory, int is_abbrev)
-{   int i, j; uchar *c;
+{   int32 i, j; uchar *c;
 
     is_abbreviation = is_abbrev;
 
@@ -226,10 +321,11 @@ extern int32 compile_string(char *b, int in_low_memory, int is_abbrev)
     /* which may be wanted as possible entries in the abbreviations table    */
 
     if (!glulx_mode && in_low_memory)
-    {   j=subtract_pointers(low_strings_top,low_strings);
-        low_strings_top=translate_text(low_strings_top, low_strings+MAX_LOW_STRINGS, b);
-        if (!low_strings_top)
-            memoryerror("MAX_LOW_STRINGS", MAX_LOW_STRINGS);
+    {   j=low_strings_top;
+        i=translate_text(-1, b);
+        ensure_memory_list_available(&low_strings_memlist, low_strings_top+i);
+        memcpy(low_strings+low_strings_top, translated_text, i);
+        low_strings_top += i;
         is_abbreviation = FALSE;
         return(0x21+(j/2));
     }
@@ -237,11 +333,7 @@ extern int32 compile_string(char *b, int in_low_memory, int is_abbrev)
     if (glulx_mode && done_compression)
         compiler_error("Tried to add a string after compression was done.");
 
-    c = translate_text(strings_holding_area, strings_holding_area+MAX_STATIC_STRINGS, b);
-    if (!c)
-        memoryerror("MAX_STATIC_STRINGS",MAX_STATIC_STRINGS);
-
-    i = subtract_pointers(c, strings_holding_area);
+    i = translate_text(-1, b);
 
     /* Insert null bytes as needed to ensure that the next static string */
     /* also occurs at an address expressible as a packed address         */
@@ -253,24 +345,22 @@ extern int32 compile_string(char *b, int in_low_memory, int is_abbrev)
         else
             textalign = scale_factor;
         while ((i%textalign)!=0)
-        {
-            if (i+2 > MAX_STATIC_STRINGS)
-                memoryerror("MAX_STATIC_STRINGS",MAX_STATIC_STRINGS);
-            i+=2; *c++ = 0; *c++ = 0;
+        {   ensure_memory_list_available(&translated_text_memlist, i+2);
+            translated_text[i++] = 0; translated_text[i++] = 0;
         }
     }
 
     j = static_strings_extent;
 
     if (temporary_files_switch)
-        for (c=strings_holding_area; c<strings_holding_area+i;
+        for (c=translated_text; c<translated_text+i;
              c++, static_strings_extent++)
             fputc(*c,Temp1_fp);
     else
-        for (c=strings_holding_area; c<strings_holding_area+i;
-             c++, static_strings_extent++)
-            write_byte_to_memory_block(&static_strings_area,
-                static_strings_extent, *c);
+    {   write_bytes_to_memory_block(&static_strings_area,
+            static_strings_extent, translated_text, i);
+        static_strings_extent += i;
+    }
 
     is_abbreviation = FALSE;
 
@@ -297,11 +387,13 @@ static void write_z_char_z(int i)
     zob_index=0;
     j= zchars_out_buffer[0]*0x0400 + zchars_out_buffer[1]*0x0020
        + zchars_out_buffer[2];
-    if (text_out_pc+2 > text_out_limit) {
+    if ((text_out_limit >= 0) && (text_out_pos+2 > text_out_limit)) {
         text_out_overflow = TRUE;
         return;
     }
-    text_out_pc[0] = j/256; text_out_pc[1] = j%256; text_out_pc+=2;
+    ensure_memory_list_available(&translated_text_memlist, text_out_pos+2);
+    translated_text[text_out_pos++] = j/256;
+    translated_text[text_out_pos++] = j%256;
     total_bytes_trans+=2;
 }
 
@@ -337,48 +429,50 @@ static void write_zscii(int zsc)
 /* ------------------------------------------------------------------------- */
 
 static void end_z_chars(void)
-{   unsigned char *p;
+{
     zchars_trans_in_last_string=total_zchars_trans-zchars_trans_in_last_string;
     while (zob_index!=0) write_z_char_z(5);
-    p=(unsigned char *) text_out_pc;
-    *(p-2)= *(p-2)+128;
+    if (text_out_pos >= 2)
+        translated_text[text_out_pos-2] += 128;
 }
 
 /* Glulx handles this much more simply -- compression is done elsewhere. */
 static void write_z_char_g(int i)
 {
   ASSERT_GLULX();
-  if (text_out_pc+1 > text_out_limit) {
+  if ((text_out_limit >= 0) && (text_out_pos+1 > text_out_limit)) {
       text_out_overflow = TRUE;
       return;
   }
+  ensure_memory_list_available(&translated_text_memlist, text_out_pos+1);
   total_zchars_trans++;
-  text_out_pc[0] = i;
-  text_out_pc++;
+  translated_text[text_out_pos++] = i;
   total_bytes_trans++;  
 }
 
 /* ------------------------------------------------------------------------- */
 /*   The main routine "text.c" provides to the rest of Inform: the text      */
-/*   translator. p is the address to write output to, s_text the source text */
-/*   and the return value is the next free address to write output to.       */
-/*   The return value will not exceed p_limit. If the translation tries to   */
-/*   overflow this boundary, the return value will be NULL (and you should   */
-/*   display an error).                                                      */
+/*   translator. s_text is the source text; the output is written to the     */
+/*   start of translated_text, and the return value is its length in bytes. */
+/*   translated_text grows as needed, so it may move: the caller should      */
+/*   copy the output away before translating anything else.                 */
+/*   If p_limit is not -1, the output may not be longer than p_limit bytes.  */
+/*   If the translation tries to overflow this boundary, the return value    */
+/*   will be -1 (and you should display an error).                           */
 /*   Note that the source text may be corrupted by this routine.             */
 /* ------------------------------------------------------------------------- */
 
-extern uchar *translate_text(uchar *p, uchar *p_limit, char *s_text)
+extern int32 translate_text(int32 p_limit, char *s_text)
 {   int i, j, k, in_alphabet, lookup_value;
     int32 unicode; int zscii;
     unsigned char *text_in;
 
-    /*  Cast the input and output streams to unsigned char: text_out_pc will
-        advance as bytes of Z-coded text are written, but text_in doesn't    */
+    /*  Cast the input stream to unsigned char: text_out_pos will advance
+        as bytes of Z-coded text are written, but text_in doesn't            */
 
     text_in     = (unsigned char *) s_text;
-    text_out_pc = (unsigned char *) p;
-    text_out_limit = (unsigned char *) p_limit;
+    text_out_pos = 0;
+    text_out_limit = p_limit;
     text_out_overflow = FALSE;
 
     /*  Remember the Z-chars total so that later we can subtract to find the
@@ -404,11 +498,13 @@ extern uchar *translate_text(uchar *p, uchar *p_limit, char *s_text)
     /*  If we're storing the whole game text to memory, then add this text   */
 
     if ((!is_abbreviation) && (store_the_text))
-    {   no_chars_transcribed += strlen(s_text)+2;
-        if (no_chars_transcribed >= MAX_TRANSCRIPT_SIZE)
-            memoryerror("MAX_TRANSCRIPT_SIZE", MAX_TRANSCRIPT_SIZE);
-        sprintf(all_text_top, "%s\n\n", s_text);
-        all_text_top += strlen(all_text_top);
+    {   /*  The optimiser looks up to two bytes past the end of the text,
+            so keep that much zeroed room after the terminating null     */
+        ensure_memory_list_available(&all_text_memlist,
+            no_chars_transcribed+strlen(s_text)+2+3);
+        sprintf(all_text+no_chars_transcribed, "%s\n\n", s_text);
+        no_chars_transcribed += strlen(s_text)+2;
+        all_text_top = all_text+no_chars_transcribed;
     }
 
     if (transcript_switch && (!veneer_mode))
@@ -748,37 +844,29 @@ string; substituting '?'.");
   }
 
   if (text_out_overflow)
-      return NULL;
+      return -1;
   else
-      return((uchar *) text_out_pc);
+      return text_out_pos;
 }
 
 static int unicode_entity_index(int32 unicode)
 {
-  unicode_usage_t *uptr;
   int j;
   int buck = unicode % UNICODE_HASH_BUCKETS;
 
-  for (uptr = unicode_usage_hash[buck]; uptr; uptr=uptr->next) {
-    if (uptr->ch == unicode)
+  for (j = unicode_usage_hash[buck]; j != -1;
+       j = unicode_usage_entries[j].next) {
+    if (unicode_usage_entries[j].ch == unicode)
       break;
   }
-  if (uptr) {
-    j = (uptr - unicode_usage_entries);
-  }
-  else {
-    if (no_unicode_chars >= MAX_UNICODE_CHARS) {
-      memoryerror("MAX_UNICODE_CHARS", MAX_UNICODE_CHARS);
-      j = 0;
-    }
-    else {
-      j = no_unicode_chars;
-      no_unicode_chars++;
-      uptr = unicode_usage_entries + j;
-      uptr->ch = unicode;
-      uptr->next = unicode_usage_hash[buck];
-      unicode_usage_hash[buck] = uptr;
-    }
+  if (j == -1) {
+    j = no_unicode_chars;
+    no_unicode_chars++;
+    ensure_memory_list_available(&unicode_usage_entries_memlist,
+      no_unicode_chars);
+    unicode_usage_entries[j].ch = unicode;
+    unicode_usage_entries[j].next = unicode_usage_hash[buck];
+    unicode_usage_hash[buck] = j;
   }
 
   return j;
@@ -817,8 +905,9 @@ void compress_game_text()
     huff_dynam_start = entities;
     entities += no_dynamic_strings;
 
-    if (entities > MAX_CHARACTER_SET)
-      memoryerror("MAX_CHARACTER_SET",MAX_CHARACTER_SET);
+    /* The Huffman tree has fewer than twice that many nodes. */
+    ensure_memory_list_available(&huff_entities_memlist, entities*2+1);
+    ensure_memory_list_available(&hufflist_memlist, entities);
 
     /* Characters */
     for (jx=0; jx<256; jx++) {
@@ -853,7 +942,7 @@ void compress_game_text()
     no_huff_entities = 257;
     huff_unicode_start = 257;
     huff_abbrev_start = 257;
-    huff_dynam_start = 257+MAX_ABBREVS;
+    huff_dynam_start = 257+no_abbreviations;
     compression_table_size = 0;
   }
 
@@ -1003,8 +1092,7 @@ void compress_game_text()
     fseek(Temp1_fp, 0, SEEK_SET);
   }
 
-  if (no_strings >= MAX_NUM_STATIC_STRINGS) 
-    memoryerror("MAX_NUM_STATIC_STRINGS", MAX_NUM_STATIC_STRINGS);
+  ensure_memory_list_available(&compressed_offsets_memlist, no_strings);
 
   for (lx=0, ix=0; lx<no_strings; lx++) {
     int escapelen=0, escapetype=0;
@@ -1264,48 +1352,55 @@ static int any_overlap(char *s1, char *s2)
     return(0);
 }
 
-#define MAX_TLBS 8000
+/*  Both methods begin with ". " and ", " as the first two abbreviations,
+    and blank them out of the text so that nothing else can overlap them     */
 
-extern void optimise_abbreviations(void)
-{   int32 i, j, t, max=0, MAX_GTABLE;
-    int32 j2, selected, available, maxat, nl;
-    tlb test;
+static void separate_punctuation(optab *chosen)
+{   int32 i;
 
-    printf("Beginning calculation of optimal abbreviations...\n");
+    chosen[0].text[0]='.';
+    chosen[0].text[1]=' ';
+    chosen[0].text[2]=0;
 
-    pass_no = 0;
-    tlbtab=my_calloc(sizeof(tlb), MAX_TLBS, "tlb table"); no_occs=0;
-    sub_buffer=my_calloc(sizeof(char), 4000, "sub_buffer");
-    for (i=0; i<MAX_TLBS; i++) tlbtab[i].occurrences=0;
-
-    bestyet=my_calloc(sizeof(optab), 256, "bestyet");
-    bestyet2=my_calloc(sizeof(optab), 64, "bestyet2");
-
-    bestyet2[0].text[0]='.';
-    bestyet2[0].text[1]=' ';
-    bestyet2[0].text[2]=0;
-
-    bestyet2[1].text[0]=',';
-    bestyet2[1].text[1]=' ';
-    bestyet2[1].text[2]=0;
+    chosen[1].text[0]=',';
+    chosen[1].text[1]=' ';
+    chosen[1].text[2]=0;
 
     for (i=0; all_text+i<all_text_top; i++)
     {
         if ((all_text[i]=='.') && (all_text[i+1]==' ') && (all_text[i+2]==' '))
         {   all_text[i]='\n'; all_text[i+1]='\n'; all_text[i+2]='\n';
-            bestyet2[0].popularity++;
+            chosen[0].popularity++;
         }
 
         if ((all_text[i]=='.') && (all_text[i+1]==' '))
         {   all_text[i]='\n'; all_text[i+1]='\n';
-            bestyet2[0].popularity++;
+            chosen[0].popularity++;
         }
 
         if ((all_text[i]==',') && (all_text[i+1]==' '))
         {   all_text[i]='\n'; all_text[i+1]='\n';
-            bestyet2[1].popularity++;
+            chosen[1].popularity++;
         }
     }
+}
+
+#define MAX_TLBS 8000
+
+static int32 optimise_by_passes(void)
+{   int32 i, j, t, max=0, MAX_GTABLE;
+    int32 j2, selected, available, maxat, nl;
+    tlb test;
+
+    pass_no = 0;
+    tlbtab=my_calloc(sizeof(tlb), MAX_TLBS, "tlb table"); no_occs=0;
+    sub_buffer=my_calloc(sizeof(char), 4000, "sub_buffer");
+    for (i=0; i<MAX_TLBS; i++) tlbtab[i].occurrences=0;
+
+    bestyet=my_calloc(sizeof(optab), 256, "bestyet");
+    bestyet2=my_calloc(sizeof(optab), 64, "bestyet2");
+
+    separate_punctuation(bestyet2);
 
     MAX_GTABLE=subtract_pointers(all_text_top,all_text)+1;
     grandtable=my_calloc(4*sizeof(int32), MAX_GTABLE/4, "grandtable");
@@ -1442,10 +1537,425 @@ extern void optimise_abbreviations(void)
         } while ((max>0)&&(available>0)&&(selected<64));
     }
 
+    return(selected);
+}
+
+/* ------------------------------------------------------------------------- */
+/*   The suffix array optimiser                                              */
+/*                                                                           */
+/*   A much faster way to the same end (the method above is kept as -u2).   */
+/*   The positions in the text are sorted into the order of the strings     */
+/*   beginning there, so that all the places where a string occurs are      */
+/*   neighbours in this "suffix array".  The length of the prefix which     */
+/*   each shares with the next (the "LCP") then gives every repeated string */
+/*   and its number of occurrences in a single sweep, and each is scored    */
+/*   with the same Z-char savings model as above.                            */
+/*                                                                           */
+/*   Choosing an abbreviation can only make the others less useful, so      */
+/*   after each choice the candidates are re-scored in order of their old   */
+/*   scores, and only until no old score could beat the best new one.  This */
+/*   re-scoring is shared out between threads, if there are POSIX threads.  */
+/* ------------------------------------------------------------------------- */
+
+#define MAX_CANDIDATE_LENGTH  (MAX_ABBREV_LENGTH-1)
+#define MAX_CANDIDATES        16384
+#define MAX_OPTIMISER_THREADS 16
+#define RESCORE_BATCH         32         /* Candidates per thread per batch  */
+
+typedef struct candidate_s
+{   int32 first, last;                   /* The range of the suffix array
+                                            where it occurs                  */
+    int32 length;
+    int32 weight;                        /* Z-chars it costs unabbreviated   */
+    int32 score;                         /* Only an upper bound until it has
+                                            been re-scored                   */
+    int32 popularity;
+    char text[MAX_ABBREV_LENGTH];
+} candidate;
+
+static int32 *suffixes, no_suffixes;
+static candidate *candidates;
+static int32 no_candidates;
+
+typedef struct rescore_job_s
+{   int32 from, to, step;
+    int32 *positions;                    /* Workspace for the occurrences    */
+} rescore_job;
+
+static int no_optimiser_threads;
+static rescore_job rescore_jobs[MAX_OPTIMISER_THREADS];
+
+static int zchar_weight(int c)
+{   if (c == ' ') return(1);
+    if (iso_to_alphabet_grid[c] < 0) return(3);
+    if (iso_to_alphabet_grid[c] >= 26) return(2);
+    return(1);
+}
+
+static double optimiser_clock(void)
+{
+#ifdef HAS_PTHREADS
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return(tv.tv_sec + tv.tv_usec / 1000000.0);
+#else
+    return((double) time(0));
+#endif
+}
+
+/*  Suffixes are sorted by at most their first MAX_CANDIDATE_LENGTH
+    characters, and end at a new-line, which sorts before everything        */
+
+static int compare_suffixes(const void *a, const void *b)
+{   int32 i = *((const int32 *) a), j = *((const int32 *) b);
+    uchar *p = (uchar *) all_text + i, *q = (uchar *) all_text + j;
+    int k;
+    for (k=0; k<MAX_CANDIDATE_LENGTH; k++)
+    {   if (p[k] != q[k])
+        {   if (p[k] == '\n') return(-1);
+            if (q[k] == '\n') return(1);
+            return(p[k] - q[k]);
+        }
+        if (p[k] == '\n') break;
+    }
+    return((i < j) ? -1 : (i > j));
+}
+
+static int compare_positions(const void *a, const void *b)
+{   int32 i = *((const int32 *) a), j = *((const int32 *) b);
+    return((i < j) ? -1 : (i > j));
+}
+
+static int common_prefix(int32 i, int32 j)
+{   int k;
+    for (k=0; k<MAX_CANDIDATE_LENGTH; k++)
+        if ((all_text[i+k] != all_text[j+k]) || (all_text[i+k] == '\n'))
+            break;
+    return(k);
+}
+
+/*  Positive if c1 is the better candidate: ties are broken so that the
+    outcome does not depend on the sorting algorithm                         */
+
+static int compare_candidates(candidate *c1, candidate *c2)
+{   if (c1->score != c2->score) return((c1->score > c2->score) ? 1 : -1);
+    if (c1->length != c2->length) return((c1->length > c2->length) ? 1 : -1);
+    if (c1->first != c2->first) return((c1->first < c2->first) ? 1 : -1);
+    return(0);
+}
+
+static int compare_candidates_best_first(const void *a, const void *b)
+{   return(compare_candidates((candidate *) b, (candidate *) a));
+}
+
+/*  Until the sweep is over, the candidates are a heap with the worst at
+    the top, so that once there are MAX_CANDIDATES the worst can be dropped  */
+
+static void sift_down_candidate(int32 i)
+{   candidate c = candidates[i];
+    int32 child;
+    while ((child = 2*i+1) < no_candidates)
+    {   if ((child+1 < no_candidates)
+            && (compare_candidates(candidates+child+1, candidates+child) < 0))
+            child++;
+        if (compare_candidates(candidates+child, &c) >= 0) break;
+        candidates[i] = candidates[child];
+        i = child;
+    }
+    candidates[i] = c;
+}
+
+static void add_candidate(candidate *c)
+{   int32 i, parent;
+    if (no_candidates == MAX_CANDIDATES)
+    {   if (compare_candidates(c, candidates) <= 0) return;
+        candidates[0] = *c;
+        sift_down_candidate(0);
+        return;
+    }
+    i = no_candidates++;
+    while (i > 0)
+    {   parent = (i-1)/2;
+        if (compare_candidates(candidates+parent, c) <= 0) break;
+        candidates[i] = candidates[parent];
+        i = parent;
+    }
+    candidates[i] = *c;
+}
+
+/*  The strings of lengths outer+1 to inner beginning at suffixes[first]
+    occur at exactly the positions suffixes[first] to suffixes[last]        */
+
+static void add_candidates(int32 first, int32 last, int outer, int inner)
+{   candidate c;
+    int32 occurrences = last - first + 1;
+    uchar *p = (uchar *) all_text + suffixes[first];
+    int length, weight = 0;
+
+    for (length=1; length<=inner; length++)
+    {   weight += zchar_weight(p[length-1]);
+        if ((length <= outer) || (length < 3)) continue;
+        c.score = (occurrences-1)*(weight-2);
+        if (c.score <= 0) continue;
+        c.first = first; c.last = last;
+        c.length = length; c.weight = weight;
+        c.popularity = occurrences;
+        memcpy(c.text, p, length);
+        c.text[length] = 0;
+        add_candidate(&c);
+    }
+}
+
+static void find_candidates(void)
+{   int32 i, first, inner_first, size = subtract_pointers(all_text_top, all_text);
+    int lcp, outer, inner, depth;
+    int stack_lcp[MAX_CANDIDATE_LENGTH+2];
+    int32 stack_first[MAX_CANDIDATE_LENGTH+2];
+
+    suffixes = my_calloc(sizeof(int32), size, "suffix array");
+    for (i=0, no_suffixes=0; i+2<size; i++)
+        if ((all_text[i]!='\n') && (all_text[i+1]!='\n')
+            && (all_text[i+2]!='\n'))
+            suffixes[no_suffixes++] = i;
+
+    printf("Sorting %ld positions in the text...\n", (long int) no_suffixes);
+    qsort(suffixes, no_suffixes, sizeof(int32), compare_suffixes);
+
+    /*  Walk the LCP intervals bottom-up: the stack holds the intervals which
+        are still open, with strictly increasing LCPs, so it never grows
+        deeper than the longest candidate                                    */
+
+    candidates = my_calloc(sizeof(candidate), MAX_CANDIDATES, "candidates");
+    no_candidates = 0;
+    depth = 0; stack_lcp[0] = 0; stack_first[0] = 0;
+    for (i=1; i<=no_suffixes; i++)
+    {   lcp = (i < no_suffixes) ? common_prefix(suffixes[i-1], suffixes[i]) : 0;
+        first = i-1;
+        while (lcp < stack_lcp[depth])
+        {   inner = stack_lcp[depth]; inner_first = stack_first[depth];
+            depth--;
+            outer = (lcp > stack_lcp[depth]) ? lcp : stack_lcp[depth];
+            add_candidates(inner_first, i-1, outer, inner);
+            first = inner_first;
+        }
+        if (lcp > stack_lcp[depth])
+        {   depth++;
+            stack_lcp[depth] = lcp; stack_first[depth] = first;
+        }
+    }
+
+    printf("%ld candidate strings found...\n", (long int) no_candidates);
+}
+
+/*  Count the occurrences of c which are still in the text and do not
+    overlap each other, leaving their positions in the given workspace       */
+
+static int32 find_occurrences(candidate *c, int32 *positions)
+{   int32 i, n = 0, count = 0, end = -1;
+    for (i=c->first; i<=c->last; i++)
+        if (memcmp(all_text + suffixes[i], c->text, c->length) == 0)
+            positions[n++] = suffixes[i];
+    if (n > 1) qsort(positions, n, sizeof(int32), compare_positions);
+    for (i=0; i<n; i++)
+        if (positions[i] >= end)
+        {   positions[count++] = positions[i];
+            end = positions[i] + c->length;
+        }
+    return(count);
+}
+
+static void *rescore_candidates(void *job_pointer)
+{   rescore_job *job = (rescore_job *) job_pointer;
+    candidate *c;
+    int32 i;
+    for (i=job->from; i<job->to; i+=job->step)
+    {   c = candidates+i;
+        if (c->score <= 0) continue;
+        c->popularity = find_occurrences(c, job->positions);
+        c->score = (c->popularity-1)*(c->weight-2);
+        if (c->score < 0) c->score = 0;
+    }
+    return(NULL);
+}
+
+static void rescore_range(int32 from, int32 to)
+{   int t;
+#ifdef HAS_PTHREADS
+    pthread_t threads[MAX_OPTIMISER_THREADS];
+    int started[MAX_OPTIMISER_THREADS];
+#endif
+
+    for (t=0; t<no_optimiser_threads; t++)
+    {   rescore_jobs[t].from = from + t;
+        rescore_jobs[t].to = to;
+        rescore_jobs[t].step = no_optimiser_threads;
+    }
+#ifdef HAS_PTHREADS
+    for (t=1; t<no_optimiser_threads; t++)
+        started[t] = (pthread_create(threads+t, NULL, rescore_candidates,
+            rescore_jobs+t) == 0);
+#endif
+    rescore_candidates(rescore_jobs);
+#ifdef HAS_PTHREADS
+    for (t=1; t<no_optimiser_threads; t++)
+    {   if (started[t]) pthread_join(threads[t], NULL);
+        else rescore_candidates(rescore_jobs+t);
+    }
+#endif
+}
+
+static int32 optimise_by_suffixes(optab *chosen)
+{   int32 i, j, n, best, done, to, selected, most_occurrences = 0;
+    candidate *c;
+
+    separate_punctuation(chosen);
+    find_candidates();
+
+    no_optimiser_threads = 1;
+#ifdef HAS_PTHREADS
+    n = (int32) sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > MAX_OPTIMISER_THREADS) n = MAX_OPTIMISER_THREADS;
+    if (n > 1) no_optimiser_threads = n;
+#endif
+    for (i=0; i<no_candidates; i++)
+        if (candidates[i].last - candidates[i].first + 1 > most_occurrences)
+            most_occurrences = candidates[i].last - candidates[i].first + 1;
+    for (i=0; i<no_optimiser_threads; i++)
+        rescore_jobs[i].positions = my_calloc(sizeof(int32),
+            most_occurrences, "optimiser workspace");
+    printf("Choosing with %d thread%s...\n", no_optimiser_threads,
+        (no_optimiser_threads == 1) ? "" : "s");
+
+    for (selected=2; selected<64; selected++)
+    {   qsort(candidates, no_candidates, sizeof(candidate),
+            compare_candidates_best_first);
+
+        /*  Every score further down the list is at most the one before it,
+            and re-scoring can only lower a score, so re-scoring stops as
+            soon as none of them could win.  The test is the full ordering,
+            tie-breaks included, so that the choice never depends on how
+            many candidates a batch happened to cover                        */
+
+        best = -1;
+        for (done=0; (done<no_candidates) && (candidates[done].score>0)
+            && ((best == -1)
+                || (compare_candidates(candidates+done, candidates+best) > 0));
+            done=to)
+        {   to = done + RESCORE_BATCH*no_optimiser_threads;
+            if (to > no_candidates) to = no_candidates;
+            rescore_range(done, to);
+            for (i=done; i<to; i++)
+                if ((candidates[i].score > 0) && ((best == -1)
+                    || (compare_candidates(candidates+i, candidates+best) > 0)))
+                    best = i;
+        }
+        if (best == -1) break;
+
+        c = candidates+best;
+        chosen[selected].length = c->length;
+        chosen[selected].popularity = c->popularity;
+        chosen[selected].score = c->score;
+        chosen[selected].location = suffixes[c->first];
+        strcpy(chosen[selected].text, c->text);
+        printf("Selection %2ld: '%s' (repeated %ld times, scoring %ld)\n",
+            (long int) selected+1, c->text, (long int) c->popularity,
+            (long int) c->score);
+
+        n = find_occurrences(c, rescore_jobs[0].positions);
+        for (i=0; i<n; i++)
+            for (j=0; j<c->length; j++)
+                all_text[rescore_jobs[0].positions[i]+j] = '\n';
+        c->score = 0;
+    }
+
+    for (i=0; i<no_optimiser_threads; i++)
+        my_free(&(rescore_jobs[i].positions), "optimiser workspace");
+    my_free(&candidates, "candidates");
+    my_free(&suffixes, "suffix array");
+    return(selected);
+}
+
+/*  The number of Z-chars the text would take with the given abbreviations,
+    counting the abbreviations themselves: used to compare the two methods   */
+
+static int32 abbreviated_weight(char *text, int32 size, optab *abbrevs,
+    int32 no_abbrevs)
+{   int32 i, j, total = 0;
+    int length, best;
+
+    for (j=0; j<no_abbrevs; j++)
+        for (i=0; abbrevs[j].text[i]!=0; i++)
+            total += zchar_weight((uchar) abbrevs[j].text[i]);
+    for (i=0; i<size; )
+    {   if (text[i] == '\n') { i++; continue; }
+        best = 0;
+        for (j=0; j<no_abbrevs; j++)
+        {   length = strlen(abbrevs[j].text);
+            if ((length > best)
+                && (strncmp(text+i, abbrevs[j].text, length) == 0))
+                best = length;
+        }
+        if (best > 0) { total += 2; i += best; }
+        else total += zchar_weight((uchar) text[i++]);
+    }
+    return(total);
+}
+
+extern void optimise_abbreviations(void)
+{   int32 i, size, selected, passes_selected = 0;
+    int32 plain, by_suffixes, by_passes;
+    double start, suffixes_time = 0.0, passes_time = 0.0;
+    char *original = NULL;
+    optab *chosen;
+
+    printf("Beginning calculation of optimal abbreviations...\n");
+
+    size = subtract_pointers(all_text_top, all_text);
+    if (optimise_setting == 3)
+    {   original = my_malloc(size+1, "copy of transcription text");
+        memcpy(original, all_text, size+1);
+    }
+
+    if (optimise_setting >= 2)
+    {   start = optimiser_clock();
+        passes_selected = optimise_by_passes();
+        passes_time = optimiser_clock() - start;
+        if (optimise_setting == 3)
+            memcpy(all_text, original, size+1);
+    }
+
+    if (optimise_setting == 2)
+    {   chosen = bestyet2; selected = passes_selected;
+    }
+    else
+    {   chosen = my_calloc(sizeof(optab), 64, "chosen abbreviations");
+        start = optimiser_clock();
+        selected = optimise_by_suffixes(chosen);
+        suffixes_time = optimiser_clock() - start;
+    }
+
     printf("\nChosen abbreviations (in Inform syntax):\n\n");
     for (i=0; i<selected; i++)
-        printf("Abbreviate \"%s\";\n", bestyet2[i].text);
+        printf("Abbreviate \"%s\";\n", chosen[i].text);
+
+    if (optimise_setting == 3)
+    {   plain = abbreviated_weight(original, size, NULL, 0);
+        by_suffixes = abbreviated_weight(original, size, chosen, selected);
+        by_passes = abbreviated_weight(original, size, bestyet2,
+            passes_selected);
+        printf("\nComparison on %ld characters of text (%ld Z-chars \
+unabbreviated):\n\n", (long int) size, (long int) plain);
+        printf("  Method         Time (s)  Abbreviations  Z-chars  Saving\n");
+        printf("  Suffix array %10.2f %14ld %8ld %7ld\n", suffixes_time,
+            (long int) selected, (long int) by_suffixes,
+            (long int) (plain - by_suffixes));
+        printf("  Multi-pass   %10.2f %14ld %8ld %7ld\n", passes_time,
+            (long int) passes_selected, (long int) by_passes,
+            (long int) (plain - by_passes));
+        my_free(&original, "copy of transcription text");
+    }
 
+    if (chosen != bestyet2) my_free(&chosen, "chosen abbreviations");
     text_free_arrays();
 }
 
@@ -1766,6 +2276,29 @@ static dict_tree_node *dtree;
 int   *final_dict_order;
 static uchar *dict_sort_codes;
 
+static memory_list dtree_memlist, final_dict_order_memlist,
+    dict_sort_codes_memlist, dictionary_memlist;
+
+/*  Make room for the given number of entries in the dictionary and the
+    arrays which sort it: dictionary_top is recalculated, since the
+    dictionary may move                                                      */
+
+static void ensure_dictionary_available(int count)
+{   int32 used = subtract_pointers(dictionary_top, dictionary);
+
+    ensure_memory_list_available(&dtree_memlist, count);
+    ensure_memory_list_available(&final_dict_order_memlist, count);
+    ensure_memory_list_available(&dict_sort_codes_memlist,
+        count*DICT_WORD_BYTES);
+    if (!glulx_mode)
+        ensure_memory_list_available(&dictionary_memlist,
+            9*count+7);
+    else
+        ensure_memory_list_available(&dictionary_memlist,
+            DICT_ENTRY_BYTE_LENGTH*count+4);
+    dictionary_top = dictionary + used;
+}
+
 static void dictionary_begin_pass(void)
 {
     /*  Leave room for the 7-byte header (added in "tables.c" much later)    */
@@ -1943,8 +2476,7 @@ extern int dictionary_add(char *dword, int x, int y, int z)
 
     CreateEntry:
 
-    if (dict_entries==MAX_DICT_ENTRIES)
-        memoryerror("MAX_DICT_ENTRIES",MAX_DICT_ENTRIES);
+    ensure_dictionary_available(dict_entries+1);
 
     dtree[dict_entries].branch[0] = VACANT;
     dtree[dict_entries].branch[1] = VACANT;
@@ -2195,6 +2727,7 @@ extern void init_text_vars(void)
     put_strings_in_low_memory = FALSE;
 
     for (j=0; j<256; j++) abbrevs_lookup[j] = -1;
+    abbrev_trie = NULL;
 
     total_zchars_trans = 0;
 
@@ -2212,7 +2745,7 @@ extern void text_begin_pass(void)
     total_chars_trans=0; total_bytes_trans=0;
     if (store_the_text) all_text_top=all_text;
     dictionary_begin_pass();
-    low_strings_top = low_strings;
+    low_strings_top = 0;
 
     static_strings_extent = 0;
     no_strings = 0;
@@ -2220,80 +2753,84 @@ extern void text_begin_pass(void)
     no_unicode_chars = 0;
 }
 
-/*  Note: for allocation and deallocation of all_the_text, see inform.c      */
+/*  Note: all_text grows here, but is freed in inform.c, since the
+    abbreviations optimiser uses it after the other arrays have gone         */
 
 extern void text_allocate_arrays(void)
-{   abbreviations_at = my_malloc(MAX_ABBREVS*MAX_ABBREV_LENGTH,
-        "abbreviations");
-    abbrev_values    = my_calloc(sizeof(int), MAX_ABBREVS, "abbrev values");
-    abbrev_quality   = my_calloc(sizeof(int), MAX_ABBREVS, "abbrev quality");
-    abbrev_freqs     = my_calloc(sizeof(int),   MAX_ABBREVS, "abbrev freqs");
-
-    dtree            = my_calloc(sizeof(dict_tree_node), MAX_DICT_ENTRIES,
-                                 "red-black tree for dictionary");
-    final_dict_order = my_calloc(sizeof(int),  MAX_DICT_ENTRIES,
-                                 "final dictionary ordering table");
-    dict_sort_codes  = my_calloc(DICT_WORD_BYTES, MAX_DICT_ENTRIES,
-                                 "dictionary sort codes");
-
-    if (!glulx_mode)
-        dictionary = my_malloc(9*MAX_DICT_ENTRIES+7,
-            "dictionary");
-    else
-        dictionary = my_malloc(DICT_ENTRY_BYTE_LENGTH*MAX_DICT_ENTRIES+4,
-            "dictionary");
+{   int ix;
 
-    strings_holding_area
-         = my_malloc(MAX_STATIC_STRINGS,"static strings holding area");
-    low_strings = my_malloc(MAX_LOW_STRINGS,"low (abbreviation) strings");
+    initialise_memory_list(&abbreviations_at_memlist,
+        sizeof(uchar), MAX_ABBREVS*MAX_ABBREV_LENGTH, &abbreviations_at,
+        "abbreviations");
+    initialise_memory_list(&abbrev_values_memlist,
+        sizeof(int), MAX_ABBREVS, &abbrev_values, "abbrev values");
+    initialise_memory_list(&abbrev_quality_memlist,
+        sizeof(int), MAX_ABBREVS, &abbrev_quality, "abbrev quality");
+    initialise_memory_list(&abbrev_freqs_memlist,
+        sizeof(int), MAX_ABBREVS, &abbrev_freqs, "abbrev freqs");
+
+    initialise_memory_list(&dtree_memlist,
+        sizeof(dict_tree_node), MAX_DICT_ENTRIES, &dtree,
+        "red-black tree for dictionary");
+    initialise_memory_list(&final_dict_order_memlist,
+        sizeof(int), MAX_DICT_ENTRIES, &final_dict_order,
+        "final dictionary ordering table");
+    initialise_memory_list(&dict_sort_codes_memlist,
+        sizeof(uchar), DICT_WORD_BYTES*MAX_DICT_ENTRIES, &dict_sort_codes,
+        "dictionary sort codes");
+    initialise_memory_list(&dictionary_memlist,
+        sizeof(uchar), (!glulx_mode)?9*MAX_DICT_ENTRIES+7
+            :DICT_ENTRY_BYTE_LENGTH*MAX_DICT_ENTRIES+4, &dictionary,
+        "dictionary");
+
+    initialise_memory_list(&translated_text_memlist,
+        sizeof(uchar), MAX_STATIC_STRINGS, &translated_text,
+        "translated text holding area");
+    initialise_memory_list(&low_strings_memlist,
+        sizeof(uchar), MAX_LOW_STRINGS, &low_strings,
+        "low (abbreviation) strings");
+    initialise_memory_list(&all_text_memlist,
+        sizeof(char), store_the_text?MAX_TRANSCRIPT_SIZE:0, &all_text,
+        "transcription text");
 
-    huff_entities = NULL;
-    hufflist = NULL;
-    unicode_usage_entries = NULL;
     done_compression = FALSE;
     compression_table_size = 0;
-    compressed_offsets = NULL;
-
-    MAX_CHARACTER_SET = 0;
 
-    if (glulx_mode) {
-      if (compression_switch) {
-        int ix;
-        MAX_CHARACTER_SET = 257 + MAX_ABBREVS + MAX_DYNAMIC_STRINGS 
-          + MAX_UNICODE_CHARS;
-        huff_entities = my_calloc(sizeof(huffentity_t), MAX_CHARACTER_SET*2+1, 
-          "huffman entities");
-        hufflist = my_calloc(sizeof(huffentity_t *), MAX_CHARACTER_SET, 
-          "huffman node list");
-        unicode_usage_entries = my_calloc(sizeof(unicode_usage_t), 
-          MAX_UNICODE_CHARS, "unicode entity entries");
-        for (ix=0; ix<UNICODE_HASH_BUCKETS; ix++)
-          unicode_usage_hash[ix] = NULL;
-      }
-      compressed_offsets = my_calloc(sizeof(int32), MAX_NUM_STATIC_STRINGS,
-        "static strings index table");
-    }
+    initialise_memory_list(&huff_entities_memlist,
+        sizeof(huffentity_t), 0, &huff_entities, "huffman entities");
+    initialise_memory_list(&hufflist_memlist,
+        sizeof(huffentity_t *), 0, &hufflist, "huffman node list");
+    initialise_memory_list(&unicode_usage_entries_memlist,
+        sizeof(unicode_usage_t), (glulx_mode && compression_switch)
+            ?MAX_UNICODE_CHARS:0, &unicode_usage_entries,
+        "unicode entity entries");
+    for (ix=0; ix<UNICODE_HASH_BUCKETS; ix++)
+        unicode_usage_hash[ix] = -1;
+    initialise_memory_list(&compressed_offsets_memlist,
+        sizeof(int32), glulx_mode?MAX_NUM_STATIC_STRINGS:0,
+        &compressed_offsets, "static strings index table");
 }
 
 extern void text_free_arrays(void)
 {
-    my_free(&strings_holding_area, "static strings holding area");
-    my_free(&low_strings, "low (abbreviation) strings");
-    my_free(&abbreviations_at, "abbreviations");
-    my_free(&abbrev_values,    "abbrev values");
-    my_free(&abbrev_quality,   "abbrev quality");
-    my_free(&abbrev_freqs,     "abbrev freqs");
-
-    my_free(&dtree,            "red-black tree for dictionary");
-    my_free(&final_dict_order, "final dictionary ordering table");
-    my_free(&dict_sort_codes,  "dictionary sort codes");
-
-    my_free(&dictionary,"dictionary");
-
-    my_free(&compressed_offsets, "static strings index table");
-    my_free(&hufflist, "huffman node list");
-    my_free(&huff_entities, "huffman entities");
-    my_free(&unicode_usage_entries, "unicode entity entities");
+    deallocate_memory_list(&translated_text_memlist);
+    deallocate_memory_list(&low_strings_memlist);
+    deallocate_memory_list(&abbreviations_at_memlist);
+    deallocate_memory_list(&abbrev_values_memlist);
+    deallocate_memory_list(&abbrev_quality_memlist);
+    deallocate_memory_list(&abbrev_freqs_memlist);
+    my_free(&abbrev_trie,      "abbreviations trie");
+
+    deallocate_memory_list(&dtree_memlist);
+    deallocate_memory_list(&final_dict_order_memlist);
+    deallocate_memory_list(&dict_sort_codes_memlist);
+
+    deallocate_memory_list(&dictionary_memlist);
+
+    deallocate_memory_list(&compressed_offsets_memlist);
+    deallocate_memory_list(&hufflist_memlist);
+    deallocate_memory_list(&huff_entities_memlist);
+    deallocate_memory_list(&unicode_usage_entries_memlist);
 
     deallocate_memory_block(&static_strings_area);
 }
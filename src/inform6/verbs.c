@@ -72,11 +72,11 @@ int no_Inform_verbs,                   /* Number of Inform-verbs made so far */
 /*     The English verb-word (reduced to lower case), null-terminated        */
 /* ------------------------------------------------------------------------- */
 
-static char *English_verb_list,        /* First byte of first record         */
-            *English_verb_list_top;    /* Next byte free for new record      */
+static char *English_verb_list;        /* First byte of first record         */
 
-static int English_verb_list_size;     /* Size of the list in bytes
-                                          (redundant but convenient)         */
+static int English_verb_list_size;     /* Size of the list in bytes, which
+                                          is also the offset of the next
+                                          free byte for a new record         */
 
 /* ------------------------------------------------------------------------- */
 /*   Arrays used by this file                                                */
@@ -93,6 +93,29 @@ static int English_verb_list_size;     /* Size of the list in bytes
           *adjectives;
   static uchar *adjective_sort_code;
 
+/*  These all grow as they are filled: MAX_VERBS, MAX_ACTIONS and the like
+    are only their initial sizes                                             */
+
+static memory_list English_verb_list_memlist, Inform_verbs_memlist,
+    grammar_lines_memlist, action_byte_offset_memlist, action_symbol_memlist,
+    grammar_token_routine_memlist, adjectives_memlist,
+    adjective_sort_code_memlist;
+
+static void ensure_Inform_verbs_available(int count)
+{   if ((!glulx_mode) && (count > 255))
+        fatalerror("The Z-machine only has room for 255 verbs: \
+use Glulx (-G) for more");
+    ensure_memory_list_available(&Inform_verbs_memlist, count);
+}
+
+extern void ensure_actions_available(int count)
+{   if (count > ((grammar_version_number==1)?256:4096))
+        fatalerror("Too many actions: the numbers from 256 (in grammar \
+version 1) or 4096 (in grammar version 2) up are used for fake actions");
+    ensure_memory_list_available(&action_byte_offset_memlist, count);
+    ensure_memory_list_available(&action_symbol_memlist, count);
+}
+
 /* ------------------------------------------------------------------------- */
 /*   Tracing for compiler maintenance                                        */
 /* ------------------------------------------------------------------------- */
@@ -186,7 +209,7 @@ extern assembly_operand action_of_name(char *name)
 
     if (sflags[j] & UNKNOWN_SFLAG)
     {
-        if (no_actions>=MAX_ACTIONS) memoryerror("MAX_ACTIONS",MAX_ACTIONS);
+        ensure_actions_available(no_actions+1);
         new_action(name, no_actions);
         action_symbol[no_actions] = j;
         assign_symbol(j, no_actions++, CONSTANT_T);
@@ -255,14 +278,17 @@ static int make_adjective(char *English_word)
     int i; 
     uchar new_sort_code[MAX_DICT_WORD_BYTES];
 
-    if (no_adjectives >= MAX_ADJECTIVES)
-        memoryerror("MAX_ADJECTIVES", MAX_ADJECTIVES);
-
     dictionary_prepare(English_word, new_sort_code);
     for (i=0; i<no_adjectives; i++)
         if (compare_sorts(new_sort_code,
           adjective_sort_code+i*DICT_WORD_BYTES) == 0)
             return(0xff-i);
+    if (no_adjectives == 0xff-180+1)
+        fatalerror("Grammar version 1 only has room for 76 prepositions, \
+numbered from 255 down to 180: use grammar version 2 for more");
+    ensure_memory_list_available(&adjectives_memlist, no_adjectives+1);
+    ensure_memory_list_available(&adjective_sort_code_memlist,
+        no_adjectives+1);
     adjectives[no_adjectives]
         = dictionary_add(English_word,8,0,0xff-no_adjectives);
     copy_sorts(adjective_sort_code+no_adjectives*DICT_WORD_BYTES,
@@ -284,6 +310,7 @@ static int make_parsing_routine(int32 routine_address)
         if (grammar_token_routine[l] == routine_address)
             return l;
 
+    ensure_memory_list_available(&grammar_token_routine_memlist, l+1);
     grammar_token_routine[l] = routine_address;
     return(no_grammar_token_routines++);
 }
@@ -306,7 +333,7 @@ static int find_or_renumber_verb(char *English_verb, int *new_number)
 
     char *p;
     p=English_verb_list;
-    while (p < English_verb_list_top)
+    while (p < English_verb_list+English_verb_list_size)
     {   if (strcmp(English_verb, p+3) == 0)
         {   if (new_number)
             {   p[1] = (*new_number)/256;
@@ -325,20 +352,24 @@ static void register_verb(char *English_verb, int number)
     /*  Registers a new English verb as referring to the given Inform-verb
         number.  (See comments above for format of the list.)                */
 
+    int entrysize;
+    char *top;
+
     if (find_or_renumber_verb(English_verb, NULL) != -1)
     {   error_named("Two different verb definitions refer to", English_verb);
         return;
     }
 
-    English_verb_list_size += strlen(English_verb)+4;
-    if (English_verb_list_size >= MAX_VERBSPACE)
-        memoryerror("MAX_VERBSPACE", MAX_VERBSPACE);
+    entrysize = strlen(English_verb)+4;
+    ensure_memory_list_available(&English_verb_list_memlist,
+        English_verb_list_size+entrysize);
+    top = English_verb_list+English_verb_list_size;
 
-    English_verb_list_top[0] = 4+strlen(English_verb);
-    English_verb_list_top[1] = number/256;
-    English_verb_list_top[2] = number%256;
-    strcpy(English_verb_list_top+3, English_verb);
-    English_verb_list_top += English_verb_list_top[0];
+    top[0] = entrysize;
+    top[1] = number/256;
+    top[2] = number%256;
+    strcpy(top+3, English_verb);
+    English_verb_list_size += entrysize;
 }
 
 static int get_verb(void)
@@ -419,18 +450,8 @@ into Inform, so suggest rewriting grammar using general parsing routines");
     /*  In Glulx, that's 5*32 + 4 = 164 bytes */
 
     mark = grammar_lines_top;
-    if (!glulx_mode) {
-        if (mark + 100 >= MAX_LINESPACE)
-        {   discard_token_location(beginning_debug_location);
-            memoryerror("MAX_LINESPACE", MAX_LINESPACE);
-        }
-    }
-    else {
-        if (mark + 165 >= MAX_LINESPACE)
-        {   discard_token_location(beginning_debug_location);
-            memoryerror("MAX_LINESPACE", MAX_LINESPACE);
-        }
-    }
+    ensure_memory_list_available(&grammar_lines_memlist,
+        mark + ((glulx_mode)?165:100));
 
     Inform_verbs[verbnum].l[line] = mark;
 
@@ -734,8 +755,7 @@ extern void make_verb(void)
     }
     else
     {   Inform_verb = no_Inform_verbs;
-        if (no_Inform_verbs == MAX_VERBS)
-            memoryerror("MAX_VERBS",MAX_VERBS);
+        ensure_Inform_verbs_available(no_Inform_verbs+1);
     }
 
     for (i=0; i<no_given; i++)
@@ -781,8 +801,7 @@ extern void extend_verb(void)
     get_next_token();
     if ((token_type == DIR_KEYWORD_TT) && (token_value == ONLY_DK))
     {   l = -1;
-        if (no_Inform_verbs == MAX_VERBS)
-            memoryerror("MAX_VERBS", MAX_VERBS);
+        ensure_Inform_verbs_available(no_Inform_verbs+1);
         while (get_next_token(),
                ((token_type == DQ_TT) || (token_type == SQ_TT)))
         {   Inform_verb = get_verb();
@@ -890,32 +909,37 @@ extern void verbs_begin_pass(void)
 
 extern void verbs_allocate_arrays(void)
 {
-    Inform_verbs          = my_calloc(sizeof(verbt),   MAX_VERBS, "verbs");
-    grammar_lines         = my_malloc(MAX_LINESPACE, "grammar lines");
-    action_byte_offset    = my_calloc(sizeof(int32),   MAX_ACTIONS, "actions");
-    action_symbol         = my_calloc(sizeof(int32),   MAX_ACTIONS,
-                                "action symbols");
-    grammar_token_routine = my_calloc(sizeof(int32),   MAX_ACTIONS,
-                                "grammar token routines");
-    adjectives            = my_calloc(sizeof(int32),   MAX_ADJECTIVES,
-                                "adjectives");
-    adjective_sort_code   = my_calloc(DICT_WORD_BYTES, MAX_ADJECTIVES,
-                                "adjective sort codes");
-
-    English_verb_list     = my_malloc(MAX_VERBSPACE, "register of verbs");
-    English_verb_list_top = English_verb_list;
+    initialise_memory_list(&Inform_verbs_memlist,
+        sizeof(verbt), MAX_VERBS, &Inform_verbs, "verbs");
+    initialise_memory_list(&grammar_lines_memlist,
+        sizeof(uchar), MAX_LINESPACE, &grammar_lines, "grammar lines");
+    initialise_memory_list(&action_byte_offset_memlist,
+        sizeof(int32), MAX_ACTIONS, &action_byte_offset, "actions");
+    initialise_memory_list(&action_symbol_memlist,
+        sizeof(int32), MAX_ACTIONS, &action_symbol, "action symbols");
+    initialise_memory_list(&grammar_token_routine_memlist,
+        sizeof(int32), MAX_ACTIONS, &grammar_token_routine,
+        "grammar token routines");
+    initialise_memory_list(&adjectives_memlist,
+        sizeof(int32), MAX_ADJECTIVES, &adjectives, "adjectives");
+    initialise_memory_list(&adjective_sort_code_memlist,
+        DICT_WORD_BYTES, MAX_ADJECTIVES, &adjective_sort_code,
+        "adjective sort codes");
+
+    initialise_memory_list(&English_verb_list_memlist,
+        sizeof(char), MAX_VERBSPACE, &English_verb_list, "register of verbs");
 }
 
 extern void verbs_free_arrays(void)
 {
-    my_free(&Inform_verbs, "verbs");
-    my_free(&grammar_lines, "grammar lines");
-    my_free(&action_byte_offset, "actions");
-    my_free(&action_symbol, "action symbols");
-    my_free(&grammar_token_routine, "grammar token routines");
-    my_free(&adjectives, "adjectives");
-    my_free(&adjective_sort_code, "adjective sort codes");
-    my_free(&English_verb_list, "register of verbs");
+    deallocate_memory_list(&Inform_verbs_memlist);
+    deallocate_memory_list(&grammar_lines_memlist);
+    deallocate_memory_list(&action_byte_offset_memlist);
+    deallocate_memory_list(&action_symbol_memlist);
+    deallocate_memory_list(&grammar_token_routine_memlist);
+    deallocate_memory_list(&adjectives_memlist);
+    deallocate_memory_list(&adjective_sort_code_memlist);
+    deallocate_memory_list(&English_verb_list_memlist);
 }
 
 /* ========================================================================= */
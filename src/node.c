@@ -22,11 +22,37 @@
 #include <goocanvas.h>
 #include <cairo.h>
 
+#include "diff-pool.h"
 #include "node.h"
 #include "skein.h"
+#include "skein-stats.h"
+#include "string-intern.h"
 #include "transcript-diff.h"
 
 #define DIFFERS_BADGE_RADIUS 8.0
+/* Knots with at least this many children look up their children by command in
+ a hash table rather than going through the list */
+#define CHILD_INDEX_THRESHOLD 16
+/* That SVG code is generated with this Python code:
+import numpy as N
+angles = N.linspace(0, 2 * N.pi, 40)
+radii = N.ones_like(angles)
+radii[1::2] *= 0.7
+xs = radii * N.cos(angles)
+ys = radii * N.sin(angles)
+print "M",
+for x, y in zip(xs, ys):
+	print "{0:.3},{1:.3}".format(round(x, 3), round(y, 3)),
+print "Z" */
+#define DIFFERS_BADGE_PATH \
+	"M 1.0,0.0 0.691,0.112 0.949,0.317 0.62,0.325 0.799,0.601 " \
+	"0.485,0.505 0.568,0.823 0.3,0.632 0.278,0.961 0.084,0.695 -0.04,0.999 " \
+	"-0.14,0.686 -0.355,0.935 -0.35,0.606 -0.632,0.775 -0.524,0.464 " \
+	"-0.845,0.534 -0.644,0.274 -0.971,0.239 -0.698,0.056 -0.997,-0.08 " \
+	"-0.68,-0.168 -0.92,-0.392 -0.592,-0.374 -0.749,-0.663 -0.443,-0.542 " \
+	"-0.5,-0.866 -0.248,-0.655 -0.2,-0.98 -0.028,-0.699 0.121,-0.993 " \
+	"0.195,-0.672 0.429,-0.903 0.398,-0.576 0.693,-0.721 0.56,-0.421 " \
+	"0.885,-0.465 0.664,-0.222 0.987,-0.16 0.7,-0.0 Z"
 
 enum {
 	PROP_0,
@@ -53,10 +79,16 @@ enum {
 
 typedef struct _I7NodePrivate {
 	gchar *id; /* Unique ID string for use in saving */
-	gchar *command; /* Game command that this knot represents */
-	gchar *label; /* Author's annotation that appears above this knot */
-	gchar *transcript_text; /* Response produced by the game to this command */
-	gchar *expected_text; /* Response the author thinks should be produced */
+	/* The texts are interned, see string-intern.c */
+	const char *command; /* Game command that this knot represents */
+	const char *label; /* Author's annotation that appears above this knot */
+	const char *transcript_text; /* Response produced by the game to this command */
+	const char *expected_text; /* Response the author thinks should be produced */
+	/* Texts in the skein cache that haven't been loaded yet; see
+	 i7_node_set_stored_texts() */
+	GMappedFile *stored_texts;
+	const char *stored_transcript_text;
+	const char *stored_expected_text;
 	gboolean changed; /* Whether the response changed since last time this knot was played */
 	gboolean blessed; /* Whether this knot has an expected response */
 	gboolean played; /* Whether this knot is currently in the thread being played */
@@ -65,23 +97,36 @@ typedef struct _I7NodePrivate {
 
 	/* Diffs */
 	I7NodeMatchType match;
-	GList *transcript_diffs;
-	GList *expected_diffs;
+	guint diff_serial; /* Changes whenever the texts do, to spot stale results */
+	gboolean diffs_deferred; /* Match type is known, but not the diffs yet */
+	GArray *transcript_diffs;
+	GArray *expected_diffs;
 	char *transcript_pango_string;
 	char *expected_pango_string;
+	guint text_version; /* Changes whenever the text shown in the Transcript does */
 
-	/* Graphical goodness */
-	cairo_pattern_t *label_pattern;
-	cairo_pattern_t *node_pattern[NODE_NUM_PATTERNS];
+	/* Graphical goodness; the item models are only created when a view of the
+	 skein's item models draws the knot, see i7_node_create_items() */
 	GooCanvasItemModel *command_item;
 	GooCanvasItemModel *label_item;
 	GooCanvasItemModel *badge_item;
 	GooCanvasItemModel *command_shape_item;
 	GooCanvasItemModel *label_shape_item;
+	guint appearance_version; /* Changes whenever the knot's look does */
+
+	/* Maps each child's command to the first child with that command, or NULL
+	 if not built yet; the keys belong to the children */
+	GHashTable *child_index;
 
 	/* x-coordinate */
 	gdouble x;
 
+	/* Layout cache; a knot whose layout is dirty implies that all its ancestors
+	 are dirty too, so invalidation can stop at the first dirty ancestor */
+	gdouble tree_width; /* Width of the subtree rooted here; negative if stale */
+	gboolean layout_dirty; /* Whether this subtree needs to be laid out again */
+	gint depth; /* Depth at which this knot was last laid out */
+
 	/* Cached values; initialize to -1 */
 	gdouble command_width;
 	gdouble command_height;
@@ -94,36 +139,182 @@ typedef struct _I7NodePrivate {
 
 G_DEFINE_TYPE(I7Node, i7_node, GOO_TYPE_CANVAS_GROUP_MODEL);
 
+/* Text versions are drawn from one counter for all knots, so that a version
+ number never belongs to two knots */
+static guint last_text_version = 0;
+
 /* STATIC FUNCTIONS */
 
+/* Call when the children are rearranged or one's command changes; the index
+ is built again the next time it is needed */
+static void
+invalidate_child_index(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	if(priv->child_index) {
+		g_hash_table_destroy(priv->child_index);
+		priv->child_index = NULL;
+	}
+}
+
+static void
+text_changed(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	priv->text_version = ++last_text_version;
+}
+
+/* Replace @old with an interned copy of @text, with all newline separators
+ changed to \n */
+static const char *
+intern_text(const char *old, const char *text)
+{
+	const char *retval;
+
+	if(text == NULL)
+		text = ""; /* silently accept NULL */
+	if(strchr(text, '\r') == NULL) {
+		retval = string_intern(text);
+	} else {
+		gchar **lines = g_strsplit(text, "\r\n", 0);
+		char *normalized = g_strjoinv("\n", lines);
+		g_strfreev(lines);
+		retval = string_intern_take(g_strdelimit(normalized, "\r", '\n'));
+	}
+
+	/* Release the old text afterwards, in case it is the same string */
+	string_intern_release(old);
+	return retval;
+}
+
+/* Intern the texts that were left in the skein cache, now that they are
+ needed */
+static void
+load_stored_texts(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+
+	if(priv->stored_texts == NULL)
+		return;
+	priv->transcript_text = intern_text(priv->transcript_text, priv->stored_transcript_text);
+	priv->expected_text = intern_text(priv->expected_text, priv->stored_expected_text);
+	g_mapped_file_unref(priv->stored_texts);
+	priv->stored_texts = NULL;
+	priv->stored_transcript_text = priv->stored_expected_text = NULL;
+}
+
+/* Fill colors of the knots, indexed by SELECT_PATTERN() */
+static const double node_colors[NODE_NUM_PATTERNS][3] = {
+	{ 0.31, 0.60, 0.02 }, /* Unplayed, without blessed transcript text: Tango Chameleon 3 */
+	{ 0.54, 0.87, 0.2 },  /* Unplayed, with blessed transcript text: Tango Chameleon 1 */
+	{ 0.77, 0.63, 0.0 },  /* Played, without blessed transcript text: Tango Butter 3 */
+	{ 0.99, 0.91, 0.31 }  /* Played, with blessed transcript text: Tango Butter 1 */
+};
+
+static cairo_pattern_t *
+create_node_pattern(double r, double g, double b)
+{
+	cairo_pattern_t *retval = cairo_pattern_create_radial(0.0, -0.33, 0.0, 0.0, 0.0, 1.0);
+	cairo_pattern_add_color_stop_rgb(retval, 0.0, MAX(1.0, r * 1.5), MAX(1.0, g * 1.5), MAX(1.0, b * 1.5));
+	cairo_pattern_add_color_stop_rgb(retval, 0.5, r, g, b);
+	cairo_pattern_add_color_stop_rgb(retval, 0.75, r * 0.5, g * 0.5, b * 0.5);
+	cairo_pattern_add_color_stop_rgb(retval, 1.0, r, g, b);
+	return retval;
+}
+
+/* The gradient for the background of the command, scaled to its size if that
+ is known yet */
+static cairo_pattern_t *
+create_command_pattern(I7NodePrivate *priv)
+{
+	const double *color = node_colors[SELECT_PATTERN(priv->played, priv->blessed)];
+	cairo_pattern_t *pattern = create_node_pattern(color[0], color[1], color[2]);
+	if(priv->command_width > 0.0 && priv->command_height > 0.0) {
+		cairo_matrix_t matrix;
+		cairo_matrix_init_scale(&matrix, 0.5 / priv->command_width, 1.0 / priv->command_height);
+		cairo_pattern_set_matrix(pattern, &matrix);
+	}
+	return pattern;
+}
+
+/* The gradient for the background of the label, scaled to its size */
+static cairo_pattern_t *
+create_label_pattern(I7NodePrivate *priv)
+{
+	cairo_matrix_t matrix;
+	cairo_pattern_t *pattern = cairo_pattern_create_linear(0.0, 0.0, 0.0, 1.0);
+	cairo_pattern_add_color_stop_rgba(pattern, 1.0, 0.0, 0.33, 0.0, 0.3);
+	cairo_pattern_add_color_stop_rgba(pattern, 0.67, 0.73, 0.84, 0.73, 0.1);
+	cairo_pattern_add_color_stop_rgba(pattern, 0.0, 0.5, 0.85, 0.5, 0.0);
+	cairo_matrix_init_scale(&matrix, 0.5 / priv->label_width, -1.0 / priv->label_height);
+	cairo_pattern_set_matrix(pattern, &matrix);
+	return pattern;
+}
+
+/* Give @item, a path or path model, @pattern as its fill; takes ownership of
+ @pattern */
+static void
+set_fill_pattern(gpointer item, cairo_pattern_t *pattern)
+{
+	g_object_set(item, "fill-pattern", pattern, NULL);
+	cairo_pattern_destroy(pattern);
+}
+
+/* The outline of the background of the command, or "" if its size isn't known
+ yet; free after use */
+static char *
+make_command_path(I7NodePrivate *priv)
+{
+	double width = priv->command_width, height = priv->command_height;
+	if(width <= 0.0 || height <= 0.0)
+		return g_strdup("");
+	return g_strdup_printf(
+	    "M %.1f -%.1f "              /* Move-to (w/2, -h/2) */
+		"a %.1f,%.1f 0 0,1 0,%.1f "  /* Arc r=(h/2, h/2) rot=0 large=0 dir=1 rel-to (0, h) */
+		"h -%.1f "                   /* Horizontal-line-rel-to (-w) */
+		"a %.1f,%.1f 0 0,1 0,-%.1f " /* Arc r=(h/2, h/2) rot=0 large=0 dir=1 rel-to (0, -h) */
+		"Z",                         /* Close-path */
+		width / 2, height / 2,
+	    height / 2, height / 2, height,
+	    width,
+	    height / 2, height / 2, height);
+}
+
+/* The outline of the background of the label; free after use */
+static char *
+make_label_path(I7NodePrivate *priv)
+{
+	double width = priv->label_width, height = priv->label_height;
+	return g_strdup_printf(
+	    "M %.1f,%.1f "                   /* Move-to (w/2+h, h/2) */
+		"a %.1f,%.1f 0 0,0 -%.1f,-%.1f " /* Arc r=(h, h) rot=0 large=0 dir=0 rel-to (-h, -h) */
+		"h -%.1f "                       /* Horizontal-line-rel-to (-w) */
+		"a %.1f,%.1f 0 0,0 -%.1f,%.1f "  /* Arc r=(h, h) rot=0 large=0 dir=0 rel-to (-h, h) */
+		"Z",
+		width / 2 + height, height / 2,
+		height, height, height, height,
+		width,
+		height, height, height, height);
+}
+
+/* Whether the label has been measured, so its background can be drawn */
+static gboolean
+label_is_drawn(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	return i7_node_has_label(self) && priv->label_width > 0.0 && priv->label_height > 0.0;
+}
+
 static void
 draw_differs_badge(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
 	if(g_object_get_data(G_OBJECT(priv->badge_item), "path-drawn") == NULL) {
 		/* if the differs badge hasn't been drawn yet, draw it */
-		g_object_set(priv->badge_item, "data",
-		"M 1.0,0.0 0.691,0.112 0.949,0.317 0.62,0.325 0.799,0.601 "
-		"0.485,0.505 0.568,0.823 0.3,0.632 0.278,0.961 0.084,0.695 -0.04,0.999 "
-		"-0.14,0.686 -0.355,0.935 -0.35,0.606 -0.632,0.775 -0.524,0.464 "
-		"-0.845,0.534 -0.644,0.274 -0.971,0.239 -0.698,0.056 -0.997,-0.08 "
-		"-0.68,-0.168 -0.92,-0.392 -0.592,-0.374 -0.749,-0.663 -0.443,-0.542 "
-		"-0.5,-0.866 -0.248,-0.655 -0.2,-0.98 -0.028,-0.699 0.121,-0.993 "
-		"0.195,-0.672 0.429,-0.903 0.398,-0.576 0.693,-0.721 0.56,-0.421 "
-		"0.885,-0.465 0.664,-0.222 0.987,-0.16 0.7,-0.0 Z",
-		"visibility", GOO_CANVAS_ITEM_VISIBLE,
-		NULL);
-		/* That SVG code is generated with this Python code:
-		import numpy as N
-		angles = N.linspace(0, 2 * N.pi, 40)
-		radii = N.ones_like(angles)
-		radii[1::2] *= 0.7
-		xs = radii * N.cos(angles)
-		ys = radii * N.sin(angles)
-		print "M",
-		for x, y in zip(xs, ys):
-			print "{0:.3},{1:.3}".format(round(x, 3), round(y, 3)),
-		print "Z" */
+		g_object_set(priv->badge_item,
+			"data", DIFFERS_BADGE_PATH,
+			"visibility", GOO_CANVAS_ITEM_VISIBLE,
+			NULL);
 		g_object_set_data(G_OBJECT(priv->badge_item), "path-drawn", GINT_TO_POINTER(1));
 		/* Have to resize the badge after drawing it */
 		g_object_set(priv->badge_item,
@@ -138,9 +329,10 @@ static void
 update_node_background(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
-	g_object_set(priv->command_shape_item,
-		"fill-pattern", priv->node_pattern[SELECT_PATTERN(priv->played, priv->blessed)],
-		NULL);
+	priv->appearance_version++;
+	if(priv->command_shape_item == NULL)
+		return;
+	set_fill_pattern(priv->command_shape_item, create_command_pattern(priv));
 	if(i7_node_get_different(self))
 		draw_differs_badge(self);
 	else
@@ -154,34 +346,147 @@ clear_diffs(I7Node *self)
 	
 	g_free(priv->transcript_pango_string);
 	g_free(priv->expected_pango_string);
-	g_list_free(priv->transcript_diffs);
-	g_list_free(priv->expected_diffs);
+	if(priv->transcript_diffs)
+		g_array_free(priv->transcript_diffs, TRUE);
+	if(priv->expected_diffs)
+		g_array_free(priv->expected_diffs, TRUE);
 	
 	priv->match = I7_NODE_CANT_COMPARE;
+	priv->diffs_deferred = FALSE;
 	priv->transcript_diffs = NULL;
 	priv->transcript_pango_string = NULL;
 	priv->expected_diffs = NULL;
 	priv->expected_pango_string = NULL;
 }
 
+/* Store the result of comparing the expected and transcript text; takes
+ ownership of the diff arrays */
 static void
-calculate_diffs(I7Node *self)
+set_diffs(I7Node *self, gboolean equal, GArray *expected_diffs, GArray *transcript_diffs)
 {
 	I7_NODE_USE_PRIVATE;
 
 	I7NodeMatchType old_match_status = priv->match;
-	
+
 	clear_diffs(self);
+	text_changed(self);
 
-	if(!i7_node_get_blessed(self))
-		priv->match = I7_NODE_CANT_COMPARE;
-	else if(!word_diff(priv->expected_text, priv->transcript_text, &priv->expected_diffs, &priv->transcript_diffs)) {
-		if(priv->expected_diffs || priv->transcript_diffs)
-			priv->match = I7_NODE_NO_MATCH;
-		else
-			priv->match = I7_NODE_NEAR_MATCH;
-	} else
+	priv->expected_diffs = expected_diffs;
+	priv->transcript_diffs = transcript_diffs;
+	if(equal)
 		priv->match = I7_NODE_EXACT_MATCH;
+	else if(expected_diffs || transcript_diffs)
+		priv->match = I7_NODE_NO_MATCH;
+	else
+		priv->match = I7_NODE_NEAR_MATCH;
+
+	/* The Pango markup is only made when the Transcript asks for it */
+
+	if(old_match_status != priv->match)
+		g_object_notify(G_OBJECT(self), "match");
+}
+
+static void
+calculate_diffs(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+
+	if(!i7_node_get_blessed(self)) {
+		I7NodeMatchType old_match_status = priv->match;
+		clear_diffs(self);
+		if(old_match_status != priv->match)
+			g_object_notify(G_OBJECT(self), "match");
+		return;
+	}
+
+	GArray *expected_diffs = NULL, *transcript_diffs = NULL;
+	gint64 start = skein_stats_start();
+	gboolean equal = word_diff(priv->expected_text, priv->transcript_text, &expected_diffs, &transcript_diffs);
+	skein_stats_stop(SKEIN_STATS_DIFF, start);
+	skein_stats_count(SKEIN_STATS_DIFFS_COMPUTED, 1);
+	set_diffs(self, equal, expected_diffs, transcript_diffs);
+}
+
+/* A comparison waiting in the skein's diff pool */
+typedef struct {
+	I7Node *node;
+	guint serial;
+} PendingDiff;
+
+static void
+pending_diff_free(PendingDiff *pending)
+{
+	g_object_unref(pending->node);
+	g_slice_free(PendingDiff, pending);
+}
+
+/* Called in the main loop when the diff pool has compared this knot's texts */
+static void
+on_background_diff_finished(gboolean equal, GArray *expected_diffs, GArray *transcript_diffs, PendingDiff *pending)
+{
+	I7Node *self = pending->node;
+	I7_NODE_USE_PRIVATE;
+
+	/* Throw the result away if either text changed again in the meantime */
+	if(pending->serial != priv->diff_serial) {
+		if(expected_diffs)
+			g_array_free(expected_diffs, TRUE);
+		if(transcript_diffs)
+			g_array_free(transcript_diffs, TRUE);
+		return;
+	}
+
+	set_diffs(self, equal, expected_diffs, transcript_diffs);
+	update_node_background(self);
+}
+
+/* If the skein is diffing in the background, hand the texts over to its pool
+ and return TRUE; the old diffs don't refer to the new texts anymore, so the
+ knot can't be compared until the result comes back */
+static gboolean
+queue_background_diff(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+
+	if(!priv->blessed)
+		return FALSE;
+	GooCanvasItemModel *skein = goo_canvas_item_model_get_parent(GOO_CANVAS_ITEM_MODEL(self));
+	if(skein == NULL || !I7_IS_SKEIN(skein))
+		return FALSE;
+	DiffPool *pool = i7_skein_get_diff_pool(I7_SKEIN(skein));
+	if(pool == NULL)
+		return FALSE;
+
+	I7NodeMatchType old_match_status = priv->match;
+	clear_diffs(self);
+	if(old_match_status != priv->match)
+		g_object_notify(G_OBJECT(self), "match");
+
+	PendingDiff *pending = g_slice_new(PendingDiff);
+	pending->node = g_object_ref(self);
+	pending->serial = priv->diff_serial;
+	diff_pool_push(pool, priv->expected_text, priv->transcript_text,
+		(DiffPoolResultFunc)on_background_diff_finished, pending,
+		(GDestroyNotify)pending_diff_free);
+	return TRUE;
+}
+
+/* Build the Pango markup for the transcript and expected text, underlining the
+ words that differ */
+static void
+make_pango_strings(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+
+	load_stored_texts(self);
+	if(priv->diffs_deferred) {
+		/* The match type came from the skein cache, but the diffs didn't */
+		gint64 start = skein_stats_start();
+		word_diff(priv->expected_text, priv->transcript_text, &priv->expected_diffs, &priv->transcript_diffs);
+		skein_stats_stop(SKEIN_STATS_DIFF, start);
+		skein_stats_count(SKEIN_STATS_DIFFS_COMPUTED, 1);
+		priv->diffs_deferred = FALSE;
+	}
 
 	if(priv->match == I7_NODE_NO_MATCH) {
 		priv->transcript_pango_string = make_pango_markup_string(priv->transcript_text, priv->transcript_diffs);
@@ -190,15 +495,17 @@ calculate_diffs(I7Node *self)
 		priv->transcript_pango_string = g_markup_escape_text(priv->transcript_text? priv->transcript_text : "", -1);
 		priv->expected_pango_string = g_markup_escape_text(priv->expected_text? priv->expected_text : "", -1);
 	}
-
-	if(old_match_status != priv->match)
-		g_object_notify(G_OBJECT(self), "match");
 }
 
 static void
 transcript_modified(I7Node *self)
 {
-	calculate_diffs(self);
+	I7_NODE_USE_PRIVATE;
+
+	priv->diff_serial++;
+	text_changed(self);
+	if(!queue_background_diff(self))
+		calculate_diffs(self);
 	update_node_background(self);
 }
 
@@ -234,18 +541,9 @@ i7_node_set_expected_text(I7Node *self, const gchar *text)
 {
 	I7_NODE_USE_PRIVATE;
 
-	g_free(priv->expected_text);
-	priv->expected_text = g_strdup(text? text : ""); /* silently accept NULL */
-
-	/* Change newline separators to \n */
-	if(strstr(priv->expected_text, "\r\n")) {
-		gchar **lines = g_strsplit(priv->expected_text, "\r\n", 0);
-		g_free(priv->expected_text);
-		priv->expected_text = g_strjoinv("\n", lines);
-		g_strfreev(lines);
-	}
-	priv->expected_text = g_strdelimit(priv->expected_text, "\r", '\n');
-	priv->blessed = !(strlen(priv->expected_text) == 0);
+	load_stored_texts(self);
+	priv->expected_text = intern_text(priv->expected_text, text);
+	priv->blessed = (*priv->expected_text != '\0');
 
 	transcript_modified(self);
 
@@ -273,19 +571,6 @@ i7_node_set_changed(I7Node *self, gboolean changed)
 		g_object_notify(G_OBJECT(self), "changed");
 }
 
-/* GENERAL STATIC FUNCTIONS */
-
-static cairo_pattern_t *
-create_node_pattern(double r, double g, double b)
-{
-	cairo_pattern_t *retval = cairo_pattern_create_radial(0.0, -0.33, 0.0, 0.0, 0.0, 1.0);
-	cairo_pattern_add_color_stop_rgb(retval, 0.0, MAX(1.0, r * 1.5), MAX(1.0, g * 1.5), MAX(1.0, b * 1.5));
-	cairo_pattern_add_color_stop_rgb(retval, 0.5, r, g, b);
-	cairo_pattern_add_color_stop_rgb(retval, 0.75, r * 0.5, g * 0.5, b * 0.5);
-	cairo_pattern_add_color_stop_rgb(retval, 1.0, r, g, b);
-	return retval;
-}
-
 /* TYPE SYSTEM */
 
 static void
@@ -295,7 +580,7 @@ i7_node_init(I7Node *self)
 	priv->id = g_strdup_printf("node-%p", self);
 	self->gnode = g_node_new(self);
 	self->tree_item = NULL;
-	self->tree_points = goo_canvas_points_new(4);
+	self->tree_points = NULL;
 
 	priv->blessed = FALSE;
 	priv->match = I7_NODE_CANT_COMPARE;
@@ -304,47 +589,21 @@ i7_node_init(I7Node *self)
 	priv->expected_diffs = NULL;
 	priv->expected_pango_string = NULL;
 
-	/* Create the cairo gradients */
-	/* Label */
-	priv->label_pattern = cairo_pattern_create_linear(0.0, 0.0, 0.0, 1.0);
-	cairo_pattern_add_color_stop_rgba(priv->label_pattern, 1.0, 0.0, 0.33, 0.0, 0.3);
-	cairo_pattern_add_color_stop_rgba(priv->label_pattern, 0.67, 0.73, 0.84, 0.73, 0.1);
-	cairo_pattern_add_color_stop_rgba(priv->label_pattern, 0.0, 0.5, 0.85, 0.5, 0.0);
-	/* Node, unplayed, without blessed transcript text: Tango Chameleon 3 */
-	priv->node_pattern[NODE_UNPLAYED_UNBLESSED] = create_node_pattern(0.31, 0.60, 0.02);
-	/* Node, unplayed, with blessed transcript text: Tango Chameleon 1 */
-	priv->node_pattern[NODE_UNPLAYED_BLESSED] = create_node_pattern(0.54, 0.87, 0.2);
-	/* Node, played, without blessed transcript text: Tango Butter 3 */
-	priv->node_pattern[NODE_PLAYED_UNBLESSED] = create_node_pattern(0.77, 0.63, 0.0);
-	/* Node, played, with blessed transcript text: Tango Butter 1 */
-	priv->node_pattern[NODE_PLAYED_BLESSED] = create_node_pattern(0.99, 0.91, 0.31);
-
-	/* Create the canvas items, though some of them can't be drawn yet */
-	priv->command_shape_item = goo_canvas_path_model_new(GOO_CANVAS_ITEM_MODEL(self), "",
-		"stroke-pattern", NULL,
-		"fill-pattern", priv->node_pattern[NODE_UNPLAYED_UNBLESSED],
-		NULL);
-	priv->label_shape_item = goo_canvas_path_model_new(GOO_CANVAS_ITEM_MODEL(self), "",
-		"stroke-pattern", NULL,
-		"fill-pattern", priv->label_pattern,
-		NULL);
-	priv->command_item = goo_canvas_text_model_new(GOO_CANVAS_ITEM_MODEL(self), "", 0.0, 0.0, -1, GTK_ANCHOR_CENTER, NULL);
-	priv->label_item = goo_canvas_text_model_new(GOO_CANVAS_ITEM_MODEL(self), "", 0.0, 0.0, -1, GTK_ANCHOR_CENTER, NULL);
-	priv->badge_item = goo_canvas_path_model_new(GOO_CANVAS_ITEM_MODEL(self), "",
-	  "fill-color", "red",
-	  "line-width", 0,
-	  "visibility", GOO_CANVAS_ITEM_HIDDEN,
-	  NULL);
-	g_object_set_data(G_OBJECT(priv->badge_item), "path-drawn", NULL);
-	g_object_set_data(G_OBJECT(priv->badge_item), "node-part", GINT_TO_POINTER(I7_NODE_PART_DIFFERS_BADGE));
-	/* Avoid drawing the differs badges unless they're actually needed, otherwise
-	it really slows down the story startup */
+	/* The canvas item models are created in i7_node_create_items(), if they
+	 are needed at all */
+	priv->command_item = priv->label_item = priv->badge_item = NULL;
+	priv->command_shape_item = priv->label_shape_item = NULL;
+	priv->appearance_version = 0;
 
 	priv->x = 0.0;
+	priv->tree_width = -1.0;
+	priv->layout_dirty = TRUE;
+	priv->depth = -1;
 	priv->command_width = -1.0;
 	priv->command_height = -1.0;
 	priv->label_width = -1.0;
 	priv->label_height = -1.0;
+	text_changed(self);
 }
 
 static void
@@ -396,10 +655,10 @@ i7_node_get_property(GObject *self, guint prop_id, GValue *value, GParamSpec *ps
 			g_value_set_string(value, priv->label);
 			break;
 		case PROP_TRANSCRIPT_TEXT:
-			g_value_set_string(value, priv->transcript_text);
+			g_value_set_string(value, i7_node_peek_transcript_text(I7_NODE(self)));
 			break;
 		case PROP_EXPECTED_TEXT:
-			g_value_set_string(value, priv->expected_text);
+			g_value_set_string(value, i7_node_peek_expected_text(I7_NODE(self)));
 			break;
 		case PROP_CHANGED:
 			g_value_set_boolean(value, priv->changed);
@@ -435,21 +694,23 @@ i7_node_finalize(GObject *self)
 {
 	I7_NODE_USE_PRIVATE;
 
-	cairo_pattern_destroy(priv->label_pattern);
-	cairo_pattern_destroy(priv->node_pattern[NODE_UNPLAYED_UNBLESSED]);
-	cairo_pattern_destroy(priv->node_pattern[NODE_UNPLAYED_BLESSED]);
-	cairo_pattern_destroy(priv->node_pattern[NODE_PLAYED_UNBLESSED]);
-	cairo_pattern_destroy(priv->node_pattern[NODE_PLAYED_BLESSED]);
-	g_free(priv->command);
-	g_free(priv->label);
-	g_free(priv->transcript_text);
-	g_free(priv->expected_text);
+	string_intern_release(priv->command);
+	string_intern_release(priv->label);
+	string_intern_release(priv->transcript_text);
+	string_intern_release(priv->expected_text);
+	if(priv->stored_texts)
+		g_mapped_file_unref(priv->stored_texts);
 	g_free(priv->transcript_pango_string);
 	g_free(priv->expected_pango_string);
 	g_free(priv->id);
-	goo_canvas_points_unref(I7_NODE(self)->tree_points);
-	g_list_free(priv->transcript_diffs);
-	g_list_free(priv->expected_diffs);
+	if(priv->child_index)
+		g_hash_table_destroy(priv->child_index);
+	if(I7_NODE(self)->tree_points)
+		goo_canvas_points_unref(I7_NODE(self)->tree_points);
+	if(priv->transcript_diffs)
+		g_array_free(priv->transcript_diffs, TRUE);
+	if(priv->expected_diffs)
+		g_array_free(priv->expected_diffs, TRUE);
 
 	/* recurse */
 	g_node_children_foreach(I7_NODE(self)->gnode, G_TRAVERSE_ALL, (GNodeForeachFunc)unref_node, NULL);
@@ -533,6 +794,7 @@ i7_node_new(const gchar *command, const gchar *label, const gchar *transcript,
 	return self;
 }
 
+/* Free after use */
 gchar *
 i7_node_get_command(I7Node *self)
 {
@@ -540,16 +802,31 @@ i7_node_get_command(I7Node *self)
 	return g_strdup(priv->command);
 }
 
+/* Don't free; only valid until the command changes */
+const char *
+i7_node_peek_command(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	return priv->command;
+}
+
 void
 i7_node_set_command(I7Node *self, const gchar *command)
 {
 	I7_NODE_USE_PRIVATE;
-	g_free(priv->command);
-	priv->command = g_strdup(command? command : ""); /* silently accept NULL */
+	const char *old_command = priv->command;
+	priv->command = string_intern(command); /* silently accept NULL */
+	if(self->gnode && self->gnode->parent)
+		invalidate_child_index(self->gnode->parent->data);
+	string_intern_release(old_command);
 
 	/* Update the graphics */
-	g_object_set(priv->command_item, "text", priv->command, NULL);
+	if(priv->command_item)
+		g_object_set(priv->command_item, "text", priv->command, NULL);
+	priv->appearance_version++;
 	priv->command_width = priv->command_height = -1.0;
+	i7_node_invalidate_layout(self);
+	text_changed(self);
 
 	g_object_notify(G_OBJECT(self), "command");
 }
@@ -562,18 +839,29 @@ i7_node_get_label(I7Node *self)
 	return g_strdup(priv->label);
 }
 
+/* Don't free; only valid until the label changes */
+const char *
+i7_node_peek_label(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	return priv->label;
+}
+
 void
 i7_node_set_label(I7Node *self, const gchar *label)
 {
 	I7_NODE_USE_PRIVATE;
-	g_free(priv->label);
-	priv->label = g_strdup(label? label : ""); /* silently accept NULL */
+	const char *old_label = priv->label;
+	priv->label = string_intern(label); /* silently accept NULL */
+	string_intern_release(old_label);
 
 	/* Update the graphics */
-
-	g_object_set(priv->label_item, "text", priv->label, NULL);
+	if(priv->label_item)
+		g_object_set(priv->label_item, "text", priv->label, NULL);
+	priv->appearance_version++;
 	priv->label_width = priv->label_height = -1.0;
 	priv->command_width = priv->command_height = -1.0;
+	i7_node_invalidate_layout(self);
 
 	g_object_notify(G_OBJECT(self), "label");
 }
@@ -585,57 +873,130 @@ i7_node_has_label(I7Node *self)
 	return (self->gnode->parent != NULL) && priv->label && (strlen(priv->label) > 0);
 }
 
+/* Free after use */
 gchar *
 i7_node_get_transcript_text(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
+	load_stored_texts(self);
 	return g_strdup(priv->transcript_text);
 }
 
+/* Don't free; only valid until the transcript text changes */
+const char *
+i7_node_peek_transcript_text(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	load_stored_texts(self);
+	return priv->transcript_text;
+}
+
 void
 i7_node_set_transcript_text(I7Node *self, const gchar *transcript)
 {
 	I7_NODE_USE_PRIVATE;
 
-	char *old_transcript_text = g_strdup(priv->transcript_text? priv->transcript_text : "");
-
-	g_free(priv->transcript_text);
-	priv->transcript_text = g_strdup(transcript? transcript : ""); /* silently accept NULL */
-
-	/* Change newline separators to \n */
-	if(strstr(priv->transcript_text, "\r\n")) {
-		gchar **lines = g_strsplit(priv->transcript_text, "\r\n", 0);
-		g_free(priv->transcript_text);
-		priv->transcript_text = g_strjoinv("\n", lines);
-		g_strfreev(lines);
-	}
-	priv->transcript_text = g_strdelimit(priv->transcript_text, "\r", '\n');
+	load_stored_texts(self);
 
-	if(strcmp(old_transcript_text, priv->transcript_text) != 0)
-		i7_node_set_changed(self, TRUE);
+	/* Equal interned strings are the same string. The first time, there is no
+	 old transcript text, which counts as "" */
+	const char *old_transcript_text = priv->transcript_text;
+	priv->transcript_text = intern_text(NULL, transcript);
+	if(old_transcript_text == NULL)
+		i7_node_set_changed(self, *priv->transcript_text != '\0');
 	else
-		i7_node_set_changed(self, FALSE);
-	g_free(old_transcript_text);
+		i7_node_set_changed(self, priv->transcript_text != old_transcript_text);
+	string_intern_release(old_transcript_text);
 
 	transcript_modified(self);
 
 	g_object_notify(G_OBJECT(self), "transcript-text");
 }
 
+/* Free after use */
 gchar *
 i7_node_get_expected_text(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
+	load_stored_texts(self);
 	return g_strdup(priv->expected_text);
 }
 
+/* Don't free; only valid until the expected text changes */
+const char *
+i7_node_peek_expected_text(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	load_stored_texts(self);
+	return priv->expected_text;
+}
+
+/*
+ * i7_node_set_stored_texts:
+ * @self: a knot that was just created
+ * @file: the mapped skein cache that the texts point into
+ * @transcript: the transcript text
+ * @expected: the expected text
+ * @match: how @transcript and @expected compare
+ *
+ * Gives the knot texts from the skein cache without copying them; they are only
+ * loaded when something asks for them, and the words that differ are only
+ * worked out when the Transcript shows them. Keeps a reference to @file until
+ * then.
+ */
+void
+i7_node_set_stored_texts(I7Node *self, GMappedFile *file, const char *transcript, const char *expected, I7NodeMatchType match)
+{
+	I7_NODE_USE_PRIVATE;
+
+	load_stored_texts(self);
+	clear_diffs(self);
+	priv->stored_texts = g_mapped_file_ref(file);
+	priv->stored_transcript_text = transcript;
+	priv->stored_expected_text = expected;
+	priv->blessed = (*expected != '\0');
+	priv->match = priv->blessed? match : I7_NODE_CANT_COMPARE;
+	priv->diffs_deferred = (priv->match == I7_NODE_NO_MATCH);
+	text_changed(self);
+	update_node_background(self);
+
+	g_object_notify(G_OBJECT(self), "blessed");
+	g_object_notify(G_OBJECT(self), "match");
+}
+
+/*
+ * i7_node_peek_stored_texts:
+ * @self: the knot
+ * @transcript: return location for the transcript text
+ * @expected: return location for the expected text
+ *
+ * Like i7_node_peek_transcript_text() and i7_node_peek_expected_text(), but
+ * doesn't load texts that are still in the skein cache.
+ *
+ * Returns: how the texts compare, or %I7_NODE_CANT_COMPARE if that isn't known
+ * yet.
+ */
+I7NodeMatchType
+i7_node_peek_stored_texts(I7Node *self, const char **transcript, const char **expected)
+{
+	I7_NODE_USE_PRIVATE;
+	if(priv->stored_texts) {
+		*transcript = priv->stored_transcript_text;
+		*expected = priv->stored_expected_text;
+	} else {
+		*transcript = priv->transcript_text;
+		*expected = priv->expected_text;
+	}
+	return priv->match;
+}
+
 const char *
 i7_node_get_transcript_pango_string(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
 
 	if(!priv->transcript_pango_string)
-		calculate_diffs(self);
+		make_pango_strings(self);
 	
 	return priv->transcript_pango_string;
 }
@@ -646,19 +1007,33 @@ i7_node_get_expected_pango_string(I7Node *self)
 	I7_NODE_USE_PRIVATE;
 
 	if(!priv->expected_pango_string)
-		calculate_diffs(self);
+		make_pango_strings(self);
 	
 	return priv->expected_pango_string;
 }
 
-I7NodeMatchType
-i7_node_get_match_type(I7Node *self)
+/*
+ * i7_node_drop_pango_strings:
+ * @self: the knot
+ *
+ * Frees the Pango markup of the transcript and expected text, for knots that
+ * the Transcript isn't showing. It is made again the next time it is asked for.
+ */
+void
+i7_node_drop_pango_strings(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
 
-	if(!priv->expected_pango_string || !priv->transcript_pango_string)
-		calculate_diffs(self);
+	g_free(priv->transcript_pango_string);
+	g_free(priv->expected_pango_string);
+	priv->transcript_pango_string = NULL;
+	priv->expected_pango_string = NULL;
+}
 
+I7NodeMatchType
+i7_node_get_match_type(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
 	return priv->match;
 }
 
@@ -666,9 +1041,9 @@ i7_node_get_match_type(I7Node *self)
  * i7_node_get_different:
  * @self: the knot.
  *
- * Computes the differences between the transcript text and expected text, and
- * returns %TRUE if they do not match. Returns %FALSE if they do match, or if
- * there is no expected text.
+ * Returns %TRUE if the transcript text and expected text do not match. Returns
+ * %FALSE if they do match, or if there is no expected text. The differences
+ * are computed whenever either text changes.
  *
  * Returns: %TRUE if transcript text and expected text differ, %FALSE if not
  * or if there is no expected text.
@@ -677,13 +1052,23 @@ gboolean
 i7_node_get_different(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
-
-	if(!priv->expected_pango_string || !priv->transcript_pango_string)
-		calculate_diffs(self);
-
 	return (priv->match == I7_NODE_NEAR_MATCH || priv->match == I7_NODE_NO_MATCH);
 }
 
+/*
+ * i7_node_get_text_version:
+ * @self: the knot
+ *
+ * Returns: a number that changes whenever the command, transcript text,
+ * expected text or their markup change, and is never shared with another knot.
+ */
+guint
+i7_node_get_text_version(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	return priv->text_version;
+}
+
 gboolean
 i7_node_get_changed(I7Node *self)
 {
@@ -733,6 +1118,7 @@ void
 i7_node_bless(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
+	load_stored_texts(self);
 	i7_node_set_expected_text(self, priv->transcript_text);
 }
 
@@ -749,26 +1135,65 @@ void i7_node_set_score(I7Node *self, gint score)
 	g_object_notify(G_OBJECT(self), "score");
 }
 
-gdouble
-i7_node_get_tree_width(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas)
+/* Returns the cached width of the subtree rooted at @self, recalculating only
+ the parts of it that were invalidated since the last time */
+static gdouble
+get_tree_width_cached(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas, gdouble spacing)
 {
 	I7_NODE_USE_PRIVATE;
-	gdouble spacing;
-	g_object_get(skein, "horizontal-spacing", &spacing, NULL);
+
+	if(priv->tree_width >= 0.0)
+		return priv->tree_width;
 
 	/* Get the tree width of all children */
-	int i;
+	GNode *child;
 	gdouble total = 0.0;
-	for(i = 0; i < g_node_n_children(self->gnode); i++) {
-		total += i7_node_get_tree_width(g_node_nth_child(self->gnode, i)->data, skein, canvas);
-		if(i > 0)
+	for(child = self->gnode->children; child; child = child->next) {
+		total += get_tree_width_cached(child->data, skein, canvas, spacing);
+		if(child != self->gnode->children)
 			total += spacing;
 	}
-	/* Return whichever is larger, that or the node width */
+	/* Use whichever is larger, that or the node width */
 	if(priv->command_width < 0.0)
 		i7_node_calculate_size(self, skein, canvas);
 	gdouble width = MAX(priv->command_width, priv->label_width);
-	return MAX(total, width);
+	priv->tree_width = MAX(total, width);
+	return priv->tree_width;
+}
+
+gdouble
+i7_node_get_tree_width(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas)
+{
+	gdouble spacing;
+	g_object_get(skein, "horizontal-spacing", &spacing, NULL);
+	return get_tree_width_cached(self, skein, canvas, spacing);
+}
+
+/*
+ * i7_node_invalidate_layout:
+ * @self: the knot
+ *
+ * Marks the layout of @self and all of its ancestors as needing to be
+ * recalculated. Call this whenever the size of @self changes, or a knot is
+ * added directly beneath it or removed from beneath it. The next call to
+ * i7_node_layout() will only lay out the subtrees that were invalidated.
+ */
+void
+i7_node_invalidate_layout(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	GNode *iter;
+
+	priv->layout_dirty = TRUE;
+	priv->tree_width = -1.0;
+
+	for(iter = self->gnode->parent; iter; iter = iter->parent) {
+		I7NodePrivate *ancestor_priv = I7_NODE_PRIVATE(iter->data);
+		if(ancestor_priv->layout_dirty && ancestor_priv->tree_width < 0.0)
+			break; /* everything above this is already invalid */
+		ancestor_priv->layout_dirty = TRUE;
+		ancestor_priv->tree_width = -1.0;
+	}
 }
 
 const gchar *
@@ -790,111 +1215,77 @@ i7_node_is_root(I7Node *self)
 	return self->gnode->parent == NULL;
 }
 
-/* Is there a child node with the given command? (@command should already be
-escaped.) */
-I7Node *
-i7_node_find_child(I7Node *self, const gchar *command)
+static void
+build_child_index(I7Node *self)
 {
-	I7Node *node = NULL;
-	GNode *gnode = self->gnode->children;
-	while(gnode != NULL) {
-		gchar *cmp_command = i7_node_get_command(I7_NODE(gnode->data));
-		/* Special case: NULL is treated as "" */
-		if((strlen(cmp_command) == 0 && (command == NULL || strlen(command) == 0)) || (strcmp(cmp_command, command) == 0)) {
-			g_free(cmp_command);
-			node = gnode->data;
-			break;
-		}
-		gnode = gnode->next;
-		g_free(cmp_command);
-	}
+	I7_NODE_USE_PRIVATE;
+	GNode *gnode;
 
-	return node;
+	priv->child_index = g_hash_table_new(g_str_hash, g_str_equal);
+	/* If more than one child has the same command, the first one wins */
+	for(gnode = g_node_last_child(self->gnode); gnode; gnode = gnode->prev)
+		g_hash_table_insert(priv->child_index, (gpointer)i7_node_peek_command(gnode->data), gnode->data);
 }
 
 /*
- * i7_node_get_next_difference_below:
- * @node: reference node to get next difference from
+ * i7_node_append_child:
+ * @self: the knot
+ * @child: a knot that has no parent
  *
- * Finds the next difference below @node in the skein.
- * Returns: pointer to next different node.
+ * Makes @child the last child of @self, keeping the index of children up to
+ * date.
  */
-I7Node *
-i7_node_get_next_difference_below(I7Node *node) {
-	GNode *child = node->gnode->children;
-
-	if(!child)
-		return NULL;
-
-	do {
-		I7Node *child_node = I7_NODE(child->data);
-		if(i7_node_get_different(child_node))
-			return child_node;
-
-		I7Node *child_diff = i7_node_get_next_difference_below(child_node);
-		if(child_diff)
-			return child_diff;
-	} while((child = child->next));
-
-	return NULL;
+void
+i7_node_append_child(I7Node *self, I7Node *child)
+{
+	I7_NODE_USE_PRIVATE;
+	g_node_append(self->gnode, child->gnode);
+	const char *command = i7_node_peek_command(child);
+	if(priv->child_index && !g_hash_table_lookup(priv->child_index, command))
+		g_hash_table_insert(priv->child_index, (gpointer)command, child);
 }
 
 /*
- * i7_node_get_next_difference:
- * @node: reference node to get next difference from
+ * i7_node_unlink:
+ * @self: the knot
  *
- * Finds the next difference (either below @node, or to the right in the skein).
- * Returns: pointer to next different node.
+ * Removes @self from its parent, if it has one. Use this rather than
+ * g_node_unlink() so the parent's index of children stays correct.
  */
-I7Node *
-i7_node_get_next_difference(I7Node *node)
+void
+i7_node_unlink(I7Node *self)
 {
-	I7Node *diff_below;
-	if((diff_below = i7_node_get_next_difference_below(node)) != NULL)
-		return diff_below;
-
-	/* Iterate up from this point */
-	GNode *top, *our_branch;
-	top = node->gnode;
+	if(self->gnode->parent)
+		invalidate_child_index(self->gnode->parent->data);
+	g_node_unlink(self->gnode);
+}
 
-	while(top) {
-		our_branch = top;
-		top = top->parent;
+/* Is there a child node with the given command? (@command should already be
+escaped.) */
+I7Node *
+i7_node_find_child(I7Node *self, const gchar *command)
+{
+	I7_NODE_USE_PRIVATE;
+	I7Node *node = NULL;
+	GNode *gnode = self->gnode->children;
+	/* Special case: NULL is treated as "" */
+	if(command == NULL)
+		command = "";
 
-		while(top && g_node_n_children(top) <= 1) {
-			our_branch = top;
-			top = top->parent;
-		}
+	if(priv->child_index == NULL && g_node_n_children(self->gnode) >= CHILD_INDEX_THRESHOLD)
+		build_child_index(self);
+	if(priv->child_index)
+		return g_hash_table_lookup(priv->child_index, command);
 
-		if(!top)
-			return NULL;
-
-		/* Find the item to the right */
-		gboolean found_branch = FALSE;
-		GNode *child = top->children;
-		do {
-			if(child == our_branch) {
-				found_branch = TRUE;
-				break;
-			}
-		} while((child = child->next));
-
-		if(!found_branch)
-			return FALSE;
-
-		/* See if we can find any differences there */
-		while((child = child->next)) {
-			I7Node *child_node = I7_NODE(child->data);
-			if(i7_node_get_different(child_node))
-				return child_node;
-
-			I7Node *child_diff = i7_node_get_next_difference_below(child_node);
-			if(child_diff)
-				return child_diff;
+	while(gnode != NULL) {
+		if(strcmp(i7_node_peek_command(I7_NODE(gnode->data)), command) == 0) {
+			node = gnode->data;
+			break;
 		}
+		gnode = gnode->next;
 	}
 
-	return NULL;
+	return node;
 }
 
 static void
@@ -903,40 +1294,98 @@ write_child_pointer(GNode *gnode, GString *string)
 	g_string_append_printf(string, "      <child nodeId=\"%s\"/>\n", I7_NODE_PRIVATE(gnode->data)->id);
 }
 
-gchar *
-i7_node_get_xml(I7Node *self)
+/* Append @text to @string, escaped like g_markup_escape_text() does, but
+ without making a copy of it first */
+static void
+append_escaped(GString *string, const char *text)
+{
+	const char *run, *ptr;
+
+	if(text == NULL)
+		return;
+	for(run = ptr = text; *ptr; ptr++) {
+		guchar ch = *ptr;
+		const char *entity = NULL;
+		gunichar control = 0;
+
+		switch(ch) {
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			case '\'': entity = "&apos;"; break;
+			case '"': entity = "&quot;"; break;
+			default:
+				if((ch < 0x20 && ch != '\t' && ch != '\n' && ch != '\r') || ch == 0x7F)
+					control = ch;
+				/* C1 control characters, except NEL, are two bytes in UTF-8 */
+				else if(ch == 0xC2 && (guchar)ptr[1] >= 0x80 && (guchar)ptr[1] <= 0x9F && (guchar)ptr[1] != 0x85)
+					control = (guchar)ptr[1];
+		}
+		if(entity == NULL && control == 0)
+			continue;
+
+		g_string_append_len(string, run, ptr - run);
+		if(entity)
+			g_string_append(string, entity);
+		else {
+			g_string_append_printf(string, "&#x%x;", control);
+			if(control >= 0x80)
+				ptr++;
+		}
+		run = ptr + 1;
+	}
+	g_string_append_len(string, run, ptr - run);
+}
+
+/*
+ * i7_node_append_xml:
+ * @self: the knot
+ * @string: a #GString
+ *
+ * Appends the XML representation of @self to @string. The texts are escaped
+ * straight into @string, so nothing is kept in the knot afterwards, and texts
+ * that are still in the skein cache are written from there without loading
+ * them. Saving is still linear in the number of knots; see i7_skein_save().
+ */
+void
+i7_node_append_xml(I7Node *self, GString *string)
 {
 	I7_NODE_USE_PRIVATE;
+	const char *transcript, *expected;
 
-	/* Escape the following strings if necessary */
-	gchar *command = g_markup_escape_text(priv->command, -1);
-	gchar *transcript_text = g_markup_escape_text(priv->transcript_text, -1);
-	gchar *expected_text = g_markup_escape_text(priv->expected_text, -1);
-	gchar *label = g_markup_escape_text(priv->label, -1);
+	i7_node_peek_stored_texts(self, &transcript, &expected);
 
-	GString *string = g_string_new("");
 	g_string_append_printf(string, "  <item nodeId=\"%s\">\n", priv->id);
-	g_string_append_printf(string, "    <command xml:space=\"preserve\">%s</command>\n", command);
-	g_string_append_printf(string, "    <result xml:space=\"preserve\">%s</result>\n", transcript_text);
-	g_string_append_printf(string, "    <commentary xml:space=\"preserve\">%s</commentary>\n", expected_text);
-	g_string_append_printf(string, "    <played>%s</played>\n", priv->played? "YES" : "NO");
-	g_string_append_printf(string, "    <changed>%s</changed>\n", priv->changed? "YES" : "NO");
-	g_string_append_printf(string, "    <temporary score=\"%d\">%s</temporary>\n", priv->score, priv->locked? "NO" : "YES");
-
-	if(label)
-		g_string_append_printf(string, "    <annotation xml:space=\"preserve\">%s</annotation>\n", label);
+	g_string_append(string, "    <command xml:space=\"preserve\">");
+	append_escaped(string, priv->command);
+	g_string_append(string, "</command>\n    <result xml:space=\"preserve\">");
+	append_escaped(string, transcript);
+	g_string_append(string, "</result>\n    <commentary xml:space=\"preserve\">");
+	append_escaped(string, expected);
+	g_string_append_printf(string, "</commentary>\n"
+		"    <played>%s</played>\n"
+		"    <changed>%s</changed>\n"
+		"    <temporary score=\"%d\">%s</temporary>\n"
+		"    <annotation xml:space=\"preserve\">",
+		priv->played? "YES" : "NO",
+		priv->changed? "YES" : "NO",
+		priv->score, priv->locked? "NO" : "YES");
+	append_escaped(string, priv->label);
+	g_string_append(string, "</annotation>\n");
+
 	if(self->gnode->children) {
 		g_string_append(string, "    <children>\n");
 		g_node_children_foreach(self->gnode, G_TRAVERSE_ALL, (GNodeForeachFunc)write_child_pointer, string);
 		g_string_append(string, "    </children>\n");
 	}
 	g_string_append(string, "  </item>\n");
-	/* Free strings if necessary */
-	g_free(command);
-	g_free(transcript_text);
-	g_free(expected_text);
-	g_free(label);
+}
 
+gchar *
+i7_node_get_xml(I7Node *self)
+{
+	GString *string = g_string_new("");
+	i7_node_append_xml(self, string);
 	return g_string_free(string, FALSE); /* return cstr */
 }
 
@@ -947,102 +1396,124 @@ i7_node_get_x(I7Node *self)
 	return priv->x;
 }
 
-void
-i7_node_layout(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas, gdouble x)
+static void
+layout_recurse(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas, gdouble hspacing, gdouble vspacing, gdouble x, gint depth)
 {
 	I7_NODE_USE_PRIVATE;
 
-	gdouble hspacing, vspacing;
-	g_object_get(skein,
-		"horizontal-spacing", &hspacing,
-		"vertical-spacing", &vspacing,
-		NULL);
+	/* If nothing changed below this knot and it hasn't moved, then its whole
+	 subtree is still laid out correctly */
+	if(!priv->layout_dirty && priv->x == x && priv->depth == depth)
+		return;
 
-	if(g_node_n_children(self->gnode) == 1)
-		i7_node_layout(self->gnode->children->data, skein, canvas, x);
+	GNode *child = self->gnode->children;
+	if(child && child->next == NULL)
+		layout_recurse(child->data, skein, canvas, hspacing, vspacing, x, depth + 1);
 	else {
 		/* Find the total width of all descendant nodes */
-		gdouble total = i7_node_get_tree_width(self, skein, canvas);
+		gdouble total = get_tree_width_cached(self, skein, canvas, hspacing);
 		/* Lay out each child node */
-		GNode *child;
 		gdouble child_x = 0.0;
 
-		for(child = self->gnode->children; child; child = child->next) {
-			gdouble treewidth = i7_node_get_tree_width(child->data, skein, canvas);
-			i7_node_layout(child->data, skein, canvas, x - total * 0.5 + child_x + treewidth * 0.5);
+		for( ; child; child = child->next) {
+			gdouble treewidth = get_tree_width_cached(child->data, skein, canvas, hspacing);
+			layout_recurse(child->data, skein, canvas, hspacing, vspacing, x - total * 0.5 + child_x + treewidth * 0.5, depth + 1);
 			child_x += treewidth + hspacing;
 		}
 	}
 
 	/* Move the node's group to its proper place */
-	gdouble y = (gdouble)(g_node_depth(self->gnode) - 1.0) * vspacing;
-	g_object_set(self, "x", x, "y", y, NULL);
-	
-	/* Cache the x coordinate */
+	g_object_set(self, "x", x, "y", (gdouble)depth * vspacing, NULL);
+	skein_stats_count(SKEIN_STATS_KNOTS_LAID_OUT, 1);
+
+	/* Cache the position */
 	priv->x = x;
+	priv->depth = depth;
+	priv->layout_dirty = FALSE;
 }
 
+void
+i7_node_layout(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas, gdouble x)
+{
+	gdouble hspacing, vspacing;
+	g_object_get(skein,
+		"horizontal-spacing", &hspacing,
+		"vertical-spacing", &vspacing,
+		NULL);
+
+	layout_recurse(self, skein, canvas, hspacing, vspacing, x, g_node_depth(self->gnode) - 1);
+}
+
+/* Draw the background of the command in its item models at its current size */
 static void
-redraw_command(I7Node *self, double width, double height)
+draw_command_shape(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
-	cairo_matrix_t matrix;
-	char *path;
-	
-	/* Calculate the scale for the pattern gradients */
-	cairo_matrix_init_scale(&matrix, 0.5 / width, 1.0 / height);
-	cairo_pattern_set_matrix(priv->node_pattern[NODE_UNPLAYED_UNBLESSED], &matrix);
-	cairo_pattern_set_matrix(priv->node_pattern[NODE_UNPLAYED_BLESSED], &matrix);
-	cairo_pattern_set_matrix(priv->node_pattern[NODE_PLAYED_UNBLESSED], &matrix);
-	cairo_pattern_set_matrix(priv->node_pattern[NODE_PLAYED_BLESSED], &matrix);
-
-	/* Draw the text background */
-	path = g_strdup_printf(
-	    "M %.1f -%.1f "              /* Move-to (w/2, -h/2) */
-		"a %.1f,%.1f 0 0,1 0,%.1f "  /* Arc r=(h/2, h/2) rot=0 large=0 dir=1 rel-to (0, h) */
-		"h -%.1f "                   /* Horizontal-line-rel-to (-w) */
-		"a %.1f,%.1f 0 0,1 0,-%.1f " /* Arc r=(h/2, h/2) rot=0 large=0 dir=1 rel-to (0, -h) */
-		"Z",                         /* Close-path */
-		width / 2, height / 2,
-	    height / 2, height / 2, height,
-	    width,
-	    height / 2, height / 2, height);
+	char *path = make_command_path(priv);
 	g_object_set(priv->command_shape_item, "data", path, NULL);
 	g_free(path);
-
-	priv->command_width = width;
-	priv->command_height = height;
+	set_fill_pattern(priv->command_shape_item, create_command_pattern(priv));
 }
 
+/* Draw the background of the label in its item models at its current size */
 static void
-redraw_label(I7Node *self, double width, double height)
+draw_label_shape(I7Node *self)
 {
 	I7_NODE_USE_PRIVATE;
-	cairo_matrix_t matrix;
-	char *path;
-
-	/* Calculate the scale for the pattern gradient */
-	cairo_matrix_init_scale(&matrix, 0.5 / width, -1.0 / height);
-	cairo_pattern_set_matrix(priv->label_pattern, &matrix);
-	
-	path = g_strdup_printf(
-	    "M %.1f,%.1f "                   /* Move-to (w/2+h, h/2) */
-		"a %.1f,%.1f 0 0,0 -%.1f,-%.1f " /* Arc r=(h, h) rot=0 large=0 dir=0 rel-to (-h, -h) */
-		"h -%.1f "                       /* Horizontal-line-rel-to (-w) */
-		"a %.1f,%.1f 0 0,0 -%.1f,%.1f "  /* Arc r=(h, h) rot=0 large=0 dir=0 rel-to (-h, h) */
-		"Z",
-		width / 2 + height, height / 2,
-		height, height, height, height,
-		width,			                       
-		height, height, height, height);
+	char *path = make_label_path(priv);
 	g_object_set(priv->label_shape_item,
 		"data", path,
+		"x", -0.5 * priv->label_width - priv->label_height,
+		"y", -priv->command_height - 0.5 * priv->label_height,
 		"visibility", GOO_CANVAS_ITEM_VISIBLE,
 		NULL);
 	g_free(path);
+	set_fill_pattern(priv->label_shape_item, create_label_pattern(priv));
+}
 
+static void
+redraw_command(I7Node *self, double width, double height)
+{
+	I7_NODE_USE_PRIVATE;
+	priv->command_width = width;
+	priv->command_height = height;
+	priv->appearance_version++;
+	if(priv->command_shape_item)
+		draw_command_shape(self);
+	i7_node_invalidate_layout(self);
+}
+
+static void
+redraw_label(I7Node *self, double width, double height)
+{
+	I7_NODE_USE_PRIVATE;
 	priv->label_width = width;
 	priv->label_height = height;
+	priv->appearance_version++;
+	if(priv->label_shape_item)
+		draw_label_shape(self);
+	i7_node_invalidate_layout(self);
+}
+
+/* Measure @text in the skein's font; for when @canvas isn't displaying the
+ skein's item models, and so can't tell us the bounds of the text items */
+static void
+measure_text(GooCanvasItemModel *skein, GooCanvas *canvas, const gchar *text, double *width, double *height)
+{
+	PangoFontDescription *font = NULL;
+	PangoRectangle logical;
+	PangoLayout *layout = gtk_widget_create_pango_layout(GTK_WIDGET(canvas), text);
+
+	g_object_get(skein, "font-desc", &font, NULL);
+	if(font) {
+		pango_layout_set_font_description(layout, font);
+		pango_font_description_free(font);
+	}
+	pango_layout_get_pixel_extents(layout, NULL, &logical);
+	g_object_unref(layout);
+
+	*width = logical.width;
+	*height = logical.height;
 }
 
 void
@@ -1057,17 +1528,22 @@ i7_node_calculate_size(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canva
 	gboolean label_width_changed, label_height_changed;
 
 	/* Calculate the bounds of the command text and label text */
-	item = goo_canvas_get_item(canvas, priv->command_item);
-	goo_canvas_item_get_bounds(item, &size);
-
-	command_width = size.x2 - size.x1;
-	command_height = size.y2 - size.y1;
+	item = priv->command_item? goo_canvas_get_item(canvas, priv->command_item) : NULL;
+	if(item) {
+		goo_canvas_item_get_bounds(item, &size);
+		command_width = size.x2 - size.x1;
+		command_height = size.y2 - size.y1;
+	} else
+		measure_text(skein, canvas, priv->command, &command_width, &command_height);
 
 	if(i7_node_has_label(self)) {
-		item = goo_canvas_get_item(canvas, priv->label_item);
-		goo_canvas_item_get_bounds(item, &size);
-		label_width = size.x2 - size.x1;
-		label_height = size.y2 - size.y1;
+		item = priv->label_item? goo_canvas_get_item(canvas, priv->label_item) : NULL;
+		if(item) {
+			goo_canvas_item_get_bounds(item, &size);
+			label_width = size.x2 - size.x1;
+			label_height = size.y2 - size.y1;
+		} else
+			measure_text(skein, canvas, priv->label, &label_width, &label_height);
 	}
 
 	command_width_changed = command_width != 0.0 && priv->command_width != command_width;
@@ -1078,20 +1554,19 @@ i7_node_calculate_size(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canva
 	if(command_width_changed || command_height_changed)
 		redraw_command(self, command_width, command_height);
 
-	if(command_height_changed)
-		g_object_set(priv->label_item, "x", 0.0, "y", -command_height, NULL);
-
 	/* Draw the label background */
 	if(i7_node_has_label(self)) {
 		if(label_width_changed || label_height_changed)
 			redraw_label(self, label_width, label_height);
+		else if(command_height_changed && priv->label_shape_item)
+			draw_label_shape(self);
+	}
 
-		if(label_width_changed || label_height_changed || command_height_changed)
-			g_object_set(priv->label_shape_item,
-			    "x", -0.5 * label_width - label_height,
-			    "y", -command_height - 0.5 * label_height,
-				NULL);
-	} else {
+	if(priv->command_item == NULL)
+		return;
+	if(command_height_changed)
+		g_object_set(priv->label_item, "x", 0.0, "y", -command_height, NULL);
+	if(!i7_node_has_label(self)) {
 		g_object_set(priv->label_shape_item,
 			"data", "",
 			"visibility", GOO_CANVAS_ITEM_HIDDEN,
@@ -1107,6 +1582,133 @@ i7_node_calculate_size(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canva
 		NULL);
 }
 
+/*
+ * i7_node_create_items:
+ * @self: the knot
+ *
+ * Creates the knot's own canvas item models, if it doesn't have them yet, and
+ * brings them up to date. Only views that display the skein's item models
+ * need them; the virtualized #I7SkeinView draws the knots in view with
+ * i7_node_update_items() instead, so that knots it never shows cost no canvas
+ * items at all.
+ */
+void
+i7_node_create_items(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+
+	if(priv->command_item)
+		return;
+
+	priv->command_shape_item = goo_canvas_path_model_new(GOO_CANVAS_ITEM_MODEL(self), "",
+		"stroke-pattern", NULL,
+		NULL);
+	priv->label_shape_item = goo_canvas_path_model_new(GOO_CANVAS_ITEM_MODEL(self), "",
+		"stroke-pattern", NULL,
+		"visibility", GOO_CANVAS_ITEM_HIDDEN,
+		NULL);
+	priv->command_item = goo_canvas_text_model_new(GOO_CANVAS_ITEM_MODEL(self), priv->command? priv->command : "", 0.0, 0.0, -1, GTK_ANCHOR_CENTER, NULL);
+	priv->label_item = goo_canvas_text_model_new(GOO_CANVAS_ITEM_MODEL(self), priv->label? priv->label : "", 0.0, 0.0, -1, GTK_ANCHOR_CENTER, NULL);
+	priv->badge_item = goo_canvas_path_model_new(GOO_CANVAS_ITEM_MODEL(self), "",
+	  "fill-color", "red",
+	  "line-width", 0,
+	  "visibility", GOO_CANVAS_ITEM_HIDDEN,
+	  NULL);
+	g_object_set_data(G_OBJECT(priv->badge_item), "path-drawn", NULL);
+	g_object_set_data(G_OBJECT(priv->badge_item), "node-part", GINT_TO_POINTER(I7_NODE_PART_DIFFERS_BADGE));
+	/* Avoid drawing the differs badges unless they're actually needed, otherwise
+	it really slows down the story startup */
+
+	/* Catch up with the sizes that were measured before there were items */
+	draw_command_shape(self);
+	if(label_is_drawn(self))
+		draw_label_shape(self);
+	if(priv->command_height > 0.0) {
+		g_object_set(priv->label_item, "x", 0.0, "y", -priv->command_height, NULL);
+		g_object_set(priv->badge_item,
+			"x", priv->command_width / 2,
+			"y", priv->command_height / 2 - DIFFERS_BADGE_RADIUS,
+			"width", DIFFERS_BADGE_RADIUS * 2,
+			"height", DIFFERS_BADGE_RADIUS * 2,
+			NULL);
+	}
+	update_node_background(self);
+}
+
+/*
+ * i7_node_update_items:
+ * @self: the knot
+ * @command_shape: a #GooCanvasPath
+ * @label_shape: a #GooCanvasPath
+ * @command: a #GooCanvasText
+ * @label: a #GooCanvasText
+ * @badge: a #GooCanvasPath
+ *
+ * Makes a set of plain canvas items look like this knot's own item models, for
+ * views that draw knots without going through the canvas model, such as the
+ * virtualized #I7SkeinView. The items should be children of one group placed
+ * at the knot's position. Call i7_node_calculate_size() first.
+ */
+void
+i7_node_update_items(I7Node *self, GooCanvasItem *command_shape, GooCanvasItem *label_shape, GooCanvasItem *command, GooCanvasItem *label, GooCanvasItem *badge)
+{
+	I7_NODE_USE_PRIVATE;
+	char *path;
+
+	path = make_command_path(priv);
+	g_object_set(command_shape, "data", path, NULL);
+	g_free(path);
+	set_fill_pattern(command_shape, create_command_pattern(priv));
+	g_object_set(command, "text", priv->command, NULL);
+
+	if(label_is_drawn(self)) {
+		path = make_label_path(priv);
+		g_object_set(label_shape,
+			"data", path,
+			"x", -0.5 * priv->label_width - priv->label_height,
+			"y", -priv->command_height - 0.5 * priv->label_height,
+			"visibility", GOO_CANVAS_ITEM_VISIBLE,
+			NULL);
+		g_free(path);
+		set_fill_pattern(label_shape, create_label_pattern(priv));
+		g_object_set(label, "text", priv->label, NULL);
+	} else {
+		g_object_set(label_shape, "visibility", GOO_CANVAS_ITEM_HIDDEN, NULL);
+		g_object_set(label, "text", "", NULL);
+	}
+	g_object_set(label, "x", 0.0, "y", -priv->command_height, NULL);
+
+	if(i7_node_get_different(self)) {
+		if(g_object_get_data(G_OBJECT(badge), "path-drawn") == NULL) {
+			g_object_set(badge, "data", DIFFERS_BADGE_PATH, NULL);
+			g_object_set_data(G_OBJECT(badge), "path-drawn", GINT_TO_POINTER(1));
+		}
+		g_object_set(badge,
+			"x", priv->command_width / 2,
+			"y", priv->command_height / 2 - DIFFERS_BADGE_RADIUS,
+			"width", DIFFERS_BADGE_RADIUS * 2,
+			"height", DIFFERS_BADGE_RADIUS * 2,
+			"visibility", GOO_CANVAS_ITEM_VISIBLE,
+			NULL);
+	} else
+		g_object_set(badge, "visibility", GOO_CANVAS_ITEM_HIDDEN, NULL);
+}
+
+/*
+ * i7_node_get_appearance_version:
+ * @self: the knot
+ *
+ * Returns: a number that changes whenever something that
+ * i7_node_update_items() draws changes, so that views can skip knots that
+ * look the same as when they last drew them.
+ */
+guint
+i7_node_get_appearance_version(I7Node *self)
+{
+	I7_NODE_USE_PRIVATE;
+	return priv->appearance_version;
+}
+
 void
 i7_node_invalidate_size(I7Node *self)
 {
@@ -1115,9 +1717,10 @@ i7_node_invalidate_size(I7Node *self)
 	priv->command_height = -1.0;
 	priv->label_width = -1.0;
 	priv->label_height = -1.0;
+	i7_node_invalidate_layout(self);
 }
 
-static gboolean
+gboolean
 i7_goo_canvas_item_get_onscreen_coordinates(GooCanvasItem *item, GooCanvas *canvas, gint *x, gint *y)
 {
 	GooCanvasBounds bounds;
@@ -1165,6 +1768,10 @@ i7_node_get_command_coordinates(I7Node *self, gint *x, gint *y, GooCanvas *canva
 
 	I7_NODE_USE_PRIVATE;
 
+	if(priv->command_item == NULL) {
+		g_warning("Node not onscreen in canvas");
+		return FALSE;
+	}
 	return i7_goo_canvas_item_get_onscreen_coordinates(goo_canvas_get_item(canvas, GOO_CANVAS_ITEM_MODEL(priv->command_item)), canvas, x, y);
 }
 
@@ -1176,5 +1783,9 @@ i7_node_get_label_coordinates(I7Node *self, gint *x, gint *y, GooCanvas *canvas)
 
 	I7_NODE_USE_PRIVATE;
 
+	if(priv->label_item == NULL) {
+		g_warning("Node not onscreen in canvas");
+		return FALSE;
+	}
 	return i7_goo_canvas_item_get_onscreen_coordinates(goo_canvas_get_item(canvas, GOO_CANVAS_ITEM_MODEL(priv->label_item)), canvas, x, y);
 }
@@ -64,15 +64,23 @@ I7Node *i7_node_new(const gchar *line, const gchar *label, const gchar *transcri
 
 /* Properties */
 gchar *i7_node_get_command(I7Node *self);
+const char *i7_node_peek_command(I7Node *self);
 void i7_node_set_command(I7Node *self, const gchar *line);
 gchar *i7_node_get_label(I7Node *self);
+const char *i7_node_peek_label(I7Node *self);
 void i7_node_set_label(I7Node *self, const gchar *label);
 gboolean i7_node_has_label(I7Node *self);
 gchar *i7_node_get_transcript_text(I7Node *self);
+const char *i7_node_peek_transcript_text(I7Node *self);
 void i7_node_set_transcript_text(I7Node *self, const gchar *transcript);
 gchar *i7_node_get_expected_text(I7Node *self);
+const char *i7_node_peek_expected_text(I7Node *self);
+void i7_node_set_stored_texts(I7Node *self, GMappedFile *file, const char *transcript, const char *expected, I7NodeMatchType match);
+I7NodeMatchType i7_node_peek_stored_texts(I7Node *self, const char **transcript, const char **expected);
 const char *i7_node_get_transcript_pango_string(I7Node *self);
 const char *i7_node_get_expected_pango_string(I7Node *self);
+void i7_node_drop_pango_strings(I7Node *self);
+guint i7_node_get_text_version(I7Node *self);
 I7NodeMatchType i7_node_get_match_type(I7Node *self);
 gboolean i7_node_get_different(I7Node *self);
 gboolean i7_node_get_changed(I7Node *self);
@@ -89,21 +97,27 @@ void i7_node_set_score(I7Node *self, gint score);
 gboolean i7_node_in_thread(I7Node *self, I7Node *endnode);
 gboolean i7_node_is_root(I7Node *self);
 I7Node *i7_node_find_child(I7Node *self, const gchar *command);
-I7Node *i7_node_get_next_difference_below(I7Node *node);
-I7Node *i7_node_get_next_difference(I7Node *node);
+void i7_node_append_child(I7Node *self, I7Node *child);
+void i7_node_unlink(I7Node *self);
 
 /* Serialization */
 const gchar *i7_node_get_unique_id(I7Node *self);
 gchar *i7_node_get_xml(I7Node *self);
+void i7_node_append_xml(I7Node *self, GString *string);
 
 /* Drawing on a GooCanvas */
 gdouble i7_node_get_x(I7Node *self);
 gdouble i7_node_get_tree_width(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas);
 void i7_node_layout(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas, gdouble x);
+void i7_node_invalidate_layout(I7Node *self);
 void i7_node_calculate_size(I7Node *self, GooCanvasItemModel *skein, GooCanvas *canvas);
 void i7_node_invalidate_size(I7Node *self);
+void i7_node_create_items(I7Node *self);
 gboolean i7_node_get_command_coordinates(I7Node *self, gint *x, gint *y, GooCanvas *canvas);
 gboolean i7_node_get_label_coordinates(I7Node *self, gint *x, gint *y, GooCanvas *canvas);
+void i7_node_update_items(I7Node *self, GooCanvasItem *command_shape, GooCanvasItem *label_shape, GooCanvasItem *command, GooCanvasItem *label, GooCanvasItem *badge);
+guint i7_node_get_appearance_version(I7Node *self);
+gboolean i7_goo_canvas_item_get_onscreen_coordinates(GooCanvasItem *item, GooCanvas *canvas, gint *x, gint *y);
 
 /* Signal handlers for use in other skein source files*/
 gboolean on_node_button_press(GooCanvasItem *item, GooCanvasItem *target_item, GdkEventButton *event, I7Node *self);
@@ -35,6 +35,7 @@
 #include "file.h"
 #include "history.h"
 #include "html.h"
+#include "placeholder-entry.h"
 #include "skein-view.h"
 #include "transcript-renderer.h"
 
@@ -735,6 +736,16 @@ i7_panel_init(I7Panel *self)
 	gtk_menu_tool_button_set_menu(GTK_MENU_TOOL_BUTTON(self->labels), self->labels_menu);
 	self->labels_action = gtk_action_group_get_action(priv->skein_action_group, "labels");
 	gtk_activatable_set_related_action(GTK_ACTIVATABLE(self->labels), self->labels_action);
+	self->next_difference_skein_action = gtk_action_group_get_action(priv->transcript_action_group, "next_difference_skein");
+
+	/* Add the Skein search entry, which is only shown on the Skein tab */
+	self->skein_search = gtk_tool_item_new();
+	self->skein_search_entry = i7_placeholder_entry_new(_("Find in Skein"));
+	gtk_entry_set_icon_from_stock(GTK_ENTRY(self->skein_search_entry), GTK_ENTRY_ICON_PRIMARY, GTK_STOCK_FIND);
+	gtk_container_add(GTK_CONTAINER(self->skein_search), self->skein_search_entry);
+	gtk_widget_show(self->skein_search_entry);
+	gtk_widget_set_no_show_all(GTK_WIDGET(self->skein_search), TRUE);
+	gtk_toolbar_insert(GTK_TOOLBAR(self->toolbar), self->skein_search, -1);
 
 	/* Reparent the widgets into our new VBox */
 	self->notebook = GTK_WIDGET(load_object(builder, "panel"));
@@ -748,8 +759,9 @@ i7_panel_init(I7Panel *self)
 	gtk_notebook_insert_page(GTK_NOTEBOOK(self->notebook), GTK_WIDGET(self->sourceview), sourcelabel, I7_PANE_SOURCE);
 	g_signal_connect_after(self->sourceview->notebook, "switch-page", G_CALLBACK(after_source_notebook_switch_page), self);
 
-	/* Add the I7SkeinView widget */
-	GtkWidget *skeinview = i7_skein_view_new();
+	/* Add the I7SkeinView widget; it only creates canvas items for the knots in
+	 view, so that large skeins don't need a set of canvas items per knot */
+	GtkWidget *skeinview = g_object_new(I7_TYPE_SKEIN_VIEW, "virtualized", TRUE, NULL);
 	gtk_widget_show(skeinview);
 	GtkWidget *skein_scrolledwindow = GTK_WIDGET(load_object(builder, "skein_scrolledwindow"));
 	gtk_container_add(GTK_CONTAINER(skein_scrolledwindow), skeinview);
@@ -779,7 +791,11 @@ i7_panel_init(I7Panel *self)
 	    "current", I7_SKEIN_COLUMN_CURRENT,
 	    "played", I7_SKEIN_COLUMN_PLAYED,
 	    "changed", I7_SKEIN_COLUMN_CHANGED,
+	    "node", I7_SKEIN_COLUMN_NODE_PTR,
+	    "text-version", I7_SKEIN_COLUMN_TEXT_VERSION,
 	    NULL);
+	/* Rows are first given an estimated height, and measured later */
+	g_signal_connect_swapped(self->transcript_cell, "heights-changed", G_CALLBACK(gtk_tree_view_column_queue_resize), self->transcript_column);
 	
 	/* Save public pointers to specific widgets */
 	LOAD_WIDGET(z8);
@@ -788,6 +804,7 @@ i7_panel_init(I7Panel *self)
 	LOAD_WIDGET(nobble_rng);
 	LOAD_WIDGET(debugging_scrolledwindow);
 	LOAD_WIDGET(inform6_scrolledwindow);
+	LOAD_WIDGET(skein_statistics_scrolledwindow);
 	LOAD_WIDGET(transcript_menu);
 	g_object_ref(self->transcript_menu);
 
@@ -803,7 +820,7 @@ i7_panel_init(I7Panel *self)
 	self->tabs[I7_PANE_SETTINGS] = GTK_WIDGET(load_object(builder, "settings"));
 	self->source_tabs[I7_SOURCE_VIEW_TAB_CONTENTS] = self->sourceview->headings;
 	self->source_tabs[I7_SOURCE_VIEW_TAB_SOURCE] = self->sourceview->source;
-	const gchar *results_tab_names[] = { "progress", "debugging", "report", "inform6" };
+	const gchar *results_tab_names[] = { "progress", "debugging", "report", "inform6", "skein_statistics" };
 	const gchar *index_tab_names[] = { "index_home", "contents", "actions", "kinds", "phrasebook", "rules", "scenes", "world" };
 	for(foo = 0; foo < I7_INDEX_NUM_TABS; foo++) {
 		if(foo < I7_RESULTS_NUM_TABS)
@@ -940,6 +957,7 @@ on_notebook_switch_page(GtkNotebook *notebook, GtkWidget *page, unsigned page_nu
 	}
 
 	gtk_action_group_set_visible(priv->skein_action_group, skein);
+	gtk_widget_set_visible(GTK_WIDGET(panel->skein_search), skein);
 	gtk_action_group_set_visible(priv->transcript_action_group, transcript);
 	gtk_action_group_set_visible(priv->documentation_action_group, documentation);
 	gtk_action_group_set_visible(priv->extensions_action_group, extensions);
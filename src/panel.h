@@ -50,6 +50,7 @@ typedef enum {
 	I7_RESULTS_TAB_DEBUGGING,
 	I7_RESULTS_TAB_REPORT,
 	I7_RESULTS_TAB_INFORM6,
+	I7_RESULTS_TAB_SKEIN_STATISTICS,
 	I7_RESULTS_NUM_TABS
 } I7PaneResultsTab;
 
@@ -75,12 +76,16 @@ typedef struct {
 	GtkToolItem *labels;
 	GtkWidget *labels_menu;
 	GtkAction *labels_action;
+	GtkAction *next_difference_skein_action;
+	GtkToolItem *skein_search;
+	GtkWidget *skein_search_entry;
 	GtkWidget *z8;
 	GtkWidget *glulx;
 	GtkWidget *blorb;
 	GtkWidget *nobble_rng;
 	GtkWidget *debugging_scrolledwindow;
 	GtkWidget *inform6_scrolledwindow;
+	GtkWidget *skein_statistics_scrolledwindow;
 	GtkWidget *transcript_menu;
 	GtkTreeViewColumn *transcript_column;
 	GtkCellRenderer *transcript_cell;
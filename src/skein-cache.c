@@ -0,0 +1,372 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The skein cache is a binary copy of Skein.skein, kept next to it as
+ Skein.skeinbin, that can be mapped into memory and read without parsing. The
+ XML file is still the real skein; the cache is only used if it was written
+ from the XML file as it is now, and is simply rewritten otherwise.
+
+ Layout, in the byte order of the machine that wrote it:
+   SkeinCacheHeader
+   SkeinCacheKnot[n_knots]      fixed-width knot table, in depth-first order
+   guint32[n_links]             child index: the children of each knot are
+                                 listed together, in order
+   char[heap_size]              string heap: NUL-terminated strings, each
+                                 distinct string only once; offset 0 is ""
+*/
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include "node.h"
+#include "skein-cache.h"
+
+#define SKEIN_CACHE_MAGIC "I7SKEIN"
+#define SKEIN_CACHE_VERSION 1
+#define SKEIN_CACHE_BYTE_ORDER 0x01020304
+#define SKEIN_CACHE_SUFFIX "bin"
+#define XML_FILE_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+typedef struct {
+	char magic[8];
+	guint32 version;
+	guint32 byte_order;
+	/* The XML file this cache was written from */
+	guint64 xml_size;
+	guint64 xml_mtime;
+	guint32 xml_mtime_usec;
+	guint32 n_knots;
+	guint32 root;
+	guint32 active;
+	guint32 n_links;
+	guint32 heap_size;
+} SkeinCacheHeader;
+
+struct _SkeinCache {
+	GMappedFile *file;
+	const SkeinCacheHeader *header;
+	const SkeinCacheKnot *knots;
+	const guint32 *links;
+	const char *heap;
+};
+
+static char *
+get_cache_path(GFile *skein_file)
+{
+	char *path = g_file_get_path(skein_file);
+	if(path == NULL)
+		return NULL;
+	char *retval = g_strconcat(path, SKEIN_CACHE_SUFFIX, NULL);
+	g_free(path);
+	return retval;
+}
+
+/* Check that the header describes the XML file as it is now */
+static gboolean
+header_matches_file(const SkeinCacheHeader *header, GFile *skein_file)
+{
+	GFileInfo *info = g_file_query_info(skein_file, XML_FILE_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if(info == NULL)
+		return FALSE;
+	gboolean retval = header->xml_size == (guint64)g_file_info_get_size(info)
+		&& header->xml_mtime == g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+		&& header->xml_mtime_usec == g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	g_object_unref(info);
+	return retval;
+}
+
+/* Check that everything in the cache points inside it, so that a damaged cache
+ can't make the reader go astray */
+static gboolean
+validate(SkeinCache *cache, gsize length)
+{
+	const SkeinCacheHeader *header = cache->header;
+	guint count;
+
+	if(length < sizeof(SkeinCacheHeader)
+		|| memcmp(header->magic, SKEIN_CACHE_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != SKEIN_CACHE_VERSION
+		|| header->byte_order != SKEIN_CACHE_BYTE_ORDER
+		|| header->n_knots == 0
+		|| header->root != 0
+		|| header->active >= header->n_knots
+		|| header->heap_size == 0)
+		return FALSE;
+	if(length != sizeof(SkeinCacheHeader) + (guint64)header->n_knots * sizeof(SkeinCacheKnot)
+		+ (guint64)header->n_links * sizeof(guint32) + header->heap_size)
+		return FALSE;
+	if(cache->heap[0] != '\0' || cache->heap[header->heap_size - 1] != '\0')
+		return FALSE;
+
+	for(count = 0; count < header->n_knots; count++) {
+		const SkeinCacheKnot *knot = cache->knots + count;
+		if(knot->command >= header->heap_size
+			|| knot->label >= header->heap_size
+			|| knot->transcript >= header->heap_size
+			|| knot->expected >= header->heap_size
+			|| knot->match < I7_NODE_CANT_COMPARE || knot->match > I7_NODE_EXACT_MATCH
+			|| knot->first_child > header->n_links
+			|| knot->n_children > header->n_links - knot->first_child)
+			return FALSE;
+	}
+
+	/* The knots are in depth-first order, so each child comes after its parent;
+	 together with each knot being a child only once, that makes it a tree */
+	guint8 *seen = g_new0(guint8, header->n_knots);
+	gboolean retval = TRUE;
+	for(count = 0; count < header->n_knots && retval; count++) {
+		const SkeinCacheKnot *knot = cache->knots + count;
+		guint link;
+		for(link = knot->first_child; link < knot->first_child + knot->n_children; link++) {
+			guint child = cache->links[link];
+			if(child <= count || child >= header->n_knots || seen[child]) {
+				retval = FALSE;
+				break;
+			}
+			seen[child] = 1;
+		}
+	}
+	g_free(seen);
+	return retval;
+}
+
+/*
+ * skein_cache_open:
+ * @skein_file: the XML skein file
+ *
+ * Maps the cache of @skein_file into memory, if there is one and it is up to
+ * date.
+ *
+ * Returns: a new #SkeinCache, or %NULL if the skein has to be read from the XML
+ * file.
+ */
+SkeinCache *
+skein_cache_open(GFile *skein_file)
+{
+	char *path = get_cache_path(skein_file);
+	if(path == NULL)
+		return NULL;
+	GMappedFile *file = g_mapped_file_new(path, FALSE, NULL);
+	g_free(path);
+	if(file == NULL)
+		return NULL;
+
+	gsize length = g_mapped_file_get_length(file);
+	const char *contents = g_mapped_file_get_contents(file);
+	SkeinCache *cache = g_slice_new0(SkeinCache);
+	cache->file = file;
+	if(length >= sizeof(SkeinCacheHeader)) {
+		cache->header = (const SkeinCacheHeader *)contents;
+		cache->knots = (const SkeinCacheKnot *)(contents + sizeof(SkeinCacheHeader));
+		cache->links = (const guint32 *)(cache->knots + cache->header->n_knots);
+		cache->heap = (const char *)(cache->links + cache->header->n_links);
+	}
+
+	if(cache->header == NULL || !validate(cache, length) || !header_matches_file(cache->header, skein_file)) {
+		skein_cache_free(cache);
+		return NULL;
+	}
+	return cache;
+}
+
+guint
+skein_cache_get_n_knots(SkeinCache *cache)
+{
+	return cache->header->n_knots;
+}
+
+guint
+skein_cache_get_root(SkeinCache *cache)
+{
+	return cache->header->root;
+}
+
+guint
+skein_cache_get_active(SkeinCache *cache)
+{
+	return cache->header->active;
+}
+
+const SkeinCacheKnot *
+skein_cache_get_knot(SkeinCache *cache, guint index)
+{
+	g_return_val_if_fail(index < cache->header->n_knots, NULL);
+	return cache->knots + index;
+}
+
+/* Returns the index of the @n-th child of @knot */
+guint
+skein_cache_get_child(SkeinCache *cache, const SkeinCacheKnot *knot, guint n)
+{
+	g_return_val_if_fail(n < knot->n_children, 0);
+	return cache->links[knot->first_child + n];
+}
+
+/* The string stays valid as long as the mapped file does */
+const char *
+skein_cache_get_string(SkeinCache *cache, guint32 offset)
+{
+	return cache->heap + offset;
+}
+
+/* Doesn't add a reference */
+GMappedFile *
+skein_cache_get_mapped_file(SkeinCache *cache)
+{
+	return cache->file;
+}
+
+void
+skein_cache_free(SkeinCache *cache)
+{
+	g_mapped_file_unref(cache->file);
+	g_slice_free(SkeinCache, cache);
+}
+
+/* WRITING */
+
+typedef struct {
+	GHashTable *indices; /* I7Node -> index + 1 */
+	GPtrArray *knots; /* In depth-first order */
+	GByteArray *heap;
+	GHashTable *offsets; /* String -> heap offset; the texts are interned, so
+	 equal strings are mostly the same pointer already */
+} CacheWriter;
+
+static gboolean
+number_knot(GNode *gnode, CacheWriter *writer)
+{
+	g_ptr_array_add(writer->knots, gnode->data);
+	g_hash_table_insert(writer->indices, gnode->data, GUINT_TO_POINTER(writer->knots->len));
+	return FALSE; /* Don't stop the traversal */
+}
+
+static guint32
+add_string(CacheWriter *writer, const char *string)
+{
+	if(string == NULL || *string == '\0')
+		return 0;
+	gpointer offset = g_hash_table_lookup(writer->offsets, string);
+	if(offset)
+		return GPOINTER_TO_UINT(offset);
+	guint32 retval = writer->heap->len;
+	g_byte_array_append(writer->heap, (const guint8 *)string, strlen(string) + 1);
+	g_hash_table_insert(writer->offsets, (gpointer)string, GUINT_TO_POINTER(retval));
+	return retval;
+}
+
+/*
+ * skein_cache_write:
+ * @skein_file: the XML skein file, which must already have been saved
+ * @root: the root knot of the skein
+ * @active: the knot that was saved as the active knot
+ * @error: return location for an error, or %NULL
+ *
+ * Writes the cache of @skein_file, replacing any old one. Texts that were
+ * never loaded from an old cache are copied without loading them.
+ *
+ * Returns: %TRUE if successful.
+ */
+gboolean
+skein_cache_write(GFile *skein_file, I7Node *root, I7Node *active, GError **error)
+{
+	g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+	char *path = get_cache_path(skein_file);
+	if(path == NULL) {
+		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, _("The skein is not a local file."));
+		return FALSE;
+	}
+	GFileInfo *info = g_file_query_info(skein_file, XML_FILE_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, NULL, error);
+	if(info == NULL) {
+		g_free(path);
+		return FALSE;
+	}
+
+	CacheWriter writer;
+	writer.indices = g_hash_table_new(NULL, NULL);
+	writer.knots = g_ptr_array_new();
+	writer.heap = g_byte_array_new();
+	writer.offsets = g_hash_table_new(NULL, NULL);
+	g_byte_array_append(writer.heap, (const guint8 *)"", 1);
+	g_node_traverse(root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)number_knot, &writer);
+
+	SkeinCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SKEIN_CACHE_MAGIC, sizeof(header.magic));
+	header.version = SKEIN_CACHE_VERSION;
+	header.byte_order = SKEIN_CACHE_BYTE_ORDER;
+	header.xml_size = g_file_info_get_size(info);
+	header.xml_mtime = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	header.xml_mtime_usec = g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	header.n_knots = writer.knots->len;
+	header.root = 0;
+	header.active = GPOINTER_TO_UINT(g_hash_table_lookup(writer.indices, active));
+	header.active = header.active? header.active - 1 : 0;
+	header.n_links = writer.knots->len - 1; /* Every knot but the root is a child */
+	g_object_unref(info);
+
+	SkeinCacheKnot *knots = g_new0(SkeinCacheKnot, writer.knots->len);
+	guint32 *links = g_new(guint32, MAX(header.n_links, 1));
+	guint count, n_links = 0;
+	for(count = 0; count < writer.knots->len; count++) {
+		I7Node *node = g_ptr_array_index(writer.knots, count);
+		SkeinCacheKnot *knot = knots + count;
+		const char *transcript, *expected;
+		I7NodeMatchType match = i7_node_peek_stored_texts(node, &transcript, &expected);
+
+		knot->command = add_string(&writer, i7_node_peek_command(node));
+		knot->label = add_string(&writer, i7_node_peek_label(node));
+		knot->transcript = add_string(&writer, transcript);
+		knot->expected = add_string(&writer, expected);
+		knot->score = i7_node_get_score(node);
+		knot->flags = (i7_node_get_locked(node)? SKEIN_CACHE_KNOT_LOCKED : 0)
+			| (i7_node_get_changed(node)? SKEIN_CACHE_KNOT_CHANGED : 0);
+		knot->match = match;
+		knot->first_child = n_links;
+
+		GNode *child;
+		for(child = node->gnode->children; child; child = child->next)
+			links[n_links++] = GPOINTER_TO_UINT(g_hash_table_lookup(writer.indices, child->data)) - 1;
+		knot->n_children = n_links - knot->first_child;
+	}
+	header.heap_size = writer.heap->len;
+
+	GByteArray *contents = g_byte_array_sized_new(sizeof(header)
+		+ header.n_knots * sizeof(SkeinCacheKnot)
+		+ header.n_links * sizeof(guint32) + header.heap_size);
+	g_byte_array_append(contents, (const guint8 *)&header, sizeof(header));
+	g_byte_array_append(contents, (const guint8 *)knots, header.n_knots * sizeof(SkeinCacheKnot));
+	g_byte_array_append(contents, (const guint8 *)links, header.n_links * sizeof(guint32));
+	g_byte_array_append(contents, writer.heap->data, writer.heap->len);
+
+	/* Written to a temporary file and renamed, so that a cache that is mapped
+	 into memory is never overwritten */
+	gboolean retval = g_file_set_contents(path, (const char *)contents->data, contents->len, error);
+
+	g_byte_array_free(contents, TRUE);
+	g_free(knots);
+	g_free(links);
+	g_hash_table_destroy(writer.indices);
+	g_hash_table_destroy(writer.offsets);
+	g_ptr_array_free(writer.knots, TRUE);
+	g_byte_array_free(writer.heap, TRUE);
+	g_free(path);
+	return retval;
+}
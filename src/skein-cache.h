@@ -0,0 +1,57 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SKEIN_CACHE_H
+#define SKEIN_CACHE_H
+
+#include <glib.h>
+#include <gio/gio.h>
+#include "node.h"
+
+typedef struct _SkeinCache SkeinCache;
+
+/* Flags of a knot in the cache */
+enum {
+	SKEIN_CACHE_KNOT_LOCKED = 1 << 0,
+	SKEIN_CACHE_KNOT_CHANGED = 1 << 1
+};
+
+/* One knot in the cache's fixed-width knot table. The texts are offsets into
+ the string heap; see skein_cache_get_string(). */
+typedef struct {
+	guint32 command;
+	guint32 label;
+	guint32 transcript;
+	guint32 expected;
+	gint32 score;
+	guint32 flags;
+	gint32 match; /* I7NodeMatchType of the transcript and expected text */
+	guint32 first_child; /* Position of its first child in the child index */
+	guint32 n_children;
+} SkeinCacheKnot;
+
+SkeinCache *skein_cache_open(GFile *skein_file);
+guint skein_cache_get_n_knots(SkeinCache *cache);
+guint skein_cache_get_root(SkeinCache *cache);
+guint skein_cache_get_active(SkeinCache *cache);
+const SkeinCacheKnot *skein_cache_get_knot(SkeinCache *cache, guint index);
+guint skein_cache_get_child(SkeinCache *cache, const SkeinCacheKnot *knot, guint n);
+const char *skein_cache_get_string(SkeinCache *cache, guint32 offset);
+GMappedFile *skein_cache_get_mapped_file(SkeinCache *cache);
+void skein_cache_free(SkeinCache *cache);
+gboolean skein_cache_write(GFile *skein_file, I7Node *root, I7Node *active, GError **error);
+
+#endif /* SKEIN_CACHE_H */
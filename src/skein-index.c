@@ -0,0 +1,291 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include "skein-index.h"
+
+/* An inverted index: maps each word to the items whose text contains it, and
+ where in the text it is, so that phrases can be found without going back to
+ the texts. The items are opaque pointers; the skein uses its knots. */
+struct _SkeinIndex {
+	GHashTable *words; /* Case-folded word -> GHashTable of item -> GArray of
+	 the word's positions in the item's texts, in increasing order */
+	GHashTable *items; /* Item -> ItemWords */
+};
+
+typedef struct {
+	GPtrArray *words; /* The keys in @words that the item is found by, so that
+	 it can be taken out again */
+	guint n_positions; /* Position of the next word added for the item */
+} ItemWords;
+
+/* Calls @func with each word in @text, case-folded; a word is a run of letters
+ and digits */
+static void
+foreach_word(const char *text, void (*func)(const char *word, gpointer data), gpointer data)
+{
+	const char *start = NULL, *ptr;
+
+	if(text == NULL)
+		return;
+	for(ptr = text; ; ptr = g_utf8_next_char(ptr)) {
+		gunichar ch = g_utf8_get_char(ptr);
+		if(ch != 0 && g_unichar_isalnum(ch)) {
+			if(start == NULL)
+				start = ptr;
+			continue;
+		}
+		if(start != NULL) {
+			char *word = g_utf8_casefold(start, ptr - start);
+			func(word, data);
+			g_free(word);
+			start = NULL;
+		}
+		if(ch == 0)
+			break;
+	}
+}
+
+static void
+item_words_free(ItemWords *item_words)
+{
+	g_ptr_array_free(item_words->words, TRUE);
+	g_slice_free(ItemWords, item_words);
+}
+
+/*
+ * skein_index_new:
+ *
+ * Returns: a new, empty #SkeinIndex.
+ */
+SkeinIndex *
+skein_index_new(void)
+{
+	SkeinIndex *index = g_slice_new(SkeinIndex);
+	index->words = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_hash_table_destroy);
+	index->items = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify)item_words_free);
+	return index;
+}
+
+typedef struct {
+	SkeinIndex *index;
+	gpointer item;
+	ItemWords *item_words;
+} AddData;
+
+static void
+add_word(const char *word, AddData *data)
+{
+	char *key;
+	GHashTable *items;
+	GArray *positions;
+
+	if(!g_hash_table_lookup_extended(data->index->words, word, (gpointer *)&key, (gpointer *)&items)) {
+		key = g_strdup(word);
+		items = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify)g_array_unref);
+		g_hash_table_insert(data->index->words, key, items);
+	}
+	if((positions = g_hash_table_lookup(items, data->item)) == NULL) {
+		positions = g_array_new(FALSE, FALSE, sizeof(guint));
+		g_hash_table_insert(items, data->item, positions);
+		g_ptr_array_add(data->item_words->words, key);
+	}
+	g_array_append_val(positions, data->item_words->n_positions);
+	data->item_words->n_positions++;
+}
+
+/*
+ * skein_index_add:
+ * @index: the index
+ * @item: the item that @text belongs to
+ * @text: a text to index
+ *
+ * Adds the words of @text to the words that @item is found by. Call this
+ * repeatedly to index several texts for the same item; a phrase is only found
+ * if it is all in one of them.
+ */
+void
+skein_index_add(SkeinIndex *index, gpointer item, const char *text)
+{
+	AddData data;
+	data.index = index;
+	data.item = item;
+	data.item_words = g_hash_table_lookup(index->items, item);
+	if(data.item_words == NULL) {
+		data.item_words = g_slice_new(ItemWords);
+		data.item_words->words = g_ptr_array_new();
+		data.item_words->n_positions = 0;
+		g_hash_table_insert(index->items, item, data.item_words);
+	}
+	foreach_word(text, (void (*)(const char *, gpointer))add_word, &data);
+	/* Leave a gap, so that the last word of this text and the first word of
+	 the next one don't count as coming one after the other */
+	data.item_words->n_positions++;
+}
+
+/*
+ * skein_index_remove:
+ * @index: the index
+ * @item: an item
+ *
+ * Forgets all the texts that were indexed for @item.
+ */
+void
+skein_index_remove(SkeinIndex *index, gpointer item)
+{
+	ItemWords *item_words = g_hash_table_lookup(index->items, item);
+	guint count;
+
+	if(item_words == NULL)
+		return;
+	for(count = 0; count < item_words->words->len; count++) {
+		const char *word = g_ptr_array_index(item_words->words, count);
+		GHashTable *items = g_hash_table_lookup(index->words, word);
+		g_hash_table_remove(items, item);
+		/* This frees the word, so do it last */
+		if(g_hash_table_size(items) == 0)
+			g_hash_table_remove(index->words, word);
+	}
+	g_hash_table_remove(index->items, item);
+}
+
+static void
+collect_query_word(const char *word, GPtrArray *query_words)
+{
+	g_ptr_array_add(query_words, g_strdup(word));
+}
+
+/* Binary search for @position in @positions, which are in increasing order */
+static gboolean
+has_position(GArray *positions, guint position)
+{
+	guint low = 0, high = positions->len;
+	while(low < high) {
+		guint middle = low + (high - low) / 2;
+		guint value = g_array_index(positions, guint, middle);
+		if(value == position)
+			return TRUE;
+		if(value < position)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return FALSE;
+}
+
+/* Whether the words whose positions in one item are in @positions come one
+ after the other. Goes through the positions of the word that occurs least
+ often and looks up where each of the other words would have to be. */
+static gboolean
+has_phrase(GArray **positions, guint n_words)
+{
+	guint rarest = 0, count, word;
+
+	for(word = 1; word < n_words; word++)
+		if(positions[word]->len < positions[rarest]->len)
+			rarest = word;
+
+	for(count = 0; count < positions[rarest]->len; count++) {
+		guint position = g_array_index(positions[rarest], guint, count);
+		if(position < rarest)
+			continue;
+		guint start = position - rarest;
+		for(word = 0; word < n_words; word++)
+			if(word != rarest && !has_position(positions[word], start + word))
+				break;
+		if(word == n_words)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * skein_index_lookup:
+ * @index: the index
+ * @query: some words
+ *
+ * Finds the items where the words in @query come one after the other, as whole
+ * words, in one of the texts, ignoring case. Anything that is not a letter or
+ * digit between the words, such as extra spaces or punctuation, doesn't count,
+ * in @query or in the texts. The search starts with the rarest word, so it
+ * takes time in proportion to the number of items that contain that word, not
+ * to the number of items in the index; the texts themselves are not looked at.
+ *
+ * Returns: (transfer container): a list of the items, in no particular order;
+ * free with g_list_free(). Returns %NULL if @query contains no words.
+ */
+GList *
+skein_index_lookup(SkeinIndex *index, const char *query)
+{
+	GPtrArray *query_words = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *sets = g_ptr_array_new();
+	GHashTable *smallest = NULL;
+	GList *retval = NULL;
+	guint count;
+
+	foreach_word(query, (void (*)(const char *, gpointer))collect_query_word, query_words);
+	for(count = 0; count < query_words->len; count++) {
+		GHashTable *items = g_hash_table_lookup(index->words, g_ptr_array_index(query_words, count));
+		if(items == NULL)
+			goto out; /* A word that isn't anywhere */
+		g_ptr_array_add(sets, items);
+		if(smallest == NULL || g_hash_table_size(items) < g_hash_table_size(smallest))
+			smallest = items;
+	}
+	if(smallest == NULL)
+		goto out;
+
+	GArray **positions = g_new(GArray *, sets->len);
+	GHashTableIter iter;
+	gpointer item;
+	g_hash_table_iter_init(&iter, smallest);
+	while(g_hash_table_iter_next(&iter, &item, NULL)) {
+		for(count = 0; count < sets->len; count++) {
+			GHashTable *items = g_ptr_array_index(sets, count);
+			if((positions[count] = g_hash_table_lookup(items, item)) == NULL)
+				break;
+		}
+		if(count == sets->len && has_phrase(positions, sets->len))
+			retval = g_list_prepend(retval, item);
+	}
+	g_free(positions);
+
+out:
+	g_ptr_array_free(sets, TRUE);
+	g_ptr_array_free(query_words, TRUE);
+	return retval;
+}
+
+/*
+ * skein_index_get_n_words:
+ * @index: the index
+ *
+ * Returns: the number of distinct words in the index.
+ */
+guint
+skein_index_get_n_words(SkeinIndex *index)
+{
+	return g_hash_table_size(index->words);
+}
+
+void
+skein_index_free(SkeinIndex *index)
+{
+	g_hash_table_destroy(index->items);
+	g_hash_table_destroy(index->words);
+	g_slice_free(SkeinIndex, index);
+}
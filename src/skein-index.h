@@ -0,0 +1,31 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SKEIN_INDEX_H
+#define SKEIN_INDEX_H
+
+#include <glib.h>
+
+typedef struct _SkeinIndex SkeinIndex;
+
+SkeinIndex *skein_index_new(void);
+void skein_index_add(SkeinIndex *index, gpointer item, const char *text);
+void skein_index_remove(SkeinIndex *index, gpointer item);
+GList *skein_index_lookup(SkeinIndex *index, const char *query);
+guint skein_index_get_n_words(SkeinIndex *index);
+void skein_index_free(SkeinIndex *index);
+
+#endif /* SKEIN_INDEX_H */
@@ -0,0 +1,584 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <glib-unix.h>
+#include "node.h"
+#include "skein.h"
+#include "skein-replay.h"
+#include "skein-stats.h"
+
+/* Replaying skein threads without a display. Chimara needs a GTK widget to
+ run a game in, so these functions drive a command-line interpreter built with
+ a stdio Glk library (such as glulxe with CheapGlk, or dfrotz) instead: the
+ commands are written to its standard input, and its standard output is cut
+ into transcripts at each prompt. */
+
+#define READ_BUFFER_SIZE 8192
+/* Restoring a saved game costs about as much as typing a few commands, so
+ don't bother saving one at a branch point any shallower than this */
+#define MIN_SNAPSHOT_DEPTH 3
+
+/* A knot to replay, copied out of the skein so that the worker threads never
+ touch the skein itself */
+typedef struct _ReplayKnot ReplayKnot;
+struct _ReplayKnot {
+	I7Node *node; /* Only touched in the main thread */
+	char *command; /* What to type, or NULL for the start knot */
+	gboolean report; /* Whether this work unit reports the knot's transcript */
+	guint depth; /* 0 for the start knot */
+	ReplayKnot *parent;
+	ReplayKnot *children;
+	ReplayKnot *next;
+};
+
+/* Part of the skein that one worker thread replays by itself: the knots on the
+ way to some of the thread ends */
+typedef struct {
+	guint id;
+	ReplayKnot *root;
+	GHashTable *knots; /* I7Node -> ReplayKnot */
+	const I7ReplayOptions *options;
+	char *snapshot_dir;
+	guint snapshot_count;
+	guint commands_typed;
+	GAsyncQueue *results;
+} WorkUnit;
+
+/* A transcript on its way back to the main thread; a result without a knot
+ means that its work unit is finished */
+typedef struct {
+	ReplayKnot *knot;
+	char *transcript;
+	GError *error;
+} ReplayResult;
+
+GQuark
+i7_replay_error_quark(void)
+{
+	return g_quark_from_static_string("i7-replay-error-quark");
+}
+
+/*
+ * i7_replay_get_interpreter_command:
+ * @story_file: path to a compiled story
+ *
+ * Picks a command-line interpreter for @story_file by its extension.
+ *
+ * Returns: (transfer full): an argument vector ending with @story_file, to be
+ * freed with g_strfreev().
+ */
+char **
+i7_replay_get_interpreter_command(const char *story_file)
+{
+	char **argv;
+	if(g_str_has_suffix(story_file, ".ulx") || g_str_has_suffix(story_file, ".gblorb")) {
+		argv = g_new0(char *, 3);
+		argv[0] = g_strdup("glulxe");
+		argv[1] = g_strdup(story_file);
+	} else {
+		/* Turn off [MORE] prompts and the startup banner */
+		argv = g_new0(char *, 5);
+		argv[0] = g_strdup("dfrotz");
+		argv[1] = g_strdup("-m");
+		argv[2] = g_strdup("-q");
+		argv[3] = g_strdup(story_file);
+	}
+	return argv;
+}
+
+/*
+ * i7_replay_run_commands:
+ * @interpreter_argv: command line that runs the story
+ * @commands: list of commands to type
+ * @timeout: number of seconds after which to give up, or 0 to wait forever
+ * @error: return location for an error, or %NULL
+ *
+ * Runs the story in a command-line interpreter, types @commands one after the
+ * other, and collects everything the game prints until it exits at the end of
+ * the input. Ignore SIGPIPE when calling this, since the game may quit before
+ * reading all of its input.
+ *
+ * Returns: (transfer full): the game's output, or %NULL if the interpreter
+ * couldn't be started or didn't finish in time.
+ */
+char *
+i7_replay_run_commands(char **interpreter_argv, GSList *commands, guint timeout, GError **error)
+{
+	GPid pid;
+	int in_fd, out_fd;
+
+	if(!g_spawn_async_with_pipes(NULL, interpreter_argv, NULL,
+		G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDERR_TO_DEV_NULL,
+		NULL, NULL, &pid, &in_fd, &out_fd, NULL, error))
+		return NULL;
+
+	GString *input = g_string_new("");
+	GSList *iter;
+	for(iter = commands; iter; iter = g_slist_next(iter)) {
+		g_string_append(input, (char *)iter->data);
+		g_string_append_c(input, '\n');
+	}
+
+	/* Write the input and read the output at the same time, so that neither
+	 the interpreter nor we can block on a full pipe */
+	g_unix_set_fd_nonblocking(in_fd, TRUE, NULL);
+	GString *output = g_string_sized_new(READ_BUFFER_SIZE);
+	char buffer[READ_BUFFER_SIZE];
+	gsize written = 0;
+	gint64 deadline = timeout? g_get_monotonic_time() + timeout * G_USEC_PER_SEC : -1;
+	gboolean timed_out = FALSE;
+
+	if(input->len == 0) {
+		close(in_fd);
+		in_fd = -1;
+	}
+
+	while(out_fd >= 0) {
+		GPollFD fds[2] = {
+			{ out_fd, G_IO_IN | G_IO_HUP | G_IO_ERR, 0 },
+			{ in_fd, G_IO_OUT | G_IO_ERR, 0 }
+		};
+		int poll_timeout = -1;
+		if(deadline != -1) {
+			gint64 remaining = deadline - g_get_monotonic_time();
+			if(remaining <= 0) {
+				timed_out = TRUE;
+				break;
+			}
+			poll_timeout = remaining / 1000 + 1;
+		}
+
+		if(g_poll(fds, in_fd >= 0? 2 : 1, poll_timeout) < 0) {
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+
+		if(in_fd >= 0 && fds[1].revents) {
+			ssize_t count = write(in_fd, input->str + written, input->len - written);
+			if(count > 0)
+				written += count;
+			/* The game may quit before it has read all of its input */
+			if(written == input->len || (count < 0 && errno != EAGAIN && errno != EINTR)) {
+				close(in_fd);
+				in_fd = -1;
+			}
+		}
+
+		if(fds[0].revents) {
+			ssize_t count = read(out_fd, buffer, READ_BUFFER_SIZE);
+			if(count > 0)
+				g_string_append_len(output, buffer, count);
+			else if(count == 0 || (errno != EAGAIN && errno != EINTR)) {
+				close(out_fd);
+				out_fd = -1;
+			}
+		}
+	}
+
+	if(in_fd >= 0)
+		close(in_fd);
+	if(out_fd >= 0)
+		close(out_fd);
+	if(timed_out)
+		kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	g_spawn_close_pid(pid);
+	g_string_free(input, TRUE);
+
+	if(timed_out) {
+		g_set_error(error, I7_REPLAY_ERROR, I7_REPLAY_ERROR_TIMED_OUT,
+			_("The interpreter did not finish within %u seconds."), timeout);
+		g_string_free(output, TRUE);
+		return NULL;
+	}
+
+	return g_string_free(output, FALSE);
+}
+
+/*
+ * i7_replay_split_transcript:
+ * @output: everything the game printed
+ * @prompt: the text that the game prints before waiting for a command, such
+ * as %I7_REPLAY_DEFAULT_PROMPT
+ * @n_commands: the number of commands that were typed
+ *
+ * Cuts the output of i7_replay_run_commands() into the text printed before the
+ * first command, followed by the response to each command. If the game stopped
+ * early, the responses to the remaining commands are empty. Whatever the game
+ * prints after the prompt following the last response is dropped.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of @n_commands + 1
+ * strings, to be freed with g_strfreev().
+ */
+char **
+i7_replay_split_transcript(const char *output, const char *prompt, guint n_commands)
+{
+	char **retval = g_new0(char *, n_commands + 2);
+	gsize prompt_len = strlen(prompt);
+	const char *start = output;
+	guint count;
+
+	for(count = 0; count <= n_commands; count++) {
+		const char *end = start? strstr(start, prompt) : NULL;
+		if(end == NULL) {
+			/* The game stopped without prompting again; the rest of the
+			 output is this response, and there are no more */
+			retval[count] = g_strdup(start? start : "");
+			start = NULL;
+			continue;
+		}
+		retval[count] = g_strndup(start, end - start);
+		start = end + prompt_len;
+	}
+
+	return retval;
+}
+
+static ReplayKnot *
+replay_knot_new(WorkUnit *unit, I7Node *node, ReplayKnot *parent)
+{
+	ReplayKnot *knot = g_slice_new0(ReplayKnot);
+	knot->node = node;
+	knot->parent = parent;
+	if(parent) {
+		knot->command = g_strcompress(i7_node_peek_command(node));
+		knot->depth = parent->depth + 1;
+		knot->next = parent->children;
+		parent->children = knot;
+	}
+	g_hash_table_insert(unit->knots, node, knot);
+	return knot;
+}
+
+static void
+replay_knot_free(ReplayKnot *knot)
+{
+	ReplayKnot *child, *next;
+	for(child = knot->children; child; child = next) {
+		next = child->next;
+		replay_knot_free(child);
+	}
+	g_free(knot->command);
+	g_slice_free(ReplayKnot, knot);
+}
+
+/* Copies the thread ending at @end into @unit's tree of knots; the knots that
+ no other unit has claimed yet are reported by this one */
+static void
+work_unit_add_thread(WorkUnit *unit, I7Node *end, GHashTable *claimed)
+{
+	GSList *path = NULL, *iter;
+	GNode *gnode;
+	ReplayKnot *knot = NULL;
+
+	for(gnode = end->gnode; gnode; gnode = gnode->parent) {
+		if((knot = g_hash_table_lookup(unit->knots, gnode->data)) != NULL)
+			break;
+		path = g_slist_prepend(path, gnode->data);
+	}
+	for(iter = path; iter; iter = g_slist_next(iter)) {
+		knot = replay_knot_new(unit, I7_NODE(iter->data), knot);
+		if(knot->parent == NULL)
+			unit->root = knot;
+		if(!g_hash_table_lookup(claimed, iter->data)) {
+			g_hash_table_insert(claimed, iter->data, iter->data);
+			knot->report = TRUE;
+		}
+	}
+	g_slist_free(path);
+}
+
+static void
+work_unit_free(WorkUnit *unit)
+{
+	if(unit->root)
+		replay_knot_free(unit->root);
+	g_hash_table_destroy(unit->knots);
+	g_slice_free(WorkUnit, unit);
+}
+
+static guint
+count_children(ReplayKnot *knot)
+{
+	guint count = 0;
+	ReplayKnot *child;
+	for(child = knot->children; child; child = child->next)
+		count++;
+	return count;
+}
+
+static void
+push_result(WorkUnit *unit, ReplayKnot *knot, const char *transcript, const GError *error)
+{
+	ReplayResult *result = g_slice_new0(ReplayResult);
+	result->knot = knot;
+	result->transcript = g_strdup(transcript);
+	result->error = error? g_error_copy(error) : NULL;
+	g_async_queue_push(unit->results, result);
+}
+
+/* Tells the main thread that none of the knots from @knot down can be played */
+static void
+report_error_recurse(WorkUnit *unit, ReplayKnot *knot, const GError *error)
+{
+	if(knot->report)
+		push_result(unit, knot, NULL, error);
+	ReplayKnot *child;
+	for(child = knot->children; child; child = child->next)
+		report_error_recurse(unit, child, error);
+}
+
+/* Whether to save the game at @knot so that its branches can restore it */
+static gboolean
+want_snapshot(WorkUnit *unit, ReplayKnot *knot)
+{
+	return unit->snapshot_dir && knot->depth >= MIN_SNAPSHOT_DEPTH && count_children(knot) > 1;
+}
+
+/* Plays the knots from @top downwards in one run of the interpreter, taking
+ the first branch wherever the thread branches, until it reaches a thread end
+ or a branch point worth saving the game at; then plays the other branches. If
+ @snapshot is given, the run starts by restoring that saved game, which was
+ made at @top's parent; otherwise the commands leading to @top are typed
+ first. */
+static void
+replay_segment(WorkUnit *unit, ReplayKnot *top, const char *snapshot)
+{
+	GError *error = NULL;
+	GSList *commands = NULL; /* In reverse order until the end */
+	guint n_prompted = 0; /* Commands that the game prompts for */
+	guint first_response; /* Index of the response to @top */
+	ReplayKnot *knot;
+
+	if(snapshot) {
+		commands = g_slist_prepend(commands, g_strdup("restore"));
+		commands = g_slist_prepend(commands, g_strdup(snapshot)); /* file name */
+		n_prompted++;
+		first_response = 2; /* After the opening text and the restore */
+	} else {
+		GSList *prefix = NULL;
+		for(knot = top->parent; knot && knot->command; knot = knot->parent) {
+			prefix = g_slist_prepend(prefix, g_strdup(knot->command));
+			n_prompted++;
+		}
+		commands = g_slist_reverse(prefix);
+		first_response = top->depth;
+	}
+
+	GPtrArray *chain = g_ptr_array_new();
+	for(knot = top; ; knot = knot->children) {
+		g_ptr_array_add(chain, knot);
+		if(knot->command) {
+			commands = g_slist_prepend(commands, g_strdup(knot->command));
+			n_prompted++;
+		}
+		if(knot->children == NULL || want_snapshot(unit, knot))
+			break;
+	}
+	ReplayKnot *bottom = knot;
+
+	/* Save the game where the thread branches, so that each branch can
+	 continue from there */
+	char *new_snapshot = NULL;
+	if(want_snapshot(unit, bottom)) {
+		char *name = g_strdup_printf("unit%u-knot%u.sav", unit->id, ++unit->snapshot_count);
+		new_snapshot = g_build_filename(unit->snapshot_dir, name, NULL);
+		g_free(name);
+		commands = g_slist_prepend(commands, g_strdup("save"));
+		commands = g_slist_prepend(commands, g_strdup(new_snapshot));
+		n_prompted++;
+	}
+	commands = g_slist_reverse(commands);
+	unit->commands_typed += g_slist_length(commands);
+
+	char *output = i7_replay_run_commands(unit->options->interpreter_argv, commands, unit->options->timeout, &error);
+	g_slist_foreach(commands, (GFunc)g_free, NULL);
+	g_slist_free(commands);
+
+	if(output == NULL) {
+		report_error_recurse(unit, top, error);
+		g_error_free(error);
+		goto finally;
+	}
+
+	char **responses = i7_replay_split_transcript(output, unit->options->prompt, n_prompted);
+	g_free(output);
+	guint count;
+	for(count = 0; count < chain->len; count++) {
+		knot = g_ptr_array_index(chain, count);
+		if(knot->report)
+			push_result(unit, knot, responses[first_response + count], NULL);
+	}
+	g_strfreev(responses);
+
+	/* The branches that weren't taken on the way down start from the
+	 beginning; the ones at the bottom restore the saved game */
+	for(count = 0; count + 1 < chain->len; count++) {
+		ReplayKnot *branch = g_ptr_array_index(chain, count);
+		for(knot = branch->children->next; knot; knot = knot->next)
+			replay_segment(unit, knot, NULL);
+	}
+	for(knot = bottom->children; knot; knot = knot->next)
+		replay_segment(unit, knot, new_snapshot);
+
+finally:
+	if(new_snapshot) {
+		g_unlink(new_snapshot);
+		g_free(new_snapshot);
+	}
+	g_ptr_array_free(chain, TRUE);
+}
+
+/* Runs in a worker thread */
+static void
+run_work_unit(WorkUnit *unit, gpointer data)
+{
+	replay_segment(unit, unit->root, NULL);
+	push_result(unit, NULL, NULL, NULL);
+}
+
+static guint
+get_default_jobs(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+	return MAX(g_get_num_processors(), 1);
+#else
+	return 2;
+#endif
+}
+
+/*
+ * i7_replay_skein:
+ * @skein: the skein
+ * @thread_ends: list of knots to play to, such as the one returned from
+ * i7_skein_get_blessed_thread_ends()
+ * @options: how to run the interpreter
+ * @callback: function to call with the transcript of each knot played
+ * @data: user data for @callback
+ * @commands_typed: (out) (allow-none): return location for the number of lines
+ * typed into the interpreter altogether
+ * @error: return location for an error, or %NULL
+ *
+ * Plays every knot on the way to @thread_ends, each of them once, and calls
+ * @callback in the calling thread as the transcripts come in.
+ *
+ * The thread ends are divided into as many work units as @options asks for
+ * jobs, and each unit is played by its own interpreter processes at the same
+ * time as the others. Within a unit the knots are walked depth-first, and each
+ * run of the interpreter plays the knots down to the next branch point. If
+ * @options asks for snapshots, the game is saved there and each branch is
+ * played by restoring it, instead of typing all the commands from the start
+ * knot again; so replaying a bushy skein costs about as many commands as there
+ * are knots, rather than the sum of the lengths of all the threads.
+ *
+ * Returns: %FALSE if the replay couldn't be started at all.
+ */
+gboolean
+i7_replay_skein(I7Skein *skein, GSList *thread_ends, const I7ReplayOptions *options, I7ReplayKnotFunc callback, gpointer data, guint *commands_typed, GError **error)
+{
+	gint64 start = skein_stats_start();
+	char *snapshot_dir = NULL;
+	if(options->use_snapshots) {
+		snapshot_dir = g_dir_make_tmp("i7-replay-XXXXXX", error);
+		if(snapshot_dir == NULL)
+			return FALSE;
+	}
+
+	/* Deal the thread ends out in order, so that each unit gets threads that
+	 are next to each other in the skein and share as much as possible */
+	guint n_ends = g_slist_length(thread_ends);
+	guint n_units = MIN(options->jobs? options->jobs : get_default_jobs(), n_ends);
+	GAsyncQueue *results = g_async_queue_new();
+	GHashTable *claimed = g_hash_table_new(NULL, NULL);
+	GPtrArray *units = g_ptr_array_new_with_free_func((GDestroyNotify)work_unit_free);
+	GSList *iter = thread_ends;
+	guint count;
+	for(count = 0; count < n_units; count++) {
+		WorkUnit *unit = g_slice_new0(WorkUnit);
+		unit->id = count;
+		unit->knots = g_hash_table_new(NULL, NULL);
+		unit->options = options;
+		unit->snapshot_dir = snapshot_dir;
+		unit->results = results;
+		guint end = (count + 1) * n_ends / n_units, index;
+		for(index = count * n_ends / n_units; index < end; index++, iter = g_slist_next(iter))
+			work_unit_add_thread(unit, I7_NODE(iter->data), claimed);
+		g_ptr_array_add(units, unit);
+	}
+	g_hash_table_destroy(claimed);
+
+	GThreadPool *workers = NULL;
+	if(n_units > 0) {
+		workers = g_thread_pool_new((GFunc)run_work_unit, NULL, n_units, FALSE, error);
+		if(workers == NULL) {
+			g_ptr_array_free(units, TRUE);
+			g_async_queue_unref(results);
+			if(snapshot_dir)
+				g_rmdir(snapshot_dir);
+			g_free(snapshot_dir);
+			return FALSE;
+		}
+		for(count = 0; count < n_units; count++)
+			g_thread_pool_push(workers, g_ptr_array_index(units, count), NULL);
+	}
+
+	/* Hand the transcripts to the caller as they arrive; the skein's views
+	 only need to catch up once at the end */
+	i7_skein_begin_changes(skein);
+	guint finished = 0;
+	while(finished < n_units) {
+		ReplayResult *result = g_async_queue_pop(results);
+		if(result->knot == NULL)
+			finished++;
+		else {
+			callback(result->knot->node, result->transcript, result->error, data);
+			skein_stats_count(SKEIN_STATS_KNOTS_REPLAYED, 1);
+		}
+		g_free(result->transcript);
+		if(result->error)
+			g_error_free(result->error);
+		g_slice_free(ReplayResult, result);
+	}
+	i7_skein_end_changes(skein);
+
+	if(workers)
+		g_thread_pool_free(workers, FALSE, TRUE);
+	guint typed = 0;
+	for(count = 0; count < n_units; count++)
+		typed += ((WorkUnit *)g_ptr_array_index(units, count))->commands_typed;
+	if(commands_typed)
+		*commands_typed = typed;
+	skein_stats_count(SKEIN_STATS_COMMANDS_TYPED, typed);
+	g_ptr_array_free(units, TRUE);
+	g_async_queue_unref(results);
+	if(snapshot_dir) {
+		g_rmdir(snapshot_dir);
+		g_free(snapshot_dir);
+	}
+	skein_stats_stop(SKEIN_STATS_REPLAY, start);
+	return TRUE;
+}
@@ -0,0 +1,56 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SKEIN_REPLAY_H
+#define SKEIN_REPLAY_H
+
+#include <glib.h>
+#include "node.h"
+#include "skein.h"
+
+G_BEGIN_DECLS
+
+#define I7_REPLAY_DEFAULT_PROMPT "\n>"
+
+typedef enum {
+	I7_REPLAY_ERROR_FAILED,
+	I7_REPLAY_ERROR_TIMED_OUT
+} I7ReplayError;
+
+#define I7_REPLAY_ERROR i7_replay_error_quark()
+
+typedef struct {
+	char **interpreter_argv; /* Command line that runs the story */
+	const char *prompt; /* Text the game prints when it waits for a command */
+	guint timeout; /* Seconds after which to give up on one run, or 0 */
+	gboolean use_snapshots; /* Resume branches from saved games */
+	guint jobs; /* Interpreters to run at once, or 0 for one per processor */
+} I7ReplayOptions;
+
+/* Called once for each knot that was replayed, with either its new transcript
+ or the reason it couldn't be played */
+typedef void (*I7ReplayKnotFunc)(I7Node *node, const char *transcript, const GError *error, gpointer data);
+
+GQuark i7_replay_error_quark(void);
+char **i7_replay_get_interpreter_command(const char *story_file);
+char *i7_replay_run_commands(char **interpreter_argv, GSList *commands, guint timeout, GError **error);
+char **i7_replay_split_transcript(const char *output, const char *prompt, guint n_commands);
+gboolean i7_replay_skein(I7Skein *skein, GSList *thread_ends, const I7ReplayOptions *options, I7ReplayKnotFunc callback, gpointer data, guint *commands_typed, GError **error);
+
+G_END_DECLS
+
+#endif /* SKEIN_REPLAY_H */
@@ -0,0 +1,209 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include "skein-stats.h"
+
+/* Timings and counts of what the skein spends its time on, for all the skeins
+ in the process together. Diffs are timed in the diff pool's worker threads, so
+ everything is behind a lock. */
+
+/* Set the environment variable I7_SKEIN_STATS to log every timed operation
+ that takes at least that many milliseconds; an empty value logs them all */
+#define LOG_VARIABLE "I7_SKEIN_STATS"
+
+static const char *timer_names[SKEIN_STATS_NUM_TIMERS] = {
+	N_("Load"),
+	N_("Save"),
+	N_("Layout"),
+	N_("Draw tree lines"),
+	N_("Compare transcripts"),
+	N_("Transcript rows"),
+	N_("Replay")
+};
+
+static const char *counter_names[SKEIN_STATS_NUM_COUNTERS] = {
+	N_("Knots loaded"),
+	N_("Loads from the cache"),
+	N_("Knots saved"),
+	N_("Knots laid out"),
+	N_("Tree lines drawn"),
+	N_("Transcripts compared"),
+	N_("Transcript rows inserted"),
+	N_("Transcript rows deleted"),
+	N_("Knots replayed"),
+	N_("Commands typed while replaying")
+};
+
+G_LOCK_DEFINE_STATIC(stats);
+static SkeinStatsTiming timings[SKEIN_STATS_NUM_TIMERS];
+static guint64 counts[SKEIN_STATS_NUM_COUNTERS];
+
+/* Threshold in microseconds for logging, or -1 if not logging */
+static gint64
+get_log_threshold(void)
+{
+	static gsize initialized = 0;
+	static gint64 threshold = -1;
+
+	if(g_once_init_enter(&initialized)) {
+		const char *value = g_getenv(LOG_VARIABLE);
+		if(value != NULL)
+			threshold = (gint64)(g_ascii_strtod(value, NULL) * 1000.0);
+		g_once_init_leave(&initialized, 1);
+	}
+	return threshold;
+}
+
+/*
+ * skein_stats_get_logging:
+ *
+ * Returns: %TRUE if the I7_SKEIN_STATS environment variable is set, and timed
+ * operations are logged.
+ */
+gboolean
+skein_stats_get_logging(void)
+{
+	return get_log_threshold() >= 0;
+}
+
+/*
+ * skein_stats_start:
+ *
+ * Starts timing an operation.
+ *
+ * Returns: the time to pass to skein_stats_stop().
+ */
+gint64
+skein_stats_start(void)
+{
+	return g_get_monotonic_time();
+}
+
+/*
+ * skein_stats_stop:
+ * @timer: which operation was timed
+ * @start: the return value of skein_stats_start()
+ *
+ * Adds the time since @start to the total for @timer.
+ */
+void
+skein_stats_stop(SkeinStatsTimer timer, gint64 start)
+{
+	g_return_if_fail(timer < SKEIN_STATS_NUM_TIMERS);
+
+	gint64 elapsed = g_get_monotonic_time() - start;
+
+	G_LOCK(stats);
+	timings[timer].calls++;
+	timings[timer].total += elapsed;
+	if(elapsed > timings[timer].longest)
+		timings[timer].longest = elapsed;
+	G_UNLOCK(stats);
+
+	gint64 threshold = get_log_threshold();
+	if(threshold >= 0 && elapsed >= threshold)
+		g_message("Skein: %s took %.3f ms", timer_names[timer], elapsed / 1000.0);
+}
+
+/*
+ * skein_stats_count:
+ * @counter: what to count
+ * @amount: how many more
+ */
+void
+skein_stats_count(SkeinStatsCounter counter, guint amount)
+{
+	g_return_if_fail(counter < SKEIN_STATS_NUM_COUNTERS);
+
+	G_LOCK(stats);
+	counts[counter] += amount;
+	G_UNLOCK(stats);
+}
+
+/*
+ * skein_stats_get_timing:
+ * @timer: an operation
+ * @timing: (out): return location for the number of times @timer was run and
+ * how long it took
+ */
+void
+skein_stats_get_timing(SkeinStatsTimer timer, SkeinStatsTiming *timing)
+{
+	g_return_if_fail(timer < SKEIN_STATS_NUM_TIMERS);
+
+	G_LOCK(stats);
+	*timing = timings[timer];
+	G_UNLOCK(stats);
+}
+
+guint64
+skein_stats_get_count(SkeinStatsCounter counter)
+{
+	g_return_val_if_fail(counter < SKEIN_STATS_NUM_COUNTERS, 0);
+
+	G_LOCK(stats);
+	guint64 retval = counts[counter];
+	G_UNLOCK(stats);
+	return retval;
+}
+
+/*
+ * skein_stats_append_report:
+ * @report: a string
+ *
+ * Appends a table of all the timings and counts to @report.
+ */
+void
+skein_stats_append_report(GString *report)
+{
+	SkeinStatsTiming copy[SKEIN_STATS_NUM_TIMERS];
+	guint64 counts_copy[SKEIN_STATS_NUM_COUNTERS];
+	int count;
+
+	G_LOCK(stats);
+	memcpy(copy, timings, sizeof(timings));
+	memcpy(counts_copy, counts, sizeof(counts));
+	G_UNLOCK(stats);
+
+	for(count = 0; count < SKEIN_STATS_NUM_TIMERS; count++) {
+		SkeinStatsTiming *timing = copy + count;
+		g_string_append_printf(report, "%-24s %8" G_GUINT64_FORMAT " x %8.3f ms = %10.1f ms, longest %8.3f ms\n",
+			_(timer_names[count]), timing->calls,
+			timing->calls? timing->total / 1000.0 / timing->calls : 0.0,
+			timing->total / 1000.0, timing->longest / 1000.0);
+	}
+	g_string_append_c(report, '\n');
+	for(count = 0; count < SKEIN_STATS_NUM_COUNTERS; count++)
+		g_string_append_printf(report, "%-32s %10" G_GUINT64_FORMAT "\n", _(counter_names[count]), counts_copy[count]);
+}
+
+/*
+ * skein_stats_reset:
+ *
+ * Sets all the timings and counts back to zero.
+ */
+void
+skein_stats_reset(void)
+{
+	G_LOCK(stats);
+	memset(timings, 0, sizeof(timings));
+	memset(counts, 0, sizeof(counts));
+	G_UNLOCK(stats);
+}
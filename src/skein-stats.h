@@ -0,0 +1,64 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SKEIN_STATS_H
+#define SKEIN_STATS_H
+
+#include <glib.h>
+
+/* Operations on the skein that are timed */
+typedef enum {
+	SKEIN_STATS_LOAD,
+	SKEIN_STATS_SAVE,
+	SKEIN_STATS_LAYOUT,
+	SKEIN_STATS_DRAW_TREE,
+	SKEIN_STATS_DIFF,
+	SKEIN_STATS_ROW_SIGNALS,
+	SKEIN_STATS_REPLAY,
+	SKEIN_STATS_NUM_TIMERS
+} SkeinStatsTimer;
+
+/* Things that are counted */
+typedef enum {
+	SKEIN_STATS_KNOTS_LOADED,
+	SKEIN_STATS_CACHE_HITS,
+	SKEIN_STATS_KNOTS_SAVED,
+	SKEIN_STATS_KNOTS_LAID_OUT,
+	SKEIN_STATS_LINES_DRAWN,
+	SKEIN_STATS_DIFFS_COMPUTED,
+	SKEIN_STATS_ROWS_INSERTED,
+	SKEIN_STATS_ROWS_DELETED,
+	SKEIN_STATS_KNOTS_REPLAYED,
+	SKEIN_STATS_COMMANDS_TYPED,
+	SKEIN_STATS_NUM_COUNTERS
+} SkeinStatsCounter;
+
+typedef struct {
+	guint64 calls;
+	gint64 total; /* Microseconds */
+	gint64 longest; /* Microseconds */
+} SkeinStatsTiming;
+
+gboolean skein_stats_get_logging(void);
+gint64 skein_stats_start(void);
+void skein_stats_stop(SkeinStatsTimer timer, gint64 start);
+void skein_stats_count(SkeinStatsCounter counter, guint amount);
+void skein_stats_get_timing(SkeinStatsTimer timer, SkeinStatsTiming *timing);
+guint64 skein_stats_get_count(SkeinStatsCounter counter);
+void skein_stats_append_report(GString *report);
+void skein_stats_reset(void);
+
+#endif /* SKEIN_STATS_H */
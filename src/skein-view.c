@@ -16,16 +16,59 @@
  */
 
 #include <gdk/gdkkeysyms.h>
+#include <glib/gi18n.h>
 #include <goocanvas.h>
 #include "skein-view.h"
 #include "skein.h"
 #include "node.h"
 
+/* Distance in pixels outside the viewport within which the virtualized view
+ still materializes knots, so that scrolling a little doesn't show gaps */
+#define VIRTUAL_MARGIN 200.0
+
+/* The canvas items drawing one knot in the virtualized view; these are
+ recycled as the view scrolls, so there are only ever about as many of them
+ as there are knots fitting in the window. The knots themselves get no item
+ models unless a non-virtualized view of the same skein draws them. */
+typedef struct {
+	I7Node *node; /* reffed; NULL while in the pool */
+	GooCanvasItem *line;
+	GooCanvasPoints *points;
+	GooCanvasItem *group;
+	GooCanvasItem *command_shape;
+	GooCanvasItem *label_shape;
+	GooCanvasItem *command;
+	GooCanvasItem *label;
+	GooCanvasItem *badge;
+
+	/* What the items were last drawn with, so that redrawing a knot that
+	 hasn't changed costs nothing */
+	gboolean stale; /* TRUE if the items were last drawn for another knot */
+	guint version; /* The knot's appearance version */
+	gdouble x, y;
+	gint line_style; /* Bits: locked, in the current thread */
+} VirtualKnot;
+
 typedef struct _I7SkeinViewPrivate
 {
 	I7Skein *skein;
 	gulong layout_handler;
 
+	/* Virtualized rendering */
+	gboolean virtualized;
+	gulong modified_handler;
+	gulong played_handler;
+	guint draw_idle;
+	GtkAdjustment *hadjustment;
+	GtkAdjustment *vadjustment;
+	gulong hadjustment_handler;
+	gulong vadjustment_handler;
+	GooCanvasItem *lines_group;
+	GooCanvasItem *knots_group;
+	PangoFontDescription *font;
+	GHashTable *materialized; /* I7Node -> VirtualKnot */
+	GSList *pool; /* Unused VirtualKnots */
+
 	/* Drag-scroll information */
 	gboolean dragging;
 	double drag_anchor[2];
@@ -41,6 +84,12 @@ enum
 	LAST_SIGNAL
 };
 
+enum
+{
+	PROP_0,
+	PROP_VIRTUALIZED
+};
+
 static guint i7_skein_view_signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE(I7SkeinView, i7_skein_view, GOO_TYPE_CANVAS);
@@ -163,6 +212,321 @@ on_motion(I7SkeinView *self, GdkEventMotion *event)
 	return TRUE;
 }
 
+/* VIRTUALIZED RENDERING */
+
+/* Find out which part of the canvas is currently in the viewport, plus a
+ margin */
+static void
+get_virtual_region(I7SkeinView *self, GooCanvasBounds *region)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	gdouble canvas_x, canvas_y;
+
+	goo_canvas_get_bounds(GOO_CANVAS(self), &canvas_x, &canvas_y, NULL, NULL);
+	region->x1 = canvas_x + gtk_adjustment_get_value(priv->hadjustment) - VIRTUAL_MARGIN;
+	region->x2 = region->x1 + gtk_adjustment_get_page_size(priv->hadjustment) + 2 * VIRTUAL_MARGIN;
+	region->y1 = canvas_y + gtk_adjustment_get_value(priv->vadjustment) - VIRTUAL_MARGIN;
+	region->y2 = region->y1 + gtk_adjustment_get_page_size(priv->vadjustment) + 2 * VIRTUAL_MARGIN;
+}
+
+static gboolean
+on_virtual_knot_button_press(GooCanvasItem *item, GooCanvasItem *target_item, GdkEventButton *event, I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	VirtualKnot *knot = g_object_get_data(G_OBJECT(item), "virtual-knot");
+
+	if(knot->node == NULL)
+		return FALSE;
+
+	if(GPOINTER_TO_INT(g_object_get_data(G_OBJECT(target_item), "node-part")) == I7_NODE_PART_DIFFERS_BADGE
+		&& event->type == GDK_2BUTTON_PRESS && event->button == 1) {
+		g_signal_emit_by_name(priv->skein, "differs-badge-activate", knot->node);
+		return TRUE;
+	}
+
+	return on_node_button_press(item, target_item, event, knot->node);
+}
+
+/* Take a set of canvas items out of the pool, or create one if the pool is
+ empty, and assign it to @node */
+static VirtualKnot *
+get_virtual_knot(I7SkeinView *self, I7Node *node)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	VirtualKnot *knot;
+
+	if(priv->pool) {
+		knot = priv->pool->data;
+		priv->pool = g_slist_delete_link(priv->pool, priv->pool);
+	} else {
+		knot = g_slice_new0(VirtualKnot);
+		knot->points = goo_canvas_points_new(4);
+		knot->line = goo_canvas_polyline_new(priv->lines_group, FALSE, 0, NULL);
+		knot->group = goo_canvas_group_new(priv->knots_group, NULL);
+		knot->command_shape = goo_canvas_path_new(knot->group, "",
+			"stroke-pattern", NULL,
+			NULL);
+		knot->label_shape = goo_canvas_path_new(knot->group, "",
+			"stroke-pattern", NULL,
+			"visibility", GOO_CANVAS_ITEM_HIDDEN,
+			NULL);
+		knot->command = goo_canvas_text_new(knot->group, "", 0.0, 0.0, -1, GTK_ANCHOR_CENTER, NULL);
+		knot->label = goo_canvas_text_new(knot->group, "", 0.0, 0.0, -1, GTK_ANCHOR_CENTER, NULL);
+		knot->badge = goo_canvas_path_new(knot->group, "",
+			"fill-color", "red",
+			"line-width", 0.0,
+			"visibility", GOO_CANVAS_ITEM_HIDDEN,
+			NULL);
+		g_object_set_data(G_OBJECT(knot->badge), "node-part", GINT_TO_POINTER(I7_NODE_PART_DIFFERS_BADGE));
+		g_object_set_data(G_OBJECT(knot->group), "virtual-knot", knot);
+		g_signal_connect(knot->group, "button-press-event", G_CALLBACK(on_virtual_knot_button_press), self);
+	}
+
+	knot->node = g_object_ref(node);
+	knot->stale = TRUE;
+	knot->line_style = -1;
+	return knot;
+}
+
+/* Hide a set of canvas items and put it back in the pool */
+static void
+recycle_knot(I7Node *node, VirtualKnot *knot, I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+
+	g_object_set(knot->group, "visibility", GOO_CANVAS_ITEM_HIDDEN, NULL);
+	g_object_set(knot->line, "visibility", GOO_CANVAS_ITEM_HIDDEN, NULL);
+	g_object_unref(knot->node);
+	knot->node = NULL;
+	priv->pool = g_slist_prepend(priv->pool, knot);
+}
+
+static void
+free_knot(VirtualKnot *knot)
+{
+	if(knot->node)
+		g_object_unref(knot->node);
+	goo_canvas_points_unref(knot->points);
+	g_slice_free(VirtualKnot, knot);
+}
+
+/* Bring the canvas items of @knot up to date with its node's position and
+ appearance */
+static void
+update_virtual_knot(I7SkeinView *self, VirtualKnot *knot, gdouble y)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	I7Node *node = knot->node;
+	gdouble x = i7_node_get_x(node);
+	guint version = i7_node_get_appearance_version(node);
+	gint line_style;
+
+	if(knot->stale || x != knot->x || y != knot->y) {
+		goo_canvas_item_set_simple_transform(knot->group, x, y, 1.0, 0.0);
+		knot->x = x;
+		knot->y = y;
+	}
+	if(knot->stale || version != knot->version) {
+		i7_node_update_items(node, knot->command_shape, knot->label_shape, knot->command, knot->label, knot->badge);
+		knot->version = version;
+	}
+	if(knot->stale)
+		g_object_set(knot->group, "visibility", GOO_CANVAS_ITEM_VISIBLE, NULL);
+
+	if(!i7_node_is_root(node)) {
+		if(i7_skein_calculate_tree_line(priv->skein, node, knot->points))
+			g_object_set(knot->line, "points", knot->points, NULL);
+		line_style = (i7_node_get_locked(node)? 1 : 0)
+			| (i7_skein_is_node_in_current_thread(priv->skein, node)? 2 : 0);
+		if(knot->stale || line_style != knot->line_style) {
+			i7_skein_style_tree_line(priv->skein, node, knot->line);
+			knot->line_style = line_style;
+		}
+		if(knot->stale)
+			g_object_set(knot->line, "visibility", GOO_CANVAS_ITEM_VISIBLE, NULL);
+	}
+	knot->stale = FALSE;
+}
+
+/* Materialize the knots in the subtree rooted at @node that fall in @region.
+Knots that already had items are taken out of @old. Since the layout centers
+each subtree on its root, a subtree that doesn't overlap @region horizontally
+can be skipped entirely, as can everything below the bottom of @region. */
+static void
+materialize_subtree(I7SkeinView *self, I7Node *node, gint depth, GooCanvasBounds *region, gdouble vspacing, GHashTable *old)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	gdouble half_width = 0.5 * i7_node_get_tree_width(node, GOO_CANVAS_ITEM_MODEL(priv->skein), GOO_CANVAS(self));
+	gdouble x = i7_node_get_x(node);
+	gdouble y = depth * vspacing;
+	GNode *child;
+
+	if(x + half_width < region->x1 || x - half_width > region->x2 || y - vspacing > region->y2)
+		return;
+
+	/* The knot is visible, or its line to its parent is */
+	if(y + vspacing >= region->y1) {
+		VirtualKnot *knot = g_hash_table_lookup(old, node);
+		if(knot)
+			g_hash_table_steal(old, node);
+		else
+			knot = get_virtual_knot(self, node);
+		update_virtual_knot(self, knot, y);
+		g_hash_table_insert(priv->materialized, node, knot);
+	}
+
+	for(child = node->gnode->children; child; child = child->next)
+		materialize_subtree(self, child->data, depth + 1, region, vspacing, old);
+}
+
+/* Make sure that exactly the knots in the viewport have canvas items */
+static void
+update_virtual_items(I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	GooCanvasBounds region;
+	gdouble vspacing;
+	GHashTable *old;
+
+	if(priv->skein == NULL || priv->hadjustment == NULL)
+		return;
+
+	get_virtual_region(self, &region);
+	g_object_get(priv->skein, "vertical-spacing", &vspacing, NULL);
+
+	old = priv->materialized;
+	priv->materialized = g_hash_table_new(g_direct_hash, g_direct_equal);
+	materialize_subtree(self, i7_skein_get_root_node(priv->skein), 0, &region, vspacing, old);
+
+	/* Whatever is left scrolled out of view */
+	g_hash_table_foreach(old, (GHFunc)recycle_knot, self);
+	g_hash_table_destroy(old);
+}
+
+/* Lay out the skein and redraw the visible knots; the virtualized counterpart
+of i7_skein_draw() */
+static gboolean
+virtual_draw(I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	I7Node *root;
+	PangoFontDescription *font = NULL;
+	gdouble hspacing, vspacing, treewidth;
+
+	priv->draw_idle = 0;
+	if(priv->skein == NULL)
+		return FALSE; /* one-shot */
+
+	g_object_get(priv->skein,
+		"horizontal-spacing", &hspacing,
+		"vertical-spacing", &vspacing,
+		"font-desc", &font,
+		NULL);
+
+	/* The text items inherit the skein's font from their group, like views of
+	 the skein's item models would */
+	if(font && !(priv->font && pango_font_description_equal(font, priv->font))) {
+		g_object_set(priv->knots_group, "font-desc", font, NULL);
+		if(priv->font)
+			pango_font_description_free(priv->font);
+		priv->font = font;
+	} else if(font)
+		pango_font_description_free(font);
+
+	root = i7_skein_get_root_node(priv->skein);
+	i7_node_layout(root, GOO_CANVAS_ITEM_MODEL(priv->skein), GOO_CANVAS(self), 0.0);
+	treewidth = i7_node_get_tree_width(root, GOO_CANVAS_ITEM_MODEL(priv->skein), GOO_CANVAS(self));
+	goo_canvas_set_bounds(GOO_CANVAS(self),
+		-treewidth * 0.5 - hspacing, -vspacing * 0.5,
+		treewidth * 0.5 + hspacing, g_node_max_height(root->gnode) * vspacing);
+
+	update_virtual_items(self);
+	return FALSE; /* one-shot */
+}
+
+static void
+schedule_virtual_draw(I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	if(priv->draw_idle == 0)
+		priv->draw_idle = g_idle_add((GSourceFunc)virtual_draw, self);
+}
+
+/* Draw straight away if a draw is pending, so that the knot items are where
+ the skein's layout says they are */
+static void
+flush_virtual_draw(I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	if(priv->draw_idle) {
+		g_source_remove(priv->draw_idle);
+		virtual_draw(self);
+	}
+}
+
+static void
+start_virtual_rendering(I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	GooCanvasItem *root = goo_canvas_get_root_item(GOO_CANVAS(self));
+
+	priv->lines_group = goo_canvas_group_new(root, NULL);
+	priv->knots_group = goo_canvas_group_new(root, NULL);
+	priv->materialized = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	priv->layout_handler = g_signal_connect_swapped(priv->skein, "needs-layout", G_CALLBACK(schedule_virtual_draw), self);
+	priv->modified_handler = g_signal_connect_swapped(priv->skein, "modified", G_CALLBACK(schedule_virtual_draw), self);
+	priv->played_handler = g_signal_connect_swapped(priv->skein, "notify::played-node", G_CALLBACK(schedule_virtual_draw), self);
+
+	/* i7_skein_view_set_skein() has checked that the parent is a scrolled
+	 window */
+	GtkWidget *scrolled_window = gtk_widget_get_parent(GTK_WIDGET(self));
+	priv->hadjustment = g_object_ref(gtk_scrolled_window_get_hadjustment(GTK_SCROLLED_WINDOW(scrolled_window)));
+	priv->vadjustment = g_object_ref(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(scrolled_window)));
+	priv->hadjustment_handler = g_signal_connect_swapped(priv->hadjustment, "value-changed", G_CALLBACK(update_virtual_items), self);
+	priv->vadjustment_handler = g_signal_connect_swapped(priv->vadjustment, "value-changed", G_CALLBACK(update_virtual_items), self);
+
+	virtual_draw(self);
+}
+
+static void
+stop_virtual_rendering(I7SkeinView *self)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+
+	if(priv->draw_idle) {
+		g_source_remove(priv->draw_idle);
+		priv->draw_idle = 0;
+	}
+	g_signal_handler_disconnect(priv->skein, priv->modified_handler);
+	g_signal_handler_disconnect(priv->skein, priv->played_handler);
+	if(priv->hadjustment) {
+		g_signal_handler_disconnect(priv->hadjustment, priv->hadjustment_handler);
+		g_signal_handler_disconnect(priv->vadjustment, priv->vadjustment_handler);
+		g_object_unref(priv->hadjustment);
+		g_object_unref(priv->vadjustment);
+		priv->hadjustment = priv->vadjustment = NULL;
+	}
+
+	g_hash_table_foreach(priv->materialized, (GHFunc)recycle_knot, self);
+	g_hash_table_destroy(priv->materialized);
+	priv->materialized = NULL;
+	g_slist_foreach(priv->pool, (GFunc)free_knot, NULL);
+	g_slist_free(priv->pool);
+	priv->pool = NULL;
+
+	/* Removing the groups destroys all the knot items */
+	goo_canvas_item_remove(priv->lines_group);
+	goo_canvas_item_remove(priv->knots_group);
+	priv->lines_group = priv->knots_group = NULL;
+	if(priv->font) {
+		pango_font_description_free(priv->font);
+		priv->font = NULL;
+	}
+}
+
+/* TYPE SYSTEM */
+
 static void
 i7_skein_view_init(I7SkeinView *self)
 {
@@ -170,31 +534,75 @@ i7_skein_view_init(I7SkeinView *self)
 	priv->skein = NULL;
 	priv->layout_handler = 0;
 	priv->dragging = FALSE;
+	priv->virtualized = FALSE;
+	priv->draw_idle = 0;
+	priv->hadjustment = priv->vadjustment = NULL;
+	priv->lines_group = priv->knots_group = NULL;
+	priv->font = NULL;
+	priv->materialized = NULL;
+	priv->pool = NULL;
 
 	g_signal_connect_after(self, "item-created", G_CALLBACK(on_item_created), &priv->skein);
 	g_signal_connect(self, "button-press-event", G_CALLBACK(on_button_press), NULL);
 	g_signal_connect(self, "button-release-event", G_CALLBACK(on_button_release), NULL);
 	g_signal_connect(self, "motion-notify-event", G_CALLBACK(on_motion), NULL);
+	/* Resizing the view may bring more knots into it */
+	g_signal_connect_after(self, "size-allocate", G_CALLBACK(update_virtual_items), NULL);
 }
 
 static void
-i7_skein_view_finalize(GObject *self)
+i7_skein_view_set_property(GObject *self, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+
+	switch(prop_id) {
+		case PROP_VIRTUALIZED:
+			priv->virtualized = g_value_get_boolean(value);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(self, prop_id, pspec);
+	}
+}
+
+static void
+i7_skein_view_get_property(GObject *self, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+
+	switch(prop_id) {
+		case PROP_VIRTUALIZED:
+			g_value_set_boolean(value, priv->virtualized);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(self, prop_id, pspec);
+	}
+}
+
+/* The virtualized view's canvas items must be taken down here, before
+ GooCanvas's dispose unrefs the root item that they belong to */
+static void
+i7_skein_view_dispose(GObject *self)
 {
 	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
 
 	if(priv->skein) {
+		if(priv->virtualized)
+			stop_virtual_rendering(I7_SKEIN_VIEW(self));
 		g_signal_handler_disconnect(priv->skein, priv->layout_handler);
 		g_object_unref(priv->skein);
+		priv->skein = NULL;
 	}
 
-	G_OBJECT_CLASS(i7_skein_view_parent_class)->finalize(self);
+	G_OBJECT_CLASS(i7_skein_view_parent_class)->dispose(self);
 }
 
 static void
 i7_skein_view_class_init(I7SkeinViewClass *klass)
 {
 	GObjectClass* object_class = G_OBJECT_CLASS(klass);
-	object_class->finalize = i7_skein_view_finalize;
+	object_class->set_property = i7_skein_view_set_property;
+	object_class->get_property = i7_skein_view_get_property;
+	object_class->dispose = i7_skein_view_dispose;
 
 	/* node-popup-menu - user right-clicked on a node */
 	i7_skein_view_signals[NODE_MENU_POPUP] = g_signal_new("node-menu-popup",
@@ -202,6 +610,12 @@ i7_skein_view_class_init(I7SkeinViewClass *klass)
 		G_STRUCT_OFFSET(I7SkeinViewClass, node_menu_popup), NULL, NULL,
 		g_cclosure_marshal_VOID__OBJECT, G_TYPE_NONE, 1, I7_TYPE_NODE);
 
+	/* Install properties */
+	g_object_class_install_property(object_class, PROP_VIRTUALIZED,
+		g_param_spec_boolean("virtualized", _("Virtualized"),
+			_("Whether to create canvas items only for the knots in view"),
+			FALSE, G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
 	/* Add private data */
 	g_type_class_add_private(klass, sizeof(I7SkeinViewPrivate));
 }
@@ -225,16 +639,32 @@ i7_skein_view_set_skein(I7SkeinView *self, I7Skein *skein)
 		return;
 
 	if(priv->skein) {
+		if(priv->virtualized)
+			stop_virtual_rendering(self);
 		g_signal_handler_disconnect(priv->skein, priv->layout_handler);
 		g_object_unref(priv->skein);
 	}
 	priv->skein = skein;
 
 	if(skein == NULL) {
-		goo_canvas_set_root_item_model(GOO_CANVAS(self), NULL);
+		if(!priv->virtualized)
+			goo_canvas_set_root_item_model(GOO_CANVAS(self), NULL);
 		return;
 	}
 
+	if(priv->virtualized) {
+		/* The virtualized view follows the scrolled window's adjustments to
+		 find out which knots are in view; without them, draw everything */
+		if(GTK_IS_SCROLLED_WINDOW(gtk_widget_get_parent(GTK_WIDGET(self)))) {
+			g_object_ref(skein);
+			start_virtual_rendering(self);
+			return;
+		}
+		g_warning("I7SkeinView is not inside a GtkScrolledWindow; drawing the "
+			"whole skein instead of only the knots in view");
+		priv->virtualized = FALSE;
+	}
+
 	goo_canvas_set_root_item_model(GOO_CANVAS(self), GOO_CANVAS_ITEM_MODEL(skein));
 	g_object_ref(skein);
 	priv->layout_handler = g_signal_connect(skein, "needs-layout", G_CALLBACK(i7_skein_schedule_draw), self);
@@ -301,11 +731,37 @@ popup_edit_window(GtkWidget *parent, gint x, gint y, const gchar *text)
 	return edit_popup;
 }
 
+/* Get the onscreen coordinates of the item in the virtualized view that shows
+ @node's command, or its label if @label is TRUE */
+static gboolean
+get_virtual_text_coordinates(I7SkeinView *self, I7Node *node, gboolean label, gint *x, gint *y)
+{
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
+	VirtualKnot *knot;
+
+	/* The knot may have only just been created */
+	flush_virtual_draw(self);
+
+	knot = g_hash_table_lookup(priv->materialized, node);
+	if(knot == NULL) {
+		g_warning("Node not onscreen in canvas");
+		return FALSE;
+	}
+	return i7_goo_canvas_item_get_onscreen_coordinates(label? knot->label : knot->command, GOO_CANVAS(self), x, y);
+}
+
 void
 i7_skein_view_edit_node(I7SkeinView *self, I7Node *node)
 {
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
 	gint x, y;
-	if(!i7_node_get_command_coordinates(node, &x, &y, GOO_CANVAS(self)))
+	gboolean onscreen;
+
+	if(priv->virtualized)
+		onscreen = get_virtual_text_coordinates(self, node, FALSE, &x, &y);
+	else
+		onscreen = i7_node_get_command_coordinates(node, &x, &y, GOO_CANVAS(self));
+	if(!onscreen)
 		return;
 	GtkWidget *parent = gtk_widget_get_toplevel(GTK_WIDGET(self));
 	gchar *command = i7_node_get_command(node);
@@ -320,8 +776,15 @@ i7_skein_view_edit_node(I7SkeinView *self, I7Node *node)
 void
 i7_skein_view_edit_label(I7SkeinView *self, I7Node *node)
 {
+	I7_SKEIN_VIEW_USE_PRIVATE(self, priv);
 	gint x, y;
-	if(!i7_node_get_label_coordinates(node, &x, &y, GOO_CANVAS(self)))
+	gboolean onscreen;
+
+	if(priv->virtualized)
+		onscreen = get_virtual_text_coordinates(self, node, TRUE, &x, &y);
+	else
+		onscreen = i7_node_get_label_coordinates(node, &x, &y, GOO_CANVAS(self));
+	if(!onscreen)
 		return;
 	GtkWidget *parent = gtk_widget_get_toplevel(GTK_WIDGET(self));
 	gchar *label = i7_node_get_label(node);
@@ -16,14 +16,18 @@
  */
 
 #include <errno.h>
+#include <string.h>
 #include <gtk/gtk.h>
 #include <gio/gio.h>
 #include <glib/gi18n.h>
-#include <libxml/parser.h>
-#include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <goocanvas.h>
 
+#include "diff-pool.h"
 #include "skein.h"
+#include "skein-cache.h"
+#include "skein-index.h"
+#include "skein-stats.h"
 #include "node.h"
 
 #define VALID_ITER(iter, priv) ( \
@@ -49,6 +53,33 @@ typedef struct _I7SkeinPrivate
 
 	GSettings *settings; /* skein settings */
 
+	/* Compares transcripts in the background; created the first time it is
+	 needed and kept until the skein is freed, since results may still be on
+	 their way after a replay is over */
+	DiffPool *diff_pool;
+	gboolean background_diffs;
+
+	/* The rows of the tree model: the knots from the root to the bottom of the
+	 current knot's thread */
+	GPtrArray *thread;
+	GHashTable *thread_index; /* I7Node -> row number plus one */
+
+	/* Knots whose transcript differs from the expected text, in the order they
+	 come in the skein (depth first); see compare_skein_order() for what
+	 finding a knot's place in it costs */
+	GSequence *differences;
+	GHashTable *difference_iters; /* I7Node -> GSequenceIter in @differences */
+
+	/* Words of each knot's texts, for searching; NULL until the first search */
+	SkeinIndex *search_index;
+
+	/* Signals held back until the end of a batch of changes */
+	guint batch_depth;
+	guint pending_signals; /* Bit mask of signal numbers */
+	I7Node *pending_show_node;
+	I7SkeinShowNodeReason pending_show_reason;
+	GHashTable *changed_rows; /* Set of knots whose rows need row-changed */
+
 	int stamp; /* Stamp for identifying tree iterators belonging to this model */
 } I7SkeinPrivate;
 
@@ -75,7 +106,8 @@ enum
 	PROP_HORIZONTAL_SPACING,
 	PROP_VERTICAL_SPACING,
 	PROP_LOCKED_COLOR,
-	PROP_UNLOCKED_COLOR
+	PROP_UNLOCKED_COLOR,
+	PROP_N_DIFFERENCES
 };
 
 static guint i7_skein_signals[LAST_SIGNAL] = { 0 };
@@ -85,40 +117,372 @@ static void i7_skein_tree_model_init(GtkTreeModelIface *iface);
 G_DEFINE_TYPE_EXTENDED(I7Skein, i7_skein, GOO_TYPE_CANVAS_GROUP_MODEL, 0,
     G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, i7_skein_tree_model_init));
 
+/* CURRENT THREAD */
+
+/* Returns the row of @node in the tree model, or -1 if it isn't in the current
+ thread */
+static int
+thread_lookup(I7SkeinPrivate *priv, I7Node *node)
+{
+	return GPOINTER_TO_INT(g_hash_table_lookup(priv->thread_index, node)) - 1;
+}
+
+static void
+thread_push(I7Skein *self, I7Node *node)
+{
+	I7_SKEIN_USE_PRIVATE;
+	g_ptr_array_add(priv->thread, node);
+	g_hash_table_insert(priv->thread_index, node, GINT_TO_POINTER(priv->thread->len));
+	skein_stats_count(SKEIN_STATS_ROWS_INSERTED, 1);
+
+	GtkTreePath *path = gtk_tree_path_new_from_indices(priv->thread->len - 1, -1);
+	GtkTreeIter iter = { priv->stamp, node };
+	gtk_tree_model_row_inserted(GTK_TREE_MODEL(self), path, &iter);
+	gtk_tree_path_free(path);
+}
+
+/* Removes the last row. Only pass TRUE for @drop_markup if the knot is still
+ in the skein. */
+static void
+thread_pop(I7Skein *self, gboolean drop_markup)
+{
+	I7_SKEIN_USE_PRIVATE;
+	I7Node *node = g_ptr_array_index(priv->thread, priv->thread->len - 1);
+	g_hash_table_remove(priv->thread_index, node);
+	g_ptr_array_set_size(priv->thread, priv->thread->len - 1);
+	skein_stats_count(SKEIN_STATS_ROWS_DELETED, 1);
+
+	GtkTreePath *path = gtk_tree_path_new_from_indices(priv->thread->len, -1);
+	gtk_tree_model_row_deleted(GTK_TREE_MODEL(self), path);
+	gtk_tree_path_free(path);
+
+	/* The Transcript no longer shows this knot, so don't keep its markup
+	 around; a skein can have a lot of transcript text */
+	if(drop_markup)
+		i7_node_drop_pango_strings(node);
+}
+
+/* Brings the cached thread up to date after the current node or the shape of
+ the skein changed, emitting row-deleted for the rows that are no longer in it
+ and row-inserted for the new ones. Unless @reshaped, the thread is assumed not
+ to have changed if it still ends at the same knot. */
+static void
+thread_update(I7Skein *self, gboolean reshaped, gboolean drop_markup)
+{
+	I7_SKEIN_USE_PRIVATE;
+	I7Node *last = i7_skein_get_thread_bottom(self, priv->current);
+
+	if(!reshaped && priv->thread->len > 0
+		&& g_ptr_array_index(priv->thread, priv->thread->len - 1) == last)
+		return;
+
+	gint64 start = skein_stats_start();
+
+	/* Collect the new thread, bottom first */
+	GPtrArray *new_thread = g_ptr_array_new();
+	GNode *gnode;
+	for(gnode = last->gnode; gnode; gnode = gnode->parent)
+		g_ptr_array_add(new_thread, gnode->data);
+
+	/* Keep the rows the two threads have in common */
+	guint common = 0;
+	while(common < priv->thread->len && common < new_thread->len
+		&& g_ptr_array_index(priv->thread, common) == g_ptr_array_index(new_thread, new_thread->len - 1 - common))
+		common++;
+
+	while(priv->thread->len > common)
+		thread_pop(self, drop_markup);
+	for( ; common < new_thread->len; common++)
+		thread_push(self, g_ptr_array_index(new_thread, new_thread->len - 1 - common));
+
+	g_ptr_array_free(new_thread, TRUE);
+	skein_stats_stop(SKEIN_STATS_ROW_SIGNALS, start);
+}
+
+/* Removes all the rows, before the knots are freed */
+static void
+thread_clear(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	gint64 start = skein_stats_start();
+	while(priv->thread->len > 0)
+		thread_pop(self, FALSE);
+	skein_stats_stop(SKEIN_STATS_ROW_SIGNALS, start);
+}
+
+/* BATCHES OF CHANGES */
+
+/* Emits @signal, one of the signals without arguments; during a batch of
+ changes, it is emitted once at the end of the batch instead */
+static void
+emit_signal(I7Skein *self, guint signal)
+{
+	I7_SKEIN_USE_PRIVATE;
+	if(priv->batch_depth > 0) {
+		priv->pending_signals |= 1 << signal;
+		/* The default handler isn't run until later */
+		if(signal == MODIFIED)
+			priv->modified = TRUE;
+		return;
+	}
+	g_signal_emit(self, i7_skein_signals[signal], 0);
+}
+
+/* Asks the views to show @node; during a batch of changes, only the last knot
+ asked for is shown, at the end */
+static void
+show_node(I7Skein *self, I7SkeinShowNodeReason why, I7Node *node)
+{
+	I7_SKEIN_USE_PRIVATE;
+	if(priv->batch_depth > 0) {
+		priv->pending_show_node = node;
+		priv->pending_show_reason = why;
+		return;
+	}
+	g_signal_emit(self, i7_skein_signals[SHOW_NODE], 0, why, node);
+}
+
+static void
+emit_row_changed(I7Skein *self, I7Node *node, int row)
+{
+	I7_SKEIN_USE_PRIVATE;
+	GtkTreePath *path = gtk_tree_path_new_from_indices(row, -1);
+	GtkTreeIter iter = { priv->stamp, node };
+	gtk_tree_model_row_changed(GTK_TREE_MODEL(self), path, &iter);
+	gtk_tree_path_free(path);
+}
+
+/* Emits everything that was held back during a batch of changes */
+static void
+flush_batch(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+
+	/* Only look at the rows that are still in the thread; the set may contain
+	 knots that were removed since */
+	if(g_hash_table_size(priv->changed_rows) > 0) {
+		guint row;
+		for(row = 0; row < priv->thread->len; row++) {
+			I7Node *node = g_ptr_array_index(priv->thread, row);
+			if(g_hash_table_lookup(priv->changed_rows, node))
+				emit_row_changed(self, node, row);
+		}
+		g_hash_table_remove_all(priv->changed_rows);
+	}
+
+	guint pending = priv->pending_signals;
+	priv->pending_signals = 0;
+	if(pending & (1 << NEEDS_LAYOUT))
+		g_signal_emit(self, i7_skein_signals[NEEDS_LAYOUT], 0);
+	if(pending & (1 << LABELS_CHANGED))
+		g_signal_emit(self, i7_skein_signals[LABELS_CHANGED], 0);
+	if(priv->pending_show_node) {
+		I7Node *node = priv->pending_show_node;
+		priv->pending_show_node = NULL;
+		g_signal_emit(self, i7_skein_signals[SHOW_NODE], 0, priv->pending_show_reason, node);
+	}
+	if(pending & (1 << MODIFIED))
+		g_signal_emit(self, i7_skein_signals[MODIFIED], 0);
+}
+
+/* DIFFERENCES */
+
+/* Compare the positions of two knots in a depth-first walk of the skein. This
+ walks up to the root from both knots and then along the children of their
+ common ancestor, so it costs time in proportion to the depth of the skein
+ and the number of children there; a search of the differences does about
+ log n of these comparisons. */
+static int
+compare_skein_order(I7Node *a, I7Node *b, gpointer data)
+{
+	if(a == b)
+		return 0;
+
+	GNode *x = a->gnode, *y = b->gnode;
+	guint depth_a = g_node_depth(x), depth_b = g_node_depth(y);
+	for( ; depth_a > depth_b; depth_a--)
+		x = x->parent;
+	for( ; depth_b > depth_a; depth_b--)
+		y = y->parent;
+	/* One knot is an ancestor of the other, and comes first */
+	if(x == y)
+		return (x == a->gnode)? -1 : 1;
+
+	while(x->parent != y->parent) {
+		x = x->parent;
+		y = y->parent;
+	}
+	for(x = x->next; x; x = x->next)
+		if(x == y)
+			return -1;
+	return 1;
+}
+
+/* Add @node to or remove it from the set of differences, according to its
+ match type */
+static void
+update_difference(I7Skein *self, I7Node *node)
+{
+	I7_SKEIN_USE_PRIVATE;
+
+	GSequenceIter *iter = g_hash_table_lookup(priv->difference_iters, node);
+	gboolean different = i7_node_get_blessed(node) && i7_node_get_different(node)
+		&& g_node_get_root(node->gnode) == priv->root->gnode;
+
+	if(different && iter == NULL) {
+		iter = g_sequence_insert_sorted(priv->differences, node, (GCompareDataFunc)compare_skein_order, NULL);
+		g_hash_table_insert(priv->difference_iters, node, iter);
+	} else if(!different && iter != NULL) {
+		g_sequence_remove(iter);
+		g_hash_table_remove(priv->difference_iters, node);
+	} else
+		return;
+
+	g_object_notify(G_OBJECT(self), "n-differences");
+}
+
+/* Call when @node is removed from the skein */
+static void
+forget_difference(I7Skein *self, I7Node *node)
+{
+	I7_SKEIN_USE_PRIVATE;
+	GSequenceIter *iter = g_hash_table_lookup(priv->difference_iters, node);
+	if(iter) {
+		g_sequence_remove(iter);
+		g_hash_table_remove(priv->difference_iters, node);
+		g_object_notify(G_OBJECT(self), "n-differences");
+	}
+}
+
+static gboolean
+append_difference(GNode *gnode, I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	I7Node *node = gnode->data;
+	if(i7_node_get_blessed(node) && i7_node_get_different(node)) {
+		GSequenceIter *iter = g_sequence_append(priv->differences, node);
+		g_hash_table_insert(priv->difference_iters, node, iter);
+	}
+	return FALSE; /* Don't stop the traversal */
+}
+
+/* Collect all the differences in a newly loaded skein; a depth-first walk
+ finds them in order */
+static void
+find_all_differences(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)append_difference, self);
+	g_object_notify(G_OBJECT(self), "n-differences");
+}
+
+/* SEARCH */
+
+/* Index the texts of @node again, if there is an index yet */
+static void
+update_search_index(I7Skein *self, I7Node *node)
+{
+	I7_SKEIN_USE_PRIVATE;
+	const char *transcript, *expected;
+
+	if(priv->search_index == NULL)
+		return;
+	skein_index_remove(priv->search_index, node);
+	skein_index_add(priv->search_index, node, i7_node_peek_command(node));
+	skein_index_add(priv->search_index, node, i7_node_peek_label(node));
+	/* Don't load texts that are still in the skein cache */
+	i7_node_peek_stored_texts(node, &transcript, &expected);
+	skein_index_add(priv->search_index, node, transcript);
+	skein_index_add(priv->search_index, node, expected);
+}
+
+static void
+forget_search_entry(I7Skein *self, I7Node *node)
+{
+	I7_SKEIN_USE_PRIVATE;
+	if(priv->search_index)
+		skein_index_remove(priv->search_index, node);
+}
+
+static gboolean
+index_node(GNode *gnode, I7Skein *self)
+{
+	update_search_index(self, gnode->data);
+	return FALSE; /* Don't stop the traversal */
+}
+
+/* Call when the whole skein is replaced; the index is built again at the next
+ search */
+static void
+drop_search_index(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	if(priv->search_index) {
+		skein_index_free(priv->search_index);
+		priv->search_index = NULL;
+	}
+}
+
+/* Forgets everything that refers to @node, which is about to be freed */
+static void
+forget_node(I7Skein *self, I7Node *node)
+{
+	I7_SKEIN_USE_PRIVATE;
+	forget_difference(self, node);
+	forget_search_entry(self, node);
+	if(priv->pending_show_node == node)
+		priv->pending_show_node = NULL;
+}
+
 /* SIGNAL HANDLERS */
 
 static void
 on_node_other_notify(I7Node *node, GParamSpec *pspec, I7Skein *self)
 {
-	g_signal_emit_by_name(self, "modified");
+	emit_signal(self, MODIFIED);
 }
 
 static void
 on_node_layout_notify(I7Node *node, GParamSpec *pspec, I7Skein *self)
 {
-	g_signal_emit_by_name(self, "needs-layout");
+	emit_signal(self, NEEDS_LAYOUT);
 	on_node_other_notify(node, pspec, self);
 }
 
 static void
 on_node_label_notify(I7Node *node, GParamSpec *pspec, I7Skein *self)
 {
+	update_search_index(self, node);
 	if(i7_node_has_label(node))
 		i7_skein_lock(self, i7_skein_get_thread_bottom(self, node));
-	g_signal_emit_by_name(self, "labels-changed");
+	emit_signal(self, LABELS_CHANGED);
 	on_node_layout_notify(node, pspec, self);
 }
 
+static void
+on_node_text_notify(I7Node *node, GParamSpec *pspec, I7Skein *self)
+{
+	update_search_index(self, node);
+}
+
 static void
 on_node_transcript_notify(I7Node *node, GParamSpec *pspec, I7Skein *self)
 {
 	I7_SKEIN_USE_PRIVATE;
-	if(!i7_skein_is_node_in_current_thread(self, node))
+	int row = thread_lookup(priv, node);
+	if(row == -1)
 		return;
-	GtkTreePath *path = gtk_tree_path_new_from_indices(g_node_depth(node->gnode) - 1, -1);
-	GtkTreeIter iter = { priv->stamp, node };
-	gtk_tree_model_row_changed(GTK_TREE_MODEL(self), path, &iter);
-	gtk_tree_path_free(path);
+	/* A knot often changes several times in one batch; tell the view once */
+	if(priv->batch_depth > 0)
+		g_hash_table_add(priv->changed_rows, node);
+	else
+		emit_row_changed(self, node, row);
+}
+
+static void
+on_node_match_notify(I7Node *node, GParamSpec *pspec, I7Skein *self)
+{
+	update_difference(self, node);
 }
 
 static void
@@ -126,12 +490,37 @@ node_listen(I7Skein *self, I7Node *node)
 {
 	g_signal_connect(node, "notify::command", G_CALLBACK(on_node_layout_notify), self);
 	g_signal_connect(node, "notify::command", G_CALLBACK(on_node_transcript_notify), self);
+	g_signal_connect(node, "notify::command", G_CALLBACK(on_node_text_notify), self);
 	g_signal_connect(node, "notify::label", G_CALLBACK(on_node_label_notify), self);
 	g_signal_connect(node, "notify::transcript-text", G_CALLBACK(on_node_other_notify), self);
 	g_signal_connect(node, "notify::transcript-text", G_CALLBACK(on_node_transcript_notify), self);
+	g_signal_connect(node, "notify::transcript-text", G_CALLBACK(on_node_text_notify), self);
 	g_signal_connect(node, "notify::expected-text", G_CALLBACK(on_node_layout_notify), self);
 	g_signal_connect(node, "notify::expected-text", G_CALLBACK(on_node_transcript_notify), self);
+	g_signal_connect(node, "notify::expected-text", G_CALLBACK(on_node_text_notify), self);
 	g_signal_connect(node, "notify::locked", G_CALLBACK(on_node_layout_notify), self);
+	/* The match type can change some time after the texts do, when it is
+	calculated in the background; redraw the differs badge then */
+	g_signal_connect(node, "notify::match", G_CALLBACK(on_node_other_notify), self);
+	g_signal_connect(node, "notify::match", G_CALLBACK(on_node_transcript_notify), self);
+	g_signal_connect(node, "notify::match", G_CALLBACK(on_node_match_notify), self);
+	update_search_index(self, node);
+}
+
+static gboolean
+invalidate_layout(GNode *gnode)
+{
+	i7_node_invalidate_layout(I7_NODE(gnode->data));
+	return FALSE; /* Don't stop the traversal */
+}
+
+/* Mark every knot as needing to be laid out again, for example when the
+ spacing changes */
+static void
+invalidate_all_layout(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)invalidate_layout, NULL);
 }
 
 /* TYPE SYSTEM */
@@ -145,6 +534,13 @@ i7_skein_init(I7Skein *self)
 	priv->current = priv->root;
 	priv->played = priv->root;
 	priv->modified = TRUE;
+	priv->thread = g_ptr_array_new();
+	g_ptr_array_add(priv->thread, priv->root);
+	priv->thread_index = g_hash_table_new(NULL, NULL);
+	g_hash_table_insert(priv->thread_index, priv->root, GINT_TO_POINTER(1));
+	priv->differences = g_sequence_new(NULL);
+	priv->difference_iters = g_hash_table_new(NULL, NULL);
+	priv->changed_rows = g_hash_table_new(NULL, NULL);
 	priv->locked_dash = goo_canvas_line_dash_new(0);
 	priv->unlocked_dash = goo_canvas_line_dash_new(2, 5.0, 5.0);
 
@@ -169,13 +565,15 @@ i7_skein_set_property(GObject *self, guint prop_id, const GValue *value, GParamS
 			break;
 		case PROP_HORIZONTAL_SPACING:
 			priv->hspacing = g_value_get_double(value);
+			invalidate_all_layout(I7_SKEIN(self));
 			g_object_notify(self, "horizontal-spacing");
-			g_signal_emit_by_name(self, "needs-layout");
+			emit_signal(I7_SKEIN(self), NEEDS_LAYOUT);
 			break;
 		case PROP_VERTICAL_SPACING:
 			priv->vspacing = g_value_get_double(value);
+			invalidate_all_layout(I7_SKEIN(self));
 			g_object_notify(self, "vertical-spacing");
-			g_signal_emit_by_name(self, "needs-layout");
+			emit_signal(I7_SKEIN(self), NEEDS_LAYOUT);
 			break;
 		case PROP_LOCKED_COLOR:
 			gdk_color_parse(g_value_get_string(value), &priv->locked);
@@ -210,6 +608,9 @@ i7_skein_get_property(GObject *self, guint prop_id, GValue *value, GParamSpec *p
 		case PROP_VERTICAL_SPACING:
 			g_value_set_double(value, priv->vspacing);
 			break;
+		case PROP_N_DIFFERENCES:
+			g_value_set_uint(value, g_sequence_get_length(priv->differences));
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(self, prop_id, pspec);
 	}
@@ -220,6 +621,14 @@ i7_skein_finalize(GObject *self)
 {
 	I7_SKEIN_USE_PRIVATE;
 
+	if(priv->diff_pool)
+		diff_pool_free(priv->diff_pool);
+	g_ptr_array_free(priv->thread, TRUE);
+	g_hash_table_destroy(priv->thread_index);
+	g_sequence_free(priv->differences);
+	g_hash_table_destroy(priv->difference_iters);
+	g_hash_table_destroy(priv->changed_rows);
+	drop_search_index(I7_SKEIN(self));
 	g_object_unref(priv->root);
 	goo_canvas_line_dash_unref(priv->unlocked_dash);
 
@@ -307,6 +716,10 @@ i7_skein_class_init(I7SkeinClass *klass)
 		g_param_spec_string("unlocked-color", _("Unlocked color"),
 			_("Color of unlocked threads"),
 			"black", G_PARAM_WRITABLE | G_PARAM_CONSTRUCT | flags));
+	g_object_class_install_property(object_class, PROP_N_DIFFERENCES,
+		g_param_spec_uint("n-differences", _("Number of differences"),
+			_("Number of knots whose transcript differs from the expected text"),
+			0, G_MAXUINT, 0, G_PARAM_READABLE | flags));
 
 	/* Add private data */
 	g_type_class_add_private(klass, sizeof(I7SkeinPrivate));
@@ -340,6 +753,8 @@ i7_skein_get_column_type(GtkTreeModel *model, int ncol)
 		case I7_SKEIN_COLUMN_PLAYED:
 		case I7_SKEIN_COLUMN_CHANGED:
 			return G_TYPE_BOOLEAN;
+		case I7_SKEIN_COLUMN_TEXT_VERSION:
+			return G_TYPE_UINT;
 		case I7_SKEIN_COLUMN_NODE_PTR:
 			return I7_TYPE_NODE;
 		default:
@@ -356,31 +771,11 @@ i7_skein_get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path)
 	I7_SKEIN_USE_PRIVATE;
 
 	int i = gtk_tree_path_get_indices(path)[0];
-	I7Node *last = i7_skein_get_thread_bottom(self, priv->current);
-	int thread_depth = g_node_depth(last->gnode) - 1;
-	/* g_node_depth returns 0 for NULL and 1 for the root node */
-	
-	if(i > thread_depth)
+	if(i < 0 || i >= (int)priv->thread->len)
 		return FALSE;
 
 	iter->stamp = priv->stamp;
-	
-	if(i == 0) {
-		iter->user_data = priv->root;
-		return TRUE;
-	}
-	if(i == thread_depth) {
-		iter->user_data = last;
-		return TRUE;
-	}
-	
-	/* Make the uninitialized iterator point to the i'th node between the root
-	 node and the bottom of the current node's thread */
-	GNode *gnode = last->gnode;
-	for( ; thread_depth > i; thread_depth--)
-		gnode = gnode->parent;
-	
-	iter->user_data = gnode->data;
+	iter->user_data = g_ptr_array_index(priv->thread, i);
 	return TRUE;
 }
 
@@ -393,8 +788,7 @@ i7_skein_get_path(GtkTreeModel *model, GtkTreeIter *iter)
 	g_return_val_if_fail(VALID_ITER(iter, priv), NULL);
 
 	GtkTreePath *path = gtk_tree_path_new();
-	int index = g_node_depth(((I7Node *)iter->user_data)->gnode) - 1;
-	gtk_tree_path_append_index(path, index);
+	gtk_tree_path_append_index(path, thread_lookup(priv, iter->user_data));
 	return path;
 }
 
@@ -410,7 +804,7 @@ i7_skein_get_value(GtkTreeModel *model, GtkTreeIter *iter, int column, GValue *v
 	switch(column) {
 		case I7_SKEIN_COLUMN_COMMAND:
 			g_value_init(value, G_TYPE_STRING);
-			g_value_take_string(value, i7_node_get_command(iter->user_data));
+			g_value_set_string(value, i7_node_peek_command(iter->user_data));
 			break;
 		case I7_SKEIN_COLUMN_TRANSCRIPT_TEXT:
 			g_value_init(value, G_TYPE_STRING);
@@ -436,6 +830,10 @@ i7_skein_get_value(GtkTreeModel *model, GtkTreeIter *iter, int column, GValue *v
 			g_value_init(value, G_TYPE_BOOLEAN);
 			g_value_set_boolean(value, i7_node_get_changed(iter->user_data));
 			break;
+		case I7_SKEIN_COLUMN_TEXT_VERSION:
+			g_value_init(value, G_TYPE_UINT);
+			g_value_set_uint(value, i7_node_get_text_version(iter->user_data));
+			break;
 		case I7_SKEIN_COLUMN_NODE_PTR:
 			g_value_init(value, I7_TYPE_NODE);
 			g_value_set_object(value, iter->user_data);
@@ -462,21 +860,13 @@ i7_skein_iter_next(GtkTreeModel *model, GtkTreeIter *iter)
 	g_return_val_if_fail(VALID_ITER(iter, priv), FALSE);
 
 	/* Don't go beyond the bottom of "current" node's thread (end of the list) */
-	I7Node *last = i7_skein_get_thread_bottom(self, priv->current);
-	if(iter->user_data == last) {
+	int next = thread_lookup(priv, iter->user_data) + 1;
+	if(next <= 0 || next >= (int)priv->thread->len) {
 		invalidate_iter(iter);
 		return FALSE;
 	}
-	
-	GNode *gnode = ((I7Node *)iter->user_data)->gnode;
 
-	for(gnode = gnode->children; gnode; gnode = gnode->next) {
-		if(i7_node_in_thread(gnode->data, last))
-			break;
-	}
-	g_assert(gnode);
-
-	iter->user_data = gnode->data;
+	iter->user_data = g_ptr_array_index(priv->thread, next);
 	return TRUE;
 }
 
@@ -512,10 +902,8 @@ i7_skein_iter_n_children(GtkTreeModel *model, GtkTreeIter *iter)
 	
 	/* If iter is NULL, return the number of toplevel nodes, i.e. the length of
 	 the list */
-	if(!iter) {
-		I7Node *last = i7_skein_get_thread_bottom(self, priv->current);
-		return g_node_depth(last->gnode);
-	}
+	if(!iter)
+		return priv->thread->len;
 	return 0;
 }
 
@@ -533,33 +921,13 @@ i7_skein_iter_nth_child(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *par
 	I7Skein *self = I7_SKEIN(model);
 	I7_SKEIN_USE_PRIVATE;
 
-	I7Node *last = i7_skein_get_thread_bottom(self, priv->current);
-	int thread_depth = g_node_depth(last->gnode) - 1;
-	/* g_node_depth returns 0 for NULL and 1 for the root node */
-	
-	if(n > thread_depth) {
+	if(n < 0 || n >= (int)priv->thread->len) {
 		invalidate_iter(iter);
 		return FALSE;
 	}
 
 	iter->stamp = priv->stamp;
-	
-	if(n == 0) {
-		iter->user_data = priv->root;
-		return TRUE;
-	}
-	if(n == thread_depth) {
-		iter->user_data = last;
-		return TRUE;
-	}
-	
-	/* Make the uninitialized iterator point to the i'th node between the root
-	 node and the bottom of the current node's thread */
-	GNode *gnode = last->gnode;
-	for( ; thread_depth > n; thread_depth--)
-		gnode = gnode->parent;
-	
-	iter->user_data = gnode->data;
+	iter->user_data = g_ptr_array_index(priv->thread, n);
 	return TRUE;
 }
 
@@ -626,55 +994,124 @@ i7_skein_set_current_node(I7Skein *self, I7Node *node)
 	if(priv->current == node)
 		return;
 
-	/* Old end of the list */
-	I7Node *old_last = i7_skein_get_thread_bottom(self, priv->current);
-	/* New end of the list */
-	I7Node *last = i7_skein_get_thread_bottom(self, node);
-	GNode *gnode = old_last->gnode;
-	
 	/* Emit row-inserted and row-deleted signals on our tree model interface */
-	if(old_last != last) {
-		/* Find a common ancestor of the old and new list bottoms */
-		int depth = g_node_depth(gnode) - 1;
-		for( ; gnode && !i7_node_in_thread(gnode->data, last); gnode = gnode->parent) {
-			GtkTreePath *path = gtk_tree_path_new_from_indices(depth--, -1);
-			gtk_tree_model_row_deleted(GTK_TREE_MODEL(self), path);
-			gtk_tree_path_free(path);
-		}
-		/* gnode is now the common ancestor, possibly the root node if no
-		 common ancestor, or possibly NULL if the tree is being rebuilt; in
-		 the latter case, first add the root node to the model */
-		if(gnode == NULL) {
-			gnode = priv->root->gnode;
-			GtkTreePath *path = gtk_tree_path_new_from_indices(0, -1);
-			GtkTreeIter iter = { priv->stamp, priv->root };
-			gtk_tree_model_row_inserted(GTK_TREE_MODEL(self), path, &iter);
-			gtk_tree_path_free(path);
-			depth = 0;
-		}
-		while(gnode != last->gnode) {
-			for(gnode = gnode->children; gnode; gnode = gnode->next) {
-				if(i7_node_in_thread(gnode->data, last))
-					break;
-			}
-			GtkTreePath *path = gtk_tree_path_new_from_indices(++depth, -1);
-			GtkTreeIter iter = { priv->stamp, gnode->data };
-			gtk_tree_model_row_inserted(GTK_TREE_MODEL(self), path, &iter);
-			gtk_tree_path_free(path);
-		}
-	}
-	
 	priv->current = node;
+	thread_update(self, FALSE, TRUE);
+
 	g_object_notify(G_OBJECT(self), "current-node");
-	g_signal_emit_by_name(self, "needs-layout");
+	emit_signal(self, NEEDS_LAYOUT);
 }
 
 gboolean
 i7_skein_is_node_in_current_thread(I7Skein *self, I7Node *node)
 {
 	I7_SKEIN_USE_PRIVATE;
-	I7Node *last = i7_skein_get_thread_bottom(self, priv->current);
-	return i7_node_in_thread(node, last);
+	return thread_lookup(priv, node) != -1;
+}
+
+/*
+ * i7_skein_get_iter_for_node:
+ * @self: the skein
+ * @node: a knot
+ * @iter: return location for a tree iter
+ *
+ * Points @iter at the row of @node in the tree model.
+ *
+ * Returns: %FALSE if @node isn't in the current thread, so has no row.
+ */
+gboolean
+i7_skein_get_iter_for_node(I7Skein *self, I7Node *node, GtkTreeIter *iter)
+{
+	I7_SKEIN_USE_PRIVATE;
+	if(thread_lookup(priv, node) == -1)
+		return FALSE;
+	iter->stamp = priv->stamp;
+	iter->user_data = node;
+	return TRUE;
+}
+
+/*
+ * i7_skein_get_n_differences:
+ * @self: the skein
+ *
+ * Returns: the number of blessed knots whose transcript differs from the
+ * expected text.
+ */
+guint
+i7_skein_get_n_differences(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	return g_sequence_get_length(priv->differences);
+}
+
+/*
+ * i7_skein_get_next_difference:
+ * @self: the skein
+ * @node: the knot to start after, or %NULL to start at the beginning
+ * @current_thread_only: whether to skip knots that aren't in the Transcript
+ *
+ * Finds the next blessed knot after @node whose transcript differs from the
+ * expected text; that is, below @node, or else to the right of it in the
+ * skein.
+ *
+ * Returns: the knot, or %NULL if there are no more.
+ */
+I7Node *
+i7_skein_get_next_difference(I7Skein *self, I7Node *node, gboolean current_thread_only)
+{
+	I7_SKEIN_USE_PRIVATE;
+	GSequenceIter *iter;
+
+	if(node == NULL)
+		iter = g_sequence_get_begin_iter(priv->differences);
+	else if((iter = g_hash_table_lookup(priv->difference_iters, node)) != NULL)
+		iter = g_sequence_iter_next(iter);
+	else
+		iter = g_sequence_search(priv->differences, node, (GCompareDataFunc)compare_skein_order, NULL);
+
+	I7Node *last = NULL;
+	if(current_thread_only)
+		last = g_ptr_array_index(priv->thread, priv->thread->len - 1);
+
+	for( ; !g_sequence_iter_is_end(iter); iter = g_sequence_iter_next(iter)) {
+		I7Node *candidate = g_sequence_get(iter);
+		if(!current_thread_only || thread_lookup(priv, candidate) != -1)
+			return candidate;
+		/* Nothing after the bottom of the thread is in the thread */
+		if(compare_skein_order(candidate, last, NULL) > 0)
+			break;
+	}
+	return NULL;
+}
+
+/*
+ * i7_skein_get_previous_difference:
+ * @self: the skein
+ * @node: the knot to start before, or %NULL to start at the end
+ * @current_thread_only: whether to skip knots that aren't in the Transcript
+ *
+ * Like i7_skein_get_next_difference(), but goes the other way.
+ *
+ * Returns: the knot, or %NULL if there are no more.
+ */
+I7Node *
+i7_skein_get_previous_difference(I7Skein *self, I7Node *node, gboolean current_thread_only)
+{
+	I7_SKEIN_USE_PRIVATE;
+	GSequenceIter *iter;
+
+	if(node == NULL)
+		iter = g_sequence_get_end_iter(priv->differences);
+	else if((iter = g_hash_table_lookup(priv->difference_iters, node)) == NULL)
+		iter = g_sequence_search(priv->differences, node, (GCompareDataFunc)compare_skein_order, NULL);
+
+	while(!g_sequence_iter_is_begin(iter)) {
+		iter = g_sequence_iter_prev(iter);
+		I7Node *candidate = g_sequence_get(iter);
+		if(!current_thread_only || thread_lookup(priv, candidate) != -1)
+			return candidate;
+	}
+	return NULL;
 }
 
 I7Node *
@@ -725,52 +1162,402 @@ i7_skein_set_played_node(I7Skein *self, I7Node *node)
 	g_object_notify(G_OBJECT(self), "played-node");
 }
 
-/* Search an xmlNode's properties for a certain one and return its content.
-String must be freed. Return NULL if not found */
-static gchar *
-get_property_from_node(xmlNode *node, const gchar *propertyname)
-{
-	xmlAttr *props;
-	for(props = node->properties; props; props = props->next)
-		if(xmlStrEqual(props->name, (const xmlChar *)propertyname))
-			return g_strdup((gchar *)props->children->content);
-	return NULL;
-}
+/* Read the ObjectiveC "YES" and "NO" into a boolean, or return default_val if
+ content is malformed */
+static gboolean
+get_boolean_from_content(const xmlChar *content, gboolean default_val)
+{
+	if(xmlStrEqual(content, (xmlChar *)"YES"))
+		return TRUE;
+	else if(xmlStrEqual(content, (xmlChar *)"NO"))
+		return FALSE;
+	else
+		return default_val;
+}
+
+/* Return the value of the attribute @name of the reader's current element,
+ interned in the reader's dictionary, or NULL if there is no such attribute */
+static const xmlChar *
+get_attribute(xmlTextReaderPtr reader, const char *name)
+{
+	const xmlChar *value = NULL;
+	if(xmlTextReaderMoveToAttribute(reader, (const xmlChar *)name) == 1) {
+		value = xmlTextReaderConstString(reader, xmlTextReaderConstValue(reader));
+		xmlTextReaderMoveToElement(reader);
+	}
+	return value;
+}
+
+/* State of the streaming skein loader. Node ids are interned as integer slots:
+ each distinct id gets a slot the first time it is seen, whether on an <item>
+ or in a <child> reference, so that a parent can refer to children whose items
+ haven't been read yet. */
+typedef struct {
+	xmlTextReaderPtr reader;
+	GHashTable *ids; /* Interned id string -> slot + 1 */
+	GPtrArray *nodes; /* Slot -> I7Node, or NULL if its item hasn't been read */
+	GArray *links; /* Pairs of parent slot, child slot, in document order */
+} SkeinLoader;
+
+static int
+intern_id(SkeinLoader *loader, const xmlChar *id)
+{
+	/* Interned strings from the same dictionary can be compared as pointers */
+	gpointer slot = g_hash_table_lookup(loader->ids, id);
+	if(slot)
+		return GPOINTER_TO_INT(slot) - 1;
+	g_ptr_array_add(loader->nodes, NULL);
+	g_hash_table_insert(loader->ids, (gpointer)id, GINT_TO_POINTER(loader->nodes->len));
+	return loader->nodes->len - 1;
+}
+
+/* Read one <item> element, which the reader is positioned on, and everything
+ inside it; create its node and record the links to its children */
+static gboolean
+load_item(I7Skein *self, SkeinLoader *loader, GError **error)
+{
+	xmlTextReaderPtr reader = loader->reader;
+	const xmlChar *id = get_attribute(reader, "nodeId");
+	xmlChar *command = NULL, *label = NULL, *transcript = NULL, *expected = NULL;
+	gboolean unlocked = TRUE, changed = FALSE;
+	int score = 0, slot, status = 1;
+
+	if(!id) {
+		if(error)
+			*error = g_error_new(I7_SKEIN_ERROR, I7_SKEIN_ERROR_BAD_FORMAT, _("nodeId attribute not found."));
+		return FALSE;
+	}
+	slot = intern_id(loader, id);
+	if(g_ptr_array_index(loader->nodes, slot)) {
+		if(error)
+			*error = g_error_new(I7_SKEIN_ERROR, I7_SKEIN_ERROR_BAD_FORMAT, _("Duplicate node ID \"%s\"."), (const char *)id);
+		return FALSE;
+	}
+
+	if(!xmlTextReaderIsEmptyElement(reader)) {
+		while((status = xmlTextReaderRead(reader)) == 1) {
+			int type = xmlTextReaderNodeType(reader);
+			const xmlChar *name = xmlTextReaderConstLocalName(reader);
+			if(type == XML_READER_TYPE_END_ELEMENT && xmlStrEqual(name, (xmlChar *)"item"))
+				break;
+			if(type != XML_READER_TYPE_ELEMENT)
+				continue;
+
+			/* Ignore "played"; it is calculated */
+			if(xmlStrEqual(name, (xmlChar *)"command")) {
+				xmlFree(command);
+				command = xmlTextReaderReadString(reader);
+			} else if(xmlStrEqual(name, (xmlChar *)"annotation")) {
+				xmlFree(label);
+				label = xmlTextReaderReadString(reader);
+			} else if(xmlStrEqual(name, (xmlChar *)"result")) {
+				xmlFree(transcript);
+				transcript = xmlTextReaderReadString(reader);
+			} else if(xmlStrEqual(name, (xmlChar *)"commentary")) {
+				xmlFree(expected);
+				expected = xmlTextReaderReadString(reader);
+			} else if(xmlStrEqual(name, (xmlChar *)"changed")) {
+				xmlChar *content = xmlTextReaderReadString(reader);
+				changed = get_boolean_from_content(content, FALSE);
+				xmlFree(content);
+			} else if(xmlStrEqual(name, (xmlChar *)"temporary")) {
+				const xmlChar *score_string = get_attribute(reader, "score");
+				xmlChar *content = xmlTextReaderReadString(reader);
+				unlocked = get_boolean_from_content(content, TRUE);
+				xmlFree(content);
+				if(score_string)
+					sscanf((const char *)score_string, "%d", &score);
+			} else if(xmlStrEqual(name, (xmlChar *)"child")) {
+				const xmlChar *child_id = get_attribute(reader, "nodeId");
+				if(child_id) {
+					int link[2] = { slot, intern_id(loader, child_id) };
+					g_array_append_vals(loader->links, link, 2);
+				}
+			}
+		}
+	}
+
+	if(status == 1) {
+		I7Node *skein_node = i7_node_new((gchar *)command, (gchar *)label, (gchar *)transcript, (gchar *)expected, FALSE, !unlocked, changed, score, GOO_CANVAS_ITEM_MODEL(self));
+		node_listen(self, skein_node);
+		g_ptr_array_index(loader->nodes, slot) = skein_node;
+	} else if(error) {
+		xmlErrorPtr xml_error = xmlGetLastError();
+		*error = g_error_new_literal(I7_SKEIN_ERROR, I7_SKEIN_ERROR_XML, xml_error? xml_error->message : _("Unexpected end of file."));
+	}
+
+	xmlFree(command);
+	xmlFree(label);
+	xmlFree(transcript);
+	xmlFree(expected);
+	return status == 1;
+}
+
+/* Doesn't actually free the node itself, but removes it from the canvas so that
+ it gets freed. Has reversed arguments and returns FALSE for use in tree
+ traversals. */
+static gboolean
+remove_node_from_canvas(GNode *gnode, I7Skein *self)
+{
+	forget_node(self, gnode->data);
+	if(I7_NODE(gnode->data)->tree_item)
+		goo_canvas_item_model_remove(I7_NODE(gnode->data)->tree_item);
+	goo_canvas_item_model_remove(GOO_CANVAS_ITEM_MODEL(gnode->data));
+	return FALSE;
+}
+
+/* Link up the knots that were read, in @nodes, according to @links, pairs of
+ parent slot and child slot; and make them the new skein. Only the knots that
+ can be reached from the root are linked in, so a malformed file can't create
+ loops; the rest are discarded. */
+static gboolean
+finish_load(I7Skein *self, GPtrArray *nodes, GArray *links, int root_slot, int active_slot, GError **error)
+{
+	I7_SKEIN_USE_PRIVATE;
+	int count;
+
+	/* Make sure every node that is referred to was actually there */
+	I7Node *root = root_slot != -1? g_ptr_array_index(nodes, root_slot) : NULL;
+	for(count = 0; count < links->len; count++)
+		if(!g_ptr_array_index(nodes, g_array_index(links, int, count)))
+			root = NULL;
+	if(!root) {
+		if(error)
+			*error = g_error_new(I7_SKEIN_ERROR, I7_SKEIN_ERROR_BAD_FORMAT, _("The skein refers to a node that isn't in it."));
+		return FALSE;
+	}
+
+	/* Each knot keeps the first link that lists it as a child. Build the lists
+	 of children from the links that were kept, back to front so that they come
+	 out in document order */
+	int *kept_link = g_new(int, nodes->len); /* Slot -> index in @links, or -1 */
+	int *first_child = g_new(int, nodes->len);
+	int *next_sibling = g_new(int, nodes->len);
+	for(count = 0; count < nodes->len; count++)
+		kept_link[count] = first_child[count] = next_sibling[count] = -1;
+	for(count = 0; count < links->len; count += 2) {
+		int child = g_array_index(links, int, count + 1);
+		if(child == root_slot || kept_link[child] != -1) {
+			g_warning("Ignoring knot listed as a child more than once in the skein");
+			continue;
+		}
+		kept_link[child] = count;
+	}
+	for(count = links->len - 2; count >= 0; count -= 2) {
+		int parent = g_array_index(links, int, count);
+		int child = g_array_index(links, int, count + 1);
+		if(kept_link[child] == count) {
+			next_sibling[child] = first_child[parent];
+			first_child[parent] = child;
+		}
+	}
+
+	/* Find the knots that can be reached from the root, in one walk; any knots
+	 in a loop are never reached */
+	gboolean *reached = g_new0(gboolean, nodes->len);
+	int *stack = g_new(int, nodes->len), depth = 0;
+	reached[root_slot] = TRUE;
+	stack[depth++] = root_slot;
+	while(depth > 0) {
+		int child;
+		for(child = first_child[stack[--depth]]; child != -1; child = next_sibling[child]) {
+			reached[child] = TRUE;
+			stack[depth++] = child;
+		}
+	}
+
+	/* Add the children to each parent, in order */
+	for(count = 0; count < links->len; count += 2) {
+		int parent = g_array_index(links, int, count);
+		int child = g_array_index(links, int, count + 1);
+		if(kept_link[child] == count && reached[child])
+			i7_node_append_child(g_ptr_array_index(nodes, parent), g_ptr_array_index(nodes, child));
+	}
+
+	I7Node *active = root;
+	if(active_slot != -1 && reached[active_slot])
+		active = g_ptr_array_index(nodes, active_slot);
+
+	/* Discard any knots that ended up unconnected to the root; none of them
+	 have been linked to anything */
+	for(count = 0; count < nodes->len; count++) {
+		I7Node *node = g_ptr_array_index(nodes, count);
+		if(node && !reached[count])
+			remove_node_from_canvas(node->gnode, self);
+	}
+
+	g_free(kept_link);
+	g_free(first_child);
+	g_free(next_sibling);
+	g_free(reached);
+	g_free(stack);
+
+	/* Discard the current skein and replace with the new */
+	thread_clear(self);
+	g_node_traverse(priv->root->gnode, G_POST_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)remove_node_from_canvas, self);
+	priv->root = root;
+	priv->played = NULL;
+	i7_skein_set_played_node(self, active);
+	i7_skein_set_current_node(self, priv->root);
+	find_all_differences(self);
+
+	emit_signal(self, NEEDS_LAYOUT);
+	emit_signal(self, LABELS_CHANGED);
+	priv->modified = FALSE;
+	return TRUE;
+}
+
+/* Read the skein from its binary cache; the transcript and expected texts stay
+ in the mapped file until they are needed */
+static gboolean
+load_cache(I7Skein *self, SkeinCache *cache)
+{
+	guint n_knots = skein_cache_get_n_knots(cache), count, child;
+	GMappedFile *file = skein_cache_get_mapped_file(cache);
+	GPtrArray *nodes = g_ptr_array_sized_new(n_knots);
+	GArray *links = g_array_sized_new(FALSE, FALSE, sizeof(int), 2 * n_knots);
+
+	for(count = 0; count < n_knots; count++) {
+		const SkeinCacheKnot *knot = skein_cache_get_knot(cache, count);
+		const char *transcript = skein_cache_get_string(cache, knot->transcript);
+		const char *expected = skein_cache_get_string(cache, knot->expected);
+		/* If it wasn't known how the texts compare, load them now so that they
+		 are compared */
+		gboolean stored = (knot->match != I7_NODE_CANT_COMPARE || *expected == '\0');
+
+		I7Node *node = i7_node_new(skein_cache_get_string(cache, knot->command),
+			skein_cache_get_string(cache, knot->label),
+			stored? "" : transcript, stored? "" : expected, FALSE,
+			(knot->flags & SKEIN_CACHE_KNOT_LOCKED) != 0,
+			(knot->flags & SKEIN_CACHE_KNOT_CHANGED) != 0,
+			knot->score, GOO_CANVAS_ITEM_MODEL(self));
+		if(stored && (*transcript != '\0' || *expected != '\0'))
+			i7_node_set_stored_texts(node, file, transcript, expected, knot->match);
+		node_listen(self, node);
+		g_ptr_array_add(nodes, node);
+
+		for(child = 0; child < knot->n_children; child++) {
+			int link[2] = { count, skein_cache_get_child(cache, knot, child) };
+			g_array_append_vals(links, link, 2);
+		}
+	}
+
+	gboolean retval = finish_load(self, nodes, links, skein_cache_get_root(cache), skein_cache_get_active(cache), NULL);
+	if(!retval) {
+		for(count = 0; count < nodes->len; count++)
+			remove_node_from_canvas(I7_NODE(g_ptr_array_index(nodes, count))->gnode, self);
+	}
+	g_ptr_array_free(nodes, TRUE);
+	g_array_free(links, TRUE);
+	return retval;
+}
+
+static gboolean
+load_xml(I7Skein *self, GFile *file, GError **error)
+{
+	SkeinLoader loader;
+	int root_slot = -1, active_slot = -1, status, count;
+	gboolean seen_top = FALSE;
+
+	/* Stream through the file instead of building a document tree; only the
+	 knot being read is held in memory besides the nodes themselves */
+	char *filename = g_file_get_path(file);
+	loader.reader = xmlReaderForFile(filename, NULL, XML_PARSE_NONET);
+	g_free(filename);
+	if(!loader.reader) {
+		xmlErrorPtr xml_error = xmlGetLastError();
+		if(error)
+			*error = g_error_new_literal(I7_SKEIN_ERROR, I7_SKEIN_ERROR_XML, xml_error? xml_error->message : _("Could not open the skein file."));
+		return FALSE;
+	}
+	loader.ids = g_hash_table_new(g_direct_hash, g_direct_equal);
+	loader.nodes = g_ptr_array_new();
+	loader.links = g_array_new(FALSE, FALSE, sizeof(int));
+
+	while((status = xmlTextReaderRead(loader.reader)) == 1) {
+		if(xmlTextReaderNodeType(loader.reader) != XML_READER_TYPE_ELEMENT)
+			continue;
+		const xmlChar *name = xmlTextReaderConstLocalName(loader.reader);
+
+		/* Check the top XML node and get the ID of the root node */
+		if(!seen_top) {
+			seen_top = TRUE;
+			if(!xmlStrEqual(name, (xmlChar *)"Skein")) {
+				if(error)
+					*error = g_error_new(I7_SKEIN_ERROR, I7_SKEIN_ERROR_BAD_FORMAT, _("<Skein> element not found."));
+				goto fail;
+			}
+			const xmlChar *root_id = get_attribute(loader.reader, "rootNode");
+			if(!root_id) {
+				if(error)
+					*error = g_error_new(I7_SKEIN_ERROR, I7_SKEIN_ERROR_BAD_FORMAT, _("rootNode attribute not found."));
+				goto fail;
+			}
+			root_slot = intern_id(&loader, root_id);
+		} else if(xmlStrEqual(name, (xmlChar *)"activeNode")) {
+			const xmlChar *active_id = get_attribute(loader.reader, "nodeId");
+			if(active_id)
+				active_slot = intern_id(&loader, active_id);
+		} else if(xmlStrEqual(name, (xmlChar *)"item")) {
+			if(!load_item(self, &loader, error))
+				goto fail;
+		}
+	}
+	if(status == -1 || !seen_top) {
+		xmlErrorPtr xml_error = xmlGetLastError();
+		if(error)
+			*error = g_error_new_literal(I7_SKEIN_ERROR, I7_SKEIN_ERROR_XML, xml_error? xml_error->message : _("<Skein> element not found."));
+		goto fail;
+	}
+
+	if(!finish_load(self, loader.nodes, loader.links, root_slot, active_slot, error))
+		goto fail;
 
-/* Read the ObjectiveC "YES" and "NO" into a boolean, or return default_val if
- content is malformed */
-static gboolean
-get_boolean_from_content(xmlNode *node, gboolean default_val)
-{
-	if(xmlStrEqual(node->children->content, (xmlChar *)"YES"))
-		return TRUE;
-	else if(xmlStrEqual(node->children->content, (xmlChar *)"NO"))
-		return FALSE;
-	else
-		return default_val;
-}
+	xmlFreeTextReader(loader.reader);
+	g_hash_table_destroy(loader.ids);
+	g_ptr_array_free(loader.nodes, TRUE);
+	g_array_free(loader.links, TRUE);
+	return TRUE;
 
-static gchar *
-get_text_content_from_node(xmlNode *node)
-{
-	if(node->children)
-		if(xmlStrEqual(node->children->name, (xmlChar *)"text"))
-			return g_strdup((gchar *)node->children->content);
-	return NULL;
+fail:
+	/* Nodes haven't been linked together yet, so remove each one */
+	for(count = 0; count < loader.nodes->len; count++) {
+		I7Node *node = g_ptr_array_index(loader.nodes, count);
+		if(node)
+			remove_node_from_canvas(node->gnode, self);
+	}
+	xmlFreeTextReader(loader.reader);
+	g_hash_table_destroy(loader.ids);
+	g_ptr_array_free(loader.nodes, TRUE);
+	g_array_free(loader.links, TRUE);
+	return FALSE;
 }
 
-/* Doesn't actually free the node itself, but removes it from the canvas so that
- it gets freed. Has reversed arguments and returns FALSE for use in tree
- traversals. */
-static gboolean
-remove_node_from_canvas(GNode *gnode, I7Skein *self)
+/* Write the binary cache for @file; it is only an optimization, so failing to
+ write it is not an error */
+static void
+write_cache(I7Skein *self, GFile *file, I7Node *active)
 {
-	if(I7_NODE(gnode->data)->tree_item)
-		goo_canvas_item_model_remove(I7_NODE(gnode->data)->tree_item);
-	goo_canvas_item_model_remove(GOO_CANVAS_ITEM_MODEL(gnode->data));
-	return FALSE;
+	I7_SKEIN_USE_PRIVATE;
+	GError *error = NULL;
+	if(!skein_cache_write(file, priv->root, active, &error)) {
+		g_warning("Could not write the skein cache: %s", error->message);
+		g_error_free(error);
+	}
 }
 
+/*
+ * i7_skein_load:
+ * @self: the skein
+ * @file: an XML skein file
+ * @error: return location for an error, or %NULL
+ *
+ * Replaces the skein with the one in @file. If the binary cache next to @file
+ * is up to date, the skein is read from there instead, and the transcript and
+ * expected texts are only loaded when needed; otherwise the cache is rebuilt.
+ *
+ * Returns: %TRUE if successful.
+ */
 gboolean
 i7_skein_load(I7Skein *self, GFile *file, GError **error)
 {
@@ -779,130 +1566,92 @@ i7_skein_load(I7Skein *self, GFile *file, GError **error)
 
 	I7_SKEIN_USE_PRIVATE;
 
-	char *filename = g_file_get_path(file);
-	xmlDoc *xmldoc = xmlParseFile(filename);
-	g_free(filename);
-	if(!xmldoc) {
-		xmlErrorPtr xml_error = xmlGetLastError();
-		if(error)
-			*error = g_error_new_literal(I7_SKEIN_ERROR, I7_SKEIN_ERROR_XML, g_strdup(xml_error->message));
-		return FALSE;
-	}
+	gint64 start = skein_stats_start();
+	gboolean loaded = FALSE;
+	/* Reading the knots is not a change to the skein, but a change already
+	 held back by an enclosing batch still has to be reported */
+	guint outer_modified = priv->pending_signals & (1 << MODIFIED);
 
-	/* Get the top XML node */
-	xmlNode *top = xmlDocGetRootElement(xmldoc);
-	if(!xmlStrEqual(top->name, (xmlChar *)"Skein")) {
-		if(error)
-			*error = g_error_new(I7_SKEIN_ERROR, I7_SKEIN_ERROR_BAD_FORMAT, _("<Skein> element not found."));
-		goto fail;
-	}
+	i7_skein_begin_changes(self);
 
-	/* Get the ID of the root node */
-	gchar *root_id = get_property_from_node(top, "rootNode");
-	if(!root_id) {
-		if(error)
-			*error = g_error_new(I7_SKEIN_ERROR, I7_SKEIN_ERROR_BAD_FORMAT, _("rootNode attribute not found."));
-		goto fail;
+	/* Don't index the knots while they are being read */
+	drop_search_index(self);
+
+	SkeinCache *cache = skein_cache_open(file);
+	if(cache) {
+		loaded = load_cache(self, cache);
+		skein_cache_free(cache);
+		if(loaded)
+			skein_stats_count(SKEIN_STATS_CACHE_HITS, 1);
 	}
 
-	/* Get all the item nodes and the ID of the active node */
-	GHashTable *nodetable = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-	gchar *active_id = NULL;
-	xmlNode *item;
-	/* Create a node object for each of the XML item nodes */
-	for(item = top->children; item; item = item->next) {
-		if(xmlStrEqual(item->name, (xmlChar *)"activeNode"))
-			active_id = get_property_from_node(item, "nodeId");
-		else if(xmlStrEqual(item->name, (xmlChar *)"item")) {
-			gchar *id, *command = NULL, *label = NULL;
-			gchar *transcript = NULL, *expected = NULL;
-			gboolean unlocked = TRUE, changed = FALSE;
-			int score = 0;
-
-			xmlNode *child;
-			for(child = item->children; child; child = child->next) {
-				/* Ignore "played" and "changed"; these are calculated */
-				if(xmlStrEqual(child->name, (xmlChar *)"command"))
-					command = get_text_content_from_node(child);
-				else if(xmlStrEqual(child->name, (xmlChar *)"annotation"))
-					label = get_text_content_from_node(child);
-				else if(xmlStrEqual(child->name, (xmlChar *)"result"))
-					transcript = get_text_content_from_node(child);
-				else if(xmlStrEqual(child->name, (xmlChar *)"commentary"))
-					expected = get_text_content_from_node(child);
-				else if(xmlStrEqual(child->name, (xmlChar *)"changed"))
-					changed = get_boolean_from_content(child, FALSE);
-				else if(xmlStrEqual(child->name, (xmlChar *)"temporary")) {
-					unlocked = get_boolean_from_content(child, TRUE);
-					gchar *trash = get_property_from_node(child, "score");
-					sscanf(trash, "%d", &score);
-					g_free(trash);
-				}
-			}
-			id = get_property_from_node(item, "nodeId"); /* freed by table */
-
-			I7Node *skein_node = i7_node_new(command, label, transcript, expected, FALSE, !unlocked, changed, score, GOO_CANVAS_ITEM_MODEL(self));
-			node_listen(self, skein_node);
-			g_hash_table_insert(nodetable, id, skein_node);
-			g_free(command);
-			g_free(label);
-			g_free(transcript);
-			g_free(expected);
-		}
+	if(!loaded) {
+		loaded = load_xml(self, file, error);
+		if(loaded)
+			write_cache(self, file, priv->played);
 	}
 
-	/* Loop through the item nodes again, adding the children to each parent */
-	for(item = top->children; item; item = item->next) {
-		if(!xmlStrEqual(item->name, (xmlChar *)"item"))
-			continue;
-		gchar *id = get_property_from_node(item, "nodeId");
-		I7Node *parent_node = g_hash_table_lookup(nodetable, id);
-		xmlNode *child;
-		for(child = item->children; child; child = child->next) {
-			if(!xmlStrEqual(child->name, (xmlChar *)"children"))
-				continue;
-			xmlNode *list;
-			for(list = child->children; list; list = list->next) {
-				if(!xmlStrEqual(list->name, (xmlChar *)"child"))
-					continue;
-				gchar *child_id = get_property_from_node(list, "nodeId");
-				g_node_append(parent_node->gnode, I7_NODE(g_hash_table_lookup(nodetable, child_id))->gnode);
-				g_free(child_id);
-			}
+	priv->pending_signals = (priv->pending_signals & ~(1 << MODIFIED)) | outer_modified;
+	i7_skein_end_changes(self);
+
+	skein_stats_stop(SKEIN_STATS_LOAD, start);
+	if(loaded) {
+		skein_stats_count(SKEIN_STATS_KNOTS_LOADED, g_node_n_nodes(priv->root->gnode, G_TRAVERSE_ALL));
+		if(skein_stats_get_logging()) {
+			I7SkeinShape shape;
+			i7_skein_get_shape(self, &shape);
+			g_message("Skein: loaded %u knots, %u deep, at most %u children of one knot, %u blessed, %u differing",
+				shape.n_knots, shape.max_depth, shape.max_fanout, shape.n_blessed, shape.n_differences);
 		}
-		g_free(id);
 	}
+	return loaded;
+}
 
-	/* Discard the current skein and replace with the new */
-	g_node_traverse(priv->root->gnode, G_POST_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)remove_node_from_canvas, self);
-	priv->root = I7_NODE(g_hash_table_lookup(nodetable, root_id));
-	priv->played = NULL;
-	i7_skein_set_played_node(self, I7_NODE(g_hash_table_lookup(nodetable, active_id)));
-	i7_skein_set_current_node(self, priv->root);
-
-	g_signal_emit_by_name(self, "needs-layout");
-	g_signal_emit_by_name(self, "labels-changed");
-	priv->modified = FALSE;
+/* Size at which the save buffer is written out to the file */
+#define SAVE_BUFFER_SIZE 65536
 
-	g_free(root_id);
-	g_free(active_id);
-	g_hash_table_destroy(nodetable);
+typedef struct {
+	GOutputStream *stream;
+	GString *buffer;
+	GError **error;
+	gboolean failed;
+} SaveData;
 
+static gboolean
+flush_save_buffer(SaveData *data)
+{
+	if(!g_output_stream_write_all(data->stream, data->buffer->str, data->buffer->len, NULL, NULL, data->error)) {
+		data->failed = TRUE;
+		return FALSE;
+	}
+	g_string_truncate(data->buffer, 0);
 	return TRUE;
-fail:
-	xmlFreeDoc(xmldoc);
-	return FALSE;
 }
 
 static gboolean
-node_write_xml(GNode *gnode, GDataOutputStream *stream)
+node_write_xml(GNode *gnode, SaveData *data)
 {
-	gchar *xml = i7_node_get_xml(I7_NODE(gnode->data));
-	g_data_output_stream_put_string(stream, xml, NULL, NULL);
-	g_free(xml);
-	return FALSE; /* Do not stop the traversal */
+	i7_node_append_xml(I7_NODE(gnode->data), data->buffer);
+	if(data->buffer->len >= SAVE_BUFFER_SIZE)
+		return !flush_save_buffer(data); /* Stop the traversal on error */
+	return FALSE;
 }
 
+/*
+ * i7_skein_save:
+ * @self: the skein
+ * @file: where to save it
+ * @error: return location for an error
+ *
+ * Writes the whole skein to @file and refreshes the binary cache next to it.
+ * Both are complete files after every save, because other Inform IDEs read
+ * Skein.skein; so a save still visits every knot and takes time in proportion
+ * to the size of the skein. Each knot's texts are escaped straight into the
+ * save buffer, and nothing is kept in the knots afterwards. There is no change
+ * journal, so saving does not take constant time.
+ *
+ * Returns: %TRUE if successful.
+ */
 gboolean
 i7_skein_save(I7Skein *self, GFile *file, GError **error)
 {
@@ -913,30 +1662,55 @@ i7_skein_save(I7Skein *self, GFile *file, GError **error)
 	GFileOutputStream *fstream = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
 	if(!fstream)
 		return FALSE;
-	GDataOutputStream *skein_stream = g_data_output_stream_new(G_OUTPUT_STREAM(fstream));
-
-	char *header = g_strdup_printf(
-			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-			"<Skein rootNode=\"%s\" "
-			"xmlns=\"http://www.logicalshift.org.uk/IF/Skein\">\n"
-			"  <generator>Inform 7</generator>\n"
-			"  <activeNode nodeId=\"%s\"/>\n",
-			i7_node_get_unique_id(priv->root),
-			i7_node_get_unique_id(priv->current));
-	if(!g_data_output_stream_put_string(skein_stream, header, NULL, error))
-		return FALSE;
 
-	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)node_write_xml, skein_stream);
-
-	if(!g_data_output_stream_put_string(skein_stream, "</Skein>\n", NULL, error))
+	gint64 start = skein_stats_start();
+
+	/* All the XML goes through one buffer; the knots append their cached XML to
+	 it, and it is written out in large chunks */
+	SaveData data;
+	data.stream = G_OUTPUT_STREAM(fstream);
+	data.buffer = g_string_sized_new(SAVE_BUFFER_SIZE * 2);
+	data.error = error;
+	data.failed = FALSE;
+
+	g_string_append_printf(data.buffer,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<Skein rootNode=\"%s\" "
+		"xmlns=\"http://www.logicalshift.org.uk/IF/Skein\">\n"
+		"  <generator>Inform 7</generator>\n"
+		"  <activeNode nodeId=\"%s\"/>\n",
+		i7_node_get_unique_id(priv->root),
+		i7_node_get_unique_id(priv->current));
+
+	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)node_write_xml, &data);
+
+	if(!data.failed) {
+		g_string_append(data.buffer, "</Skein>\n");
+		flush_save_buffer(&data);
+	}
+	g_string_free(data.buffer, TRUE);
+
+	if(data.failed) {
+		/* Closing with a cancelled cancellable leaves the old file in place */
+		GCancellable *cancellable = g_cancellable_new();
+		g_cancellable_cancel(cancellable);
+		g_output_stream_close(G_OUTPUT_STREAM(fstream), cancellable, NULL);
+		g_object_unref(cancellable);
+		g_object_unref(fstream);
+		skein_stats_stop(SKEIN_STATS_SAVE, start);
 		return FALSE;
+	}
 
-	g_object_unref(skein_stream);
+	gboolean closed = g_output_stream_close(G_OUTPUT_STREAM(fstream), NULL, error);
 	g_object_unref(fstream);
+	if(closed) {
+		priv->modified = FALSE;
+		write_cache(self, file, priv->current);
+		skein_stats_count(SKEIN_STATS_KNOTS_SAVED, g_node_n_nodes(priv->root->gnode, G_TRAVERSE_ALL));
+	}
 
-	priv->modified = FALSE;
-
-	return TRUE;
+	skein_stats_stop(SKEIN_STATS_SAVE, start);
+	return closed;
 }
 
 /* Imports a list of commands into the Skein */
@@ -956,6 +1730,8 @@ i7_skein_import(I7Skein *self, GFile *file, GError **error)
 		return FALSE;
 	GDataInputStream *stream = g_data_input_stream_new(G_INPUT_STREAM(istream));
 
+	i7_skein_begin_changes(self);
+
 	gchar *line;
 	while((line = g_data_input_stream_read_line(stream, NULL, NULL, error))) {
 		g_strstrip(line);
@@ -966,7 +1742,8 @@ i7_skein_import(I7Skein *self, GFile *file, GError **error)
 				/* Wasn't found, create new node */
 				newnode = i7_node_new(node_command, "", "", "", FALSE, FALSE, FALSE, 0, GOO_CANVAS_ITEM_MODEL(self));
 				node_listen(self, newnode);
-				g_node_append(node->gnode, newnode->gnode);
+				i7_node_append_child(node, newnode);
+				i7_node_invalidate_layout(newnode);
 				added = TRUE;
 			}
 			g_free(node_command);
@@ -979,15 +1756,18 @@ i7_skein_import(I7Skein *self, GFile *file, GError **error)
 		goto fail;
 
 	if(added) {
-		g_signal_emit_by_name(self, "needs-layout");
-		g_signal_emit_by_name(self, "modified");
+		thread_update(self, TRUE, FALSE);
+		emit_signal(self, NEEDS_LAYOUT);
+		emit_signal(self, MODIFIED);
 	}
 
+	i7_skein_end_changes(self);
 	g_object_unref(stream);
 	g_object_unref(istream);
 	return TRUE;
 
 fail:
+	i7_skein_end_changes(self);
 	g_object_unref(stream);
 	g_object_unref(istream);
 	return FALSE;
@@ -1013,56 +1793,93 @@ rgba_from_gdk_color(GdkColor *color)
 		| 0xFF;
 }
 
+/*
+ * i7_skein_calculate_tree_line:
+ * @self: the skein
+ * @node: a knot which is not the root
+ * @points: a #GooCanvasPoints with room for 4 points
+ *
+ * Fills in @points with the line connecting @node to its parent.
+ *
+ * Returns: %TRUE if @points changed, %FALSE if it already held that line.
+ */
+gboolean
+i7_skein_calculate_tree_line(I7Skein *self, I7Node *node, GooCanvasPoints *points)
+{
+	I7_SKEIN_USE_PRIVATE;
+
+	gdouble nodex = i7_node_get_x(node);
+	gdouble destx = i7_node_get_x(I7_NODE(node->gnode->parent->data));
+	gdouble nodey = (gdouble)(g_node_depth(node->gnode) - 1.0) * priv->vspacing;
+	gdouble desty = nodey - priv->vspacing;
+
+	if(points->coords[0] == destx && points->coords[4] == nodex && points->coords[7] == nodey)
+		return FALSE;
+
+	points->coords[0] = points->coords[2] = destx;
+	points->coords[1] = desty;
+	points->coords[3] = desty + 0.2 * priv->vspacing;
+	points->coords[4] = points->coords[6] = nodex;
+	points->coords[5] = nodey - 0.2 * priv->vspacing;
+	points->coords[7] = nodey;
+	return TRUE;
+}
+
+/*
+ * i7_skein_style_tree_line:
+ * @self: the skein
+ * @node: a knot which is not the root
+ * @line: a #GooCanvasPolyline or #GooCanvasPolylineModel
+ *
+ * Styles the line connecting @node to its parent according to whether @node is
+ * locked and whether it is in the current thread.
+ */
+void
+i7_skein_style_tree_line(I7Skein *self, I7Node *node, gpointer line)
+{
+	I7_SKEIN_USE_PRIVATE;
+
+	gboolean in_current_thread = i7_skein_is_node_in_current_thread(self, node);
+
+	if(i7_node_get_locked(node))
+		g_object_set(line,
+			"stroke-color-rgba", rgba_from_gdk_color(&priv->locked),
+			"line-dash", priv->locked_dash,
+			"line-width", in_current_thread? 4.0 : 1.5,
+			NULL);
+	else
+		g_object_set(line,
+			"stroke-color-rgba", rgba_from_gdk_color(&priv->unlocked),
+			"line-dash", priv->unlocked_dash,
+			"line-width", in_current_thread? 4.0 : 1.5,
+			NULL);
+}
+
 static void
 draw_tree(I7Skein *self, I7Node *node, GooCanvas *canvas)
 {
-	I7_SKEIN_USE_PRIVATE;
+	i7_node_create_items(node);
 
 	/* Draw a line from the node to its parent */
 	if(node->gnode->parent) {
-		/* Calculate the coordinates */
-		gdouble nodex = i7_node_get_x(node);
-		gdouble destx = i7_node_get_x(I7_NODE(node->gnode->parent->data));
-		gdouble nodey = (gdouble)(g_node_depth(node->gnode) - 1.0) * priv->vspacing;
-		gdouble desty = nodey - priv->vspacing;
-
-		if(!node->tree_item)
+		if(!node->tree_item) {
 			node->tree_item = goo_canvas_polyline_model_new(GOO_CANVAS_ITEM_MODEL(self), FALSE, 0, NULL);
+			node->tree_points = goo_canvas_points_new(4);
+		}
 
-		if(node->tree_points->coords[0] != destx || node->tree_points->coords[4] != nodex) {
-			node->tree_points->coords[0] = node->tree_points->coords[2] = destx;
-			node->tree_points->coords[1] = desty;
-			node->tree_points->coords[3] = desty + 0.2 * priv->vspacing;
-			node->tree_points->coords[4] = node->tree_points->coords[6] = nodex;
-			node->tree_points->coords[5] = nodey - 0.2 * priv->vspacing;
-			node->tree_points->coords[7] = nodey;
+		if(i7_skein_calculate_tree_line(self, node, node->tree_points))
 			g_object_set(node->tree_item, "points", node->tree_points, NULL);
-		}
 
-		gboolean in_current_thread = i7_skein_is_node_in_current_thread(self, node);
-		
-		if(i7_node_get_locked(node))
-			g_object_set(node->tree_item,
-				"stroke-color-rgba", rgba_from_gdk_color(&priv->locked),
-			    "line-dash", priv->locked_dash,
-				"line-width", in_current_thread? 4.0 : 1.5,
-				NULL);
-		else
-			g_object_set(node->tree_item,
-				"stroke-color-rgba", rgba_from_gdk_color(&priv->unlocked),
-				"line-dash", priv->unlocked_dash,
-				"line-width", in_current_thread? 4.0 : 1.5,
-				NULL);
+		i7_skein_style_tree_line(self, node, node->tree_item);
 
 		goo_canvas_item_model_lower(node->tree_item, NULL); /* put at bottom */
+		skein_stats_count(SKEIN_STATS_LINES_DRAWN, 1);
 	}
 
 	/* Draw the children's lines to this node */
-	int i;
-	for(i = 0; i < g_node_n_children(node->gnode); i++) {
-		I7Node *child = g_node_nth_child(node->gnode, i)->data;
-		draw_tree(self, child, canvas);
-	}
+	GNode *child;
+	for(child = node->gnode->children; child; child = child->next)
+		draw_tree(self, child->data, canvas);
 }
 
 static void
@@ -1073,10 +1890,14 @@ draw_intern(I7Skein *self, GooCanvas *canvas)
 	if(GPOINTER_TO_INT(g_object_get_data(G_OBJECT(canvas), "waiting-for-draw")) == 0)
 		return;
 
+	gint64 start = skein_stats_start();
 	i7_node_layout(priv->root, GOO_CANVAS_ITEM_MODEL(self), canvas, 0.0);
-
 	gdouble treewidth = i7_node_get_tree_width(priv->root, GOO_CANVAS_ITEM_MODEL(self), canvas);
+	skein_stats_stop(SKEIN_STATS_LAYOUT, start);
+
+	start = skein_stats_start();
 	draw_tree(self, priv->root, canvas);
+	skein_stats_stop(SKEIN_STATS_DRAW_TREE, start);
 
 	goo_canvas_set_bounds(canvas,
 		-treewidth * 0.5 - priv->hspacing, -(priv->vspacing) * 0.5,
@@ -1121,43 +1942,6 @@ i7_skein_schedule_draw(I7Skein *self, GooCanvas *canvas)
 	g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, (GSourceFunc)idle_draw, draw_data, (GDestroyNotify)destroy_draw_data);
 }
 
-/* Remove all the rows from the tree model, in preparation for a complicated
- * modification */
-static void
-remove_all_from_model(I7Skein *self)
-{
-	int nrows = gtk_tree_model_iter_n_children(GTK_TREE_MODEL(self), NULL);
-	int count;
-	for(count = nrows - 1; count >= 0; count--) {
-		GtkTreePath *path = gtk_tree_path_new_from_indices(count, -1);
-		gtk_tree_model_row_deleted(GTK_TREE_MODEL(self), path);
-		gtk_tree_path_free(path);
-	}
-}
-
-/* Put all the rows of the current thread back in the tree model, after
- * finishing a complicated modification */
-static void
-reinstate_all_in_model(I7Skein *self)
-{
-	I7_SKEIN_USE_PRIVATE;
-	I7Node *last = i7_skein_get_thread_bottom(self, priv->current);
-	GNode *gnode = priv->root->gnode;
-	while(gnode) {
-		int depth = g_node_depth(gnode) - 1;
-		GtkTreePath *path = gtk_tree_path_new_from_indices(depth, -1);
-		GtkTreeIter iter = { priv->stamp, gnode->data };
-		gtk_tree_model_row_inserted(GTK_TREE_MODEL(self), path, &iter);
-		gtk_tree_path_free(path);
-
-		/* Advance to the next node in the thread */
-		for(gnode = gnode->children; gnode; gnode = gnode->next) {
-			if(i7_node_in_thread(gnode->data, last))
-				break;
-		}
-	}
-}
-
 /* Add a new node with the given command, under the played node. Unless there
  is already a node with that command. In either case, return a pointer to that
  node. */
@@ -1175,12 +1959,16 @@ i7_skein_new_command(I7Skein *self, const gchar *command)
 		node = i7_node_new(node_command, "", "", "", TRUE, FALSE, FALSE, 0, GOO_CANVAS_ITEM_MODEL(self));
 		node_listen(self, node);
 
-		gboolean remove = i7_skein_is_node_in_current_thread(self, priv->played);
-		if(remove)
-		   remove_all_from_model(self);
-		g_node_append(priv->played->gnode, node->gnode);
-		if(remove)
-			reinstate_all_in_model(self);
+		i7_node_append_child(priv->played, node);
+		i7_node_invalidate_layout(node);
+		/* In the usual case of playing on from the end of the thread, the
+		 new knot just becomes the last row */
+		if(priv->thread->len > 0
+			&& g_ptr_array_index(priv->thread, priv->thread->len - 1) == priv->played
+			&& g_node_n_children(priv->played->gnode) == 1)
+			thread_push(self, node);
+		else
+			thread_update(self, TRUE, FALSE);
 		node_added = TRUE;
 	}
 	g_free(node_command);
@@ -1191,9 +1979,9 @@ i7_skein_new_command(I7Skein *self, const gchar *command)
 
 	/* Send signals */
 	if(node_added)
-		g_signal_emit_by_name(self, "needs-layout");
-	g_signal_emit_by_name(self, "show-node", I7_REASON_COMMAND, node);
-	g_signal_emit_by_name(self, "modified");
+		emit_signal(self, NEEDS_LAYOUT);
+	show_node(self, I7_REASON_COMMAND, node);
+	emit_signal(self, MODIFIED);
 
 	return node;
 }
@@ -1212,10 +2000,8 @@ i7_skein_next_command(I7Skein *self, gchar **command)
 	while(next->gnode->parent != priv->played->gnode)
 		next = next->gnode->parent->data;
 	priv->played = next;
-	gchar *temp = i7_node_get_command(next);
-	*command = g_strcompress(temp);
-	g_free(temp);
-	g_signal_emit_by_name(self, "show-node", I7_REASON_COMMAND, next);
+	*command = g_strcompress(i7_node_peek_command(next));
+	show_node(self, I7_REASON_COMMAND, next);
 	return TRUE;
 }
 
@@ -1231,9 +2017,7 @@ i7_skein_get_commands_to_node(I7Skein *self, I7Node *from_node, I7Node *to_node)
 		while(next->gnode->parent != pointer)
 			next = next->gnode->parent->data;
 		pointer = next->gnode;
-		gchar *skein_command = i7_node_get_command(next);
-		commands = g_slist_prepend(commands, g_strcompress(skein_command));
-		g_free(skein_command);
+		commands = g_slist_prepend(commands, g_strcompress(i7_node_peek_command(next)));
 	}
 	commands = g_slist_reverse(commands);
 	return commands;
@@ -1256,7 +2040,7 @@ i7_skein_update_after_playing(I7Skein *self, const gchar *transcript)
 	i7_node_set_played(priv->played, TRUE);
 	if(strlen(transcript)) {
 		i7_node_set_transcript_text(priv->played, transcript);
-		g_signal_emit_by_name(self, "show-node", I7_REASON_TRANSCRIPT, priv->played);
+		show_node(self, I7_REASON_TRANSCRIPT, priv->played);
 	}
 }
 
@@ -1287,12 +2071,12 @@ i7_skein_add_new(I7Skein *self, I7Node *node)
 	I7Node *newnode = i7_node_new("", "", "", "", FALSE, FALSE, FALSE, 0, GOO_CANVAS_ITEM_MODEL(self));
 	node_listen(self, newnode);
 
-	remove_all_from_model(self);
-	g_node_append(node->gnode, newnode->gnode);
-	reinstate_all_in_model(self);
+	i7_node_append_child(node, newnode);
+	i7_node_invalidate_layout(newnode);
+	thread_update(self, TRUE, FALSE);
 
-	g_signal_emit_by_name(self, "needs-layout");
-	g_signal_emit_by_name(self, "modified");
+	emit_signal(self, NEEDS_LAYOUT);
+	emit_signal(self, MODIFIED);
 
 	return newnode;
 }
@@ -1303,14 +2087,14 @@ i7_skein_add_new_parent(I7Skein *self, I7Node *node)
 	I7Node *newnode = i7_node_new("", "", "", "", FALSE, FALSE, FALSE, 0, GOO_CANVAS_ITEM_MODEL(self));
 	node_listen(self, newnode);
 
-	remove_all_from_model(self);
 	g_node_insert(node->gnode->parent, g_node_child_position(node->gnode->parent, node->gnode), newnode->gnode);
-	g_node_unlink(node->gnode);
-	g_node_append(newnode->gnode, node->gnode);
-	reinstate_all_in_model(self);
+	i7_node_unlink(node);
+	i7_node_append_child(newnode, node);
+	i7_node_invalidate_layout(newnode);
+	thread_update(self, TRUE, FALSE);
 
-	g_signal_emit_by_name(self, "needs-layout");
-	g_signal_emit_by_name(self, "modified");
+	emit_signal(self, NEEDS_LAYOUT);
+	emit_signal(self, MODIFIED);
 
 	return newnode;
 }
@@ -1324,18 +2108,21 @@ i7_skein_remove_all(I7Skein *self, I7Node *node)
 	if(G_NODE_IS_ROOT(node->gnode))
 		return FALSE;
 
+	i7_skein_begin_changes(self);
 	if(i7_node_in_thread(node, priv->played))
 		i7_skein_set_played_node(self, priv->root);
 	if(i7_skein_is_node_in_current_thread(self, node))
 		i7_skein_set_current_node(self, priv->root);
 	
-	remove_all_from_model(self);
-	g_node_unlink(node->gnode);
+	i7_node_invalidate_layout(I7_NODE(node->gnode->parent->data));
+	i7_node_unlink(node);
+	/* Update the rows before the knots are freed */
+	thread_update(self, TRUE, FALSE);
 	g_node_traverse(node->gnode, G_POST_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)remove_node_from_canvas, self);
-	reinstate_all_in_model(self);
 	
-	g_signal_emit_by_name(self, "needs-layout");
-	g_signal_emit_by_name(self, "modified");
+	emit_signal(self, NEEDS_LAYOUT);
+	emit_signal(self, MODIFIED);
+	i7_skein_end_changes(self);
 	return TRUE;
 }
 
@@ -1347,12 +2134,13 @@ i7_skein_remove_single(I7Skein *self, I7Node *node)
 	if(G_NODE_IS_ROOT(node->gnode))
 		return FALSE;
 
+	i7_skein_begin_changes(self);
 	if(i7_node_in_thread(node, priv->played))
 		i7_skein_set_played_node(self, priv->root);
 	if(i7_skein_is_node_in_current_thread(self, node))
 		i7_skein_set_current_node(self, priv->root);
 
-	remove_all_from_model(self);
+	i7_node_invalidate_layout(I7_NODE(node->gnode->parent->data));
 	if(!G_NODE_IS_LEAF(node->gnode)) {
 		int i;
 		for(i = g_node_n_children(node->gnode) - 1; i >= 0; i--) {
@@ -1361,12 +2149,13 @@ i7_skein_remove_single(I7Skein *self, I7Node *node)
 			g_node_insert_after(node->gnode->parent, node->gnode, iter);
 		}
 	}
-	g_node_unlink(node->gnode);
+	i7_node_unlink(node);
+	thread_update(self, TRUE, FALSE);
 	remove_node_from_canvas(node->gnode, self);
-	reinstate_all_in_model(self);
 	
-	g_signal_emit_by_name(self, "needs-layout");
-	g_signal_emit_by_name(self, "modified");
+	emit_signal(self, NEEDS_LAYOUT);
+	emit_signal(self, MODIFIED);
+	i7_skein_end_changes(self);
 	return TRUE;
 }
 
@@ -1374,8 +2163,10 @@ void
 i7_skein_lock(I7Skein *self, I7Node *node)
 {
 	GNode *iter;
+	i7_skein_begin_changes(self);
 	for(iter = node->gnode; iter; iter = iter->parent)
 		i7_node_set_locked(I7_NODE(iter->data), TRUE);
+	i7_skein_end_changes(self);
 
 	/* TODO change thread colors */
 	I7_SKEIN_PRIVATE(self)->modified = TRUE;
@@ -1395,76 +2186,177 @@ i7_skein_unlock_recurse(I7Skein *self, I7Node *node)
 void
 i7_skein_unlock(I7Skein *self, I7Node *node)
 {
+	i7_skein_begin_changes(self);
 	i7_skein_unlock_recurse(self, node);
-	g_signal_emit_by_name(self, "modified");
+	emit_signal(self, MODIFIED);
+	i7_skein_end_changes(self);
 }
 
-static void
-i7_skein_trim_recurse(I7Skein *self, I7Node *node, gint min_score)
+/* Returns the @k-th largest of @n values, counting from 0; rearranges @values.
+ Hoare's selection algorithm, so linear time on average. */
+static gint
+select_nth_largest(gint *values, guint n, guint k)
 {
-	I7_SKEIN_USE_PRIVATE;
-
-	int i = 0;
-	while(i < g_node_n_children(node->gnode)) {
-		I7Node *child = g_node_nth_child(node->gnode, i)->data;
-		if(i7_node_get_locked(child) || i7_node_get_score(child) > min_score) {
-			i7_skein_trim_recurse(self, child, min_score);
-			i++;
-		} else {
-			if(i7_skein_is_node_in_current_thread(self, child)) {
-				i7_skein_set_current_node(self, priv->root);
-				i7_skein_set_played_node(self, priv->root);
-			}
+	guint left = 0, right = n - 1;
 
-			if(i7_skein_remove_all(self, child) == FALSE)
+	while(left < right) {
+		gint pivot = values[left + (right - left) / 2];
+		guint i = left, j = right;
+		while(i <= j) {
+			while(values[i] > pivot)
+				i++;
+			while(values[j] < pivot)
+				j--;
+			if(i <= j) {
+				gint temp = values[i];
+				values[i] = values[j];
+				values[j] = temp;
 				i++;
+				if(j == 0)
+					break;
+				j--;
+			}
 		}
+		if(k <= j)
+			right = j;
+		else if(k >= i)
+			left = i;
+		else
+			break;
 	}
+	return values[k];
 }
 
-static gint
-int_compare_reversed(gconstpointer a, gconstpointer b)
+static gboolean
+collect_score(GNode *gnode, GHashTable *scores)
 {
-	return GPOINTER_TO_INT(a) < GPOINTER_TO_INT(b);
+	gint score = i7_node_get_score(I7_NODE(gnode->data));
+	g_hash_table_insert(scores, GINT_TO_POINTER(score), GINT_TO_POINTER(score));
+	return FALSE; /* don't stop the traversal */
 }
 
-static gboolean
-look_for_scores(GNode *gnode, GList **listptr)
+/* Returns the @max_temps-th highest distinct score in the skein, counting from
+ 0, or 0 if there aren't that many */
+static gint
+get_trim_threshold(I7Skein *self, gint max_temps)
 {
-	gint score = i7_node_get_score(I7_NODE(gnode->data));
+	I7_SKEIN_USE_PRIVATE;
 
-	if(g_list_index(*listptr, GINT_TO_POINTER(score)) == -1)
-		*listptr = g_list_insert_sorted(*listptr, GINT_TO_POINTER(score), int_compare_reversed);
+	GHashTable *scores = g_hash_table_new(NULL, NULL);
+	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)collect_score, scores);
+
+	gint min_score = 0;
+	guint n_scores = g_hash_table_size(scores);
+	if(max_temps >= 0 && (guint)max_temps < n_scores) {
+		gint *values = g_new(gint, n_scores);
+		GHashTableIter iter;
+		gpointer key;
+		guint count = 0;
+		g_hash_table_iter_init(&iter, scores);
+		while(g_hash_table_iter_next(&iter, &key, NULL))
+			values[count++] = GPOINTER_TO_INT(key);
+		min_score = select_nth_largest(values, n_scores, max_temps);
+		g_free(values);
+	}
+	g_hash_table_destroy(scores);
+	return min_score;
+}
 
-	return FALSE; /* don't stop the traversal */
+/* Collects the unlocked knots below @node scoring @min_score or less; the
+ subtrees below them are not searched, since they will go too */
+static void
+collect_doomed(I7Node *node, gint min_score, GPtrArray *doomed)
+{
+	GNode *child;
+	for(child = node->gnode->children; child; child = child->next) {
+		I7Node *child_node = child->data;
+		if(i7_node_get_locked(child_node) || i7_node_get_score(child_node) > min_score)
+			collect_doomed(child_node, min_score, doomed);
+		else
+			g_ptr_array_add(doomed, child_node);
+	}
 }
 
-/*static void
-print_score(gpointer item, gpointer data)
+static gboolean
+forget_canvas_items(GNode *gnode, GHashTable *items)
 {
-	g_print("%d ", GPOINTER_TO_INT(item));
-}*/
+	I7Node *node = gnode->data;
+	I7Skein *skein = I7_SKEIN(goo_canvas_item_model_get_parent(GOO_CANVAS_ITEM_MODEL(node)));
+	forget_node(skein, node);
+	g_hash_table_insert(items, node, node);
+	if(node->tree_item)
+		g_hash_table_insert(items, node->tree_item, node->tree_item);
+	return FALSE; /* don't stop the traversal */
+}
 
-void
-i7_skein_trim(I7Skein *self, I7Node *node, gint max_temps)
+/* Removes the knots in @doomed and everything below them from the skein all at
+ once, instead of one by one with i7_skein_remove_all() */
+static void
+remove_subtrees(I7Skein *self, GPtrArray *doomed)
 {
 	I7_SKEIN_USE_PRIVATE;
+	guint count;
+	gboolean current_removed = FALSE, played_removed = FALSE;
 
-	GList *scores_in_use = NULL;
-	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)look_for_scores, &scores_in_use);
+	for(count = 0; count < doomed->len; count++) {
+		I7Node *node = g_ptr_array_index(doomed, count);
+		current_removed = current_removed || i7_skein_is_node_in_current_thread(self, node);
+		played_removed = played_removed || i7_node_in_thread(node, priv->played);
+	}
+	if(current_removed)
+		i7_skein_set_current_node(self, priv->root);
+	if(current_removed || played_removed)
+		i7_skein_set_played_node(self, priv->root);
 
-	/*g_print("Scores in use: ");
-	g_list_foreach(scores_in_use, print_score, NULL);
-	g_print("\n");*/
+	for(count = 0; count < doomed->len; count++) {
+		I7Node *node = g_ptr_array_index(doomed, count);
+		i7_node_invalidate_layout(I7_NODE(node->gnode->parent->data));
+		i7_node_unlink(node);
+	}
+	/* Update the rows before the knots are freed */
+	thread_update(self, TRUE, FALSE);
+
+	/* Take all the canvas items out in one pass over the skein's children,
+	 rather than looking up each one's position separately */
+	GHashTable *items = g_hash_table_new(NULL, NULL);
+	for(count = 0; count < doomed->len; count++) {
+		I7Node *node = g_ptr_array_index(doomed, count);
+		g_node_traverse(node->gnode, G_POST_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)forget_canvas_items, items);
+	}
+	int child_num;
+	for(child_num = goo_canvas_item_model_get_n_children(GOO_CANVAS_ITEM_MODEL(self)) - 1; child_num >= 0; child_num--) {
+		GooCanvasItemModel *child = goo_canvas_item_model_get_child(GOO_CANVAS_ITEM_MODEL(self), child_num);
+		if(g_hash_table_lookup(items, child))
+			goo_canvas_item_model_remove_child(GOO_CANVAS_ITEM_MODEL(self), child_num);
+	}
+	g_hash_table_destroy(items);
+}
 
+/*
+ * i7_skein_trim:
+ * @self: the skein
+ * @node: the knot below which to trim
+ * @max_temps: how many of the highest scores to keep
+ *
+ * Removes all the unlocked knots below @node, and the knots below them, except
+ * those whose score is one of the @max_temps highest scores in the skein.
+ */
+void
+i7_skein_trim(I7Skein *self, I7Node *node, gint max_temps)
+{
 	/* Keep only the highest @max_temps scores (and those that are locked, of course) */
-	gint min_score = GPOINTER_TO_INT(g_list_nth_data(scores_in_use, max_temps));
-	/*g_print("Min score: %d\n", min_score);*/
-	g_list_free(scores_in_use);
+	gint min_score = get_trim_threshold(self, max_temps);
 
-	i7_skein_trim_recurse(self, node, min_score);
-	g_signal_emit_by_name(self, "needs-layout");
-	g_signal_emit_by_name(self, "modified");
+	i7_skein_begin_changes(self);
+	GPtrArray *doomed = g_ptr_array_new();
+	collect_doomed(node, min_score, doomed);
+	if(doomed->len > 0)
+		remove_subtrees(self, doomed);
+	g_ptr_array_free(doomed, TRUE);
+
+	emit_signal(self, NEEDS_LAYOUT);
+	emit_signal(self, MODIFIED);
+	i7_skein_end_changes(self);
 }
 
 static void
@@ -1492,6 +2384,39 @@ i7_skein_get_labels(I7Skein *self)
 	return labels;
 }
 
+/*
+ * i7_skein_search:
+ * @self: the skein
+ * @phrase: text to look for
+ *
+ * Finds the knots whose command, label, transcript or expected text contains
+ * @phrase, ignoring case. The words of @phrase must appear as whole words, one
+ * after the other, in one of those texts.
+ * The first search builds an index of all the words in the skein, which is kept
+ * up to date from then on, so that searches don't have to look at every knot.
+ *
+ * Returns: (transfer container): a list of the knots, in the order they come
+ * in the skein. Free with g_slist_free().
+ */
+GSList *
+i7_skein_search(I7Skein *self, const char *phrase)
+{
+	I7_SKEIN_USE_PRIVATE;
+
+	if(priv->search_index == NULL) {
+		priv->search_index = skein_index_new();
+		g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)index_node, self);
+	}
+
+	GList *found = skein_index_lookup(priv->search_index, phrase), *iter;
+	GSList *retval = NULL;
+	for(iter = found; iter; iter = g_list_next(iter))
+		retval = g_slist_prepend(retval, iter->data);
+	g_list_free(found);
+
+	return g_slist_sort_with_data(retval, (GCompareDataFunc)compare_skein_order, NULL);
+}
+
 static void
 free_node_label(I7SkeinNodeLabel *label)
 {
@@ -1538,10 +2463,12 @@ void
 i7_skein_bless(I7Skein *self, I7Node *node, gboolean all)
 {
 	GNode *iter;
+	i7_skein_begin_changes(self);
 	for(iter = node->gnode; iter; iter = all? iter->parent : NULL)
 		i7_node_bless(I7_NODE(iter->data));
 
-	g_signal_emit_by_name(self, "modified");
+	emit_signal(self, MODIFIED);
+	i7_skein_end_changes(self);
 }
 
 gboolean
@@ -1638,6 +2565,84 @@ i7_skein_get_modified(I7Skein *self)
 	return priv->modified;
 }
 
+/*
+ * i7_skein_begin_changes:
+ * @self: the skein
+ *
+ * Starts a batch of changes. Until the matching i7_skein_end_changes(), the
+ * skein holds back #I7Skein::needs-layout, #I7Skein::labels-changed,
+ * #I7Skein::show-node, #I7Skein::modified, property notifications and
+ * row-changed on the Transcript's rows, and emits each of them only once at
+ * the end, so that a change to many knots costs one layout instead of one for
+ * each knot. Batches can be nested.
+ */
+void
+i7_skein_begin_changes(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	priv->batch_depth++;
+	g_object_freeze_notify(G_OBJECT(self));
+}
+
+/*
+ * i7_skein_end_changes:
+ * @self: the skein
+ *
+ * Ends a batch of changes started with i7_skein_begin_changes(). At the end of
+ * the outermost batch, the signals that were held back are emitted.
+ */
+void
+i7_skein_end_changes(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	g_return_if_fail(priv->batch_depth > 0);
+	if(--priv->batch_depth == 0)
+		flush_batch(self);
+	g_object_thaw_notify(G_OBJECT(self));
+}
+
+/*
+ * i7_skein_begin_background_diffs:
+ * @self: the skein
+ *
+ * From now on, knots compare their transcript text with their expected text
+ * in worker threads instead of right away, and get their match type and
+ * differs badge in batches from the main loop. Use this while replaying many
+ * threads at once, and call i7_skein_end_background_diffs() afterwards.
+ */
+void
+i7_skein_begin_background_diffs(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	if(priv->diff_pool == NULL)
+		priv->diff_pool = diff_pool_new();
+	priv->background_diffs = TRUE;
+}
+
+/*
+ * i7_skein_end_background_diffs:
+ * @self: the skein
+ *
+ * Goes back to comparing transcripts right away. Comparisons that are still
+ * in progress are finished and delivered in the background, unless the skein
+ * is freed first.
+ */
+void
+i7_skein_end_background_diffs(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	priv->background_diffs = FALSE;
+}
+
+/* Returns the pool that knots should queue their comparisons in, or NULL if
+ they should compare their transcripts right away */
+DiffPool *
+i7_skein_get_diff_pool(I7Skein *self)
+{
+	I7_SKEIN_USE_PRIVATE;
+	return priv->background_diffs? priv->diff_pool : NULL;
+}
+
 static gboolean
 invalidate(GNode *gnode)
 {
@@ -1651,16 +2656,42 @@ i7_skein_set_font(I7Skein *self, PangoFontDescription *font)
 	I7_SKEIN_USE_PRIVATE;
 	g_object_set(self, "font-desc", font, NULL);
 	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)invalidate, NULL);
-	g_signal_emit_by_name(self, "needs-layout");
+	emit_signal(self, NEEDS_LAYOUT);
 }
 
 /* DEBUG */
+static gboolean
+measure_shape(GNode *gnode, I7SkeinShape *shape)
+{
+	shape->n_knots++;
+	shape->max_fanout = MAX(shape->max_fanout, g_node_n_children(gnode));
+	if(i7_node_get_blessed(I7_NODE(gnode->data)))
+		shape->n_blessed++;
+	return FALSE;
+}
+
+/*
+ * i7_skein_get_shape:
+ * @self: the skein
+ * @shape: (out): return location for the statistics
+ *
+ * Measures the size of the skein, for finding out which skeins are big enough
+ * to slow things down.
+ */
+void
+i7_skein_get_shape(I7Skein *self, I7SkeinShape *shape)
+{
+	I7_SKEIN_USE_PRIVATE;
+	memset(shape, 0, sizeof(I7SkeinShape));
+	g_node_traverse(priv->root->gnode, G_PRE_ORDER, G_TRAVERSE_ALL, -1, (GNodeTraverseFunc)measure_shape, shape);
+	shape->max_depth = g_node_max_height(priv->root->gnode) - 1;
+	shape->n_differences = g_sequence_get_length(priv->differences);
+}
+
 static void
 i7_skein_node_dump(I7Node *node)
 {
-	gchar *command = i7_node_get_command(node);
-	g_printerr("(%s)", command);
-	g_free(command);
+	g_printerr("(%s)", i7_node_peek_command(node));
 }
 
 static void
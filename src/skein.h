@@ -23,6 +23,7 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <goocanvas.h>
 #include <cairo.h>
+#include "diff-pool.h"
 #include "node.h"
 
 typedef enum {
@@ -39,6 +40,7 @@ enum {
 	I7_SKEIN_COLUMN_CURRENT,
 	I7_SKEIN_COLUMN_PLAYED,
 	I7_SKEIN_COLUMN_CHANGED,
+	I7_SKEIN_COLUMN_TEXT_VERSION,
 	I7_SKEIN_COLUMN_NODE_PTR,
 	I7_SKEIN_NUM_COLUMNS
 };
@@ -57,6 +59,15 @@ typedef struct {
 	I7Node *node;
 } I7SkeinNodeLabel;
 
+/* Statistics about the shape of a skein */
+typedef struct {
+	guint n_knots;
+	guint max_depth; /* Commands in the longest thread */
+	guint max_fanout; /* Children of the knot with the most children */
+	guint n_blessed;
+	guint n_differences;
+} I7SkeinShape;
+
 typedef struct _I7SkeinClass I7SkeinClass;
 typedef struct _I7Skein I7Skein;
 
@@ -90,11 +101,16 @@ GQuark i7_skein_error_quark(void);
 GType i7_skein_get_type(void) G_GNUC_CONST;
 I7Skein *i7_skein_new(void);
 void i7_skein_free_node_label_list(GSList *labels);
+GSList *i7_skein_search(I7Skein *self, const char *phrase);
 
 I7Node *i7_skein_get_root_node(I7Skein *self);
 I7Node *i7_skein_get_current_node(I7Skein *self);
 void i7_skein_set_current_node(I7Skein *self, I7Node *node);
 gboolean i7_skein_is_node_in_current_thread(I7Skein *self, I7Node *node);
+gboolean i7_skein_get_iter_for_node(I7Skein *self, I7Node *node, GtkTreeIter *iter);
+guint i7_skein_get_n_differences(I7Skein *self);
+I7Node *i7_skein_get_next_difference(I7Skein *self, I7Node *node, gboolean current_thread_only);
+I7Node *i7_skein_get_previous_difference(I7Skein *self, I7Node *node, gboolean current_thread_only);
 I7Node *i7_skein_get_played_node(I7Skein *self);
 gboolean i7_skein_load(I7Skein *self, GFile *file, GError **error);
 gboolean i7_skein_save(I7Skein *self, GFile *file, GError **error);
@@ -102,6 +118,8 @@ gboolean i7_skein_import(I7Skein *self, GFile *file, GError **error);
 void i7_skein_reset(I7Skein *self, gboolean current);
 void i7_skein_draw(I7Skein *self, GooCanvas *canvas);
 void i7_skein_schedule_draw(I7Skein *self, GooCanvas *canvas);
+gboolean i7_skein_calculate_tree_line(I7Skein *self, I7Node *node, GooCanvasPoints *points);
+void i7_skein_style_tree_line(I7Skein *self, I7Node *node, gpointer line);
 I7Node *i7_skein_new_command(I7Skein *self, const gchar *command);
 gboolean i7_skein_next_command(I7Skein *self, gchar **command);
 GSList *i7_skein_get_commands(I7Skein *self);
@@ -123,9 +141,15 @@ I7Node *i7_skein_get_thread_top(I7Skein *self, I7Node *node);
 I7Node *i7_skein_get_thread_bottom(I7Skein *self, I7Node *node);
 GSList *i7_skein_get_blessed_thread_ends(I7Skein *self);
 gboolean i7_skein_get_modified(I7Skein *self);
+void i7_skein_begin_changes(I7Skein *self);
+void i7_skein_end_changes(I7Skein *self);
 void i7_skein_set_font(I7Skein *self, PangoFontDescription *font);
+void i7_skein_begin_background_diffs(I7Skein *self);
+void i7_skein_end_background_diffs(I7Skein *self);
+DiffPool *i7_skein_get_diff_pool(I7Skein *self);
 
 /* DEBUG */
+void i7_skein_get_shape(I7Skein *self, I7SkeinShape *shape);
 void i7_skein_dump(I7Skein *self);
 
 G_END_DECLS
@@ -0,0 +1,318 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* i7-skein-replay: replays every blessed thread of a project's skein without
+ a display, and writes a JUnit-style XML report of which knots' transcripts
+ match their expected text. Exits with status 0 if they all do, 1 if any
+ don't, and 2 if the replay couldn't be done at all. */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <libxml/xmlwriter.h>
+#include "node.h"
+#include "skein.h"
+#include "skein-replay.h"
+
+/* Compiled stories that the IDE may have left in the Build folder */
+static const char * const story_file_names[] = {
+	"output.ulx", "output.z8", "output.z5", "output.z6",
+	"output.gblorb", "output.zblorb", NULL
+};
+
+typedef struct {
+	char *name; /* The commands leading to the knot */
+	I7NodeMatchType match;
+	char *expected;
+	char *actual;
+	char *error; /* Why the thread couldn't be played, or NULL */
+} KnotResult;
+
+static void
+knot_result_free(KnotResult *result)
+{
+	g_free(result->name);
+	g_free(result->expected);
+	g_free(result->actual);
+	g_free(result->error);
+	g_slice_free(KnotResult, result);
+}
+
+static GFile *
+find_story_file(GFile *project)
+{
+	GFile *build = g_file_get_child(project, "Build");
+	const char * const *name;
+	for(name = story_file_names; *name; name++) {
+		GFile *file = g_file_get_child(build, *name);
+		if(g_file_query_exists(file, NULL)) {
+			g_object_unref(build);
+			return file;
+		}
+		g_object_unref(file);
+	}
+	g_object_unref(build);
+	return NULL;
+}
+
+/* Returns the commands from the start knot to @node, separated by slashes */
+static char *
+get_knot_name(I7Node *node)
+{
+	GString *name = g_string_new("");
+	GNode *gnode;
+	for(gnode = node->gnode; gnode; gnode = gnode->parent) {
+		if(name->len > 0)
+			g_string_prepend(name, " / ");
+		g_string_prepend(name, i7_node_peek_command(I7_NODE(gnode->data)));
+	}
+	return g_string_free(name, FALSE);
+}
+
+/* Called for each knot that was replayed; stores its new transcript, and if
+ it is blessed, whether that matches */
+static void
+on_knot_replayed(I7Node *node, const char *transcript, const GError *error, GPtrArray *results)
+{
+	if(transcript)
+		i7_node_set_transcript_text(node, transcript);
+	if(!i7_node_get_blessed(node))
+		return;
+
+	KnotResult *result = g_slice_new0(KnotResult);
+	result->name = get_knot_name(node);
+	result->expected = i7_node_get_expected_text(node);
+	if(transcript) {
+		result->match = i7_node_get_match_type(node);
+		result->actual = i7_node_get_transcript_text(node);
+	} else {
+		result->match = I7_NODE_CANT_COMPARE;
+		result->error = g_strdup(error->message);
+	}
+	g_ptr_array_add(results, result);
+}
+
+static gboolean
+write_report(GPtrArray *results, const char *suite_name, double elapsed, const char *filename, guint *n_failures, guint *n_errors)
+{
+	guint count;
+	*n_failures = *n_errors = 0;
+	for(count = 0; count < results->len; count++) {
+		KnotResult *result = g_ptr_array_index(results, count);
+		if(result->error)
+			(*n_errors)++;
+		else if(result->match == I7_NODE_NO_MATCH)
+			(*n_failures)++;
+	}
+
+	xmlTextWriterPtr writer = xmlNewTextWriterFilename(filename, 0);
+	if(writer == NULL)
+		return FALSE;
+	xmlTextWriterSetIndent(writer, 1);
+	xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL);
+	xmlTextWriterStartElement(writer, BAD_CAST "testsuites");
+	xmlTextWriterStartElement(writer, BAD_CAST "testsuite");
+	xmlTextWriterWriteAttribute(writer, BAD_CAST "name", BAD_CAST suite_name);
+	xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "tests", "%u", results->len);
+	xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "failures", "%u", *n_failures);
+	xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "errors", "%u", *n_errors);
+	xmlTextWriterWriteFormatAttribute(writer, BAD_CAST "time", "%.3f", elapsed);
+
+	for(count = 0; count < results->len; count++) {
+		KnotResult *result = g_ptr_array_index(results, count);
+		xmlTextWriterStartElement(writer, BAD_CAST "testcase");
+		xmlTextWriterWriteAttribute(writer, BAD_CAST "classname", BAD_CAST "skein");
+		xmlTextWriterWriteAttribute(writer, BAD_CAST "name", BAD_CAST result->name);
+		if(result->error) {
+			xmlTextWriterStartElement(writer, BAD_CAST "error");
+			xmlTextWriterWriteAttribute(writer, BAD_CAST "type", BAD_CAST "interpreter");
+			xmlTextWriterWriteAttribute(writer, BAD_CAST "message", BAD_CAST result->error);
+			xmlTextWriterEndElement(writer);
+		} else if(result->match == I7_NODE_NO_MATCH) {
+			xmlTextWriterStartElement(writer, BAD_CAST "failure");
+			xmlTextWriterWriteAttribute(writer, BAD_CAST "type", BAD_CAST "no-match");
+			xmlTextWriterWriteAttribute(writer, BAD_CAST "message", BAD_CAST "Transcript differs from the expected text");
+			xmlTextWriterWriteFormatString(writer, "Expected:\n%s\n\nActual:\n%s\n", result->expected, result->actual);
+			xmlTextWriterEndElement(writer);
+		} else if(result->match == I7_NODE_NEAR_MATCH) {
+			/* Passes, but note that the whitespace differs */
+			xmlTextWriterWriteElement(writer, BAD_CAST "system-out", BAD_CAST "Transcript differs from the expected text only in whitespace");
+		}
+		xmlTextWriterEndElement(writer);
+	}
+
+	xmlTextWriterEndDocument(writer);
+	xmlFreeTextWriter(writer);
+	return TRUE;
+}
+
+int
+main(int argc, char *argv[])
+{
+#ifdef ENABLE_NLS
+	bindtextdomain(GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
+	bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
+	textdomain(GETTEXT_PACKAGE);
+#endif
+
+	GError *error = NULL;
+
+	/* Set up the command-line options */
+	char *story_filename = NULL, *interpreter = NULL, *prompt = NULL;
+	char *report_filename = NULL;
+	int timeout = 60, jobs = 0;
+	gboolean save = FALSE, no_snapshots = FALSE;
+	char **remaining_args = NULL;
+	GOptionEntry entries[] = {
+		{ "story", 's', 0, G_OPTION_ARG_FILENAME, &story_filename,
+		  N_("Compiled story to play (default: the one in the project's Build "
+		  "folder)"), N_("FILE") },
+		{ "interpreter", 'i', 0, G_OPTION_ARG_STRING, &interpreter,
+		  N_("Command-line interpreter to play the story with; the story file "
+		  "is added to the end (default: glulxe or dfrotz)"), N_("COMMAND") },
+		{ "prompt", 'p', 0, G_OPTION_ARG_STRING, &prompt,
+		  N_("Text that the game prints when it waits for a command, with C "
+		  "escapes (default: \"\\n>\")"), N_("TEXT") },
+		{ "timeout", 't', 0, G_OPTION_ARG_INT, &timeout,
+		  N_("Give up on a thread after this many seconds, or 0 to wait forever "
+		  "(default: 60)"), N_("SECONDS") },
+		{ "jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+		  N_("Number of interpreters to run at the same time (default: one "
+		  "for each processor)"), N_("N") },
+		{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &report_filename,
+		  N_("Where to write the report (default: standard output)"), N_("FILE") },
+		{ "save", 0, 0, G_OPTION_ARG_NONE, &save,
+		  N_("Save the new transcripts in the skein"), NULL },
+		{ "no-snapshots", 0, 0, G_OPTION_ARG_NONE, &no_snapshots,
+		  N_("Play each branch from the start instead of restoring a game "
+		  "saved where it branches off, for games that can't save"), NULL },
+		{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY,
+		  &remaining_args, "", N_("PROJECT") },
+		{ NULL }
+	};
+	GOptionContext *context = g_option_context_new(
+	/* TRANSLATORS: This is the usage string for the --help message */
+	  _("- Replay a project's skein without a display"));
+	g_option_context_add_main_entries(context, entries, GETTEXT_PACKAGE);
+	if(!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return 2;
+	}
+	if(remaining_args == NULL || remaining_args[1] != NULL || timeout < 0 || jobs < 0) {
+		char *help = g_option_context_get_help(context, TRUE, NULL);
+		g_printerr("%s", help);
+		g_free(help);
+		return 2;
+	}
+	g_option_context_free(context);
+
+#if !GLIB_CHECK_VERSION(2,36,0)
+	g_type_init();
+#endif
+	/* The game may quit before reading all the commands */
+	signal(SIGPIPE, SIG_IGN);
+
+	GFile *project = g_file_new_for_commandline_arg(remaining_args[0]);
+	GFile *skein_file = g_file_get_child(project, "Skein.skein");
+	I7Skein *skein = i7_skein_new();
+	if(!i7_skein_load(skein, skein_file, &error)) {
+		g_printerr(_("Could not load the skein: %s\n"), error->message);
+		return 2;
+	}
+
+	GFile *story_file = story_filename? g_file_new_for_commandline_arg(story_filename) : find_story_file(project);
+	if(story_file == NULL) {
+		g_printerr(_("No compiled story found in the project's Build folder; "
+			"compile it first, or use --story.\n"));
+		return 2;
+	}
+	char *story_path = g_file_get_path(story_file);
+
+	char **interpreter_argv;
+	if(interpreter) {
+		int interpreter_argc;
+		char **parsed_argv;
+		if(!g_shell_parse_argv(interpreter, &interpreter_argc, &parsed_argv, &error)) {
+			g_printerr(_("Could not parse the interpreter command: %s\n"), error->message);
+			return 2;
+		}
+		interpreter_argv = g_new0(char *, interpreter_argc + 2);
+		memcpy(interpreter_argv, parsed_argv, interpreter_argc * sizeof(char *));
+		interpreter_argv[interpreter_argc] = g_strdup(story_path);
+		g_free(parsed_argv); /* The strings now belong to interpreter_argv */
+	} else {
+		interpreter_argv = i7_replay_get_interpreter_command(story_path);
+	}
+
+	char *real_prompt = prompt? g_strcompress(prompt) : g_strdup(I7_REPLAY_DEFAULT_PROMPT);
+	I7ReplayOptions options = { interpreter_argv, real_prompt, timeout, !no_snapshots, jobs };
+
+	/* Play each blessed thread */
+	GPtrArray *results = g_ptr_array_new_with_free_func((GDestroyNotify)knot_result_free);
+	GTimer *timer = g_timer_new();
+	guint commands_typed;
+	GSList *blessed_nodes = i7_skein_get_blessed_thread_ends(skein);
+	if(!i7_replay_skein(skein, blessed_nodes, &options, (I7ReplayKnotFunc)on_knot_replayed, results, &commands_typed, &error)) {
+		g_printerr(_("Could not replay the skein: %s\n"), error->message);
+		return 2;
+	}
+	g_slist_free(blessed_nodes);
+	double elapsed = g_timer_elapsed(timer, NULL);
+	g_timer_destroy(timer);
+
+	/* Write the report */
+	int retval = 0;
+	guint n_failures, n_errors;
+	char *suite_name = g_file_get_basename(project);
+	if(!write_report(results, suite_name, elapsed, report_filename? report_filename : "-", &n_failures, &n_errors)) {
+		g_printerr(_("Could not write the report.\n"));
+		retval = 2;
+	} else if(n_failures > 0 || n_errors > 0) {
+		retval = 1;
+	}
+	g_printerr(_("%u knots checked: %u passed, %u failed, %u could not be played\n"),
+		results->len, results->len - n_failures - n_errors, n_failures, n_errors);
+	g_printerr(_("%u lines typed in %.1f seconds\n"), commands_typed, elapsed);
+
+	if(save && !i7_skein_save(skein, skein_file, &error)) {
+		g_printerr(_("Could not save the skein: %s\n"), error->message);
+		g_clear_error(&error);
+		retval = 2;
+	}
+
+	g_free(suite_name);
+	g_ptr_array_free(results, TRUE);
+	g_free(real_prompt);
+	g_strfreev(interpreter_argv);
+	g_free(story_path);
+	g_object_unref(story_file);
+	g_object_unref(skein);
+	g_object_unref(skein_file);
+	g_object_unref(project);
+	g_free(story_filename);
+	g_free(interpreter);
+	g_free(prompt);
+	g_free(report_filename);
+	g_strfreev(remaining_args);
+	return retval;
+}
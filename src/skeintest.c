@@ -3,6 +3,9 @@
 gcc -o skeintest skeintest.c skein.c node.c `pkg-config --cflags --libs gtk+-2.0 gdk-pixbuf-2.0 libxml-2.0 cairo goocanvas`
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <gtk/gtk.h>
 #include <goocanvas.h>
 #include "skein.h"
@@ -244,6 +247,180 @@ on_node_popup(I7Skein *skein, I7Node *node, I7SkeinView *view)
 	gtk_menu_popup(GTK_MENU(menu), NULL, NULL, NULL, NULL, 3, gtk_get_current_event_time());
 }
 
+/* Build a random skein of @n_knots knots. New knots are mostly added near the
+ most recently added ones, so that the skein has long threads as well as bushy
+ parts, like a real one. */
+static I7Skein *
+build_random_skein(int n_knots)
+{
+	I7Skein *skein = i7_skein_new();
+	GPtrArray *knots = g_ptr_array_sized_new(n_knots);
+	int count;
+
+	g_ptr_array_add(knots, i7_skein_get_root_node(skein));
+	for(count = 1; count < n_knots; count++) {
+		I7Node *parent = g_ptr_array_index(knots, g_random_int_range(MAX(0, (int)knots->len - 50), knots->len));
+		I7Node *node = i7_skein_add_new(skein, parent);
+		gchar *command = g_strdup_printf("command %d", count);
+		i7_node_set_command(node, command);
+		g_free(command);
+		g_ptr_array_add(knots, node);
+	}
+	g_ptr_array_free(knots, TRUE);
+	return skein;
+}
+
+static I7Node *
+random_knot(I7Skein *skein)
+{
+	GNode *gnode = i7_skein_get_root_node(skein)->gnode;
+	while(gnode->children)
+		gnode = g_node_nth_child(gnode, g_random_int_range(0, g_node_n_children(gnode)));
+	return gnode->data;
+}
+
+/* Time a full layout of a big skein, and then the incremental layouts after
+ adding one knot at a time, as happens when the user types commands */
+static void
+benchmark_layout(int n_knots)
+{
+	GtkWidget *window = gtk_offscreen_window_new();
+	GtkWidget *scroll = gtk_scrolled_window_new(NULL, NULL);
+	GtkWidget *view = i7_skein_view_new();
+	GTimer *timer = g_timer_new();
+	double layout_time = 0.0, draw_time = 0.0;
+	int count;
+
+	gtk_container_add(GTK_CONTAINER(scroll), view);
+	gtk_container_add(GTK_CONTAINER(window), scroll);
+	gtk_widget_show_all(window);
+
+	g_print("Building skein of %d knots...\n", n_knots);
+	I7Skein *skein = build_random_skein(n_knots);
+	I7Node *root = i7_skein_get_root_node(skein);
+
+	g_timer_start(timer);
+	i7_skein_view_set_skein(I7_SKEIN_VIEW(view), skein);
+	g_print("Initial layout and draw: %.3f s\n", g_timer_elapsed(timer, NULL));
+
+	g_timer_start(timer);
+	i7_node_layout(root, GOO_CANVAS_ITEM_MODEL(skein), GOO_CANVAS(view), 0.0);
+	g_print("Layout with nothing changed: %.6f s\n", g_timer_elapsed(timer, NULL));
+
+	for(count = 0; count < 100; count++) {
+		I7Node *node = i7_skein_add_new(skein, random_knot(skein));
+		i7_node_set_command(node, "new command");
+
+		g_timer_start(timer);
+		i7_node_layout(root, GOO_CANVAS_ITEM_MODEL(skein), GOO_CANVAS(view), 0.0);
+		layout_time += g_timer_elapsed(timer, NULL);
+
+		g_timer_start(timer);
+		i7_skein_draw(skein, GOO_CANVAS(view));
+		draw_time += g_timer_elapsed(timer, NULL);
+	}
+	g_print("Layout after adding one knot: %.6f s average\n", layout_time / 100);
+	g_print("Draw after adding one knot: %.6f s average\n", draw_time / 100);
+
+	g_timer_destroy(timer);
+	gtk_widget_destroy(window);
+	g_object_unref(skein);
+}
+
+/* Check that two skeins have the same shape and the same text in each knot */
+static gboolean
+same_tree(GNode *a, GNode *b)
+{
+	gchar *a_text = i7_node_get_command(a->data), *b_text = i7_node_get_command(b->data);
+	gboolean same = strcmp(a_text, b_text) == 0;
+	g_free(a_text);
+	g_free(b_text);
+	a_text = i7_node_get_transcript_text(a->data);
+	b_text = i7_node_get_transcript_text(b->data);
+	same = same && strcmp(a_text, b_text) == 0;
+	g_free(a_text);
+	g_free(b_text);
+
+	for(a = a->children, b = b->children; same && a && b; a = a->next, b = b->next)
+		same = same_tree(a, b);
+	return same && a == NULL && b == NULL;
+}
+
+/* Time saving a big skein with transcripts and loading it back again */
+static void
+benchmark_load(int n_knots)
+{
+	GTimer *timer = g_timer_new();
+	GError *error = NULL;
+	int fd, count;
+	gchar *filename;
+
+	g_print("Building skein of %d knots...\n", n_knots);
+	I7Skein *skein = build_random_skein(n_knots);
+	for(count = 0; count < n_knots; count++) {
+		I7Node *node = random_knot(skein);
+		gchar *transcript = g_strdup_printf("You can't see any such thing. (%d)\n\n>", count);
+		i7_node_set_transcript_text(node, transcript);
+		g_free(transcript);
+	}
+
+	fd = g_file_open_tmp("skeintest-XXXXXX.skein", &filename, &error);
+	if(fd == -1) {
+		g_printerr("Error: %s\n", error->message);
+		g_error_free(error);
+		return;
+	}
+	close(fd);
+	GFile *file = g_file_new_for_path(filename);
+
+	g_timer_start(timer);
+	if(!i7_skein_save(skein, file, &error))
+		goto fail;
+	g_print("Save: %.3f s\n", g_timer_elapsed(timer, NULL));
+
+	I7Skein *loaded = i7_skein_new();
+	g_timer_start(timer);
+	if(!i7_skein_load(loaded, file, &error)) {
+		g_object_unref(loaded);
+		goto fail;
+	}
+	g_print("Load: %.3f s\n", g_timer_elapsed(timer, NULL));
+
+	g_timer_start(timer);
+	if(!i7_skein_save(loaded, file, &error)) {
+		g_object_unref(loaded);
+		goto fail;
+	}
+	g_print("Save after loading: %.3f s\n", g_timer_elapsed(timer, NULL));
+
+	/* Check the round trip */
+	guint before = g_node_n_nodes(i7_skein_get_root_node(skein)->gnode, G_TRAVERSE_ALL);
+	guint after = g_node_n_nodes(i7_skein_get_root_node(loaded)->gnode, G_TRAVERSE_ALL);
+	gboolean same = same_tree(i7_skein_get_root_node(skein)->gnode, i7_skein_get_root_node(loaded)->gnode);
+	g_print("Round trip %s (%u knots before, %u after)\n", same? "OK" : "FAILED", before, after);
+
+	/* Now most of the XML is cached on the knots */
+	i7_node_set_command(random_knot(loaded), "changed command");
+	g_timer_start(timer);
+	if(!i7_skein_save(loaded, file, &error)) {
+		g_object_unref(loaded);
+		goto fail;
+	}
+	g_print("Save after changing one knot: %.3f s\n", g_timer_elapsed(timer, NULL));
+
+	g_object_unref(loaded);
+fail:
+	if(error) {
+		g_printerr("Error: %s\n", error->message);
+		g_error_free(error);
+	}
+	g_file_delete(file, NULL, NULL);
+	g_object_unref(file);
+	g_free(filename);
+	g_timer_destroy(timer);
+	g_object_unref(skein);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -251,6 +428,17 @@ main(int argc, char **argv)
 
 	gtk_init(&argc, &argv);
 
+	/* Run with --benchmark-layout [number of knots] to time the layout engine */
+	if(argc > 1 && strcmp(argv[1], "--benchmark-layout") == 0) {
+		benchmark_layout(argc > 2? atoi(argv[2]) : 20000);
+		return 0;
+	}
+	/* Run with --benchmark-load [number of knots] to time saving and loading */
+	if(argc > 1 && strcmp(argv[1], "--benchmark-load") == 0) {
+		benchmark_load(argc > 2? atoi(argv[2]) : 50000);
+		return 0;
+	}
+
 	/* Create widgets */
 	Widgets *w = g_slice_new0(Widgets);
 	w->skein = i7_skein_new();
@@ -78,14 +78,27 @@ i7_story_test_compiler_output(I7Story *story)
 	gtk_widget_grab_focus(GTK_WIDGET(glk));
 }
 
+/* Ends the batch of skein changes started by play_commands(), if it is still
+ going on */
+static void
+finish_replay(I7Story *story)
+{
+	I7_STORY_USE_PRIVATE(story, priv);
+	if(priv->replaying) {
+		priv->replaying = FALSE;
+		i7_skein_end_changes(priv->skein);
+	}
+}
+
 /* Finish setting up the interpreter when forced input is done processing;
  * this signal is set up in play_commands() because the interpreter processes
  * the commands you feed it asynchronously. */
 static void
-on_waiting(ChimaraGlk *glk)
+on_waiting(ChimaraGlk *glk, I7Story *story)
 {
 	if(!chimara_glk_is_line_input_pending(glk)) {
 		chimara_glk_set_interactive(glk, TRUE);
+		finish_replay(story);
 
 		/* Set focus to the interpreter */
 		gtk_widget_grab_focus(GTK_WIDGET(glk));
@@ -93,7 +106,7 @@ on_waiting(ChimaraGlk *glk)
 		/* Disconnect this signal handler - have to do it this way, because
 		 a gulong can't be packed into a pointer */
 		gulong handler = g_signal_handler_find(glk, G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA,
-			0, 0, NULL, on_waiting, NULL);
+			0, 0, NULL, on_waiting, story);
 		g_signal_handler_disconnect(glk, handler);
 	}
 }
@@ -111,14 +124,27 @@ play_commands(I7Story *story, GSList *commands, gboolean start_interpreter)
 	ChimaraIF *glk = CHIMARA_IF(story->panel[side]->tabs[I7_PANE_STORY]);
 
 	/* Set non-interactive if there are commands, because we don't want to
-	 scroll through screens full of -- more -- prompts */
-	if(commands)
+	 scroll through screens full of -- more -- prompts; and have the skein's
+	 views catch up with all the commands at once at the end */
+	if(commands) {
 		chimara_glk_set_interactive(CHIMARA_GLK(glk), FALSE);
+		if(!priv->replaying) {
+			priv->replaying = TRUE;
+			i7_skein_begin_changes(priv->skein);
+		}
+	}
 
 	/* Load and start the interpreter */
 	if(start_interpreter) {
 		if(!chimara_if_run_game_file(glk, priv->compiler_output_file, &err)) {
 			error_dialog(GTK_WINDOW(story), err, _("Could not load interpreter: "));
+			/* No "waiting" signal will come to end the batch, and there is
+			 nothing to feed the commands to */
+			chimara_glk_set_interactive(CHIMARA_GLK(glk), TRUE);
+			finish_replay(story);
+			i7_skein_reset(priv->skein, TRUE);
+			i7_story_show_pane(story, I7_PANE_STORY);
+			return;
 		}
 		i7_skein_reset(priv->skein, TRUE);
 	}
@@ -133,7 +159,7 @@ play_commands(I7Story *story, GSList *commands, gboolean start_interpreter)
 		chimara_glk_feed_line_input(CHIMARA_GLK(glk), (gchar *)iter->data);
 
 	/* Finish the rest when the input is done being processed */
-	g_signal_connect(glk, "waiting", G_CALLBACK(on_waiting), NULL);
+	g_signal_connect(glk, "waiting", G_CALLBACK(on_waiting), story);
 }
 
 /* Compile finished action: run the compiler output and feed commands from the
@@ -294,10 +320,18 @@ i7_story_run_compiler_output_and_entire_skein(I7Story *story)
 	data->glk = CHIMARA_GLK(story->panel[side]->tabs[I7_PANE_STORY]);
 	chimara_glk_set_interactive(data->glk, FALSE);
 	
+	/* Compare the transcripts with the expected text on other processors while
+	the interpreter is busy, instead of after each command */
+	i7_skein_begin_background_diffs(data->skein);
+	i7_skein_begin_changes(data->skein);
+
 	GSList *blessed_nodes = i7_skein_get_blessed_thread_ends(data->skein);
 	g_slist_foreach(blessed_nodes, (GFunc)run_entire_skein_loop, data);
 	g_slist_free(blessed_nodes);
 
+	i7_skein_end_changes(data->skein);
+	i7_skein_end_background_diffs(data->skein);
+
 	chimara_glk_set_interactive(data->glk, TRUE);
 
 	g_object_unref(data->file_to_run);
@@ -401,6 +435,8 @@ on_game_stopped(ChimaraGlk *game, I7Story *story)
 	I7_STORY_USE_PRIVATE(story, priv);
 	GtkAction *stop = gtk_action_group_get_action(priv->story_action_group, "stop");
 	gtk_action_set_sensitive(stop, FALSE);
+	/* The game can end before all the replayed commands are processed */
+	finish_replay(story);
 }
 
 /* Grab commands entered by the user and store them in the skein */
@@ -36,6 +36,7 @@ typedef struct {
 	GtkTextBuffer *notes;
 	GtkTextBuffer *progress;
 	GtkTextBuffer *debug_log;
+	GtkTextBuffer *skein_statistics;
 	GtkSourceBuffer *i6_source;
 	/* The Settings.plist object */
 	PlistObject *settings;
@@ -50,6 +51,7 @@ typedef struct {
 	I7Skein *skein;
 	GSettings *skein_settings;
 	gboolean test_me;
+	gboolean replaying; /* Skein changes are batched until the replay is over */
 } I7StoryPrivate;
 
 #define I7_STORY_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE((o), I7_TYPE_STORY, I7StoryPrivate))
@@ -15,13 +15,17 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <glib/gi18n.h>
 #include <gtk/gtk.h>
 #include <gtksourceview/gtksourcebuffer.h>
 #include <gtksourceview/gtksourcelanguage.h>
 #include <gtksourceview/gtksourcelanguagemanager.h>
 #include "story.h"
+#include "story-private.h"
 #include "document.h"
 #include "lang.h"
+#include "skein.h"
+#include "skein-stats.h"
 
 
 /* Add the debugging tabs to this main window */
@@ -34,6 +38,8 @@ i7_story_add_debug_tabs(I7Document *document)
 	gtk_widget_show(GTK_WIDGET(I7_STORY(document)->panel[RIGHT]->debugging_scrolledwindow));
 	gtk_widget_show(GTK_WIDGET(I7_STORY(document)->panel[LEFT]->inform6_scrolledwindow));
 	gtk_widget_show(GTK_WIDGET(I7_STORY(document)->panel[RIGHT]->inform6_scrolledwindow));
+	gtk_widget_show(GTK_WIDGET(I7_STORY(document)->panel[LEFT]->skein_statistics_scrolledwindow));
+	gtk_widget_show(GTK_WIDGET(I7_STORY(document)->panel[RIGHT]->skein_statistics_scrolledwindow));
 }
 
 /* Remove the debugging tabs from this window */
@@ -46,6 +52,39 @@ i7_story_remove_debug_tabs(I7Document *document)
 	gtk_widget_hide(GTK_WIDGET(I7_STORY(document)->panel[RIGHT]->debugging_scrolledwindow));
 	gtk_widget_hide(GTK_WIDGET(I7_STORY(document)->panel[LEFT]->inform6_scrolledwindow));
 	gtk_widget_hide(GTK_WIDGET(I7_STORY(document)->panel[RIGHT]->inform6_scrolledwindow));
+	gtk_widget_hide(GTK_WIDGET(I7_STORY(document)->panel[LEFT]->skein_statistics_scrolledwindow));
+	gtk_widget_hide(GTK_WIDGET(I7_STORY(document)->panel[RIGHT]->skein_statistics_scrolledwindow));
+}
+
+/* Fill in the Skein Statistics tab with the shape of this story's skein and
+ the time spent on skeins so far */
+static void
+update_skein_statistics(I7Story *story)
+{
+	I7_STORY_USE_PRIVATE(story, priv);
+	I7SkeinShape shape;
+	i7_skein_get_shape(priv->skein, &shape);
+
+	GString *report = g_string_new("");
+	g_string_append_printf(report, _("Knots: %u\n"), shape.n_knots);
+	g_string_append_printf(report, _("Longest thread: %u commands\n"), shape.max_depth);
+	g_string_append_printf(report, _("Most children of one knot: %u\n"), shape.max_fanout);
+	g_string_append_printf(report, _("Blessed knots: %u\n"), shape.n_blessed);
+	g_string_append_printf(report, _("Knots differing from the blessed transcript: %u\n"), shape.n_differences);
+	g_string_append(report, _("\nTime spent on all skeins since Inform started:\n\n"));
+	skein_stats_append_report(report);
+
+	gtk_text_buffer_set_text(priv->skein_statistics, report->str, report->len);
+	g_string_free(report, TRUE);
+}
+
+/* The statistics change all the time, so only bring them up to date when the
+ tab is looked at */
+void
+on_results_notebook_switch_page(GtkNotebook *notebook, GtkWidget *page, unsigned page_num, I7Story *story)
+{
+	if(page_num == I7_RESULTS_TAB_SKEIN_STATISTICS)
+		update_skein_statistics(story);
 }
 
 /* Set up the Inform 6 highlighting */
@@ -15,12 +15,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
 #include "configfile.h"
 #include "node.h"
+#include "placeholder-entry.h"
 #include "skein.h"
 #include "skein-view.h"
 #include "story.h"
@@ -307,6 +309,35 @@ on_labels_changed(I7Skein *skein, I7Panel *panel)
 	i7_skein_free_node_label_list(labels);
 }
 
+/* Jump to the next knot that matches the text in the Skein search entry;
+ pressing Enter again goes on to the one after that */
+void
+on_skein_search_activate(GtkEntry *entry, I7Panel *panel)
+{
+	I7Story *story = I7_STORY(gtk_widget_get_toplevel(GTK_WIDGET(panel)));
+	const char *phrase = i7_placeholder_entry_get_text(I7_PLACEHOLDER_ENTRY(entry));
+	if(phrase == NULL || *phrase == '\0')
+		return;
+
+	GSList *results = i7_skein_search(i7_story_get_skein(story), phrase);
+	if(results == NULL) {
+		gdk_window_beep(gtk_widget_get_window(GTK_WIDGET(entry)));
+		return;
+	}
+
+	/* Remember which match was shown last, as long as the text stays the same */
+	unsigned position = 0;
+	const char *last_phrase = g_object_get_data(G_OBJECT(entry), "last-search-phrase");
+	if(last_phrase && strcmp(last_phrase, phrase) == 0)
+		position = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(entry), "last-search-position")) + 1;
+	position %= g_slist_length(results);
+	g_object_set_data_full(G_OBJECT(entry), "last-search-phrase", g_strdup(phrase), g_free);
+	g_object_set_data(G_OBJECT(entry), "last-search-position", GUINT_TO_POINTER(position));
+
+	i7_skein_view_show_node(I7_SKEIN_VIEW(panel->tabs[I7_PANE_SKEIN]), g_slist_nth_data(results, position), I7_REASON_USER_ACTION);
+	g_slist_free(results);
+}
+
 void
 on_show_node(I7Skein *skein, I7SkeinShowNodeReason why, I7Node *node, I7Panel *panel)
 {
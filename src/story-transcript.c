@@ -15,6 +15,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <glib/gi18n.h>
 #include <gtk/gtk.h>
 #include "node.h"
 #include "panel.h"
@@ -220,6 +221,24 @@ i7_story_next_changed(I7Story *story)
 	gtk_tree_path_free(path);
 }
 
+/* Selects the row of @node in the Transcript and scrolls to it, or beeps if
+ there is no such knot */
+static void
+select_difference(I7Story *story, GtkTreeView *transcript, I7Skein *skein, I7Node *node)
+{
+	GtkTreeIter iter;
+
+	if(node == NULL || !i7_skein_get_iter_for_node(skein, node, &iter)) {
+		gdk_window_beep(gtk_widget_get_window(GTK_WIDGET(story)));
+		return;
+	}
+
+	gtk_tree_selection_select_iter(gtk_tree_view_get_selection(transcript), &iter);
+	GtkTreePath *path = gtk_tree_model_get_path(GTK_TREE_MODEL(skein), &iter);
+	gtk_tree_view_scroll_to_cell(transcript, path, NULL, FALSE, 0.0, 0.0);
+	gtk_tree_path_free(path);
+}
+
 /*
  * i7_story_previous_difference:
  * @story: the story
@@ -236,6 +255,7 @@ i7_story_previous_difference(I7Story *story)
 	GtkTreeSelection *selection = gtk_tree_view_get_selection(transcript);
 	GtkTreeModel *skein;
 	GtkTreeIter iter;
+	I7Node *node = NULL;
 
 	if(!gtk_tree_selection_get_selected(selection, &skein, &iter)) {
 		/* Start at the top if no selected item */
@@ -243,28 +263,9 @@ i7_story_previous_difference(I7Story *story)
 		return;
 	}
 
-	/* Find the previous item */
-	gboolean found = FALSE;
-	while(!found && _gtk_tree_model_iter_previous(skein, &iter)) {
-		I7Node *node = NULL;
-		gtk_tree_model_get(skein, &iter, I7_SKEIN_COLUMN_NODE_PTR, &node, -1);
-		if(i7_node_get_blessed(node) && i7_node_get_different(node))
-			found = TRUE;
-		g_object_unref(node);
-	}
-	
-	if(!found) {
-		/* No previous item */
-		gdk_window_beep(gtk_widget_get_window(GTK_WIDGET(story)));
-		return;
-	}
-	
-	/* Move to the previous item */
-	gtk_tree_selection_select_iter(selection, &iter);
-	GtkTreePath *path = gtk_tree_model_get_path(skein, &iter);
-	gtk_tree_view_scroll_to_cell(transcript, path, NULL, FALSE, 0.0, 0.0);
-
-	gtk_tree_path_free(path);
+	gtk_tree_model_get(skein, &iter, I7_SKEIN_COLUMN_NODE_PTR, &node, -1);
+	select_difference(story, transcript, I7_SKEIN(skein), i7_skein_get_previous_difference(I7_SKEIN(skein), node, TRUE));
+	g_object_unref(node);
 }
 
 /*
@@ -283,38 +284,17 @@ i7_story_next_difference(I7Story *story)
 	GtkTreeSelection *selection = gtk_tree_view_get_selection(transcript);
 	GtkTreeModel *skein;
 	GtkTreeIter iter;
-	gboolean found = FALSE;
-
-	if(!gtk_tree_selection_get_selected(selection, &skein, &iter)) {
-		/* Start at the top if no selected item */
-		g_assert(gtk_tree_model_get_iter_first(skein, &iter));
-
-		/* If the top node is a difference, just use it */
-		I7Node *root = i7_skein_get_root_node(I7_SKEIN(skein));
-		found = (i7_node_get_blessed(root) && i7_node_get_different(root));
-	}
+	I7Node *node = NULL;
 
-	/* Find the next item */
-	while(!found && gtk_tree_model_iter_next(skein, &iter)) {
-		I7Node *node = NULL;
+	/* Start at the top if no selected item */
+	if(gtk_tree_selection_get_selected(selection, &skein, &iter))
 		gtk_tree_model_get(skein, &iter, I7_SKEIN_COLUMN_NODE_PTR, &node, -1);
-		if(i7_node_get_blessed(node) && i7_node_get_different(node))
-			found = TRUE;
-		g_object_unref(node);
-	}
-	
-	if(!found) {
-		/* No next item */
-		gdk_window_beep(gtk_widget_get_window(GTK_WIDGET(story)));
-		return;
-	}
-	
-	/* Move to the next item */
-	gtk_tree_selection_select_iter(selection, &iter);
-	GtkTreePath *path = gtk_tree_model_get_path(skein, &iter);
-	gtk_tree_view_scroll_to_cell(transcript, path, NULL, FALSE, 0.0, 0.0);
+	else
+		skein = gtk_tree_view_get_model(transcript);
 
-	gtk_tree_path_free(path);
+	select_difference(story, transcript, I7_SKEIN(skein), i7_skein_get_next_difference(I7_SKEIN(skein), node, TRUE));
+	if(node)
+		g_object_unref(node);
 }
 
 /*
@@ -344,21 +324,35 @@ i7_story_next_difference_skein(I7Story *story)
 	gtk_tree_model_get(skein, &iter, I7_SKEIN_COLUMN_NODE_PTR, &current_node, -1);
 
 	/* Find the next item */
-	I7Node *next_node = i7_node_get_next_difference(current_node);
+	I7Node *next_node = i7_skein_get_next_difference(I7_SKEIN(skein), current_node, FALSE);
 	if(!next_node)
-		next_node = i7_node_get_next_difference(i7_skein_get_root_node(I7_SKEIN(skein)));
+		next_node = i7_skein_get_next_difference(I7_SKEIN(skein), NULL, FALSE);
+	g_object_unref(current_node);
 	if(!next_node) {
 		/* No next item */
 		gdk_window_beep(gtk_widget_get_window(GTK_WIDGET(story)));
 		return;
 	}
-	g_object_unref(current_node);
 
 	/* display item in skein and transcript */
 	i7_story_show_node_in_transcript(story, next_node);
 	g_signal_emit_by_name(skein, "show-node", I7_REASON_TRANSCRIPT, next_node);
 }
 
+/* Show the number of differences on the "Next in Skein" button */
+void
+on_differences_changed(I7Skein *skein, GParamSpec *pspec, I7Panel *panel)
+{
+	guint count = i7_skein_get_n_differences(skein);
+	/* TRANSLATORS: Transcript panel; %u is the number of differences */
+	char *label = g_strdup_printf(_("Next in _Skein (%u)"), count);
+	g_object_set(panel->next_difference_skein_action,
+		"short-label", label,
+		"sensitive", count > 0,
+		NULL);
+	g_free(label);
+}
+
 /*
  * i7_story_show_node_in_transcript:
  * @story: the story
@@ -60,7 +60,11 @@ void on_node_activate(I7Skein *, I7Node *, I7Story *);
 void on_node_popup(I7SkeinView *, I7Node *);
 void on_differs_badge_activate(I7Skein *, I7Node *, I7Story *);
 void on_labels_changed(I7Skein *, I7Panel *);
+void on_differences_changed(I7Skein *, GParamSpec *, I7Panel *);
+void on_skein_search_activate(GtkEntry *, I7Panel *);
 void on_show_node(I7Skein *, I7SkeinShowNodeReason, I7Node *, I7Panel *);
+/* Defined in story-results.c */
+void on_results_notebook_switch_page(GtkNotebook *, GtkWidget *, unsigned, I7Story *);
 /* Defined in story-game.c */
 void on_game_started(ChimaraGlk *, I7Story *);
 void on_game_stopped(ChimaraGlk *, I7Story *);
@@ -646,6 +650,7 @@ story_init_panel(I7Story *self, I7Panel *panel, PangoFontDescription *font)
 	g_object_bind_property(self, "create-blorb", panel->blorb, "active", G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
 	g_object_bind_property(self, "nobble-rng", panel->nobble_rng, "active", G_BINDING_BIDIRECTIONAL | G_BINDING_SYNC_CREATE);
 	g_signal_connect(panel->tabs[I7_PANE_SOURCE], "switch-page", G_CALLBACK(on_source_notebook_switch_page), self);
+	g_signal_connect(panel->tabs[I7_PANE_RESULTS], "switch-page", G_CALLBACK(on_results_notebook_switch_page), self);
 	g_signal_connect(panel->source_tabs[I7_SOURCE_VIEW_TAB_CONTENTS], "row-activated", G_CALLBACK(on_headings_row_activated), self);
 	g_signal_connect(panel, "select-view", G_CALLBACK(on_panel_select_view), self);
 	g_signal_connect(panel, "paste-code", G_CALLBACK(on_panel_paste_code), self);
@@ -654,6 +659,9 @@ story_init_panel(I7Story *self, I7Panel *panel, PangoFontDescription *font)
 	g_signal_connect(panel, "display-extensions-docpage", G_CALLBACK(on_panel_display_extensions_docpage), self);
 	g_signal_connect(panel, "display-index-page", G_CALLBACK(on_panel_display_index_page), self);
 	g_signal_connect(priv->skein, "labels-changed", G_CALLBACK(on_labels_changed), panel);
+	g_signal_connect(priv->skein, "notify::n-differences", G_CALLBACK(on_differences_changed), panel);
+	g_signal_connect(panel->skein_search_entry, "activate", G_CALLBACK(on_skein_search_activate), panel);
+	on_differences_changed(priv->skein, NULL, panel);
 	g_signal_connect(priv->skein, "show-node", G_CALLBACK(on_show_node), panel);
 	g_signal_connect(panel->tabs[I7_PANE_SKEIN], "node-menu-popup", G_CALLBACK(on_node_popup), NULL);
 	g_signal_connect(panel->tabs[I7_PANE_STORY], "started", G_CALLBACK(on_game_started), self);
@@ -666,11 +674,13 @@ story_init_panel(I7Story *self, I7Panel *panel, PangoFontDescription *font)
 	gtk_text_view_set_buffer(GTK_TEXT_VIEW(panel->results_tabs[I7_RESULTS_TAB_PROGRESS]), priv->progress);
 	gtk_text_view_set_buffer(GTK_TEXT_VIEW(panel->results_tabs[I7_RESULTS_TAB_DEBUGGING]), priv->debug_log);
 	gtk_text_view_set_buffer(GTK_TEXT_VIEW(panel->results_tabs[I7_RESULTS_TAB_INFORM6]), GTK_TEXT_BUFFER(priv->i6_source));
+	gtk_text_view_set_buffer(GTK_TEXT_VIEW(panel->results_tabs[I7_RESULTS_TAB_SKEIN_STATISTICS]), priv->skein_statistics);
 	i7_skein_view_set_skein(I7_SKEIN_VIEW(panel->tabs[I7_PANE_SKEIN]), priv->skein);
 	gtk_tree_view_set_model(GTK_TREE_VIEW(panel->tabs[I7_PANE_TRANSCRIPT]), GTK_TREE_MODEL(priv->skein));
 	
-	/* Set the Results/Progress to a monospace font */
+	/* Set the Results/Progress and Skein Statistics to a monospace font */
 	gtk_widget_modify_font(GTK_WIDGET(panel->results_tabs[I7_RESULTS_TAB_PROGRESS]), font);
+	gtk_widget_modify_font(GTK_WIDGET(panel->results_tabs[I7_RESULTS_TAB_SKEIN_STATISTICS]), font);
 
 	/* Connect the Previous Section and Next Section actions to the up and down buttons */
 	gtk_activatable_set_related_action(GTK_ACTIVATABLE(panel->sourceview->previous), I7_DOCUMENT(self)->previous_section);
@@ -813,9 +823,11 @@ i7_story_init(I7Story *self)
 	set_buffer_language(buffer, "inform7");
 	gtk_source_buffer_set_style_scheme(buffer, i7_app_get_current_color_scheme(theapp));
 
-	/* Create a text buffer for the Progress, Debugging and I6 text views */
+	/* Create a text buffer for the Progress, Debugging, I6 and Skein Statistics
+	 text views */
 	priv->progress = gtk_text_buffer_new(NULL);
 	priv->debug_log = gtk_text_buffer_new(NULL);
+	priv->skein_statistics = gtk_text_buffer_new(NULL);
 	priv->i6_source = create_inform6_source_buffer();
 
 	/* Create a monospace font description for the Results/Progress views */
@@ -835,6 +847,7 @@ i7_story_init(I7Story *self)
 	g_object_unref(priv->notes);
 	g_object_unref(priv->progress);
 	g_object_unref(priv->debug_log);
+	g_object_unref(priv->skein_statistics);
 	g_object_unref(priv->i6_source);
 
 	/* Set up the Previous Section and Next Section actions to synch with the buttons */
@@ -0,0 +1,128 @@
+/* Copyright (C) 2014 P. F. Chimento
+ * This file is part of GNOME Inform 7.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include "string-intern.h"
+
+/* The reference count is stored right before the characters, so releasing a
+ string doesn't need to hash it */
+typedef struct {
+	guint refcount;
+	char str[1];
+} InternedString;
+
+#define INTERNED_STRING(s) ((InternedString *)((s) - G_STRUCT_OFFSET(InternedString, str)))
+
+/* Maps the characters of each string to its InternedString */
+static GHashTable *strings = NULL;
+G_LOCK_DEFINE_STATIC(strings);
+
+static const char *
+intern_len(const char *str, gsize len)
+{
+	InternedString *interned;
+
+	G_LOCK(strings);
+	if(G_UNLIKELY(strings == NULL))
+		strings = g_hash_table_new(g_str_hash, g_str_equal);
+
+	if((interned = g_hash_table_lookup(strings, str)) != NULL) {
+		interned->refcount++;
+	} else {
+		interned = g_malloc(G_STRUCT_OFFSET(InternedString, str) + len + 1);
+		interned->refcount = 1;
+		memcpy(interned->str, str, len + 1);
+		g_hash_table_insert(strings, interned->str, interned);
+	}
+	G_UNLOCK(strings);
+
+	return interned->str;
+}
+
+/*
+ * string_intern:
+ * @str: a string, or %NULL for the empty string
+ *
+ * Looks up a copy of @str that is shared with everyone else who interned the
+ * same text, making one if there is none yet. Knots in a skein produced by
+ * replaying the same story repeat the same responses thousands of times.
+ *
+ * Returns: the shared copy, which must not be modified. Release it with
+ * string_intern_release() when done.
+ */
+const char *
+string_intern(const char *str)
+{
+	if(str == NULL)
+		str = "";
+	return intern_len(str, strlen(str));
+}
+
+/*
+ * string_intern_take:
+ * @str: a newly-allocated string
+ *
+ * Like string_intern(), but frees @str.
+ *
+ * Returns: the shared copy of @str.
+ */
+const char *
+string_intern_take(char *str)
+{
+	const char *retval = string_intern(str);
+	g_free(str);
+	return retval;
+}
+
+/*
+ * string_intern_release:
+ * @str: a string returned from string_intern(), or %NULL
+ *
+ * Gives up a reference to an interned string. When nobody refers to the string
+ * anymore, it is freed.
+ */
+void
+string_intern_release(const char *str)
+{
+	if(str == NULL)
+		return;
+
+	InternedString *interned = INTERNED_STRING(str);
+
+	G_LOCK(strings);
+	if(--interned->refcount == 0) {
+		g_hash_table_remove(strings, interned->str);
+		g_free(interned);
+	}
+	G_UNLOCK(strings);
+}
+
+/*
+ * string_intern_get_count:
+ *
+ * Returns: the number of distinct strings currently interned.
+ */
+guint
+string_intern_get_count(void)
+{
+	guint count;
+	G_LOCK(strings);
+	count = strings? g_hash_table_size(strings) : 0;
+	G_UNLOCK(strings);
+	return count;
+}
@@ -16,8 +16,12 @@
  */
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include "skein.h"
+#include "skein-replay.h"
+#include "skein-stats.h"
 #include "node.h"
+#include "string-intern.h"
 
 void
 test_skein_import(void)
@@ -54,4 +58,512 @@ test_skein_import(void)
 
 	g_object_unref(commands_file);
 	g_object_unref(skein);
-}
\ No newline at end of file
+}
+
+static void
+count_row_inserted(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, int *count)
+{
+	(*count)++;
+}
+
+void
+test_skein_current_thread(void)
+{
+	I7Skein *skein = i7_skein_new();
+	GtkTreeModel *model = GTK_TREE_MODEL(skein);
+	GtkTreeIter iter;
+	int inserted = 0;
+
+	g_signal_connect(skein, "row-inserted", G_CALLBACK(count_row_inserted), &inserted);
+
+	/* Playing on from the end of the thread adds one row */
+	I7Node *first = i7_skein_new_command(skein, "look");
+	g_assert_cmpint(inserted, ==, 1);
+	I7Node *second = i7_skein_new_command(skein, "jump");
+	g_assert_cmpint(inserted, ==, 2);
+	g_assert_cmpint(gtk_tree_model_iter_n_children(model, NULL), ==, 3);
+	g_assert(gtk_tree_model_iter_nth_child(model, &iter, NULL, 2));
+	g_assert(iter.user_data == second);
+	g_assert(!gtk_tree_model_iter_next(model, &iter));
+
+	/* Branching from the middle of the thread replaces the rows below it */
+	i7_skein_reset(skein, FALSE);
+	i7_skein_new_command(skein, "look");
+	I7Node *branch = i7_skein_new_command(skein, "wait");
+	g_assert(i7_skein_get_current_node(skein) == branch);
+	g_assert_cmpint(gtk_tree_model_iter_n_children(model, NULL), ==, 3);
+	g_assert(i7_skein_is_node_in_current_thread(skein, first));
+	g_assert(!i7_skein_is_node_in_current_thread(skein, second));
+
+	GtkTreePath *path = gtk_tree_path_new_from_indices(2, -1);
+	g_assert(gtk_tree_model_get_iter(model, &iter, path));
+	g_assert(iter.user_data == branch);
+	gtk_tree_path_free(path);
+
+	g_object_unref(skein);
+}
+
+void
+test_skein_interned_text(void)
+{
+	I7Skein *skein = i7_skein_new();
+	I7Node *node1 = i7_skein_new_command(skein, "take lamp");
+	i7_skein_update_after_playing(skein, "Taken.");
+	i7_skein_reset(skein, TRUE);
+	I7Node *node2 = i7_skein_new_command(skein, "take all");
+	i7_skein_update_after_playing(skein, "Taken.");
+
+	/* Both knots share one copy of the text */
+	g_assert(i7_node_peek_transcript_text(node1) == i7_node_peek_transcript_text(node2));
+	g_assert_cmpstr(i7_node_peek_transcript_text(node2), ==, "Taken.");
+
+	/* Newlines are normalized before interning */
+	i7_node_set_transcript_text(node2, "Taken.\r\nYou feel lighter.");
+	g_assert_cmpstr(i7_node_peek_transcript_text(node2), ==, "Taken.\nYou feel lighter.");
+	g_assert(i7_node_get_changed(node2));
+
+	g_object_unref(skein);
+
+	guint count = string_intern_get_count();
+	const char *str1 = string_intern("You can't go that way.");
+	const char *str2 = string_intern("You can't go that way.");
+	g_assert(str1 == str2);
+	g_assert_cmpuint(string_intern_get_count(), ==, count + 1);
+	string_intern_release(str1);
+	string_intern_release(str2);
+	g_assert_cmpuint(string_intern_get_count(), ==, count);
+}
+
+void
+test_skein_wide_knot(void)
+{
+	I7Skein *skein = i7_skein_new();
+	I7Node *root = i7_skein_get_root_node(skein);
+	I7Node *children[40];
+	int count;
+
+	/* Enough children that the knot indexes them by command */
+	for(count = 0; count < 40; count++) {
+		char *command = g_strdup_printf("verb%d", count);
+		i7_skein_reset(skein, TRUE);
+		children[count] = i7_skein_new_command(skein, command);
+		g_free(command);
+	}
+	g_assert(i7_node_find_child(root, "verb0") == children[0]);
+	g_assert(i7_node_find_child(root, "verb39") == children[39]);
+	g_assert(i7_node_find_child(root, "xyzzy") == NULL);
+
+	/* Typing a command again goes to the existing knot */
+	i7_skein_reset(skein, TRUE);
+	g_assert(i7_skein_new_command(skein, "verb20") == children[20]);
+
+	/* The index follows removals and renamed commands */
+	i7_skein_remove_single(skein, children[10]);
+	g_assert(i7_node_find_child(root, "verb10") == NULL);
+	i7_node_set_command(children[11], "xyzzy");
+	g_assert(i7_node_find_child(root, "xyzzy") == children[11]);
+	g_assert(i7_node_find_child(root, "verb11") == NULL);
+	I7Node *added = i7_skein_add_new(skein, root);
+	i7_node_set_command(added, "plugh");
+	g_assert(i7_node_find_child(root, "plugh") == added);
+
+	g_object_unref(skein);
+}
+
+static void
+make_different(I7Node *node)
+{
+	i7_node_set_transcript_text(node, "You can't see any such thing.");
+	i7_node_bless(node);
+	i7_node_set_transcript_text(node, "Taken.");
+}
+
+void
+test_skein_differences(void)
+{
+	I7Skein *skein = i7_skein_new();
+	I7Node *look = i7_skein_new_command(skein, "look");
+	I7Node *jump = i7_skein_new_command(skein, "jump");
+	i7_skein_reset(skein, TRUE);
+	I7Node *wait = i7_skein_new_command(skein, "wait");
+
+	/* Made different out of order, but kept in skein order */
+	make_different(wait);
+	make_different(jump);
+	make_different(look);
+	g_assert_cmpuint(i7_skein_get_n_differences(skein), ==, 3);
+	g_assert(i7_skein_get_next_difference(skein, NULL, FALSE) == look);
+	g_assert(i7_skein_get_next_difference(skein, look, FALSE) == jump);
+	g_assert(i7_skein_get_next_difference(skein, jump, FALSE) == wait);
+	g_assert(i7_skein_get_next_difference(skein, wait, FALSE) == NULL);
+	g_assert(i7_skein_get_previous_difference(skein, wait, FALSE) == jump);
+	g_assert(i7_skein_get_previous_difference(skein, NULL, FALSE) == wait);
+
+	/* Only "wait" is in the current thread */
+	g_assert(i7_skein_get_next_difference(skein, NULL, TRUE) == wait);
+	g_assert(i7_skein_get_previous_difference(skein, wait, TRUE) == NULL);
+
+	/* Knots that aren't differences can be used as starting points */
+	i7_node_bless(jump);
+	g_assert_cmpuint(i7_skein_get_n_differences(skein), ==, 2);
+	g_assert(i7_skein_get_next_difference(skein, jump, FALSE) == wait);
+	g_assert(i7_skein_get_previous_difference(skein, jump, FALSE) == look);
+
+	i7_skein_remove_single(skein, look);
+	g_assert_cmpuint(i7_skein_get_n_differences(skein), ==, 1);
+	g_assert(i7_skein_get_next_difference(skein, NULL, FALSE) == wait);
+
+	g_object_unref(skein);
+}
+
+void
+test_skein_trim(void)
+{
+	I7Skein *skein = i7_skein_new();
+	I7Node *root = i7_skein_get_root_node(skein);
+	I7Node *a = i7_skein_new_command(skein, "a");
+	i7_skein_reset(skein, TRUE);
+	I7Node *b = i7_skein_new_command(skein, "b");
+	I7Node *e = i7_skein_new_command(skein, "e");
+	i7_skein_reset(skein, TRUE);
+	I7Node *c = i7_skein_new_command(skein, "c");
+	i7_skein_reset(skein, TRUE);
+	I7Node *d = i7_skein_new_command(skein, "d");
+	i7_node_set_score(a, 5);
+	i7_node_set_score(b, 3);
+	i7_node_set_score(e, 10);
+	i7_node_set_score(c, 1);
+	i7_node_set_score(d, 1);
+	i7_skein_lock(skein, c);
+
+	/* The third highest score is 3, so knots scoring 3 or less are trimmed
+	 along with everything below them, unless they are locked */
+	i7_skein_trim(skein, root, 2);
+	g_assert_cmpuint(g_node_n_children(root->gnode), ==, 2);
+	g_assert(i7_node_find_child(root, "a") == a);
+	g_assert(i7_node_find_child(root, "c") == c);
+	g_assert(i7_node_find_child(root, "b") == NULL);
+	g_assert(i7_node_find_child(root, "d") == NULL);
+	/* "d" was the current knot */
+	g_assert(i7_skein_get_current_node(skein) == root);
+	g_assert_cmpint(gtk_tree_model_iter_n_children(GTK_TREE_MODEL(skein), NULL), ==, 1);
+
+	/* With fewer distinct scores than asked for, knots scoring 0 still go */
+	i7_node_set_score(a, 0);
+	i7_skein_trim(skein, root, 30);
+	g_assert_cmpuint(g_node_n_children(root->gnode), ==, 1);
+
+	g_object_unref(skein);
+}
+
+void
+test_skein_cache(void)
+{
+	GError *err = NULL;
+	char *dir = g_dir_make_tmp("skein-test-XXXXXX", &err);
+	g_assert(err == NULL);
+	char *path = g_build_filename(dir, "Skein.skein", NULL);
+	char *cache_path = g_strconcat(path, "bin", NULL);
+	GFile *file = g_file_new_for_path(path);
+
+	I7Skein *skein = i7_skein_new();
+	I7Node *node = i7_skein_new_command(skein, "look");
+	i7_skein_update_after_playing(skein, "A couch.");
+	i7_node_bless(node);
+	i7_skein_update_after_playing(skein, "A sofa.");
+	i7_node_set_label(node, "Furniture");
+	i7_skein_new_command(skein, "jump");
+	i7_skein_update_after_playing(skein, "Whee!");
+	g_assert(i7_skein_save(skein, file, &err));
+	g_assert(err == NULL);
+	g_object_unref(skein);
+	g_assert(g_file_test(cache_path, G_FILE_TEST_EXISTS));
+
+	/* Loaded from the cache; the knot is known to differ before its texts are
+	 loaded */
+	skein = i7_skein_new();
+	g_assert(i7_skein_load(skein, file, &err));
+	g_assert(err == NULL);
+	node = i7_node_find_child(i7_skein_get_root_node(skein), "look");
+	g_assert(node);
+	g_assert_cmpstr(i7_node_peek_label(node), ==, "Furniture");
+	g_assert(i7_node_get_blessed(node));
+	g_assert(i7_node_get_different(node));
+	g_assert_cmpuint(i7_skein_get_n_differences(skein), ==, 1);
+	g_assert_cmpstr(i7_node_peek_transcript_text(node), ==, "A sofa.");
+	g_assert_cmpstr(i7_node_peek_expected_text(node), ==, "A couch.");
+	I7Node *child = i7_node_find_child(node, "jump");
+	g_assert(child);
+	g_assert_cmpstr(i7_node_peek_transcript_text(child), ==, "Whee!");
+	g_assert(i7_skein_get_played_node(skein) == child);
+	g_object_unref(skein);
+
+	/* A cache that is older than the XML file is ignored */
+	g_assert(g_file_set_contents(path,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<Skein rootNode=\"root\" xmlns=\"http://www.logicalshift.org.uk/IF/Skein\">\n"
+		"  <item nodeId=\"root\"><command>- start -</command></item>\n"
+		"</Skein>\n", -1, &err));
+	skein = i7_skein_new();
+	g_assert(i7_skein_load(skein, file, &err));
+	g_assert(err == NULL);
+	g_assert(G_NODE_IS_LEAF(i7_skein_get_root_node(skein)->gnode));
+	g_object_unref(skein);
+
+	g_unlink(cache_path);
+	g_unlink(path);
+	g_rmdir(dir);
+	g_object_unref(file);
+	g_free(cache_path);
+	g_free(path);
+	g_free(dir);
+}
+
+/* Knots that can't be reached from the root, including ones that list each
+ other as children, are dropped when loading */
+void
+test_skein_load_unreachable(void)
+{
+	GError *err = NULL;
+	char *dir = g_dir_make_tmp("skein-test-XXXXXX", &err);
+	g_assert(err == NULL);
+	char *path = g_build_filename(dir, "Skein.skein", NULL);
+	char *cache_path = g_strconcat(path, "bin", NULL);
+	GFile *file = g_file_new_for_path(path);
+	g_assert(g_file_set_contents(path,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<Skein rootNode=\"root\" xmlns=\"http://www.logicalshift.org.uk/IF/Skein\">\n"
+		"  <activeNode nodeId=\"c\"/>\n"
+		"  <item nodeId=\"c\"><command>c</command><children><child nodeId=\"d\"/></children></item>\n"
+		"  <item nodeId=\"root\"><command>- start -</command><children><child nodeId=\"a\"/></children></item>\n"
+		"  <item nodeId=\"a\"><command>a</command><children><child nodeId=\"b\"/></children></item>\n"
+		"  <item nodeId=\"d\"><command>d</command><children><child nodeId=\"c\"/></children></item>\n"
+		"  <item nodeId=\"b\"><command>b</command></item>\n"
+		"  <item nodeId=\"e\"><command>e</command></item>\n"
+		"</Skein>\n", -1, &err));
+
+	I7Skein *skein = i7_skein_new();
+	g_assert(i7_skein_load(skein, file, &err));
+	g_assert(err == NULL);
+	I7Node *root = i7_skein_get_root_node(skein);
+	g_assert_cmpuint(g_node_n_nodes(root->gnode, G_TRAVERSE_ALL), ==, 3);
+	I7Node *a = i7_node_find_child(root, "a");
+	g_assert(a);
+	I7Node *b = i7_node_find_child(a, "b");
+	g_assert(b);
+	g_assert(G_NODE_IS_LEAF(b->gnode));
+	/* The active knot was in the loop */
+	g_assert(i7_skein_get_played_node(skein) == root);
+	g_object_unref(skein);
+
+	g_unlink(cache_path);
+	g_unlink(path);
+	g_rmdir(dir);
+	g_object_unref(file);
+	g_free(cache_path);
+	g_free(path);
+	g_free(dir);
+}
+
+void
+test_skein_search(void)
+{
+	I7Skein *skein = i7_skein_new();
+	I7Node *look = i7_skein_new_command(skein, "look");
+	i7_skein_update_after_playing(skein, "You see a comfy couch here.");
+	I7Node *sit = i7_skein_new_command(skein, "sit on couch");
+	i7_skein_update_after_playing(skein, "You sink  into...\nthe cushions.");
+	i7_skein_reset(skein, TRUE);
+	I7Node *jump = i7_skein_new_command(skein, "jump");
+	i7_skein_update_after_playing(skein, "Wheee!");
+
+	GSList *results = i7_skein_search(skein, "COUCH");
+	g_assert_cmpuint(g_slist_length(results), ==, 2);
+	g_assert(results->data == look);
+	g_assert(results->next->data == sit);
+	g_slist_free(results);
+
+	/* The words have to be together */
+	results = i7_skein_search(skein, "comfy couch");
+	g_assert_cmpuint(g_slist_length(results), ==, 1);
+	g_assert(results->data == look);
+	g_slist_free(results);
+	g_assert(i7_skein_search(skein, "couch comfy") == NULL);
+	g_assert(i7_skein_search(skein, "cou") == NULL);
+	/* A phrase doesn't run on from the command into the transcript */
+	g_assert(i7_skein_search(skein, "couch you") == NULL);
+	g_assert(i7_skein_search(skein, "the the") == NULL);
+
+	/* Whatever is between the words, other than letters and digits, doesn't
+	 matter in the text or in the phrase */
+	results = i7_skein_search(skein, "sink into the");
+	g_assert_cmpuint(g_slist_length(results), ==, 1);
+	g_assert(results->data == sit);
+	g_slist_free(results);
+	results = i7_skein_search(skein, "a comfy,  couch");
+	g_assert_cmpuint(g_slist_length(results), ==, 1);
+	g_assert(results->data == look);
+	g_slist_free(results);
+
+	/* The index follows changes to the skein */
+	i7_node_set_label(jump, "Bouncy couch");
+	results = i7_skein_search(skein, "couch");
+	g_assert_cmpuint(g_slist_length(results), ==, 3);
+	g_slist_free(results);
+	i7_skein_remove_all(skein, look);
+	results = i7_skein_search(skein, "couch");
+	g_assert_cmpuint(g_slist_length(results), ==, 1);
+	g_assert(results->data == jump);
+	g_slist_free(results);
+	i7_skein_reset(skein, TRUE);
+	I7Node *sleep = i7_skein_new_command(skein, "sleep");
+	i7_skein_update_after_playing(skein, "You dream of a couch.");
+	results = i7_skein_search(skein, "couch");
+	g_assert_cmpuint(g_slist_length(results), ==, 2);
+	g_assert(g_slist_find(results, sleep));
+	g_slist_free(results);
+
+	g_object_unref(skein);
+}
+
+void
+test_skein_shape(void)
+{
+	I7Skein *skein = i7_skein_new();
+	I7Node *look = i7_skein_new_command(skein, "look");
+	i7_skein_new_command(skein, "x me");
+	i7_skein_new_command(skein, "i");
+	i7_skein_set_played_node(skein, look);
+	i7_skein_new_command(skein, "jump");
+	i7_skein_set_played_node(skein, look);
+	i7_skein_new_command(skein, "wait");
+	i7_skein_reset(skein, TRUE);
+	I7Node *sleep = i7_skein_new_command(skein, "sleep");
+	make_different(sleep);
+	i7_node_set_transcript_text(look, "Living room");
+	i7_node_bless(look);
+
+	I7SkeinShape shape;
+	i7_skein_get_shape(skein, &shape);
+	g_assert_cmpuint(shape.n_knots, ==, 7);
+	g_assert_cmpuint(shape.max_depth, ==, 3);
+	g_assert_cmpuint(shape.max_fanout, ==, 3);
+	g_assert_cmpuint(shape.n_blessed, ==, 2);
+	g_assert_cmpuint(shape.n_differences, ==, 1);
+
+	/* Moving the current knot changes the rows of the Transcript */
+	guint64 inserted = skein_stats_get_count(SKEIN_STATS_ROWS_INSERTED);
+	SkeinStatsTiming before, after;
+	skein_stats_get_timing(SKEIN_STATS_ROW_SIGNALS, &before);
+	i7_skein_set_current_node(skein, look);
+	g_assert_cmpuint(skein_stats_get_count(SKEIN_STATS_ROWS_INSERTED), >, inserted);
+	skein_stats_get_timing(SKEIN_STATS_ROW_SIGNALS, &after);
+	g_assert_cmpuint(after.calls, ==, before.calls + 1);
+
+	g_object_unref(skein);
+}
+
+static void
+count_signal(I7Skein *skein, guint *count)
+{
+	(*count)++;
+}
+
+static void
+record_show_node(I7Skein *skein, guint why, I7Node *node, I7Node **shown)
+{
+	*shown = node;
+}
+
+void
+test_skein_batch(void)
+{
+	I7Skein *skein = i7_skein_new();
+	guint layouts = 0, modifications = 0;
+	I7Node *shown = NULL;
+	g_signal_connect(skein, "needs-layout", G_CALLBACK(count_signal), &layouts);
+	g_signal_connect(skein, "modified", G_CALLBACK(count_signal), &modifications);
+	g_signal_connect(skein, "show-node", G_CALLBACK(record_show_node), &shown);
+
+	i7_skein_begin_changes(skein);
+	i7_skein_begin_changes(skein);
+	int count;
+	I7Node *node = NULL;
+	for(count = 0; count < 100; count++) {
+		char *command = g_strdup_printf("wait %d", count);
+		node = i7_skein_new_command(skein, command);
+		i7_node_set_transcript_text(node, "Time passes.");
+		g_free(command);
+	}
+	i7_skein_bless(skein, node, TRUE);
+	i7_skein_end_changes(skein);
+	/* Nothing is emitted until the outermost batch ends */
+	g_assert_cmpuint(layouts, ==, 0);
+	g_assert(shown == NULL);
+	g_assert(i7_skein_get_modified(skein));
+	i7_skein_end_changes(skein);
+	g_assert_cmpuint(layouts, ==, 1);
+	g_assert_cmpuint(modifications, ==, 1);
+	g_assert(shown == node);
+
+	/* A knot that was asked to be shown and then removed isn't shown */
+	shown = NULL;
+	i7_skein_begin_changes(skein);
+	I7Node *extra = i7_skein_new_command(skein, "jump");
+	i7_skein_remove_all(skein, extra);
+	i7_skein_end_changes(skein);
+	g_assert(shown == NULL);
+	g_assert_cmpuint(layouts, ==, 2);
+
+	/* Loading is not a change, but it doesn't hide a change that the enclosing
+	 batch made before it */
+	GError *err = NULL;
+	char *dir = g_dir_make_tmp("skein-test-XXXXXX", &err);
+	g_assert(err == NULL);
+	char *path = g_build_filename(dir, "Skein.skein", NULL);
+	char *cache_path = g_strconcat(path, "bin", NULL);
+	GFile *file = g_file_new_for_path(path);
+	g_assert(g_file_set_contents(path,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<Skein rootNode=\"root\" xmlns=\"http://www.logicalshift.org.uk/IF/Skein\">\n"
+		"  <item nodeId=\"root\"><command>- start -</command></item>\n"
+		"</Skein>\n", -1, &err));
+	modifications = 0;
+	g_assert(i7_skein_load(skein, file, &err));
+	g_assert(err == NULL);
+	g_assert_cmpuint(modifications, ==, 0);
+	i7_skein_begin_changes(skein);
+	i7_skein_new_command(skein, "xyzzy");
+	g_assert(i7_skein_load(skein, file, &err));
+	g_assert(err == NULL);
+	i7_skein_end_changes(skein);
+	g_assert_cmpuint(modifications, ==, 1);
+
+	g_unlink(cache_path);
+	g_unlink(path);
+	g_rmdir(dir);
+	g_object_unref(file);
+	g_free(cache_path);
+	g_free(path);
+	g_free(dir);
+	g_object_unref(skein);
+}
+
+void
+test_skein_replay_split_transcript(void)
+{
+	char **responses = i7_replay_split_transcript("Intro\n>You see a couch.\n>Taken.\n>\nBye", I7_REPLAY_DEFAULT_PROMPT, 2);
+	g_assert_cmpuint(g_strv_length(responses), ==, 3);
+	g_assert_cmpstr(responses[0], ==, "Intro");
+	g_assert_cmpstr(responses[1], ==, "You see a couch.");
+	g_assert_cmpstr(responses[2], ==, "Taken.");
+	g_strfreev(responses);
+
+	/* The game ends before all the commands are typed */
+	responses = i7_replay_split_transcript("Intro\n>You die.\n*** The End ***", I7_REPLAY_DEFAULT_PROMPT, 3);
+	g_assert_cmpuint(g_strv_length(responses), ==, 4);
+	g_assert_cmpstr(responses[1], ==, "You die.\n*** The End ***");
+	g_assert_cmpstr(responses[2], ==, "");
+	g_assert_cmpstr(responses[3], ==, "");
+	g_strfreev(responses);
+}
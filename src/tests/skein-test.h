@@ -24,6 +24,17 @@
 G_BEGIN_DECLS
 
 void test_skein_import(void);
+void test_skein_current_thread(void);
+void test_skein_interned_text(void);
+void test_skein_wide_knot(void);
+void test_skein_differences(void);
+void test_skein_trim(void);
+void test_skein_cache(void);
+void test_skein_load_unreachable(void);
+void test_skein_search(void);
+void test_skein_shape(void);
+void test_skein_batch(void);
+void test_skein_replay_split_transcript(void);
 
 G_END_DECLS
 
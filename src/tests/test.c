@@ -37,6 +37,17 @@ main(int argc, char **argv)
 	g_test_add_func("/app/colorscheme/get-current", test_app_colorscheme_get_current);
 
 	g_test_add_func("/skein/import", test_skein_import);
+	g_test_add_func("/skein/current-thread", test_skein_current_thread);
+	g_test_add_func("/skein/interned-text", test_skein_interned_text);
+	g_test_add_func("/skein/wide-knot", test_skein_wide_knot);
+	g_test_add_func("/skein/differences", test_skein_differences);
+	g_test_add_func("/skein/trim", test_skein_trim);
+	g_test_add_func("/skein/cache", test_skein_cache);
+	g_test_add_func("/skein/load-unreachable", test_skein_load_unreachable);
+	g_test_add_func("/skein/search", test_skein_search);
+	g_test_add_func("/skein/shape", test_skein_shape);
+	g_test_add_func("/skein/batch", test_skein_batch);
+	g_test_add_func("/skein/replay/split-transcript", test_skein_replay_split_transcript);
 
 	g_test_add_func("/story/util/files-are-siblings", test_files_are_siblings);
 	g_test_add_func("/story/util/files-are-not-siblings", test_files_are_not_siblings);
@@ -17,126 +17,264 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <glib.h>
 #include <sys/types.h>
+#include "transcript-diff.h"
 
-/* Prerequisites for including Gnulib's diffseq algorithm */
+/* A word of a string, as a span of bytes within it; the hash is compared
+ before the bytes, so most unequal words are told apart without a memcmp() */
+typedef struct {
+	guint offset;
+	guint length;
+	guint hash;
+} DiffToken;
+
+/* Everything needed to compare two transcripts. The buffers are kept between
+ comparisons and only grow, so comparing a whole skein's worth of transcripts
+ doesn't allocate memory for each one. */
+struct _DiffContext {
+	const char *expected;
+	const char *actual;
+	DiffToken *expected_tokens;
+	DiffToken *actual_tokens;
+	gsize expected_tokens_allocated;
+	gsize actual_tokens_allocated;
+	ssize_t *work_buffer;
+	gsize work_buffer_allocated;
+	GArray *expected_diffs;
+	GArray *actual_diffs;
+};
+
+static inline gboolean
+is_word_separator(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline gboolean
+tokens_equal(DiffContext *diff, ssize_t x, ssize_t y)
+{
+	const DiffToken *a = diff->expected_tokens + x;
+	const DiffToken *b = diff->actual_tokens + y;
+	return a->hash == b->hash && a->length == b->length
+		&& memcmp(diff->expected + a->offset, diff->actual + b->offset, a->length) == 0;
+}
+
+/* Prerequisites for including Gnulib's diffseq algorithm; the words are
+ compared through the context rather than as a vector of elements */
 #include <limits.h>
 #include <stdbool.h>
-#define ELEMENT char *
-#define EQUAL(a,b) (strcmp((a), (b)) == 0)
+#define XVECREF_YVECREF_EQUAL(ctxt,xoff,yoff) tokens_equal((ctxt)->diff, (xoff), (yoff))
 #define OFFSET ssize_t
 #define EXTRA_CONTEXT_FIELDS \
-	GList *expected_diffs; \
-	GList *actual_diffs;
+	DiffContext *diff;
 #define NOTE_DELETE(ctxt,xoff) \
 	G_STMT_START { \
-		if(*(xv[(xoff)]) != '\0') { \
-			(ctxt)->expected_diffs = g_list_prepend((ctxt)->expected_diffs, GSIZE_TO_POINTER((xoff))); \
-		} \
+		guint index = (xoff); \
+		g_array_append_val((ctxt)->diff->expected_diffs, index); \
 	} G_STMT_END
 #define NOTE_INSERT(ctxt,yoff) \
 	G_STMT_START { \
-		if(*(yv[(yoff)]) != '\0') { \
-			(ctxt)->actual_diffs = g_list_prepend((ctxt)->actual_diffs, GSIZE_TO_POINTER((yoff))); \
-		} \
+		guint index = (yoff); \
+		g_array_append_val((ctxt)->diff->actual_diffs, index); \
 	} G_STMT_END
 #define USE_HEURISTIC
 #define lint /* To suppress GCC warnings */
 
 #include "diffseq.h"
 
+/* Split @string into words in place, storing their spans in @tokens, which is
+ grown if necessary. Returns the number of words. */
+static gsize
+tokenize(const char *string, DiffToken **tokens, gsize *allocated)
+{
+	const char *p = string;
+	gsize count = 0;
+
+	while(*p) {
+		while(is_word_separator(*p))
+			p++;
+		if(*p == '\0')
+			break;
+
+		/* FNV-1a hash of the word */
+		const char *start = p;
+		guint hash = 2166136261u;
+		while(*p && !is_word_separator(*p))
+			hash = (hash ^ (guchar)*p++) * 16777619u;
+
+		if(count == *allocated) {
+			*allocated = MAX(64, *allocated * 2);
+			*tokens = g_renew(DiffToken, *tokens, *allocated);
+		}
+		(*tokens)[count].offset = start - string;
+		(*tokens)[count].length = p - start;
+		(*tokens)[count].hash = hash;
+		count++;
+	}
+	return count;
+}
+
+/* Copy the word indices collected in @diffs into an array of exactly the right
+ size, or return NULL if there are none */
+static GArray *
+copy_diffs(GArray *diffs)
+{
+	GArray *retval;
+
+	if(diffs->len == 0)
+		return NULL;
+	retval = g_array_sized_new(FALSE, FALSE, sizeof(guint), diffs->len);
+	g_array_append_vals(retval, diffs->data, diffs->len);
+	return retval;
+}
+
 /*
- * word_diff:
+ * diff_context_new:
+ *
+ * Creates a context for comparing transcripts with diff_context_compare(). A
+ * context may only be used by one thread at a time.
+ *
+ * Returns: a new #DiffContext; free with diff_context_free().
+ */
+DiffContext *
+diff_context_new(void)
+{
+	DiffContext *ctxt = g_slice_new0(DiffContext);
+	ctxt->expected_diffs = g_array_new(FALSE, FALSE, sizeof(guint));
+	ctxt->actual_diffs = g_array_new(FALSE, FALSE, sizeof(guint));
+	return ctxt;
+}
+
+void
+diff_context_free(DiffContext *ctxt)
+{
+	g_free(ctxt->expected_tokens);
+	g_free(ctxt->actual_tokens);
+	g_free(ctxt->work_buffer);
+	g_array_free(ctxt->expected_diffs, TRUE);
+	g_array_free(ctxt->actual_diffs, TRUE);
+	g_slice_free(DiffContext, ctxt);
+}
+
+/*
+ * diff_context_compare:
+ * @ctxt: a #DiffContext
+ * @expected: the expected text
+ * @actual: the actual text
+ * @expected_diffs: return location for the indices of the words in @expected
+ * that are different in @actual
+ * @actual_diffs: likewise for @actual
+ *
  * Compares strings @expected and @actual for approximate equality. Returns TRUE
- * if they are _exactly_ equal, FALSE if not. @expected_diffs and @actual_diffs
- * are the return locations for lists of word indices that are different in
- * @expected and @actual. The indices are stored using GSIZE_TO_POINTER().
- * If the function returns FALSE but NULL (the empty list) is returned in
- * @expected_diffs and @actual_diffs, then all the words are the same and
- * therefore the strings only differ by whitespace.
- * You should free the lists when done.
+ * if they are _exactly_ equal, FALSE if not. The word indices are returned as
+ * arrays of guint in ascending order, or NULL if there are no different words;
+ * if the function returns FALSE but both arrays are NULL, then all the words
+ * are the same and therefore the strings only differ by whitespace.
+ * Free the arrays with g_array_free() when done.
  */
 gboolean
-word_diff(const char *expected, const char *actual, GList **expected_diffs, GList **actual_diffs)
+diff_context_compare(DiffContext *ctxt, const char *expected, const char *actual, GArray **expected_diffs, GArray **actual_diffs)
 {
+	*expected_diffs = *actual_diffs = NULL;
+
 	/* If strings are exactly the same, we have our answer */
 	if(strcmp(expected, actual) == 0)
 		return TRUE;
 
-	char **expected_words = g_strsplit_set(expected, " \n\r\t", -1);
-	char **actual_words = g_strsplit_set(actual, " \n\r\t", -1);
-	ssize_t expected_limit = 0;
-	ssize_t actual_limit = 0;
-	ssize_t *work_buffer;
-	struct context ctxt;
-	char **iter;
+	ssize_t expected_limit = tokenize(expected, &ctxt->expected_tokens, &ctxt->expected_tokens_allocated);
+	ssize_t actual_limit = tokenize(actual, &ctxt->actual_tokens, &ctxt->actual_tokens_allocated);
+	ssize_t diags = expected_limit + actual_limit + 3;
+	struct context diffseq_ctxt;
+	ssize_t count;
 
-	/* Find lengths of word vectors */
-	for(iter = expected_words; *iter; iter++)
-		expected_limit++;
-	for(iter = actual_words; *iter; iter++)
-		actual_limit++;
+	/* Grow the work buffer if necessary */
+	if(2 * diags > ctxt->work_buffer_allocated) {
+		g_free(ctxt->work_buffer);
+		ctxt->work_buffer_allocated = 2 * diags;
+		ctxt->work_buffer = g_new(ssize_t, ctxt->work_buffer_allocated);
+	}
 
-	/* Allocate a work buffer */
-	work_buffer = g_new0(ssize_t, 2 * (expected_limit + actual_limit + 3));
+	ctxt->expected = expected;
+	ctxt->actual = actual;
+	g_array_set_size(ctxt->expected_diffs, 0);
+	g_array_set_size(ctxt->actual_diffs, 0);
 
 	/* Call the Gnulib diff algorithm */
-	ctxt.xvec = expected_words; /* char * const * */
-	ctxt.yvec = actual_words;
-	ctxt.fdiag = work_buffer + actual_limit + 1;
-	ctxt.bdiag = work_buffer + expected_limit + actual_limit + 3;
-	ctxt.expected_diffs = *expected_diffs;
-	ctxt.actual_diffs = *actual_diffs;
-	ctxt.heuristic = TRUE;
-	compareseq(0, expected_limit, 0, actual_limit, FALSE, &ctxt);
-
-	g_strfreev(expected_words);
-	g_strfreev(actual_words);
-	g_free(work_buffer);
-
-	*expected_diffs = g_list_reverse(ctxt.expected_diffs);
-	*actual_diffs = g_list_reverse(ctxt.actual_diffs);
+	diffseq_ctxt.diff = ctxt;
+	diffseq_ctxt.fdiag = ctxt->work_buffer + actual_limit + 1;
+	diffseq_ctxt.bdiag = ctxt->work_buffer + diags + actual_limit + 1;
+	diffseq_ctxt.heuristic = TRUE;
+	/* Same limit on the cost of the edit script as GNU diff uses */
+	diffseq_ctxt.too_expensive = 1;
+	for(count = diags; count != 0; count >>= 2)
+		diffseq_ctxt.too_expensive <<= 1;
+	diffseq_ctxt.too_expensive = MAX(4096, diffseq_ctxt.too_expensive);
+	compareseq(0, expected_limit, 0, actual_limit, FALSE, &diffseq_ctxt);
+
+	*expected_diffs = copy_diffs(ctxt->expected_diffs);
+	*actual_diffs = copy_diffs(ctxt->actual_diffs);
 
 	return FALSE;
 }
 
+static void
+free_default_context(DiffContext *ctxt)
+{
+	if(ctxt)
+		diff_context_free(ctxt);
+}
+
+static GPrivate default_context = G_PRIVATE_INIT((GDestroyNotify)free_default_context);
+
+/*
+ * word_diff:
+ * Like diff_context_compare(), using a context belonging to the calling
+ * thread.
+ */
+gboolean
+word_diff(const char *expected, const char *actual, GArray **expected_diffs, GArray **actual_diffs)
+{
+	DiffContext *ctxt = g_private_get(&default_context);
+	if(ctxt == NULL) {
+		ctxt = diff_context_new();
+		g_private_set(&default_context, ctxt);
+	}
+	return diff_context_compare(ctxt, expected, actual, expected_diffs, actual_diffs);
+}
+
 char *
-make_pango_markup_string(const char *string, GList *diffs)
+make_pango_markup_string(const char *string, GArray *diffs)
 {
 	if(diffs == NULL)
-		return g_strdup(string);
+		return g_markup_escape_text(string, -1);
 
-	char **words = g_strsplit_set(string, " \n\r\t", -1);
-	char **word;
-	ssize_t count;
-	GString *result = g_string_new("");
+	GString *result = g_string_sized_new(strlen(string) + 7 * diffs->len);
+	const char *p = string, *start;
+	guint word = 0, next_diff = 0;
 
-	for(word = words, count = 0; *word; word++, count++) {
+	while(*p) {
 		/* Copy whitespace */
-		while(isspace(*string))
-			g_string_append_c(result, *string++);
+		for(start = p; is_word_separator(*p); p++)
+			;
+		g_string_append_len(result, start, p - start);
+		if(*p == '\0')
+			break;
 
-		char *escaped_word = g_markup_escape_text(*word, -1);
+		for(start = p; *p && !is_word_separator(*p); p++)
+			;
+		char *escaped_word = g_markup_escape_text(start, p - start);
 
-		if(diffs && count == (ssize_t)(GPOINTER_TO_SIZE(diffs->data))) {
-			diffs = g_list_next(diffs);
+		if(next_diff < diffs->len && g_array_index(diffs, guint, next_diff) == word) {
+			next_diff++;
 			g_string_append_printf(result, "<u>%s</u>", escaped_word);
 		} else {
 			g_string_append(result, escaped_word);
 		}
 
 		g_free(escaped_word);
-
-		string += strlen(*word);
+		word++;
 	}
 
-	g_strfreev(words);
-
-	/* Copy final whitespace */
-	while(isspace(*string))
-		g_string_append_c(result, *string++);
-
 	return g_string_free(result, FALSE); /* return C-string */
-}
\ No newline at end of file
+}
@@ -14,7 +14,17 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#ifndef TRANSCRIPT_DIFF_H
+#define TRANSCRIPT_DIFF_H
+
 #include <glib.h>
 
-gboolean word_diff(const char *expected, const char *actual, GList **expected_diffs, GList **actual_diffs);
-char *make_pango_markup_string(const char *string, GList *diffs);
+typedef struct _DiffContext DiffContext;
+
+DiffContext *diff_context_new(void);
+void diff_context_free(DiffContext *ctxt);
+gboolean diff_context_compare(DiffContext *ctxt, const char *expected, const char *actual, GArray **expected_diffs, GArray **actual_diffs);
+gboolean word_diff(const char *expected, const char *actual, GArray **expected_diffs, GArray **actual_diffs);
+char *make_pango_markup_string(const char *string, GArray *diffs);
+
+#endif /* TRANSCRIPT_DIFF_H */
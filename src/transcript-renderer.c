@@ -65,6 +65,35 @@ static Color colors[] = {
 	{ 1.0, 1.0, 0.7 }  /* ACTIVE */
 };
 
+/* How long to spend measuring rows in the background before letting the main
+ loop run again, in microseconds */
+#define MEASURE_TIME_SLICE 20000
+
+/* Size of a knot's text, stored on the knot; valid only for the text version,
+ width and font that it was measured with */
+typedef struct {
+	guint text_version;
+	unsigned text_width; /* Width available to the transcript and expected text */
+	guint font; /* Hash of the font description */
+	gboolean estimated; /* Guessed from the length of the text, not measured yet */
+	gboolean queued; /* Waiting to be measured in the background */
+	int command_height;
+	int text_height; /* Height of the taller of the transcript and expected text */
+} CachedSize;
+
+/* A row whose size was estimated, and the text that needs to be measured */
+typedef struct {
+	GObject *node;
+	guint text_version;
+	unsigned text_width;
+	guint font;
+	char *command;
+	char *transcript_text;
+	char *expected_text;
+} PendingMeasurement;
+
+static GQuark cached_size_quark = 0;
+
 /* The private properties are the non-persistent renderer state; any call to 
 i7_cell_renderer_transcript_render() must yield a cell of the same size for 
 the same values of these properties */
@@ -85,11 +114,44 @@ struct _I7CellRendererTranscriptPrivate
 	gboolean current;
 	gboolean played;
 	gboolean changed;
+	/* The knot being rendered, on which its size is cached, and the version of
+	 its text; if there is no knot, the size is measured every time */
+	GObject *node;
+	guint text_version;
+
+	/* Layouts shared between get_size() and render(), and which text, width
+	 and font they were last filled with */
+	GtkWidget *layout_widget;
+	PangoLayout *command_layout;
+	PangoLayout *transcript_layout;
+	PangoLayout *expected_layout;
+	gboolean layouts_filled;
+	guint layout_version;
+	unsigned layout_width;
+	guint layout_font;
+	CachedSize scratch_size; /* For rendering without a knot */
+
+	/* Font metrics for estimating the height of rows not measured yet */
+	guint metrics_font;
+	int line_height;
+	int char_width;
+
+	/* Rows waiting to be measured in the background */
+	GQueue *pending;
+	guint measure_source;
+	gboolean heights_changed;
 };
 
 #define I7_CELL_RENDERER_TRANSCRIPT_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE((o), I7_TYPE_CELL_RENDERER_TRANSCRIPT, I7CellRendererTranscriptPrivate))
 #define I7_CELL_RENDERER_TRANSCRIPT_USE_PRIVATE I7CellRendererTranscriptPrivate *priv = I7_CELL_RENDERER_TRANSCRIPT_PRIVATE(self)
 
+enum {
+	HEIGHTS_CHANGED,
+	LAST_SIGNAL
+};
+
+static guint i7_cell_renderer_transcript_signals[LAST_SIGNAL] = { 0 };
+
 enum  {
 	PROP_0,
 	PROP_DEFAULT_WIDTH,
@@ -100,7 +162,9 @@ enum  {
 	PROP_MATCH_TYPE,
 	PROP_CURRENT,
 	PROP_PLAYED,
-	PROP_CHANGED
+	PROP_CHANGED,
+	PROP_NODE,
+	PROP_TEXT_VERSION
 };
 
 G_DEFINE_TYPE(I7CellRendererTranscript, i7_cell_renderer_transcript, GTK_TYPE_CELL_RENDERER);
@@ -121,6 +185,9 @@ i7_cell_renderer_transcript_init(I7CellRendererTranscript *self)
 	priv->current = FALSE;
 	priv->played = FALSE;
 	priv->changed = FALSE;
+	priv->node = NULL;
+	priv->text_version = 0;
+	priv->pending = g_queue_new();
 }
 
 static void 
@@ -167,6 +234,16 @@ i7_cell_renderer_transcript_set_property(GObject *self, unsigned prop_id, const
 			priv->changed = g_value_get_boolean(value);
 			g_object_notify(self, "changed");
 			break;
+		case PROP_NODE:
+			if(priv->node)
+				g_object_unref(priv->node);
+			priv->node = g_value_dup_object(value);
+			g_object_notify(self, "node");
+			break;
+		case PROP_TEXT_VERSION:
+			priv->text_version = g_value_get_uint(value);
+			g_object_notify(self, "text-version");
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(self, prop_id, pspec);
 	}
@@ -204,11 +281,43 @@ i7_cell_renderer_transcript_get_property(GObject *self, guint prop_id, GValue *v
 		case PROP_CHANGED:
 			g_value_set_boolean(value, priv->changed);
 			break;
+		case PROP_NODE:
+			g_value_set_object(value, priv->node);
+			break;
+		case PROP_TEXT_VERSION:
+			g_value_set_uint(value, priv->text_version);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(self, prop_id, pspec);
 	}
 }
 
+static void
+pending_measurement_free(PendingMeasurement *item)
+{
+	g_object_unref(item->node);
+	g_free(item->command);
+	g_free(item->transcript_text);
+	g_free(item->expected_text);
+	g_slice_free(PendingMeasurement, item);
+}
+
+static void
+free_layouts(I7CellRendererTranscriptPrivate *priv)
+{
+	if(priv->layout_widget) {
+		g_object_remove_weak_pointer(G_OBJECT(priv->layout_widget), (gpointer *)&priv->layout_widget);
+		priv->layout_widget = NULL;
+	}
+	if(priv->command_layout) {
+		g_object_unref(priv->command_layout);
+		g_object_unref(priv->transcript_layout);
+		g_object_unref(priv->expected_layout);
+		priv->command_layout = priv->transcript_layout = priv->expected_layout = NULL;
+	}
+	priv->layouts_filled = FALSE;
+}
+
 static void 
 i7_cell_renderer_transcript_finalize(GObject* self) 
 {
@@ -217,44 +326,253 @@ i7_cell_renderer_transcript_finalize(GObject* self)
 	g_free(priv->command);
 	g_free(priv->transcript_text);
 	g_free(priv->expected_text);
+	if(priv->node)
+		g_object_unref(priv->node);
+	if(priv->measure_source)
+		g_source_remove(priv->measure_source);
+	g_queue_foreach(priv->pending, (GFunc)pending_measurement_free, NULL);
+	g_queue_free(priv->pending);
+	free_layouts(priv);
 	
 	G_OBJECT_CLASS(i7_cell_renderer_transcript_parent_class)->finalize(self);
 }
 
+static guint
+get_font_hash(GtkWidget *widget)
+{
+	return pango_font_description_hash(gtk_widget_get_style(widget)->font_desc);
+}
+
+/* Make sure there are layouts for @widget in its current font */
+static void
+ensure_layouts(I7CellRendererTranscriptPrivate *priv, GtkWidget *widget, guint font)
+{
+	if(priv->layout_widget == widget && priv->layout_font == font)
+		return;
+
+	free_layouts(priv);
+	priv->layout_widget = widget;
+	g_object_add_weak_pointer(G_OBJECT(widget), (gpointer *)&priv->layout_widget);
+	priv->layout_font = font;
+	priv->command_layout = gtk_widget_create_pango_layout(widget, NULL);
+	priv->transcript_layout = gtk_widget_create_pango_layout(widget, NULL);
+	pango_layout_set_wrap(priv->transcript_layout, PANGO_WRAP_WORD_CHAR);
+	priv->expected_layout = gtk_widget_create_pango_layout(widget, NULL);
+	pango_layout_set_wrap(priv->expected_layout, PANGO_WRAP_WORD_CHAR);
+}
+
+/* Put the text into the layouts, unless they already hold it, and measure it */
+static void
+fill_layouts(I7CellRendererTranscriptPrivate *priv, guint text_version, unsigned text_width, const char *command, const char *transcript_text, const char *expected_text, CachedSize *size)
+{
+	/* Version 0 means the text didn't come from a knot */
+	if(!(priv->layouts_filled && text_version != 0 && priv->layout_version == text_version && priv->layout_width == text_width)) {
+		int wrap_width = (int)(text_width - priv->text_padding * 2) * PANGO_SCALE;
+		pango_layout_set_text(priv->command_layout, command? command : "", -1);
+		pango_layout_set_markup(priv->transcript_layout, transcript_text? transcript_text : "", -1);
+		pango_layout_set_width(priv->transcript_layout, wrap_width);
+		pango_layout_set_markup(priv->expected_layout, expected_text? expected_text : "", -1);
+		pango_layout_set_width(priv->expected_layout, wrap_width);
+		priv->layouts_filled = TRUE;
+		priv->layout_version = text_version;
+		priv->layout_width = text_width;
+	}
+
+	if(size == NULL)
+		return;
+
+	PangoRectangle command_rect, transcript_rect, expected_rect;
+	pango_layout_get_pixel_extents(priv->command_layout, NULL, &command_rect);
+	pango_layout_get_pixel_extents(priv->transcript_layout, NULL, &transcript_rect);
+	pango_layout_get_pixel_extents(priv->expected_layout, NULL, &expected_rect);
+	size->command_height = command_rect.height;
+	size->text_height = MAX(transcript_rect.height, expected_rect.height);
+	size->text_version = text_version;
+	size->text_width = text_width;
+	size->font = priv->layout_font;
+	size->estimated = FALSE;
+}
+
+/* Count the lines that @markup will probably take up when wrapped at
+ @chars_per_line characters, skipping the tags */
+static int
+estimate_lines(const char *markup, int chars_per_line)
+{
+	int lines = 0, column = 0;
+	gboolean in_tag = FALSE;
+	const char *ptr;
+
+	if(markup == NULL)
+		return 1;
+
+	for(ptr = markup; ; ptr++) {
+		if(*ptr == '\n' || *ptr == '\0') {
+			lines += (column == 0)? 1 : (column - 1) / chars_per_line + 1;
+			column = 0;
+			if(*ptr == '\0')
+				break;
+		} else if(*ptr == '<')
+			in_tag = TRUE;
+		else if(*ptr == '>')
+			in_tag = FALSE;
+		else if(!in_tag && (*ptr & 0xC0) != 0x80) /* Count UTF-8 characters */
+			column++;
+	}
+	return lines;
+}
+
+static void
+estimate_size(I7CellRendererTranscriptPrivate *priv, GtkWidget *widget, guint font, unsigned text_width, CachedSize *size)
+{
+	if(priv->metrics_font != font || priv->line_height == 0) {
+		PangoFontMetrics *metrics = pango_context_get_metrics(gtk_widget_get_pango_context(widget), gtk_widget_get_style(widget)->font_desc, NULL);
+		priv->line_height = MAX(1, PANGO_PIXELS(pango_font_metrics_get_ascent(metrics) + pango_font_metrics_get_descent(metrics)));
+		priv->char_width = MAX(1, PANGO_PIXELS(pango_font_metrics_get_approximate_char_width(metrics)));
+		pango_font_metrics_unref(metrics);
+		priv->metrics_font = font;
+	}
+
+	int chars_per_line = MAX(1, ((int)text_width - (int)priv->text_padding * 2) / priv->char_width);
+	size->command_height = estimate_lines(priv->command, G_MAXINT) * priv->line_height;
+	size->text_height = MAX(estimate_lines(priv->transcript_text, chars_per_line), estimate_lines(priv->expected_text, chars_per_line)) * priv->line_height;
+	size->text_version = priv->text_version;
+	size->text_width = text_width;
+	size->font = font;
+	size->estimated = TRUE;
+}
+
+/* Idle callback: measure the rows whose height was estimated, a slice of time
+ at a time, and tell the view to fetch their heights again when done */
+static gboolean
+measure_pending(I7CellRendererTranscript *self)
+{
+	I7_CELL_RENDERER_TRANSCRIPT_USE_PRIVATE;
+	gint64 deadline = g_get_monotonic_time() + MEASURE_TIME_SLICE;
+	PendingMeasurement *item;
+
+	while(g_get_monotonic_time() < deadline && (item = g_queue_pop_head(priv->pending)) != NULL) {
+		CachedSize *size = g_object_get_qdata(item->node, cached_size_quark);
+		/* Skip rows that changed or were measured while they waited; also stop
+		 if the widget went away or changed its font */
+		if(size && size->estimated && priv->layout_widget && priv->layout_font == item->font
+			&& size->font == item->font && size->text_version == item->text_version && size->text_width == item->text_width) {
+			int estimated_height = size->command_height + size->text_height;
+			fill_layouts(priv, item->text_version, item->text_width, item->command, item->transcript_text, item->expected_text, size);
+			if(size->command_height + size->text_height != estimated_height)
+				priv->heights_changed = TRUE;
+		}
+		if(size)
+			size->queued = FALSE;
+		pending_measurement_free(item);
+	}
+
+	if(!g_queue_is_empty(priv->pending))
+		return TRUE; /* Call again */
+
+	priv->measure_source = 0;
+	if(priv->heights_changed) {
+		priv->heights_changed = FALSE;
+		g_signal_emit(self, i7_cell_renderer_transcript_signals[HEIGHTS_CHANGED], 0);
+	}
+	return FALSE;
+}
+
+static void
+schedule_measuring(I7CellRendererTranscript *self)
+{
+	I7_CELL_RENDERER_TRANSCRIPT_USE_PRIVATE;
+	if(priv->measure_source == 0)
+		priv->measure_source = g_idle_add((GSourceFunc)measure_pending, self);
+}
+
+static void
+queue_measurement(I7CellRendererTranscript *self, CachedSize *size)
+{
+	I7_CELL_RENDERER_TRANSCRIPT_USE_PRIVATE;
+
+	if(size->queued)
+		return;
+	size->queued = TRUE;
+
+	PendingMeasurement *item = g_slice_new(PendingMeasurement);
+	item->node = g_object_ref(priv->node);
+	item->text_version = size->text_version;
+	item->text_width = size->text_width;
+	item->font = size->font;
+	item->command = g_strdup(priv->command);
+	item->transcript_text = g_strdup(priv->transcript_text);
+	item->expected_text = g_strdup(priv->expected_text);
+	g_queue_push_tail(priv->pending, item);
+	schedule_measuring(self);
+}
+
+static void
+cached_size_free(CachedSize *size)
+{
+	g_slice_free(CachedSize, size);
+}
+
+/* Look up the size of the row currently in the renderer's properties. Rows
+ that were never measured at this width and font get an estimated size, and
+ are measured later in the background, unless @exact is TRUE. A row whose text
+ changed since it was measured is always measured again right away, since it
+ is probably on screen. */
+static CachedSize *
+get_row_size(I7CellRendererTranscript *self, GtkWidget *widget, unsigned text_width, gboolean exact)
+{
+	I7_CELL_RENDERER_TRANSCRIPT_USE_PRIVATE;
+	guint font = get_font_hash(widget);
+
+	if(priv->node == NULL) {
+		ensure_layouts(priv, widget, font);
+		fill_layouts(priv, 0, text_width, priv->command, priv->transcript_text, priv->expected_text, &priv->scratch_size);
+		return &priv->scratch_size;
+	}
+
+	CachedSize *size = g_object_get_qdata(priv->node, cached_size_quark);
+	if(size == NULL) {
+		size = g_slice_new0(CachedSize);
+		g_object_set_qdata_full(priv->node, cached_size_quark, size, (GDestroyNotify)cached_size_free);
+	}
+
+	gboolean same_size = (size->text_width == text_width && size->font == font);
+	gboolean same_text = (size->text_version == priv->text_version);
+	if(same_size && same_text && !(exact && size->estimated))
+		return size;
+
+	ensure_layouts(priv, widget, font);
+	if(!exact && !(same_size && !same_text)) {
+		estimate_size(priv, widget, font, text_width, size);
+		queue_measurement(self, size);
+		return size;
+	}
+
+	int old_height = size->command_height + size->text_height;
+	gboolean was_estimated = size->estimated;
+	fill_layouts(priv, priv->text_version, text_width, priv->command, priv->transcript_text, priv->expected_text, size);
+	/* The view already made room for the estimated height */
+	if(was_estimated && old_height != size->command_height + size->text_height) {
+		priv->heights_changed = TRUE;
+		schedule_measuring(self);
+	}
+	return size;
+}
+
 static void 
 i7_cell_renderer_transcript_get_size(GtkCellRenderer *self, GtkWidget *widget, GdkRectangle *cell_area, int *x_offset, int *y_offset, int *width, int *height) 
 {
 	I7_CELL_RENDERER_TRANSCRIPT_USE_PRIVATE;
 
-	PangoRectangle command_rect, transcript_rect, expected_rect;
-	PangoLayout *layout;
 	unsigned xpad, ypad, transcript_width, calc_width, calc_height;
 	
 	g_object_get(self, "xpad", &xpad, "ypad", &ypad, NULL);
 	transcript_width = (priv->default_width / 2) - xpad;
 
-	/* Get size of command */
-	layout = gtk_widget_create_pango_layout(widget, priv->command);
-	pango_layout_get_pixel_extents(layout, NULL, &command_rect);
-	g_object_unref(layout);
-
-	/* Get size of transcript text */
-	layout = gtk_widget_create_pango_layout(widget, priv->transcript_text);
-	pango_layout_set_width(layout, (int)(transcript_width - priv->text_padding * 2) * PANGO_SCALE);
-	pango_layout_set_wrap(layout, PANGO_WRAP_WORD_CHAR);
-	pango_layout_get_pixel_extents(layout, NULL, &transcript_rect);
-	g_object_unref(layout);
-
-	/* Get size of expected text */
-	layout = gtk_widget_create_pango_layout(widget, priv->expected_text);
-	pango_layout_set_width(layout, (int)(transcript_width - priv->text_padding * 2) * PANGO_SCALE);
-	pango_layout_set_wrap(layout, PANGO_WRAP_WORD_CHAR);
-	pango_layout_get_pixel_extents(layout, NULL, &expected_rect);
-	g_object_unref (layout);
+	CachedSize *size = get_row_size(I7_CELL_RENDERER_TRANSCRIPT(self), widget, transcript_width, FALSE);
 
 	/* Calculate the required width and height for the cell */
 	calc_width = priv->default_width;
-	calc_height = (unsigned)(command_rect.height + MAX(transcript_rect.height, expected_rect.height)) + ypad * 2 + priv->text_padding * 4;
+	calc_height = (unsigned)(size->command_height + size->text_height) + ypad * 2 + priv->text_padding * 4;
 
 	/* Set the passed-in parameters; if the available cell area is larger than
 	 the required width and height, just use that instead */
@@ -292,11 +610,18 @@ i7_cell_renderer_transcript_render(GtkCellRenderer *self, GdkWindow *window, Gtk
 	GtkStateType state;
 	cairo_t *cr;
 	PangoRectangle command_rect;
-	PangoLayout *layout;
 	GtkStyle *style = gtk_widget_get_style(widget);
 
-	/* Get the size we calculated earlier and then take the padding into account */
+	/* A row on screen must be measured properly even if its height was only
+	 estimated so far; this also leaves its text in the layouts */
 	g_object_get(self, "xpad", &xpad, "ypad", &ypad, NULL);
+	transcript_width = priv->default_width / 2 - xpad;
+	CachedSize *size = get_row_size(I7_CELL_RENDERER_TRANSCRIPT(self), widget, transcript_width, TRUE);
+	ensure_layouts(priv, widget, get_font_hash(widget));
+	fill_layouts(priv, priv->node? priv->text_version : 0, transcript_width, priv->command, priv->transcript_text, priv->expected_text, NULL);
+	command_rect.height = size->command_height;
+
+	/* Get the size we calculated earlier and then take the padding into account */
 	gtk_cell_renderer_get_size(self, widget, cell_area, &x, &y, &width, &height);
 	x += cell_area->x + (int)xpad;
 	y += cell_area->y + (int)ypad;
@@ -320,20 +645,15 @@ i7_cell_renderer_transcript_render(GtkCellRenderer *self, GdkWindow *window, Gtk
 	cr = gdk_cairo_create(GDK_DRAWABLE(window));
 
 	/* Draw the command */
-	layout = gtk_widget_create_pango_layout(widget, priv->command);
-	pango_layout_get_pixel_extents(layout, NULL, &command_rect);
-
 	set_rgb_style(cr, STYLE_COMMAND);
 	cairo_rectangle(cr, (double)x, (double)y, 
 	    (double)width, (double)(command_rect.height + priv->text_padding * 2));
 	cairo_fill(cr);
 	gtk_paint_layout(style, window, state, TRUE, cell_area, widget, NULL, 
 	    	x + priv->text_padding, y + priv->text_padding, 
-	    	layout);
-	g_object_unref(layout);
+	    	priv->command_layout);
 
 	/* Draw the transcript text */
-	transcript_width = priv->default_width / 2 - xpad;
 	if(priv->changed)
 		set_rgb_style(cr, STYLE_CHANGED);
 	else
@@ -345,15 +665,10 @@ i7_cell_renderer_transcript_render(GtkCellRenderer *self, GdkWindow *window, Gtk
 	    (double)(width / 2), 
 	    (double)(height - command_rect.height - priv->text_padding * 2));
 	cairo_fill(cr);
-	layout = gtk_widget_create_pango_layout(widget, NULL);
-	pango_layout_set_markup(layout, priv->transcript_text, -1);
-	pango_layout_set_width(layout, (int)(transcript_width - priv->text_padding * 2) * PANGO_SCALE);
-	pango_layout_set_wrap(layout, PANGO_WRAP_WORD_CHAR);
 	gtk_paint_layout(style, window, state, TRUE, cell_area, widget, NULL, 
 	    x + (int)priv->text_padding, 
 	    y + command_rect.height + (int)priv->text_padding * 3, 
-		layout);
-	g_object_unref(layout);
+		priv->transcript_layout);
 	
 	/* Draw the expected text */
 	switch(priv->match_type) {
@@ -378,15 +693,10 @@ i7_cell_renderer_transcript_render(GtkCellRenderer *self, GdkWindow *window, Gtk
 	    (double)(width / 2), 
 	    (double)(height - command_rect.height - priv->text_padding * 2));
 	cairo_fill(cr);
-	layout = gtk_widget_create_pango_layout(widget, NULL);
-	pango_layout_set_markup(layout, priv->expected_text, -1);
-	pango_layout_set_width(layout, (int)(transcript_width - priv->text_padding * 2) * PANGO_SCALE);
-	pango_layout_set_wrap(layout, PANGO_WRAP_WORD_CHAR);
 	gtk_paint_layout(style, window, state, TRUE, cell_area, widget, NULL,
 	    x + width / 2 + (int)priv->text_padding, 
 	    y + command_rect.height + (int)priv->text_padding * 3, 
-		layout);
-	g_object_unref(layout);
+		priv->expected_layout);
 
 	/* Draw some lines */
 	gtk_paint_hline(style, window, state, cell_area, widget, NULL, 
@@ -466,6 +776,28 @@ i7_cell_renderer_transcript_class_init(I7CellRendererTranscriptClass *klass)
 	    g_param_spec_boolean("changed", _("Changed"),
 		    _("Whether to render the node as having been changed since it was last played"),
 		    FALSE, G_PARAM_READWRITE | flags));
+	g_object_class_install_property(object_class, PROP_NODE,
+	    g_param_spec_object("node", _("Node"),
+		    _("The node being rendered, on which its size is cached"),
+		    G_TYPE_OBJECT, G_PARAM_READWRITE | flags));
+	g_object_class_install_property(object_class, PROP_TEXT_VERSION,
+	    g_param_spec_uint("text-version", _("Text version"),
+		    _("Number that changes whenever the node's text does"),
+		    0, G_MAXUINT, 0, G_PARAM_READWRITE | flags));
+
+	/*
+	 * I7CellRendererTranscript::heights-changed:
+	 * @renderer: the renderer that received the signal
+	 *
+	 * Emitted when rows whose height was only estimated have been measured in
+	 * the background, and some turned out a different height; the view should
+	 * ask for the row sizes again.
+	 */
+	i7_cell_renderer_transcript_signals[HEIGHTS_CHANGED] = g_signal_new("heights-changed",
+		G_OBJECT_CLASS_TYPE(klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+		g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+	cached_size_quark = g_quark_from_static_string("i7-cell-renderer-transcript-size");
 	
 	/* Add private data */
 	g_type_class_add_private (klass, sizeof (I7CellRendererTranscriptPrivate));